@@ -968,9 +968,27 @@ bool radix_tree_lookup(struct radix_tree *rt,
 }
 
 // FIXME: build up the keys too
+// node4 and node16 keep their keys in insertion order, so work out
+// the lexicographical visiting order before descending.
+static void _sort_keys(const uint8_t *keys, unsigned nr, uint8_t *order)
+{
+	unsigned i, j;
+	uint8_t tmp;
+
+	for (i = 0; i < nr; i++) {
+		order[i] = i;
+		for (j = i; j && keys[order[j - 1]] > keys[order[j]]; j--) {
+			tmp = order[j];
+			order[j] = order[j - 1];
+			order[j - 1] = tmp;
+		}
+	}
+}
+
 static bool _iterate(struct value *v, struct radix_tree_iterator *it)
 {
 	unsigned i;
+	uint8_t order[16];
 	struct value_chain *vc;
 	struct prefix_chain *pc;
 	struct node4 *n4;
@@ -996,22 +1014,24 @@ static bool _iterate(struct value *v, struct radix_tree_iterator *it)
 
 	case NODE4:
 		n4 = (struct node4 *) v->value.ptr;
+		_sort_keys(n4->keys, n4->nr_entries, order);
 		for (i = 0; i < n4->nr_entries; i++)
-			if (!_iterate(n4->values + i, it))
+			if (!_iterate(n4->values + order[i], it))
         			return false;
         	return true;
 
 	case NODE16:
 		n16 = (struct node16 *) v->value.ptr;
+		_sort_keys(n16->keys, n16->nr_entries, order);
 		for (i = 0; i < n16->nr_entries; i++)
-        		if (!_iterate(n16->values + i, it))
+        		if (!_iterate(n16->values + order[i], it))
         			return false;
 		return true;
 
 	case NODE48:
 		n48 = (struct node48 *) v->value.ptr;
-		for (i = 0; i < n48->nr_entries; i++)
-        		if (!_iterate(n48->values + i, it))
+		for (i = 0; i < 256; i++)
+        		if (n48->keys[i] < 48 && !_iterate(n48->values + n48->keys[i], it))
         			return false;
 		return true;
 
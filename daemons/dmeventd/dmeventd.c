@@ -97,6 +97,8 @@ static int _use_syslog = 1;
 static int _systemd_activation = 0;
 static int _foreground = 0;
 static int _restart = 0;
+static int _restore_saved = 0;
+static char *_saved_registrations = NULL; /* Content last saved with -m */
 static time_t _idle_since = 0;
 static const char *_exit_on = DEFAULT_DMEVENTD_EXIT_ON_PATH;
 static char **_initial_registrations = 0;
@@ -143,6 +145,7 @@ static const char *decode_cmd(uint32_t cmd)
 	case DM_EVENT_CMD_DIE:				return "DIE";
 	case DM_EVENT_CMD_GET_STATUS:			return "GET_STATUS";
 	case DM_EVENT_CMD_GET_PARAMETERS:		return "GET_PARAMETERS";
+	case DM_EVENT_CMD_BATCH:			return "BATCH";
 	default:					return "unknown";
 	}
 }
@@ -1657,6 +1660,8 @@ static int _handle_request(struct dm_event_daemon_message *msg,
 	}
 }
 
+static int _do_process_batch(struct dm_event_daemon_message *msg);
+
 /* Process a request passed from the communication thread. */
 static int _do_process_request(struct dm_event_daemon_message *msg)
 {
@@ -1664,6 +1669,9 @@ static int _do_process_request(struct dm_event_daemon_message *msg)
 	char *answer;
 	struct message_data message_data = { .msg =  msg };
 
+	if (msg->cmd == DM_EVENT_CMD_BATCH)
+		return _do_process_batch(msg);
+
 	/* Parse the message. */
 	if (msg->cmd == DM_EVENT_CMD_HELLO || msg->cmd == DM_EVENT_CMD_DIE)  {
 		ret = 0;
@@ -1689,6 +1697,271 @@ static int _do_process_request(struct dm_event_daemon_message *msg)
 	return ret;
 }
 
+/*
+ * Process several requests sent in one message.
+ *
+ * The request data is the message id on its own line followed by one
+ * "<cmd> <dso> <uuid> <events> <timeout>" line per request. Requests
+ * are handled in order and the reply holds the message id followed by
+ * one "<status> <answer>" line for each request, so a client can
+ * (un)register or query many devices with a single FIFO round trip.
+ */
+static int _do_process_batch(struct dm_event_daemon_message *msg)
+{
+	struct dm_event_daemon_message sub;
+	struct dm_pool *mem;
+	char *id = NULL, *line, *next, *answer, *reply = NULL;
+	unsigned long cmd;
+	int ret = -EINVAL;
+	int r;
+
+	if (!(mem = dm_pool_create("dmeventd_batch", 1024)) ||
+	    !dm_pool_begin_object(mem, 1024)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	if (!msg->data || !msg->size || msg->data[msg->size - 1] ||
+	    !(next = strchr(msg->data, '\n'))) {
+		log_error("Malformed batch request.");
+		goto out;
+	}
+
+	id = msg->data;
+	*next++ = '\0';
+
+	if (!dm_pool_grow_object(mem, id, 0) ||
+	    !dm_pool_grow_object(mem, "\n", 1)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (line = next; *line; line = next) {
+		if ((next = strchr(line, '\n')))
+			*next++ = '\0';
+		else
+			next = line + strlen(line);
+
+		memset(&sub, 0, sizeof(sub));
+		errno = 0;
+		cmd = strtoul(line, &answer, 10);
+		/* Only per-device requests may be batched. */
+		if (errno || (*answer != ' ') ||
+		    ((cmd != DM_EVENT_CMD_REGISTER_FOR_EVENT) &&
+		     (cmd != DM_EVENT_CMD_UNREGISTER_FOR_EVENT) &&
+		     (cmd != DM_EVENT_CMD_GET_REGISTERED_DEVICE) &&
+		     (cmd != DM_EVENT_CMD_SET_TIMEOUT) &&
+		     (cmd != DM_EVENT_CMD_GET_TIMEOUT))) {
+			r = -EINVAL;
+			answer = NULL;
+		} else {
+			sub.cmd = (uint32_t) cmd;
+			if ((r = dm_asprintf(&sub.data, "%s%s", id, answer)) < 0) {
+				ret = -ENOMEM;
+				goto out;
+			}
+			sub.size = (uint32_t) r;
+			r = _do_process_request(&sub);
+			/* Strip the message id from the answer. */
+			if ((answer = sub.data) && (answer = strchr(answer, ' ')))
+				answer++;
+		}
+
+		if ((r = dm_asprintf(&reply, "%d %s\n", r,
+				     answer ? : strerror(EINVAL))) < 0) {
+			free(sub.data);
+			ret = -ENOMEM;
+			goto out;
+		}
+		free(sub.data);
+
+		if (!dm_pool_grow_object(mem, reply, (size_t) r - 1)) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		free(reply);
+		reply = NULL;
+	}
+
+	if (!dm_pool_grow_object(mem, "", 1)) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	answer = dm_pool_end_object(mem);
+	if (!(reply = strdup(answer))) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	free(msg->data);
+	msg->data = reply;
+	msg->size = (uint32_t) strlen(reply) + 1;
+	reply = NULL;
+	ret = 0;
+out:
+	free(reply);
+	reply = NULL;
+	if (mem)
+		dm_pool_destroy(mem);
+
+	msg->cmd = ret;
+	if (ret) {
+		/* Plain error reply, as for a single request. */
+		if (!id || ((r = dm_asprintf(&reply, "%s %s", id, strerror(-ret))) < 0)) {
+			reply = NULL;
+			r = 0;
+		}
+		free(msg->data);
+		msg->data = reply;
+		msg->size = (uint32_t) r;
+	}
+
+	return ret;
+}
+
+/*
+ * With -m, save the current registrations, so a new instance started
+ * with -m restores the monitoring requested by lvm2 even when this one
+ * was killed and could not hand its registrations over as with -R.
+ * As only what clients registered is saved, devices lvm2 does not
+ * monitor (activation/monitoring=0, --ignoremonitoring or
+ * lvchange --monitor n) are not monitored by the new instance either.
+ *
+ * The content is collected under the lock, but the file is written
+ * without holding it and only when the registrations have changed.
+ */
+static void _save_registrations(void)
+{
+	char tmp[] = DM_EVENT_REGISTRATIONS_FILE ".XXXXXX";
+	struct thread_status *thread;
+	struct dm_pool *mem;
+	char num[64], *content;
+	FILE *f;
+	int fd, r = 1;
+
+	if (!_restore_saved)
+		return;
+
+	if (!(mem = dm_pool_create("registrations", 1024)) ||
+	    !dm_pool_begin_object(mem, 1024)) {
+		log_error("Failed to allocate registrations to save.");
+		goto out;
+	}
+
+	_lock_mutex();
+	dm_list_iterate_items(thread, &_thread_registry) {
+		if (!thread->events)
+			continue;
+		(void) dm_snprintf(num, sizeof(num), " %u %" PRIu32 "\n",
+				   thread->events, thread->timeout);
+		if (!dm_pool_grow_object(mem, "0:0 ", 4) ||
+		    !dm_pool_grow_object(mem, thread->dso_data->dso_name, 0) ||
+		    !dm_pool_grow_object(mem, " ", 1) ||
+		    !dm_pool_grow_object(mem, thread->device.uuid, 0) ||
+		    !dm_pool_grow_object(mem, num, 0)) {
+			r = 0;
+			break;
+		}
+	}
+	_unlock_mutex();
+
+	if (!r || !dm_pool_grow_object(mem, "\0", 1) ||
+	    !(content = dm_pool_end_object(mem))) {
+		log_error("Failed to allocate registrations to save.");
+		goto out;
+	}
+
+	if (_saved_registrations && !strcmp(_saved_registrations, content))
+		goto out; /* unchanged */
+
+	if ((fd = mkstemp(tmp)) < 0) {
+		log_sys_error("mkstemp", tmp);
+		goto out;
+	}
+
+	if (!(f = fdopen(fd, "w"))) {
+		log_sys_error("fdopen", tmp);
+		(void) close(fd);
+		goto bad;
+	}
+
+	if (fputs(content, f) < 0) {
+		log_sys_error("fputs", tmp);
+		(void) dm_fclose(f);
+		goto bad;
+	}
+
+	if (dm_fclose(f)) {
+		log_sys_error("write", tmp);
+		goto bad;
+	}
+
+	if (rename(tmp, DM_EVENT_REGISTRATIONS_FILE)) {
+		log_sys_error("rename", DM_EVENT_REGISTRATIONS_FILE);
+		goto bad;
+	}
+
+	free(_saved_registrations);
+	if (!(_saved_registrations = strdup(content)))
+		log_debug("Failed to remember saved registrations.");
+	goto out;
+bad:
+	if (unlink(tmp))
+		log_sys_debug("unlink", tmp);
+out:
+	if (mem)
+		dm_pool_destroy(mem);
+}
+
+/*
+ * Append registrations saved by a previous instance to the initial
+ * registrations. Devices removed since then fail to register.
+ */
+static void _load_saved_registrations(void)
+{
+	char **regs, *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int count = 0, first;
+	FILE *f;
+
+	if (!(f = fopen(DM_EVENT_REGISTRATIONS_FILE, "r"))) {
+		if (errno != ENOENT)
+			log_sys_error("fopen", DM_EVENT_REGISTRATIONS_FILE);
+		return;
+	}
+
+	if (_initial_registrations)
+		while (_initial_registrations[count])
+			++count;
+	first = count;
+
+	while ((len = getline(&line, &size, f)) > 0) {
+		if (line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (!len)
+			continue;
+		if (!(regs = realloc(_initial_registrations, sizeof(char*) * (count + 2)))) {
+			log_error("Failed to allocate saved registrations.");
+			break;
+		}
+		_initial_registrations = regs;
+		regs[count] = regs[count + 1] = NULL;
+		if (!(regs[count] = strdup(line))) {
+			log_error("Failed to allocate saved registration.");
+			break;
+		}
+		++count;
+	}
+
+	free(line);
+
+	if (fclose(f))
+		log_sys_debug("fclose", DM_EVENT_REGISTRATIONS_FILE);
+
+	log_debug("Restoring %d saved registrations.", count - first);
+}
+
 /* Only one caller at a time. */
 static void _process_request(struct dm_event_fifos *fifos)
 {
@@ -1712,6 +1985,11 @@ static void _process_request(struct dm_event_fifos *fifos)
 	if (!_client_write(fifos, &msg))
 		stack;
 
+	if ((cmd == DM_EVENT_CMD_REGISTER_FOR_EVENT) ||
+	    (cmd == DM_EVENT_CMD_UNREGISTER_FOR_EVENT) ||
+	    (cmd == DM_EVENT_CMD_BATCH))
+		_save_registrations();
+
 	DEBUGLOG("<<< CMD:%s (0x%x) completed (result %d).", decode_cmd(cmd), cmd, msg.cmd);
 
 	free(msg.data);
@@ -2024,9 +2302,11 @@ static int _reinstate_registrations(struct dm_event_fifos *fifos)
 	static const char _failed_parsing_msg[] = "Failed to parse existing event registration.\n";
 	static const char *_delim = " ";
 	struct dm_event_daemon_message msg = { 0 };
-	char *endp, *dso_name, *dev_name, *mask, *timeout;
+	struct dm_pool *mem;
+	char *endp, *dso_name, *dev_name, *mask, *timeout, *requests, *reply;
+	const char **dev_names;
 	unsigned long mask_value, timeout_value;
-	int i, ret;
+	int i, n = 0, ret;
 
 	ret = daemon_talk(fifos, &msg, DM_EVENT_CMD_HELLO, NULL, NULL, 0, 0);
 	free(msg.data);
@@ -2037,6 +2317,16 @@ static int _reinstate_registrations(struct dm_event_fifos *fifos)
 		return 0;
 	}
 
+	for (i = 0; _initial_registrations[i]; ++i)
+		;
+
+	if (!(mem = dm_pool_create("dmeventd_reinstate", 1024)) ||
+	    !(dev_names = dm_pool_zalloc(mem, (i + 1) * sizeof(*dev_names))) ||
+	    !dm_pool_begin_object(mem, 1024)) {
+		fprintf(stderr, "Memory allocation for registrations failed.\n");
+		goto bad;
+	}
+
 	for (i = 0; _initial_registrations[i]; ++i) {
 		if (!(strtok(_initial_registrations[i], _delim)) ||
 		    !(dso_name = strtok(NULL, _delim)) ||
@@ -2061,15 +2351,50 @@ static int _reinstate_registrations(struct dm_event_fifos *fifos)
 			continue;
 		}
 
-		if (daemon_talk(fifos, &msg, DM_EVENT_CMD_REGISTER_FOR_EVENT,
-				dso_name,
-				dev_name,
-				(enum dm_event_mask) mask_value,
-				timeout_value))
-			fprintf(stderr, "Failed to reinstate monitoring for device %s.\n", dev_name);
+		/* All registrations are sent to the new instance at once. */
+		if ((ret = dm_asprintf(&reply, "%d %s %s %lu %lu\n",
+				       DM_EVENT_CMD_REGISTER_FOR_EVENT, dso_name,
+				       dev_name, mask_value, timeout_value)) < 0 ||
+		    !dm_pool_grow_object(mem, reply, (size_t) ret - 1)) {
+			if (ret >= 0)
+				free(reply);
+			fprintf(stderr, "Memory allocation for registrations failed.\n");
+			goto bad;
+		}
+		free(reply);
+		dev_names[n++] = dev_name;
+	}
+
+	if (!dm_pool_grow_object(mem, "", 1)) {
+		fprintf(stderr, "Memory allocation for registrations failed.\n");
+		goto bad;
 	}
+	requests = dm_pool_end_object(mem);
+
+	if (n && daemon_talk_batch(fifos, &msg, requests))
+		goto bad;
+
+	/* One "<status> <answer>" line per device after the message id. */
+	reply = n ? strchr(msg.data, '\n') : NULL;
+	for (i = 0; i < n; ++i) {
+		if (reply)
+			reply++;
+		if (!reply || atoi(reply))
+			fprintf(stderr, "Failed to reinstate monitoring for device %s.\n", dev_names[i]);
+		if (reply)
+			reply = strchr(reply, '\n');
+	}
+
+	free(msg.data);
+	dm_pool_destroy(mem);
 
 	return 1;
+bad:
+	free(msg.data);
+	if (mem)
+		dm_pool_destroy(mem);
+
+	return 0;
 }
 
 static int _info_dmeventd(const char *name, struct dm_event_fifos *fifos)
@@ -2249,13 +2574,14 @@ bad:
 static void _usage(char *prog, FILE *file)
 {
 	fprintf(file, "Usage:\n"
-		"%s [-d [-d [-d]]] [-e path] [-f] [-h] [i] [-l] [-R] [-V] [-?]\n\n"
+		"%s [-d [-d [-d]]] [-e path] [-f] [-h] [i] [-l] [-m] [-R] [-V] [-?]\n\n"
 		"   -d       Log debug messages to syslog (-d, -dd, -ddd)\n"
 		"   -e       Select a file path checked on exit\n"
 		"   -f       Don't fork, run in the foreground\n"
 		"   -h       Show this help information\n"
 		"   -i       Query running instance of dmeventd for info\n"
 		"   -l       Log to stdout,stderr instead of syslog\n"
+		"   -m       Save registrations and restore those saved by a previous instance\n"
 		"   -?       Show this help information on stderr\n"
 		"   -R       Restart dmeventd\n"
 		"   -V       Show version of dmeventd\n\n", prog);
@@ -2274,7 +2600,7 @@ int main(int argc, char *argv[])
 
 	optopt = optind = opterr = 0;
 	optarg = (char*) "";
-	while ((opt = getopt(argc, argv, ":?e:fhiVdlR")) != EOF) {
+	while ((opt = getopt(argc, argv, ":?e:fhiVdlmR")) != EOF) {
 		switch (opt) {
 		case 'h':
 			_usage(argv[0], stdout);
@@ -2303,6 +2629,9 @@ int main(int argc, char *argv[])
 		case 'l':
 			_use_syslog = 0;
 			break;
+		case 'm':
+			_restore_saved++;
+			break;
 		case 'V':
 			printf("dmeventd version: %s\n", DM_LIB_VERSION);
 			return EXIT_SUCCESS;
@@ -2375,8 +2704,13 @@ int main(int argc, char *argv[])
 
 	_idle_since = time(NULL);
 
-	if (_initial_registrations)
+	if (_restore_saved)
+		_load_saved_registrations();
+
+	if (_initial_registrations) {
 		_process_initial_registrations();
+		_save_registrations();
+	}
 
 	for (;;) {
 		if (_idle_since) {
@@ -2426,6 +2760,7 @@ int main(int argc, char *argv[])
 	}
 
 	pthread_mutex_destroy(&_global_mutex);
+	free(_saved_registrations);
 
 	log_notice("dmeventd shutting down.");
 
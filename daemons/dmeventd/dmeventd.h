@@ -19,6 +19,8 @@
 
 #define	DM_EVENT_FIFO_CLIENT	DEFAULT_DM_RUN_DIR "/dmeventd-client"
 #define	DM_EVENT_FIFO_SERVER	DEFAULT_DM_RUN_DIR "/dmeventd-server"
+/* Registrations restored by dmeventd -m */
+#define	DM_EVENT_REGISTRATIONS_FILE	DEFAULT_DM_RUN_DIR "/dmeventd-registrations"
 
 #define DM_EVENT_DEFAULT_TIMEOUT 10
 
@@ -35,6 +37,7 @@ enum dm_event_command {
 	DM_EVENT_CMD_DIE,
 	DM_EVENT_CMD_GET_STATUS,
 	DM_EVENT_CMD_GET_PARAMETERS,
+	DM_EVENT_CMD_BATCH,	/* Protocol version 3 */
 };
 
 /* Message passed between client and daemon. */
@@ -69,6 +72,9 @@ int daemon_talk(struct dm_event_fifos *fifos,
 		struct dm_event_daemon_message *msg, int cmd,
 		const char *dso_name, const char *dev_name,
 		enum dm_event_mask evmask, uint32_t timeout);
+int daemon_talk_batch(struct dm_event_fifos *fifos,
+		      struct dm_event_daemon_message *msg,
+		      const char *requests);
 int init_fifos(struct dm_event_fifos *fifos);
 void fini_fifos(struct dm_event_fifos *fifos);
 int dm_event_get_version(struct dm_event_fifos *fifos, int *version);
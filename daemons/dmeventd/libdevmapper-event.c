@@ -400,6 +400,50 @@ int daemon_talk(struct dm_event_fifos *fifos,
 	return (int32_t) msg->cmd;
 }
 
+/*
+ * Send several requests in one DM_EVENT_CMD_BATCH message.
+ * requests holds one "<cmd> <dso> <uuid> <events> <timeout>" line per
+ * request and the reply data holds one "<status> <answer>" line per
+ * request after the message id line. Needs protocol version 3.
+ */
+int daemon_talk_batch(struct dm_event_fifos *fifos,
+		      struct dm_event_daemon_message *msg,
+		      const char *requests)
+{
+	int msg_size;
+
+	memset(msg, 0, sizeof(*msg));
+
+	if ((msg_size = dm_asprintf(&(msg->data), "%d:%d\n%s",
+				    getpid(), _sequence_nr, requests)) < 0) {
+		log_error("_daemon_talk_batch: message allocation failed.");
+		return -ENOMEM;
+	}
+	msg->cmd = DM_EVENT_CMD_BATCH;
+	msg->size = msg_size; /* Includes the terminating NUL */
+
+	if (!_daemon_write(fifos, msg)) {
+		stack;
+		free(msg->data);
+		msg->data = NULL;
+		return -EIO;
+	}
+
+	do {
+		free(msg->data);
+		msg->data = NULL;
+
+		if (!_daemon_read(fifos, msg)) {
+			stack;
+			return -EIO;
+		}
+	} while (!msg->data || !_check_message_id(msg));
+
+	_sequence_nr++;
+
+	return (int32_t) msg->cmd;
+}
+
 /*
  * start_daemon
  *
@@ -739,6 +783,163 @@ static int _parse_message(struct dm_event_daemon_message *msg, char **dso_name,
 	return -ENOMEM;
 }
 
+/*
+ * Send the same command for many handlers over one FIFO connection.
+ * With a daemon speaking protocol version 3 all requests go in a single
+ * batch message, otherwise they are sent one after another. Per-handler
+ * status is stored in results[].
+ *
+ * Returns 0 if dmeventd could not be reached.
+ */
+static int _do_events(int cmd, struct dm_event_handler **dmevhs, unsigned count,
+		      int *results)
+{
+	struct dm_event_fifos fifos = {
+		.client = -1,
+		.server = -1,
+		/* FIXME Make these either configurable or depend directly on dmeventd_path */
+		.client_path = DM_EVENT_FIFO_CLIENT,
+		.server_path = DM_EVENT_FIFO_SERVER
+	};
+	struct dm_event_daemon_message msg = { 0 };
+	struct dm_pool *mem = NULL;
+	struct dm_task *dmt;
+	char *request, *line, *next;
+	int version, len, ret = 0;
+	unsigned i;
+
+	for (i = 0; i < count; ++i)
+		results[i] = -ENODEV;
+
+	if (!_init_client(dmevhs[0]->dmeventd_path, &fifos))
+		goto_out;
+
+	if (!dm_event_get_version(&fifos, &version))
+		goto_out;
+
+	if (!(mem = dm_pool_create("dm_event_batch", 1024)) ||
+	    !dm_pool_begin_object(mem, 1024))
+		goto_out;
+
+	for (i = 0; i < count; ++i) {
+		if (!(dmt = _get_device_info(dmevhs[i])))
+			continue;
+
+		if (version < 3) {
+			/* Old daemon: one request at a time. */
+			results[i] = daemon_talk(&fifos, &msg, cmd, dmevhs[i]->dso,
+						 dm_task_get_uuid(dmt),
+						 dmevhs[i]->mask, dmevhs[i]->timeout);
+			free(msg.data);
+			msg.data = NULL;
+		} else {
+			len = dm_asprintf(&request, "%d %s %s %u %" PRIu32 "\n", cmd,
+					  dmevhs[i]->dso ? : "-", dm_task_get_uuid(dmt),
+					  dmevhs[i]->mask, dmevhs[i]->timeout);
+			if ((len < 0) || !dm_pool_grow_object(mem, request, (size_t) len - 1)) {
+				if (len >= 0)
+					free(request);
+				dm_task_destroy(dmt);
+				goto_out;
+			}
+			free(request);
+			results[i] = 0; /* Queued */
+		}
+
+		dm_task_destroy(dmt);
+	}
+
+	if (version < 3) {
+		ret = 1;
+		goto out;
+	}
+
+	if (!dm_pool_grow_object(mem, "", 1))
+		goto_out;
+
+	request = dm_pool_end_object(mem);
+	if (!*request) {
+		ret = 1; /* No device found */
+		goto out;
+	}
+
+	if ((len = daemon_talk_batch(&fifos, &msg, request))) {
+		log_error("Batched dmeventd request failed: %s.", strerror(-len));
+		goto out;
+	}
+
+	/* Skip message id line, then one reply line per queued request. */
+	next = strchr(msg.data, '\n');
+	for (i = 0; i < count; ++i) {
+		if (results[i])
+			continue; /* Device not found, not sent */
+
+		if (!next || !*(line = next + 1)) {
+			results[i] = -EIO;
+			next = NULL;
+			continue;
+		}
+
+		if ((next = strchr(line, '\n')))
+			*next = '\0';
+
+		results[i] = atoi(line);
+	}
+
+	ret = 1;
+out:
+	free(msg.data);
+	if (mem)
+		dm_pool_destroy(mem);
+	fini_fifos(&fifos);
+
+	return ret;
+}
+
+static int _set_handlers(int cmd, struct dm_event_handler **dmevhs, unsigned count)
+{
+	int *results;
+	unsigned i;
+	int r;
+
+	if (!count)
+		return 1;
+
+	if (!(results = malloc(count * sizeof(*results)))) {
+		log_error("Failed to allocate batch results.");
+		return 0;
+	}
+
+	if ((r = _do_events(cmd, dmevhs, count, results)))
+		for (i = 0; i < count; ++i) {
+			if (!results[i] || (results[i] == -ENODEV))
+				continue; /* Missing devices are already reported */
+			log_error("%s: event %sregistration failed: %s.",
+				  dmevhs[i]->dev_name ? : (dmevhs[i]->uuid ? : "device"),
+				  (cmd == DM_EVENT_CMD_REGISTER_FOR_EVENT) ? "" : "de",
+				  strerror(-results[i]));
+			r = 0;
+		}
+
+	for (i = 0; r && (i < count); ++i)
+		if (results[i])
+			r = 0;
+
+	free(results);
+
+	return r;
+}
+
+int dm_event_register_handlers(struct dm_event_handler **dmevhs, unsigned count)
+{
+	return _set_handlers(DM_EVENT_CMD_REGISTER_FOR_EVENT, dmevhs, count);
+}
+
+int dm_event_unregister_handlers(struct dm_event_handler **dmevhs, unsigned count)
+{
+	return _set_handlers(DM_EVENT_CMD_UNREGISTER_FOR_EVENT, dmevhs, count);
+}
+
 /*
  * Returns 0 if handler found; error (-ENOMEM, -ENOENT) otherwise.
  */
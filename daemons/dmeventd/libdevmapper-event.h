@@ -47,7 +47,7 @@ enum dm_event_mask {
 };
 
 #define DM_EVENT_ALL_ERRORS DM_EVENT_ERROR_MASK
-#define DM_EVENT_PROTOCOL_VERSION 2
+#define DM_EVENT_PROTOCOL_VERSION 3
 
 struct dm_task;
 struct dm_event_handler;
@@ -106,6 +106,20 @@ int dm_event_get_registered_device(struct dm_event_handler *dmevh, int next);
 int dm_event_register_handler(const struct dm_event_handler *dmevh);
 int dm_event_unregister_handler(const struct dm_event_handler *dmevh);
 
+/*
+ * (Un)register many handlers with one request to dmeventd.
+ *
+ * A dmeventd speaking protocol version 3 or newer receives all the
+ * requests in a single message and answers them with a single reply;
+ * older daemons are sent the requests one by one over one connection.
+ * All handlers must use the same dmeventd path.
+ *
+ * Returns 1 if every handler succeeded and logs the failing devices
+ * otherwise.
+ */
+int dm_event_register_handlers(struct dm_event_handler **dmevhs, unsigned count);
+int dm_event_unregister_handlers(struct dm_event_handler **dmevhs, unsigned count);
+
 /* Set debug level for logging, and whether to log on stdout/stderr or syslog */
 void dm_event_log_set(int debug_log_level, int use_syslog);
 
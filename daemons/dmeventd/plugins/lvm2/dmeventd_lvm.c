@@ -85,6 +85,8 @@ int dmeventd_lvm2_init(void)
 		}
 
 		lvm2_disable_dmeventd_monitoring(_lvm_handle);
+		/* Avoid listing all devices again for each command */
+		lvm2_incremental(_lvm_handle, 1);
 		/* FIXME Temporary: move to dmeventd core */
 		lvm2_run(_lvm_handle, "_memlock_inc");
 		log_debug("lvm plugin initilized.");
@@ -769,6 +769,15 @@ void dm_tree_use_no_flush_suspend(struct dm_tree_node *dnode);
  */
 void dm_tree_retry_remove(struct dm_tree_node *dnode);
 
+/*
+ * Suspend devices at the same level of the tree with up to
+ * 'concurrency' suspend ioctls running at once, so independent
+ * devices flush in parallel and the whole suspend takes about as
+ * long as the slowest of them.  Devices are still only suspended
+ * after all their parents in the tree.  Default is 1, one by one.
+ */
+void dm_tree_set_suspend_concurrency(struct dm_tree_node *dnode, unsigned concurrency);
+
 /*
  * Is the uuid prefix present in the tree?
  * Only returns 0 if every node was checked successfully.
@@ -1183,6 +1192,12 @@ void dm_tree_node_set_udev_flags(struct dm_tree_node *node, uint16_t udev_flags)
 void dm_tree_node_set_presuspend_node(struct dm_tree_node *node,
 				      struct dm_tree_node *presuspend_node);
 
+/*
+ * Do not suspend the node (nor its children) in dm_tree_suspend_children(),
+ * i.e. when its table is known to stay unchanged by the following reload.
+ */
+void dm_tree_node_set_keep_running(struct dm_tree_node *node);
+
 int dm_tree_node_add_target_area(struct dm_tree_node *node,
 				    const char *dev_name,
 				    const char *dlid,
@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <sys/ioctl.h>
+#include <pthread.h>
 #include <sys/utsname.h>
 #include <limits.h>
 #include <unistd.h>
@@ -2033,14 +2034,20 @@ static int _dm_ioctl_unmangle_uuids(int type, struct dm_ioctl *dmi)
 }
 #endif
 
-static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
-				     unsigned buffer_repeat_count,
-				     unsigned retry_repeat_count,
-				     int *retryable)
+static int _ioctl_with_uevent(const struct dm_task *dmt)
+{
+	return dmt->type == DM_DEVICE_RESUME ||
+	       dmt->type == DM_DEVICE_REMOVE ||
+	       dmt->type == DM_DEVICE_RENAME;
+}
+
+/* Create the ioctl argument of the task, ready for the ioctl call. */
+static struct dm_ioctl *_prepare_dm_ioctl(struct dm_task *dmt,
+					  unsigned buffer_repeat_count,
+					  unsigned retry_repeat_count)
 {
 	struct dm_ioctl *dmi;
 	int ioctl_with_uevent;
-	int r;
 
 	dmt->ioctl_errno = 0;
 
@@ -2058,9 +2065,7 @@ static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
 	if (dmt->no_open_count)
 		dmi->flags |= DM_SKIP_BDGET_FLAG;
 
-	ioctl_with_uevent = dmt->type == DM_DEVICE_RESUME ||
-			    dmt->type == DM_DEVICE_REMOVE ||
-			    dmt->type == DM_DEVICE_RENAME;
+	ioctl_with_uevent = _ioctl_with_uevent(dmt);
 
 	if (ioctl_with_uevent && dm_cookie_supported()) {
 		/*
@@ -2128,15 +2133,24 @@ static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
 			     dmt->enable_checks ? "enablechecks " : "",
 			     dmt->sector, _sanitise_message(dmt->message),
 			     dmi->data_size, retry_repeat_count);
-#ifdef DM_IOCTLS
-	r = ioctl(_control_fd, command, dmi);
 
+	return dmi;
+}
+
+/*
+ * Process the result 'r' and 'ioctl_errno' of the ioctl call.
+ * Returns the ioctl argument with the results, or NULL on failure.
+ */
+static struct dm_ioctl *_check_dm_ioctl(struct dm_task *dmt, struct dm_ioctl *dmi,
+					int r, int ioctl_errno, int *retryable)
+{
+#ifdef DM_IOCTLS
 	if (dmt->record_timestamp)
 		if (!dm_timestamp_get(_dm_ioctl_timestamp))
 			stack;
 
-	if (r < 0 && dmt->expected_errno != errno) {
-		dmt->ioctl_errno = errno;
+	if (r < 0 && dmt->expected_errno != ioctl_errno) {
+		dmt->ioctl_errno = ioctl_errno;
 		if (dmt->ioctl_errno == ENXIO && ((dmt->type == DM_DEVICE_INFO) ||
 						  (dmt->type == DM_DEVICE_MKNODES) ||
 						  (dmt->type == DM_DEVICE_STATUS)))
@@ -2178,7 +2192,7 @@ static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
 		}
 	}
 
-	if (ioctl_with_uevent && dm_udev_get_sync_support() &&
+	if (_ioctl_with_uevent(dmt) && dm_udev_get_sync_support() &&
 	    !_check_uevent_generated(dmi)) {
 		log_debug_activation("Uevent not generated! Calling udev_complete "
 				     "internally to avoid process lock-up.");
@@ -2202,6 +2216,26 @@ error:
 	return NULL;
 }
 
+static struct dm_ioctl *_do_dm_ioctl(struct dm_task *dmt, unsigned command,
+				     unsigned buffer_repeat_count,
+				     unsigned retry_repeat_count,
+				     int *retryable)
+{
+	struct dm_ioctl *dmi;
+	int r = -1;
+	int ioctl_errno = 0;
+
+	if (!(dmi = _prepare_dm_ioctl(dmt, buffer_repeat_count, retry_repeat_count)))
+		return NULL;
+
+#ifdef DM_IOCTLS
+	r = ioctl(_control_fd, command, dmi);
+	ioctl_errno = errno;
+#endif
+
+	return _check_dm_ioctl(dmt, dmi, r, ioctl_errno, retryable);
+}
+
 void dm_task_update_nodes(void)
 {
 	update_devs();
@@ -2377,6 +2411,155 @@ repeat_ioctl:
 	return 0;
 }
 
+/*
+ * Suspend ioctls run from worker threads while devices are suspended,
+ * so they must not allocate memory.  Their stacks are allocated before,
+ * small enough to come from the already locked heap instead of mmap.
+ */
+#define DM_IOCTL_THREAD_STACK_SIZE (64 * 1024)
+
+struct dm_ioctl_job {
+	struct dm_task *dmt;
+	struct dm_ioctl *dmi;
+	int r;
+	int ioctl_errno;
+};
+
+struct dm_ioctl_jobs {
+	pthread_mutex_t lock;
+	struct dm_ioctl_job *jobs;
+	unsigned count;
+	unsigned next;
+};
+
+static void *_ioctl_jobs_run(void *arg)
+{
+	struct dm_ioctl_jobs *jobs = arg;
+	struct dm_ioctl_job *job;
+
+	for (;;) {
+		pthread_mutex_lock(&jobs->lock);
+		job = (jobs->next < jobs->count) ? &jobs->jobs[jobs->next++] : NULL;
+		pthread_mutex_unlock(&jobs->lock);
+
+		if (!job)
+			return NULL;
+#ifdef DM_IOCTLS
+		job->r = ioctl(_control_fd, _cmd_data_v4[job->dmt->type].cmd, job->dmi);
+		job->ioctl_errno = errno;
+#else
+		job->r = -1;
+#endif
+	}
+}
+
+int dm_task_run_concurrent(struct dm_task **dmts, unsigned count, unsigned concurrency)
+{
+	struct dm_ioctl_jobs jobs = { .count = count };
+	struct dm_ioctl_job *job;
+	struct dm_ioctl *dmi;
+	pthread_attr_t attr;
+	pthread_t *threads = NULL;
+	char **stacks = NULL;
+	size_t stack_size = DM_IOCTL_THREAD_STACK_SIZE;
+	unsigned i, started = 0;
+	int retryable = 0;
+	int r = 0;
+
+	if (!count)
+		return 1;
+
+	if (!concurrency)
+		concurrency = 1;
+
+	for (i = 0; i < count; ++i)
+		if ((dmts[i]->type != DM_DEVICE_SUSPEND) || dmts[i]->enable_checks) {
+			log_error(INTERNAL_ERROR "Only plain suspend tasks can run concurrently.");
+			return 0;
+		}
+
+	if (!_open_control())
+		return_0;
+
+	if (!(jobs.jobs = zalloc(sizeof(*jobs.jobs) * count)))
+		return_0;
+
+	for (i = 0; i < count; ++i) {
+		jobs.jobs[i].dmt = dmts[i];
+		if (!(jobs.jobs[i].dmi = _prepare_dm_ioctl(dmts[i], _ioctl_buffer_double_factor, 1)))
+			goto_out;
+	}
+
+	/* The calling thread runs ioctls as well. */
+	if (concurrency > count)
+		concurrency = count;
+	if (concurrency > 1) {
+		if (!(threads = zalloc(sizeof(*threads) * (concurrency - 1))) ||
+		    !(stacks = zalloc(sizeof(*stacks) * (concurrency - 1))))
+			goto_out;
+
+		if (stack_size < PTHREAD_STACK_MIN)
+			stack_size = PTHREAD_STACK_MIN;
+
+		for (i = 0; i < concurrency - 1; ++i)
+			if (!(stacks[i] = malloc(stack_size)))
+				goto_out;
+	}
+
+	if (pthread_mutex_init(&jobs.lock, NULL)) {
+		log_sys_error("pthread_mutex_init", "");
+		goto out;
+	}
+
+	for (; started < concurrency - 1; ++started) {
+		if (pthread_attr_init(&attr))
+			break;
+		if (pthread_attr_setstack(&attr, stacks[started], stack_size) ||
+		    pthread_create(&threads[started], &attr, _ioctl_jobs_run, &jobs)) {
+			(void) pthread_attr_destroy(&attr);
+			break;
+		}
+		(void) pthread_attr_destroy(&attr);
+	}
+
+	(void) _ioctl_jobs_run(&jobs);
+
+	for (i = 0; i < started; ++i)
+		if (pthread_join(threads[i], NULL))
+			log_sys_error("pthread_join", "");
+
+	(void) pthread_mutex_destroy(&jobs.lock);
+
+	log_debug_activation("Ran %u ioctls with %u threads.", count, started + 1);
+
+	r = 1;
+	for (i = 0; i < count; ++i) {
+		job = &jobs.jobs[i];
+		dmi = _check_dm_ioctl(job->dmt, job->dmi, job->r, job->ioctl_errno, &retryable);
+		job->dmi = NULL;
+		if (!dmi) {
+			r = 0;
+			continue;
+		}
+
+		/* Was structure reused? */
+		_dm_zfree_dmi(job->dmt->dmi.v4);
+		job->dmt->dmi.v4 = dmi;
+	}
+out:
+	if (stacks)
+		for (i = 0; i < concurrency - 1; ++i)
+			free(stacks[i]);
+	free(stacks);
+	free(threads);
+	for (i = 0; i < count; ++i)
+		if (jobs.jobs[i].dmi)
+			_dm_zfree_dmi(jobs.jobs[i].dmi);
+	free(jobs.jobs);
+
+	return r;
+}
+
 void dm_hold_control_dev(int hold_open)
 {
 	_hold_control_fd_open = hold_open ? 1 : 0;
@@ -87,4 +87,11 @@ struct cmd_data {
 int dm_check_version(void);
 uint64_t dm_task_get_existing_table_size(struct dm_task *dmt);
 
+/*
+ * Run DM_DEVICE_SUSPEND tasks with up to 'concurrency' ioctls at once
+ * and wait for all of them.  Each task gets its own results as with
+ * dm_task_run().  Returns 0 if any of them failed.
+ */
+int dm_task_run_concurrent(struct dm_task **dmts, unsigned count, unsigned concurrency);
+
 #endif
@@ -331,6 +331,8 @@ struct dm_tree_node {
 	 */
 	struct dm_tree_node *presuspend_node;
 
+	int keep_running;		/* Leave running during suspend_children */
+
 	/* Callback */
 	dm_node_callback_fn callback;
 	void *callback_data;
@@ -346,6 +348,7 @@ struct dm_tree {
 	int skip_lockfs;		/* 1 skips lockfs (for non-snapshots) */
 	int no_flush;			/* 1 sets noflush (mirrors/multipath) */
 	int retry_remove;		/* 1 retries remove if not successful */
+	unsigned suspend_concurrency;	/* >1 suspends siblings concurrently */
 	uint32_t cookie;
 	char buf[DM_NAME_LEN + 32];	/* print buffer for device_name (major:minor) */
 	const char **optional_uuid_suffixes;	/* uuid suffixes ignored when matching */
@@ -426,6 +429,11 @@ void dm_tree_retry_remove(struct dm_tree_node *dnode)
 	dnode->dtree->retry_remove = 1;
 }
 
+void dm_tree_set_suspend_concurrency(struct dm_tree_node *dnode, unsigned concurrency)
+{
+	dnode->dtree->suspend_concurrency = concurrency;
+}
+
 /*
  * Node functions.
  */
@@ -677,6 +685,11 @@ void dm_tree_node_set_presuspend_node(struct dm_tree_node *node,
 	node->presuspend_node = presuspend_node;
 }
 
+void dm_tree_node_set_keep_running(struct dm_tree_node *node)
+{
+	node->keep_running = 1;
+}
+
 const char *dm_tree_node_get_name(const struct dm_tree_node *node)
 {
 	return node->info.exists ? node->name : "";
@@ -1375,11 +1388,10 @@ out:
 	return r;
 }
 
-static int _suspend_node(const char *name, uint32_t major, uint32_t minor,
-			 int skip_lockfs, int no_flush, struct dm_info *newinfo)
+static struct dm_task *_suspend_node_task(const char *name, uint32_t major, uint32_t minor,
+					  int skip_lockfs, int no_flush)
 {
 	struct dm_task *dmt;
-	int r = 0;
 
 	log_verbose("Suspending %s (%" PRIu32 ":%" PRIu32 ")%s%s",
 		    name, major, minor,
@@ -1388,12 +1400,13 @@ static int _suspend_node(const char *name, uint32_t major, uint32_t minor,
 
 	if (!(dmt = dm_task_create(DM_DEVICE_SUSPEND))) {
 		log_error("Suspend dm_task creation failed for %s", name);
-		return 0;
+		return NULL;
 	}
 
 	if (!dm_task_set_major(dmt, major) || !dm_task_set_minor(dmt, minor)) {
 		log_error("Failed to set device number for %s suspension.", name);
-		goto out;
+		dm_task_destroy(dmt);
+		return NULL;
 	}
 
 	if (!dm_task_no_open_count(dmt))
@@ -1405,11 +1418,23 @@ static int _suspend_node(const char *name, uint32_t major, uint32_t minor,
 	if (no_flush && !dm_task_no_flush(dmt))
 		log_warn("WARNING: Failed to set no_flush flag.");
 
+	return dmt;
+}
+
+static int _suspend_node(const char *name, uint32_t major, uint32_t minor,
+			 int skip_lockfs, int no_flush, struct dm_info *newinfo)
+{
+	struct dm_task *dmt;
+	int r;
+
+	if (!(dmt = _suspend_node_task(name, major, minor, skip_lockfs, no_flush)))
+		return 0;
+
 	if ((r = dm_task_run(dmt))) {
 		inc_suspended();
 		r = dm_task_get_info(dmt, newinfo);
 	}
-out:
+
 	dm_task_destroy(dmt);
 
 	return r;
@@ -1896,6 +1921,42 @@ int dm_tree_deactivate_children(struct dm_tree_node *dnode,
 	return _dm_tree_deactivate_children(dnode, uuid_prefix, uuid_prefix_len, 0);
 }
 
+/*
+ * Suspend nodes at one level of the tree with concurrent ioctls.
+ * None of them is a parent of another and all their parents are
+ * suspended already, so the order does not matter.
+ */
+static int _suspend_nodes_concurrently(struct dm_tree_node **nodes,
+				       struct dm_task **dmts, unsigned count,
+				       unsigned concurrency)
+{
+	struct dm_info newinfo;
+	unsigned i;
+	int r = 1;
+
+	log_debug_activation("Suspending %u devices with up to %u at once.",
+			     count, concurrency);
+
+	/* Failures are reported below, with the failed nodes. */
+	(void) dm_task_run_concurrent(dmts, count, concurrency);
+
+	for (i = 0; i < count; ++i) {
+		if (dm_task_get_info(dmts[i], &newinfo)) {
+			inc_suspended();
+			/* Update cached info */
+			nodes[i]->info = newinfo;
+		} else {
+			log_error("Unable to suspend %s (" FMTu32 ":"
+				  FMTu32 ")", _node_name(nodes[i]),
+				  nodes[i]->info.major, nodes[i]->info.minor);
+			r = 0;
+		}
+		dm_task_destroy(dmts[i]);
+	}
+
+	return r;
+}
+
 int dm_tree_suspend_children(struct dm_tree_node *dnode,
 			     const char *uuid_prefix,
 			     size_t uuid_prefix_len)
@@ -1907,6 +1968,21 @@ int dm_tree_suspend_children(struct dm_tree_node *dnode,
 	const struct dm_info *dinfo;
 	const char *name;
 	const char *uuid;
+	unsigned concurrency = dnode->dtree->suspend_concurrency;
+	struct dm_tree_node **nodes = NULL;
+	struct dm_task **dmts = NULL;
+	unsigned count = 0, num_children;
+
+	/* Nodes at this level are collected and suspended at once */
+	if ((concurrency > 1) &&
+	    ((num_children = dm_tree_node_num_children(dnode, 0)) > 1)) {
+		if (!(nodes = malloc(sizeof(*nodes) * num_children)) ||
+		    !(dmts = malloc(sizeof(*dmts) * num_children))) {
+			log_error("Failed to allocate suspend tasks.");
+			free(nodes);
+			return 0;
+		}
+	}
 
 	/* Suspend nodes at this level of the tree */
 	while ((child = dm_tree_next_child(&handle, dnode, 0))) {
@@ -1929,12 +2005,20 @@ int dm_tree_suspend_children(struct dm_tree_node *dnode,
 		if (!_uuid_prefix_matches(uuid, uuid_prefix, uuid_prefix_len))
 			continue;
 
+		if (child->keep_running) {
+			log_debug_activation("Keeping %s running.", _node_name(child));
+			continue;
+		}
+
 		/* Ensure immediate parents are already suspended */
 		if (!_children_suspended(child, 1, uuid_prefix, uuid_prefix_len))
 			continue;
 
-		if (!_info_by_dev(dinfo->major, dinfo->minor, 0, &info, NULL, NULL, NULL))
-			return_0;
+		if (!_info_by_dev(dinfo->major, dinfo->minor, 0, &info, NULL, NULL, NULL)) {
+			stack;
+			r = 0;
+			goto out;
+		}
 
 		if (!info.exists || info.suspended)
 			continue;
@@ -1952,6 +2036,19 @@ int dm_tree_suspend_children(struct dm_tree_node *dnode,
 			continue;
 		}
 
+		if (nodes) {
+			if (!(dmts[count] = _suspend_node_task(name, info.major, info.minor,
+							       child->dtree->skip_lockfs,
+							       child->dtree->no_flush))) {
+				log_error("Unable to suspend %s (" FMTu32 ":"
+					  FMTu32 ")", name, info.major, info.minor);
+				r = 0;
+				continue;
+			}
+			nodes[count++] = child;
+			continue;
+		}
+
 		if (!_suspend_node(name, info.major, info.minor,
 				   child->dtree->skip_lockfs,
 				   child->dtree->no_flush, &newinfo)) {
@@ -1965,11 +2062,17 @@ int dm_tree_suspend_children(struct dm_tree_node *dnode,
 		child->info = newinfo;
 	}
 
+	if (count) {
+		if (!_suspend_nodes_concurrently(nodes, dmts, count, concurrency))
+			r = 0;
+		count = 0;
+	}
+
 	/* Then suspend any child nodes */
 	handle = NULL;
 
 	while ((child = dm_tree_next_child(&handle, dnode, 0))) {
-		if (child->props.skip_suspend)
+		if (child->props.skip_suspend || child->keep_running)
 			continue;
 
 		if (!(uuid = dm_tree_node_get_uuid(child))) {
@@ -1982,9 +2085,18 @@ int dm_tree_suspend_children(struct dm_tree_node *dnode,
 			continue;
 
 		if (dm_tree_node_num_children(child, 0))
-			if (!dm_tree_suspend_children(child, uuid_prefix, uuid_prefix_len))
-				return_0;
+			if (!dm_tree_suspend_children(child, uuid_prefix, uuid_prefix_len)) {
+				stack;
+				r = 0;
+				goto out;
+			}
 	}
+out:
+	/* Tasks collected before a failure are never run */
+	while (count)
+		dm_task_destroy(dmts[--count]);
+	free(dmts);
+	free(nodes);
 
 	return r;
 }
@@ -258,6 +258,11 @@ int lv_snapshot_percent(const struct logical_volume *lv, dm_percent_t *percent)
 {
 	return 0;
 }
+int lv_origin_snapshots_percent(const struct logical_volume *origin,
+				dm_percent_t *percents)
+{
+	return 0;
+}
 int lv_mirror_percent(struct cmd_context *cmd, const struct logical_volume *lv,
 		      int wait, dm_percent_t *percent, uint32_t *event_nr)
 {
@@ -406,6 +411,14 @@ int monitor_dev_for_events(struct cmd_context *cmd, const struct logical_volume
 {
 	return 1;
 }
+int monitor_dev_for_events_batch(struct cmd_context *cmd)
+{
+	return 1;
+}
+int monitor_dev_for_events_flush(struct cmd_context *cmd)
+{
+	return 1;
+}
 /* fs.c */
 void fs_unlock(void)
 {
@@ -427,6 +440,16 @@ int lv_has_target_type(struct dm_pool *mem, const struct logical_volume *lv,
 {
         return 0;
 }
+int activation_check_pools(struct cmd_context *cmd, struct volume_group *vg)
+{
+	return 1;
+}
+void activation_check_pools_release(struct cmd_context *cmd)
+{
+}
+void activation_lv_state_release(struct cmd_context *cmd)
+{
+}
 #else				/* DEVMAPPER_SUPPORT */
 
 static int _activation = 1;
@@ -996,6 +1019,41 @@ int lv_snapshot_percent(const struct logical_volume *lv, dm_percent_t *percent)
 	return r;
 }
 
+/*
+ * Fetch usage of all snapshots of an active origin with a single
+ * dev_manager instead of one lv_info() and dev_manager per snapshot.
+ * percents[] follows the order of origin->snapshot_segs and entries
+ * for snapshots without a live table are set to DM_PERCENT_INVALID.
+ */
+int lv_origin_snapshots_percent(const struct logical_volume *origin,
+				dm_percent_t *percents)
+{
+	struct dev_manager *dm;
+	struct lv_segment *snap_seg;
+	unsigned i = 0;
+
+	dm_list_iterate_items_gen(snap_seg, &origin->snapshot_segs, origin_list)
+		percents[i++] = DM_PERCENT_INVALID;
+
+	if (!lv_info(origin->vg->cmd, origin, 0, NULL, 0, 0))
+		return 0;
+
+	log_debug_activation("Checking snapshots percent for origin %s.",
+			     display_lvname(origin));
+
+	if (!(dm = dev_manager_create(origin->vg->cmd, origin->vg->name, 1)))
+		return_0;
+
+	i = 0;
+	dm_list_iterate_items_gen(snap_seg, &origin->snapshot_segs, origin_list)
+		if (!dev_manager_snapshot_percent(dm, snap_seg->cow, &percents[i++]))
+			percents[i - 1] = DM_PERCENT_INVALID;
+
+	dev_manager_destroy(dm);
+
+	return 1;
+}
+
 /* FIXME Merge with snapshot_percent */
 int lv_mirror_percent(struct cmd_context *cmd, const struct logical_volume *lv,
 		      int wait, dm_percent_t *percent, uint32_t *event_nr)
@@ -1742,11 +1800,19 @@ out:
 	return r;
 }
 
+/* (Un)registration queued by monitor_dev_for_events_batch() */
+struct dmeventd_batch_item {
+	struct dm_list list;
+	struct dm_event_handler *dmevh;
+	int set;
+};
+
 int target_register_events(struct cmd_context *cmd, const char *dso, const struct logical_volume *lv,
 			    int evmask __attribute__((unused)), int set, int timeout)
 {
 	char *uuid;
 	struct dm_event_handler *dmevh;
+	struct dmeventd_batch_item *item;
 	int r;
 
 	if (!dso)
@@ -1760,6 +1826,18 @@ int target_register_events(struct cmd_context *cmd, const char *dso, const struc
 					       DM_EVENT_ALL_ERRORS | (timeout ? DM_EVENT_TIMEOUT : 0))))
 		return_0;
 
+	if (cmd->dmeventd_batch) {
+		if (!(item = dm_pool_alloc(cmd->mem, sizeof(*item)))) {
+			dm_event_handler_destroy(dmevh);
+			return_0;
+		}
+		item->dmevh = dmevh;
+		item->set = set;
+		dm_list_add(cmd->dmeventd_batch, &item->list);
+		log_debug_activation("Queued %smonitoring of %s for events.", set ? "" : "un", uuid);
+		return 1;
+	}
+
 	r = set ? dm_event_register_handler(dmevh) : dm_event_unregister_handler(dmevh);
 
 	dm_event_handler_destroy(dmevh);
@@ -2009,6 +2087,10 @@ int monitor_dev_for_events(struct cmd_context *cmd, const struct logical_volume
 			}
 		}
 
+		/* Queued [un]monitor is checked when sent to dmeventd */
+		if (cmd->dmeventd_batch)
+			continue;
+
 		/* Check [un]monitor results */
 		/* Try a couple times if pending, but not forever... */
 		for (i = 0;; i++) {
@@ -2038,6 +2120,74 @@ int monitor_dev_for_events(struct cmd_context *cmd, const struct logical_volume
 #endif
 }
 
+/*
+ * Queue dmeventd (un)registrations of the following monitor_dev_for_events()
+ * calls, so that monitor_dev_for_events_flush() sends them to dmeventd
+ * in one request instead of one request per device.
+ */
+int monitor_dev_for_events_batch(struct cmd_context *cmd)
+{
+#ifdef DMEVENTD
+	if (cmd->dmeventd_batch)
+		return 1;
+
+	if (!(cmd->dmeventd_batch = dm_pool_alloc(cmd->mem, sizeof(*cmd->dmeventd_batch))))
+		return_0;
+
+	dm_list_init(cmd->dmeventd_batch);
+#endif
+	return 1;
+}
+
+/*
+ * Send the queued (un)registrations to dmeventd and stop queueing.
+ * Returns 0 if any of them failed.
+ */
+int monitor_dev_for_events_flush(struct cmd_context *cmd)
+{
+#ifdef DMEVENTD
+	struct dmeventd_batch_item *item;
+	struct dm_event_handler **dmevhs;
+	unsigned count;
+	int set, r = 1;
+
+	if (!cmd->dmeventd_batch)
+		return 1;
+
+	if (!(dmevhs = dm_pool_alloc(cmd->mem, dm_list_size(cmd->dmeventd_batch) * sizeof(*dmevhs)))) {
+		log_error("Failed to allocate dmeventd registrations.");
+		r = 0;
+		goto out;
+	}
+
+	for (set = 0; set < 2; set++) {
+		count = 0;
+		dm_list_iterate_items(item, cmd->dmeventd_batch)
+			if (item->set == set)
+				dmevhs[count++] = item->dmevh;
+
+		if (!count)
+			continue;
+
+		log_debug_activation("Sending %u %sregistrations to dmeventd.",
+				     count, set ? "" : "un");
+
+		if (!(set ? dm_event_register_handlers(dmevhs, count) :
+		      dm_event_unregister_handlers(dmevhs, count)))
+			r = 0;
+	}
+out:
+	dm_list_iterate_items(item, cmd->dmeventd_batch)
+		dm_event_handler_destroy(item->dmevh);
+
+	cmd->dmeventd_batch = NULL;
+
+	return r;
+#else
+	return 1;
+#endif
+}
+
 struct detached_lv_data {
 	const struct volume_group *vg_pre;
 	struct lv_activate_opts *laopts;
@@ -2063,6 +2213,36 @@ static int _preload_detached_lv(struct logical_volume *lv, void *data)
 	return 1;
 }
 
+/*
+ * Check the only change to an active origin is the addition of new
+ * snapshots, so the already existing snapshots keep identical tables.
+ */
+static int _lv_only_adds_snapshots(const struct logical_volume *lv,
+				   const struct logical_volume *lv_pre)
+{
+	const struct logical_volume *cow_pre;
+	const struct lv_segment *snap_seg, *snap_seg_pre;
+
+	if (!lv_is_origin(lv) || !lv_is_origin(lv_pre) ||
+	    lv_is_merging_origin(lv) || lv_is_merging_origin(lv_pre) ||
+	    (lv->size != lv_pre->size) ||
+	    (dm_list_size(&lv_pre->snapshot_segs) <= dm_list_size(&lv->snapshot_segs)))
+		return 0;
+
+	dm_list_iterate_items_gen(snap_seg, &lv->snapshot_segs, origin_list) {
+		if (!(cow_pre = find_lv_in_vg_by_lvid(lv_pre->vg, &snap_seg->cow->lvid)) ||
+		    !lv_is_cow(cow_pre) || lv_is_merging_cow(cow_pre) ||
+		    !(snap_seg_pre = find_snapshot(cow_pre)) ||
+		    (snap_seg_pre->origin != lv_pre) ||
+		    (snap_seg_pre->chunk_size != snap_seg->chunk_size) ||
+		    (cow_pre->size != snap_seg->cow->size) ||
+		    ((cow_pre->status ^ snap_seg->cow->status) & LVM_WRITE))
+			return 0;
+	}
+
+	return 1;
+}
+
 static int _lv_suspend(struct cmd_context *cmd, const char *lvid_s,
 		       struct lv_activate_opts *laopts, int error_if_not_suspended,
 	               const struct logical_volume *lv, const struct logical_volume *lv_pre)
@@ -2113,6 +2293,12 @@ static int _lv_suspend(struct cmd_context *cmd, const char *lvid_s,
 		laopts->origin_only = 0;
 	}
 
+	if (!laopts->origin_only && _lv_only_adds_snapshots(lv, lv_pre)) {
+		log_debug_activation("Not suspending existing snapshots of %s.",
+				     display_lvname(lv));
+		laopts->keep_snapshots_running = 1;
+	}
+
 	/*
 	 * Preload devices for the LV.
 	 * If the PVMOVE LV is being removed, it's only present in the old
@@ -2794,6 +2980,95 @@ int pv_uses_vg(struct physical_volume *pv,
 	return dev_manager_device_uses_vg(pv->dev, vg);
 }
 
+/* Metadata LV read by thin_check or cache_check */
+static const struct logical_volume *_checked_metadata_lv(const struct logical_volume *lv)
+{
+	if (lv_is_thin_pool(lv))
+		return first_seg(lv)->metadata_lv;
+
+	if (lv_is_cache(lv) && !lv_is_cache_vol(first_seg(lv)->pool_lv))
+		return first_seg(first_seg(lv)->pool_lv)->metadata_lv;
+
+	return NULL;
+}
+
+/*
+ * Check metadata of all inactive thin and cache pools of a VG with
+ * checking commands running in parallel before activating its LVs.
+ * Pool activations then only reuse the results. Metadata is read
+ * through read-only activated component LVs, which are deactivated
+ * again before returning.
+ */
+int activation_check_pools(struct cmd_context *cmd, struct volume_group *vg)
+{
+	int concurrency = find_config_tree_int(cmd, global_metadata_check_concurrency_CFG, NULL);
+	struct dm_list pool_lvs;
+	struct lv_list *lvl, *plvl, *tlvl;
+	const struct logical_volume *mlv;
+	int r = 1;
+
+	if (!activation() || test_mode() || (concurrency < 2) || vg_is_shared(vg))
+		return 1;
+
+	dm_list_init(&pool_lvs);
+
+	dm_list_iterate_items(lvl, &vg->lvs) {
+		if (!(mlv = _checked_metadata_lv(lvl->lv)) ||
+		    lv_is_active(lvl->lv) || lv_is_active(mlv))
+			continue;
+
+		if (!(plvl = dm_pool_alloc(cmd->mem, sizeof(*plvl))))
+			return_0;
+
+		plvl->lv = lvl->lv;
+		dm_list_add(&pool_lvs, &plvl->list);
+	}
+
+	/* Nothing to gain for a single pool */
+	if (dm_list_size(&pool_lvs) < 2)
+		return 1;
+
+	log_debug_activation("Checking metadata of %u pools in VG %s before activation.",
+			     dm_list_size(&pool_lvs), vg->name);
+
+	dm_list_iterate_items_safe(plvl, tlvl, &pool_lvs) {
+		if (!activate_lv(cmd, _checked_metadata_lv(plvl->lv))) {
+			log_debug_activation("Leaving metadata check of %s for its activation.",
+					     display_lvname(plvl->lv));
+			dm_list_del(&plvl->list);
+		}
+	}
+
+	if (!sync_local_dev_names(cmd))
+		stack;
+	else if (!dev_manager_check_pools(cmd, &pool_lvs, (unsigned) concurrency))
+		stack;
+
+	dm_list_iterate_items(plvl, &pool_lvs) {
+		mlv = _checked_metadata_lv(plvl->lv);
+		if (!deactivate_lv(cmd, mlv)) {
+			log_error("Failed to deactivate metadata LV %s.",
+				  display_lvname(mlv));
+			r = 0;
+		}
+	}
+
+	if (!sync_local_dev_names(cmd))
+		r = 0;
+
+	return r;
+}
+
+void activation_check_pools_release(struct cmd_context *cmd)
+{
+	dev_manager_check_pools_destroy(cmd);
+}
+
+void activation_lv_state_release(struct cmd_context *cmd)
+{
+	dev_manager_lv_state_release(cmd);
+}
+
 void activation_release(void)
 {
 	if (critical_section())
@@ -2964,6 +3239,10 @@ int suspend_lv(struct cmd_context *cmd, const struct logical_volume *lv)
 {
 	int ret;
 
+	/* Resume uses the precommitted VG, do not parse it while suspended. */
+	if (!vg_import_deferred_copy(lv->vg))
+		return_0;
+
 	critical_section_inc(cmd, "locking for suspend");
 
 	ret = lv_suspend_if_active(cmd, NULL, 0, 0, lv_committed(lv), lv);
@@ -2975,6 +3254,9 @@ int suspend_lv_origin(struct cmd_context *cmd, const struct logical_volume *lv)
 {
 	int ret;
 
+	if (!vg_import_deferred_copy(lv->vg))
+		return_0;
+
 	critical_section_inc(cmd, "locking for suspend");
 
 	ret = lv_suspend_if_active(cmd, NULL, 1, 0, lv_committed(lv), lv);
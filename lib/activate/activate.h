@@ -89,6 +89,7 @@ struct lv_activate_opts {
 				 * flags are persistent in udev db for any spurious event
 				 * that follows. */
 	unsigned resuming;	/* Set when resuming after a suspend. */
+	unsigned keep_snapshots_running; /* Origin only gains new snapshots. */
 	const struct logical_volume *component_lv;
 };
 
@@ -120,6 +121,10 @@ int list_lv_modules(struct dm_pool *mem, const struct logical_volume *lv,
 void activation_release(void);
 void activation_exit(void);
 
+int activation_check_pools(struct cmd_context *cmd, struct volume_group *vg);
+void activation_check_pools_release(struct cmd_context *cmd);
+void activation_lv_state_release(struct cmd_context *cmd);
+
 /* int lv_suspend(struct cmd_context *cmd, const char *lvid_s); */
 int lv_suspend_if_active(struct cmd_context *cmd, const char *lvid_s, unsigned origin_only, unsigned exclusive,
 			 const struct logical_volume *lv, const struct logical_volume *lv_pre);
@@ -183,6 +188,8 @@ int lv_check_transient(struct logical_volume *lv);
  * Returns 1 if percent has been set, else 0.
  */
 int lv_snapshot_percent(const struct logical_volume *lv, dm_percent_t *percent);
+int lv_origin_snapshots_percent(const struct logical_volume *origin,
+				dm_percent_t *percents);
 int lv_mirror_percent(struct cmd_context *cmd, const struct logical_volume *lv,
 		      int wait, dm_percent_t *percent, uint32_t *event_nr);
 int lv_raid_percent(const struct logical_volume *lv, dm_percent_t *percent);
@@ -227,6 +234,8 @@ int lv_has_target_type(struct dm_pool *mem, const struct logical_volume *lv,
 
 int monitor_dev_for_events(struct cmd_context *cmd, const struct logical_volume *lv,
 			   const struct lv_activate_opts *laopts, int monitor);
+int monitor_dev_for_events_batch(struct cmd_context *cmd);
+int monitor_dev_for_events_flush(struct cmd_context *cmd);
 
 #ifdef DMEVENTD
 #  include "daemons/dmeventd/libdevmapper-event.h"
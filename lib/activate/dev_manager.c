@@ -27,9 +27,12 @@
 #include "lib/misc/lvm-exec.h"
 #include "lib/datastruct/str_list.h"
 #include "lib/misc/lvm-signal.h"
+#include "lib/misc/crc.h"
+#include "device_mapper/misc/dm-ioctl.h"
 
 #include <limits.h>
 #include <dirent.h>
+#include <sys/wait.h>
 
 #define MAX_TARGET_PARAMSIZE 50000
 #define LVM_UDEV_NOSCAN_FLAG DM_SUBSYSTEM_UDEV_FLAG0
@@ -956,12 +959,287 @@ int dev_manager_get_device_list(const char *prefix, struct dm_list **devs, unsig
 	return r;
 }
 
+/*
+ * Activation state of the LVs of one VG, kept between commands in
+ * a file in LV_STATE_DIR named by the VG id.  It records dm info of
+ * active LVs by their dm uuid.  Recorded info is only used while the
+ * VG seqno is unchanged and DM_DEVICE_LIST, run once for all LVs,
+ * reports the device with the same number and event number, so
+ * commands know whether an LV is active without per-LV ioctls.
+ * Anything else falls back to querying the device.
+ */
+struct lv_state_cache {
+	struct dm_pool *mem;
+	struct dm_hash_table *states;	/* indexed by dm uuid */
+	struct dm_list *devs;		/* from DM_DEVICE_LIST */
+	char vgid[ID_LEN + 1];
+	uint32_t seqno;
+	unsigned dirty:1;
+};
+
+struct lv_state {
+	uint32_t major;
+	uint32_t minor;
+	uint32_t event_nr;
+	int read_only;
+	int32_t target_count;
+};
+
+static int _lv_state_path(const char *vgid, char *path, size_t size)
+{
+	if (dm_snprintf(path, size, "%s/%s", LV_STATE_DIR, vgid) < 0) {
+		log_debug_activation("Path for LV state of VG %s is too long.", vgid);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _lv_state_store(struct lv_state_cache *lsc, const char *dlid,
+			   const struct lv_state *state)
+{
+	struct lv_state *st;
+
+	if (!(st = dm_hash_lookup(lsc->states, dlid))) {
+		if (!(st = dm_pool_alloc(lsc->mem, sizeof(*st))))
+			return_0;
+
+		if (!dm_hash_insert(lsc->states, dlid, st)) {
+			log_error("Failed to store LV state of %s.", dlid);
+			return 0;
+		}
+	}
+
+	*st = *state;
+
+	return 1;
+}
+
+static void _lv_state_read(struct lv_state_cache *lsc)
+{
+	char path[PATH_MAX];
+	char dlid[DM_UUID_LEN + 1];
+	char buf[256];
+	struct lv_state state;
+	uint32_t seqno;
+	FILE *fp;
+
+	if (!_lv_state_path(lsc->vgid, path, sizeof(path)) ||
+	    !(fp = fopen(path, "r")))
+		return;
+
+	if (!fgets(buf, sizeof(buf), fp) ||
+	    (sscanf(buf, "seqno %" SCNu32, &seqno) != 1) ||
+	    (seqno != lsc->seqno)) {
+		log_debug_activation("Ignoring LV state for other metadata in %s.", path);
+		goto out;
+	}
+
+	while (fgets(buf, sizeof(buf), fp))
+		if ((sscanf(buf, "%" DM_TO_STRING(DM_UUID_LEN) "s %" SCNu32 " %" SCNu32 " %" SCNu32 " %d %" SCNd32,
+			    dlid, &state.major, &state.minor, &state.event_nr,
+			    &state.read_only, &state.target_count) != 6) ||
+		    !_lv_state_store(lsc, dlid, &state)) {
+			log_debug_activation("Ignoring invalid LV state in %s.", path);
+			dm_hash_wipe(lsc->states);
+			break;
+		}
+out:
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+}
+
+static void _lv_state_write(struct lv_state_cache *lsc)
+{
+	char path[PATH_MAX], tmp_path[PATH_MAX];
+	struct dm_hash_node *n;
+	const struct lv_state *st;
+	FILE *fp;
+
+	if (!_lv_state_path(lsc->vgid, path, sizeof(path)) ||
+	    (dm_snprintf(tmp_path, sizeof(tmp_path), "%s.%d", path, (int) getpid()) < 0) ||
+	    !dm_create_dir(LV_STATE_DIR))
+		return;
+
+	if (!(fp = fopen(tmp_path, "w"))) {
+		log_sys_debug("fopen", tmp_path);
+		return;
+	}
+
+	fprintf(fp, "seqno %" PRIu32 "\n", lsc->seqno);
+
+	dm_hash_iterate(n, lsc->states) {
+		st = dm_hash_get_data(lsc->states, n);
+		fprintf(fp, "%s %" PRIu32 " %" PRIu32 " %" PRIu32 " %d %" PRId32 "\n",
+			dm_hash_get_key(lsc->states, n), st->major, st->minor,
+			st->event_nr, st->read_only, st->target_count);
+	}
+
+	/* Readers see either the old or the new file. */
+	if (dm_fclose(fp))
+		log_sys_debug("fclose", tmp_path);
+	else if (!rename(tmp_path, path))
+		return;
+	else
+		log_sys_debug("rename", tmp_path);
+
+	if (unlink(tmp_path))
+		log_sys_debug("unlink", tmp_path);
+}
+
+static void _lv_state_cache_destroy(struct cmd_context *cmd)
+{
+	struct lv_state_cache *lsc = cmd->lv_state_cache;
+
+	if (!lsc)
+		return;
+
+	dm_device_list_destroy(&lsc->devs);
+	if (lsc->states)
+		dm_hash_destroy(lsc->states);
+	if (lsc->mem)
+		dm_pool_destroy(lsc->mem);
+	free(lsc);
+	cmd->lv_state_cache = NULL;
+}
+
+static struct lv_state_cache *_lv_state_cache_get(struct cmd_context *cmd,
+						  const struct volume_group *vg)
+{
+	struct lv_state_cache *lsc = cmd->lv_state_cache;
+	unsigned devs_features = 0;
+
+	if (!cmd->use_lv_state_cache || cmd->disable_dm_devs)
+		return NULL;
+
+	if (lsc && !memcmp(lsc->vgid, &vg->id, ID_LEN) &&
+	    (lsc->seqno == vg->seqno))
+		return lsc;
+
+	dev_manager_lv_state_release(cmd);
+
+	if (!(lsc = zalloc(sizeof(*lsc))))
+		return_NULL;
+
+	cmd->lv_state_cache = lsc;
+	memcpy(lsc->vgid, &vg->id, ID_LEN);
+	lsc->seqno = vg->seqno;
+
+	if (!(lsc->mem = dm_pool_create("lv_state", 1024)) ||
+	    !(lsc->states = dm_hash_create(128)))
+		goto_bad;
+
+	if (!dev_manager_get_device_list(NULL, &lsc->devs, &devs_features))
+		goto_bad;
+
+	if (!(devs_features & DM_DEVICE_LIST_HAS_UUID) ||
+	    !(devs_features & DM_DEVICE_LIST_HAS_EVENT_NR)) {
+		log_debug_activation("Device list does not provide uuids and event numbers "
+				     "for LV state cache.");
+		goto bad;
+	}
+
+	_lv_state_read(lsc);
+
+	return lsc;
+
+bad:
+	/* Do not try again within this command. */
+	cmd->use_lv_state_cache = 0;
+	_lv_state_cache_destroy(cmd);
+
+	return NULL;
+}
+
+static int _lv_state_cached(struct lv_state_cache *lsc, const char *dlid,
+			    const struct dm_active_device *dm_dev,
+			    struct dm_info *dminfo)
+{
+	const struct lv_state *st;
+
+	if (!(st = dm_hash_lookup(lsc->states, dlid)) ||
+	    (st->major != (uint32_t) dm_dev->major) ||
+	    (st->minor != (uint32_t) dm_dev->minor) ||
+	    (st->event_nr != dm_dev->event_nr))
+		return 0;
+
+	memset(dminfo, 0, sizeof(*dminfo));
+	dminfo->exists = 1;
+	dminfo->live_table = 1;
+	dminfo->major = st->major;
+	dminfo->minor = st->minor;
+	dminfo->event_nr = st->event_nr;
+	dminfo->read_only = st->read_only;
+	dminfo->target_count = st->target_count;
+
+	return 1;
+}
+
+static void _lv_state_update(struct lv_state_cache *lsc, const char *dlid,
+			     const struct dm_active_device *dm_dev,
+			     const struct dm_info *dminfo)
+{
+	struct lv_state state = {
+		.major = dminfo->major,
+		.minor = dminfo->minor,
+		.event_nr = dminfo->event_nr,
+		.read_only = dminfo->read_only,
+		.target_count = dminfo->target_count,
+	};
+
+	/* Only settled devices that did not change since being listed. */
+	if (!dminfo->exists || !dminfo->live_table || dminfo->inactive_table ||
+	    dminfo->suspended || dminfo->internal_suspend ||
+	    (dminfo->major != (uint32_t) dm_dev->major) ||
+	    (dminfo->minor != (uint32_t) dm_dev->minor) ||
+	    (dminfo->event_nr != dm_dev->event_nr))
+		return;
+
+	if (_lv_state_store(lsc, dlid, &state))
+		lsc->dirty = 1;
+}
+
+/*
+ * Write recorded LV states for the next command and drop the cache,
+ * as the device list is not valid anymore once the VG is unlocked.
+ */
+void dev_manager_lv_state_release(struct cmd_context *cmd)
+{
+	struct lv_state_cache *lsc = cmd->lv_state_cache;
+
+	if (lsc && lsc->dirty)
+		_lv_state_write(lsc);
+
+	_lv_state_cache_destroy(cmd);
+}
+
+/* LVs of the VG are going to change, so forget their recorded states. */
+static void _lv_state_forget(struct cmd_context *cmd, const struct volume_group *vg)
+{
+	char vgid[ID_LEN + 1];
+	char path[PATH_MAX];
+
+	_lv_state_cache_destroy(cmd);
+
+	if (!cmd->use_lv_state_cache)
+		return;
+
+	memcpy(vgid, &vg->id, ID_LEN);
+	vgid[ID_LEN] = 0;
+
+	if (_lv_state_path(vgid, path, sizeof(path)) &&
+	    unlink(path) && (errno != ENOENT))
+		log_sys_debug("unlink", path);
+}
+
 int dev_manager_info(struct cmd_context *cmd,
 		     const struct logical_volume *lv, const char *layer,
 		     int with_open_count, int with_read_ahead, int with_name_check,
 		     struct dm_info *dminfo, uint32_t *read_ahead,
 		     struct lv_seg_status *seg_status)
 {
+	struct lv_state_cache *lsc = NULL;
+	const struct dm_active_device *dm_dev = NULL;
 	char *dlid, *name;
 	int r = 0;
 
@@ -981,10 +1259,29 @@ int dev_manager_info(struct cmd_context *cmd,
 		goto out;
 	}
 
+	if (dminfo && (lsc = _lv_state_cache_get(cmd, lv->vg))) {
+		if (!dm_device_list_find_by_uuid(lsc->devs, dlid, &dm_dev)) {
+			log_debug_activation("Listed as inactive %s.", name);
+			memset(dminfo, 0, sizeof(*dminfo));
+			r = 1;
+			goto out;
+		}
+
+		/* Open count, read ahead and status change without events. */
+		if (!with_open_count && !with_read_ahead && !seg_status &&
+		    _lv_state_cached(lsc, dlid, dm_dev, dminfo)) {
+			log_debug_activation("Cached as active %s.", name);
+			r = 1;
+			goto out;
+		}
+	}
+
 	if (!(r = _info(cmd, name, dlid,
 			with_open_count, with_read_ahead, with_name_check,
 			dminfo, read_ahead, seg_status)))
 		stack;
+	else if (lsc && dm_dev)
+		_lv_state_update(lsc, dlid, dm_dev, dminfo);
 out:
 	dm_pool_free(cmd->mem, name);
 
@@ -2523,32 +2820,35 @@ static int _check_tool_version(struct cmd_context *cmd, const char *tool,
 	return ret;
 }
 
-static int _pool_callback(struct dm_tree_node *node,
-			  dm_node_callback_t type, void *cb_data)
+/*
+ * Build the check command line for pool metadata.
+ * Returns 1 with argv[0] set to NULL when no check is needed.
+ */
+static int _pool_check_argv(struct cmd_context *cmd, struct dm_pool *mem,
+			    const struct pool_cb_data *data, const char **argv)
 {
-	int ret, status = 0, fd;
-	const struct pool_cb_data *data = cb_data;
 	const struct logical_volume *pool_lv = data->pool_lv;
 	const struct logical_volume *mlv = first_seg(pool_lv)->metadata_lv;
-	struct cmd_context *cmd = pool_lv->vg->cmd;
 	long buf[64 / sizeof(long)]; /* buffer for short disk header (64B) */
 	int args = 0;
+	int i, fd;
 	char *mpath;
-	const char *argv[DEFAULT_MAX_EXEC_ARGS + 7] = { /* Max supported 15 args */
-		find_config_tree_str_allow_empty(cmd, data->exec, NULL)
-	};
 
-	if (!argv[0] || !*argv[0]) /* *_check tool is unconfigured/disabled with "" setting */
+	argv[0] = find_config_tree_str_allow_empty(cmd, data->exec, NULL);
+
+	if (!argv[0] || !*argv[0]) { /* *_check tool is unconfigured/disabled with "" setting */
+		argv[0] = NULL;
 		return 1;
+	}
 
 	if (lv_is_cache_vol(pool_lv)) {
-		if (!(mpath = lv_dmpath_suffix_dup(data->dm->mem, pool_lv, "-cmeta"))) {
+		if (!(mpath = lv_dmpath_suffix_dup(mem, pool_lv, "-cmeta"))) {
 			log_error("Failed to build device path for checking cachevol metadata %s.",
 			  	 display_lvname(pool_lv));
 			return 0;
 		}
 	} else {
-		if (!(mpath = lv_dmpath_dup(data->dm->mem, mlv))) {
+		if (!(mpath = lv_dmpath_dup(mem, mlv))) {
 			log_error("Failed to build device path for checking pool metadata %s.",
 			  	 display_lvname(mlv));
 			return 0;
@@ -2571,16 +2871,17 @@ static int _pool_callback(struct dm_tree_node *node,
 				log_sys_error("close", mpath);
 			return 0;
 		}
-		for (ret = 0; ret < (int) DM_ARRAY_SIZE(buf); ++ret)
-			if (buf[ret])
+		for (i = 0; i < (int) DM_ARRAY_SIZE(buf); ++i)
+			if (buf[i])
 				break;
 
 		if (close(fd))
 			log_sys_error("close", mpath);
 
-		if (ret == (int) DM_ARRAY_SIZE(buf)) {
+		if (i == (int) DM_ARRAY_SIZE(buf)) {
 			log_debug_activation("Metadata checking skipped, detected empty disk header on %s.",
 					     mpath);
+			argv[0] = NULL;
 			return 1;
 		}
 	}
@@ -2590,64 +2891,282 @@ static int _pool_callback(struct dm_tree_node *node,
 
 	argv[++args] = mpath;
 
-	if (!(ret = exec_cmd(cmd, (const char * const *)argv,
-			     &status, 0))) {
-		if (status == ENOENT) {
-			log_warn("WARNING: Check is skipped, please install recommended missing binary %s!",
-				 argv[0]);
-			return 1;
-		}
+	return 1;
+}
 
-		if ((data->version.maj || data->version.min || data->version.patch) &&
-		    !_check_tool_version(cmd, argv[0],
-					 data->version.maj, data->version.min, data->version.patch)) {
-			log_warn("WARNING: Check is skipped, please upgrade installed version of %s!",
-				 argv[0]);
-			return 1;
-		}
-		switch (type) {
-		case DM_NODE_CALLBACK_PRELOADED:
-			log_err_once("Check of pool %s failed (status:%d). "
-				     "Manual repair required!",
-				     display_lvname(pool_lv), status);
-			break;
-		default:
-			log_warn("WARNING: Integrity check of metadata for pool "
-				 "%s failed.", display_lvname(pool_lv));
-		}
-		/*
-		 * FIXME: What should we do here??
-		 *
-		 * Maybe mark the node, so it's not activating
-		 * as pool but as error/linear and let the
-		 * dm tree resolve the issue.
-		 */
+/*
+ * Failed check is ignored when the checking tool
+ * is not installed or its version is too old.
+ */
+static int _pool_check_ignored(struct cmd_context *cmd, const struct pool_cb_data *data,
+			       const char *const *argv, int status)
+{
+	if (status == ENOENT) {
+		log_warn("WARNING: Check is skipped, please install recommended missing binary %s!",
+			 argv[0]);
+		return 1;
 	}
 
-	return ret;
+	if ((data->version.maj || data->version.min || data->version.patch) &&
+	    !_check_tool_version(cmd, argv[0],
+				 data->version.maj, data->version.min, data->version.patch)) {
+		log_warn("WARNING: Check is skipped, please upgrade installed version of %s!",
+			 argv[0]);
+		return 1;
+	}
+
+	return 0;
 }
 
-static int _pool_register_callback(struct dev_manager *dm,
-				   struct dm_tree_node *node,
-				   const struct logical_volume *lv)
+static void _pool_check_failed(const struct logical_volume *pool_lv,
+			       dm_node_callback_t type, int status)
 {
-	struct pool_cb_data *data;
+	switch (type) {
+	case DM_NODE_CALLBACK_PRELOADED:
+		log_err_once("Check of pool %s failed (status:%d). "
+			     "Manual repair required!",
+			     display_lvname(pool_lv), status);
+		break;
+	default:
+		log_warn("WARNING: Integrity check of metadata for pool "
+			 "%s failed.", display_lvname(pool_lv));
+	}
+	/*
+	 * FIXME: What should we do here??
+	 *
+	 * Maybe mark the node, so it's not activating
+	 * as pool but as error/linear and let the
+	 * dm tree resolve the issue.
+	 */
+}
 
-	/* Do not skip metadata of testing even for unused thin pools */
-#if 0
-	/* Skip metadata testing for unused thin pool. */
-	if (lv_is_thin_pool(lv) &&
-	    (!first_seg(lv)->transaction_id ||
-	     ((first_seg(lv)->transaction_id == 1) &&
-	      pool_has_message(first_seg(lv), NULL, 0))))
-		return 1;
-#endif
+/*
+ * Results of metadata checks run for many pools at once
+ * before their activation, see dev_manager_check_pools().
+ */
+struct pool_check_results {
+	struct dm_pool *mem;
+	struct dm_hash_table *results;	/* indexed by pool lvid */
+};
 
-	if (!(data = dm_pool_zalloc(dm->mem, sizeof(*data)))) {
-		log_error("Failed to allocated path for callback.");
+struct pool_check_result {
+	uint64_t transaction_id;
+	int failed;
+	int status;
+};
+
+static uint64_t _pool_check_transaction_id(const struct logical_volume *pool_lv)
+{
+	return lv_is_thin_pool(pool_lv) ? first_seg(pool_lv)->transaction_id : 0;
+}
+
+static int _pool_check_store(struct pool_check_results *pcr,
+			     const struct logical_volume *pool_lv,
+			     int failed, int status)
+{
+	struct pool_check_result *res;
+
+	if (!(res = dm_pool_zalloc(pcr->mem, sizeof(*res))))
+		return_0;
+
+	res->transaction_id = _pool_check_transaction_id(pool_lv);
+	res->failed = failed;
+	res->status = status;
+
+	if (!dm_hash_insert_binary(pcr->results, &pool_lv->lvid.id,
+				   sizeof(pool_lv->lvid.id), res)) {
+		log_error("Failed to store metadata check result of pool %s.",
+			  display_lvname(pool_lv));
 		return 0;
 	}
 
+	return 1;
+}
+
+static const struct pool_check_result *_pool_check_lookup(struct cmd_context *cmd,
+							  const struct logical_volume *pool_lv)
+{
+	const struct pool_check_result *res;
+
+	if (!cmd->pool_check_results ||
+	    !(res = dm_hash_lookup_binary(cmd->pool_check_results->results,
+					  &pool_lv->lvid.id, sizeof(pool_lv->lvid.id))) ||
+	    (res->transaction_id != _pool_check_transaction_id(pool_lv)))
+		return NULL;
+
+	return res;
+}
+
+/*
+ * Key of a successful check: the metadata superblock, which changes
+ * with every metadata commit, and the command line used for the check.
+ */
+static int _pool_check_key(const char *const *argv, uint32_t *key)
+{
+	uint8_t buf[4096]; /* metadata superblock block */
+	const char *mpath;
+	ssize_t len;
+	int i, fd;
+
+	for (i = 0; argv[i + 1]; ++i)
+		;
+	mpath = argv[i];
+
+	if ((fd = open(mpath, O_RDONLY)) < 0) {
+		log_sys_debug("open", mpath);
+		return 0;
+	}
+
+	len = read(fd, buf, sizeof(buf));
+
+	if (close(fd))
+		log_sys_debug("close", mpath);
+
+	if (len != (ssize_t) sizeof(buf)) {
+		log_sys_debug("read", mpath);
+		return 0;
+	}
+
+	*key = calc_crc(INITIAL_CRC, buf, sizeof(buf));
+
+	for (i = 0; argv[i] != mpath; ++i)
+		*key = calc_crc(*key, (const uint8_t *) argv[i], strlen(argv[i]) + 1);
+
+	return 1;
+}
+
+static int _pool_check_state_path(const struct logical_volume *pool_lv,
+				  char *path, size_t size)
+{
+	if (dm_snprintf(path, size, "%s/%.*s", POOL_CHECK_DIR,
+			(int) sizeof(pool_lv->lvid.id), pool_lv->lvid.s) < 0) {
+		log_debug_activation("Path for metadata check state of %s is too long.",
+				     display_lvname(pool_lv));
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Check passed with the same superblock, command line and transaction_id
+ * since the pool was last deactivated, so it does not need to run again.
+ */
+static int _pool_check_unchanged(struct cmd_context *cmd,
+				 const struct logical_volume *pool_lv,
+				 const char *const *argv)
+{
+	char path[PATH_MAX];
+	char buf[64];
+	uint64_t transaction_id;
+	uint32_t key, file_key;
+	FILE *fp;
+	int r = 0;
+
+	if (!find_config_tree_bool(cmd, global_metadata_check_cache_CFG, NULL) ||
+	    !_pool_check_state_path(pool_lv, path, sizeof(path)) ||
+	    !(fp = fopen(path, "r")))
+		return 0;
+
+	if (fgets(buf, sizeof(buf), fp) &&
+	    (sscanf(buf, FMTu64 " %" SCNx32, &transaction_id, &file_key) == 2) &&
+	    (transaction_id == _pool_check_transaction_id(pool_lv)) &&
+	    _pool_check_key(argv, &key) && (key == file_key)) {
+		log_verbose("Skipping check of unchanged metadata of pool %s.",
+			    display_lvname(pool_lv));
+		r = 1;
+	}
+
+	if (fclose(fp))
+		log_sys_debug("fclose", path);
+
+	return r;
+}
+
+static void _pool_check_remember(struct cmd_context *cmd,
+				 const struct logical_volume *pool_lv,
+				 const char *const *argv)
+{
+	char path[PATH_MAX];
+	uint32_t key;
+	FILE *fp;
+
+	if (!find_config_tree_bool(cmd, global_metadata_check_cache_CFG, NULL) ||
+	    !_pool_check_key(argv, &key) ||
+	    !_pool_check_state_path(pool_lv, path, sizeof(path)) ||
+	    !dm_create_dir(POOL_CHECK_DIR))
+		return;
+
+	if (!(fp = fopen(path, "w"))) {
+		log_sys_debug("fopen", path);
+		return;
+	}
+
+	fprintf(fp, FMTu64 " %08" PRIx32 "\n", _pool_check_transaction_id(pool_lv), key);
+
+	if (dm_fclose(fp)) {
+		log_sys_debug("fclose", path);
+		if (unlink(path))
+			log_sys_debug("unlink", path);
+	}
+}
+
+static void _pool_check_forget(const struct logical_volume *pool_lv)
+{
+	char path[PATH_MAX];
+
+	if (_pool_check_state_path(pool_lv, path, sizeof(path)) &&
+	    unlink(path) && (errno != ENOENT))
+		log_sys_debug("unlink", path);
+}
+
+static int _pool_callback(struct dm_tree_node *node,
+			  dm_node_callback_t type, void *cb_data)
+{
+	int ret, status = 0;
+	const struct pool_cb_data *data = cb_data;
+	const struct logical_volume *pool_lv = data->pool_lv;
+	struct cmd_context *cmd = pool_lv->vg->cmd;
+	const struct pool_check_result *res;
+	const char *argv[DEFAULT_MAX_EXEC_ARGS + 7] = { 0 }; /* Max supported 15 args */
+
+	if ((type == DM_NODE_CALLBACK_PRELOADED) &&
+	    (res = _pool_check_lookup(cmd, pool_lv))) {
+		log_debug_activation("Using result of metadata check run before activation of pool %s.",
+				     display_lvname(pool_lv));
+		if (!res->failed)
+			return 1;
+		_pool_check_failed(pool_lv, type, res->status);
+		return 0;
+	}
+
+	if (!_pool_check_argv(cmd, data->dm->mem, data, argv))
+		return_0;
+
+	if (!argv[0])
+		return 1;
+
+	if ((type == DM_NODE_CALLBACK_PRELOADED) &&
+	    _pool_check_unchanged(cmd, pool_lv, argv))
+		return 1;
+
+	if (!(ret = exec_cmd(cmd, (const char * const *)argv,
+			     &status, 0))) {
+		_pool_check_forget(pool_lv);
+
+		if (_pool_check_ignored(cmd, data, argv, status))
+			return 1;
+
+		_pool_check_failed(pool_lv, type, status);
+	} else
+		_pool_check_remember(cmd, pool_lv, argv);
+
+	return ret;
+}
+
+static int _pool_cb_data_init(struct pool_cb_data *data, struct dev_manager *dm,
+			      const struct logical_volume *lv)
+{
 	data->dm = dm;
 
 	if (lv_is_thin_pool(lv)) {
@@ -2671,11 +3190,189 @@ static int _pool_register_callback(struct dev_manager *dm,
 		return 0;
 	}
 
+	return 1;
+}
+
+static int _pool_register_callback(struct dev_manager *dm,
+				   struct dm_tree_node *node,
+				   const struct logical_volume *lv)
+{
+	struct pool_cb_data *data;
+
+	/* Do not skip metadata of testing even for unused thin pools */
+#if 0
+	/* Skip metadata testing for unused thin pool. */
+	if (lv_is_thin_pool(lv) &&
+	    (!first_seg(lv)->transaction_id ||
+	     ((first_seg(lv)->transaction_id == 1) &&
+	      pool_has_message(first_seg(lv), NULL, 0))))
+		return 1;
+#endif
+
+	if (!(data = dm_pool_zalloc(dm->mem, sizeof(*data)))) {
+		log_error("Failed to allocated path for callback.");
+		return 0;
+	}
+
+	if (!_pool_cb_data_init(data, dm, lv))
+		return_0;
+
 	dm_tree_node_set_callback(node, _pool_callback, data);
 
 	return 1;
 }
 
+struct pool_check_job {
+	struct pool_cb_data data;
+	const char *argv[DEFAULT_MAX_EXEC_ARGS + 7];
+	pid_t pid;
+};
+
+/* Delay between polls of running checks */
+#define POOL_CHECK_POLL_USLEEP	10000
+
+/* Store the result of a finished check */
+static int _pool_check_finished(struct cmd_context *cmd, struct pool_check_results *pcr,
+				struct pool_check_job *job, int status)
+{
+	int rstatus = -1;
+
+	if (exec_cmd_finish(job->argv, job->pid, status, &rstatus))
+		_pool_check_remember(cmd, job->data.pool_lv, job->argv);
+	else
+		_pool_check_forget(job->data.pool_lv);
+
+	job->pid = 0;
+
+	if (!rstatus || _pool_check_ignored(cmd, &job->data, job->argv, rstatus))
+		return _pool_check_store(pcr, job->data.pool_lv, 0, 0);
+
+	return _pool_check_store(pcr, job->data.pool_lv, 1, rstatus);
+}
+
+/*
+ * Run metadata checks of given thin pools and cached LVs with
+ * up to 'concurrency' checking commands running in parallel.
+ * Metadata LVs have to be already active. Results are kept
+ * in the command context until dev_manager_check_pools_destroy()
+ * and used instead of running the check during pool activation
+ * as long as the pool's transaction_id remains the same.
+ * Pools without result are checked by their activation as usual.
+ */
+int dev_manager_check_pools(struct cmd_context *cmd, struct dm_list *pool_lvs,
+			    unsigned concurrency)
+{
+	struct pool_check_results *pcr;
+	struct pool_check_job *jobs, *job;
+	struct lv_list *lvl;
+	unsigned i, count = dm_list_size(pool_lvs), running = 0, finished;
+	int status, r = 1;
+	pid_t pid;
+
+	if (!count)
+		return 1;
+
+	if (!(pcr = cmd->pool_check_results)) {
+		if (!(pcr = zalloc(sizeof(*pcr))))
+			return_0;
+
+		if (!(pcr->mem = dm_pool_create("pool_check", 1024)) ||
+		    !(pcr->results = dm_hash_create(32))) {
+			log_error("Failed to allocate pool metadata check results.");
+			if (pcr->mem)
+				dm_pool_destroy(pcr->mem);
+			free(pcr);
+			return 0;
+		}
+
+		cmd->pool_check_results = pcr;
+	}
+
+	if (!(jobs = dm_pool_zalloc(pcr->mem, count * sizeof(*jobs))))
+		return_0;
+
+	i = 0;
+	dm_list_iterate_items(lvl, pool_lvs) {
+		job = &jobs[i++];
+		if (!_pool_cb_data_init(&job->data, NULL, lvl->lv) ||
+		    !_pool_check_argv(cmd, pcr->mem, &job->data, job->argv)) {
+			/* Leave the check for activation */
+			stack;
+			job->argv[0] = NULL;
+		} else if (!job->argv[0] ||
+			   _pool_check_unchanged(cmd, job->data.pool_lv, job->argv)) {
+			job->argv[0] = NULL;
+			if (!_pool_check_store(pcr, job->data.pool_lv, 0, 0))
+				return_0;
+		}
+	}
+
+	i = 0;
+	while ((i < count) || running) {
+		for (; (i < count) && (running < concurrency); ++i) {
+			job = &jobs[i];
+			if (!job->argv[0])
+				continue;
+			if (!(job->pid = exec_cmd_start(cmd, job->argv, 0))) {
+				stack;
+				continue;
+			}
+			running++;
+		}
+
+		if (!running)
+			break;
+
+		/*
+		 * Wait only for own children. In dmeventd other threads
+		 * run their own commands and wait for them.
+		 */
+		finished = 0;
+		for (job = jobs; job < jobs + count; ++job) {
+			if (!job->pid)
+				continue;
+
+			if (!(pid = waitpid(job->pid, &status, WNOHANG)))
+				continue;
+
+			if (pid < 0) {
+				if (errno == EINTR)
+					continue;
+				/* Without result the pool activation runs the check */
+				log_sys_debug("waitpid", job->argv[0]);
+				job->pid = 0;
+			} else if (!_pool_check_finished(cmd, pcr, job, status))
+				r = 0;
+
+			running--;
+			finished++;
+		}
+
+		if (!finished && running)
+			usleep(POOL_CHECK_POLL_USLEEP);
+	}
+
+	/* Do not leave any zombies behind on error */
+	for (job = jobs; job < jobs + count; ++job)
+		if (job->pid && (waitpid(job->pid, &status, 0) != job->pid))
+			log_sys_debug("waitpid", job->argv[0]);
+
+	return r;
+}
+
+void dev_manager_check_pools_destroy(struct cmd_context *cmd)
+{
+	struct pool_check_results *pcr = cmd->pool_check_results;
+
+	if (!pcr)
+		return;
+
+	dm_hash_destroy(pcr->results);
+	dm_pool_destroy(pcr->mem);
+	free(pcr);
+	cmd->pool_check_results = NULL;
+}
+
 /* Add special devices _cmeta & _cdata on top of CacheVol to dm tree */
 static int _add_cvol_subdev_to_dtree(struct dev_manager *dm, struct dm_tree *dtree,
 				     const struct logical_volume *lv, int meta_or_data)
@@ -3891,6 +4588,32 @@ static int _clean_tree(struct dev_manager *dm, struct dm_tree_node *root, const
 	return 1;
 }
 
+/*
+ * Existing snapshots of an origin stay unchanged when only new snapshots
+ * are added, so there is no need to suspend (and later resume) them.
+ */
+static int _keep_snapshots_running(struct dev_manager *dm, struct dm_tree *dtree,
+				   const struct logical_volume *lv)
+{
+	struct lv_segment *snap_seg;
+	struct dm_tree_node *dnode;
+	const char *dlid;
+
+	dm_list_iterate_items_gen(snap_seg, &lv->snapshot_segs, origin_list) {
+		if (!(dlid = build_dm_uuid(dm->mem, snap_seg->cow, NULL)))
+			return_0;
+
+		if (!(dnode = dm_tree_find_node_by_uuid(dtree, dlid)))
+			continue;
+
+		log_debug_activation("Keeping snapshot %s running.",
+				     display_lvname(snap_seg->cow));
+		dm_tree_node_set_keep_running(dnode);
+	}
+
+	return 1;
+}
+
 static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 			struct lv_activate_opts *laopts, action_t action)
 {
@@ -3903,6 +4626,7 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 	char *dlid;
 	int r = 0;
 	unsigned tmp_state;
+	int concurrency;
 
 	if (action < DM_ARRAY_SIZE(_action_names))
 		log_debug_activation("Creating %s%s tree for %s.",
@@ -3933,6 +4657,9 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 	if (!dtree)
 		return_0;
 
+	if (action != CLEAN)
+		_lv_state_forget(dm->cmd, lv->vg);
+
 	if (!(root = dm_tree_find_node(dtree, 0, 0))) {
 		log_error("Lost dependency tree root node.");
 		goto out_no_root;
@@ -3969,6 +4696,11 @@ static int _tree_action(struct dev_manager *dm, const struct logical_volume *lv,
 			dm_tree_use_no_flush_suspend(root);
 		/* Fall through */
 	case SUSPEND_WITH_LOCKFS:
+		if (laopts->keep_snapshots_running && lv_is_origin(lv) &&
+		    !_keep_snapshots_running(dm, dtree, lv))
+			goto_out;
+		if ((concurrency = find_config_tree_int(dm->cmd, activation_suspend_concurrency_CFG, NULL)) > 1)
+			dm_tree_set_suspend_concurrency(root, (unsigned) concurrency);
 		if (!dm_tree_suspend_children(root, dlid, DLID_SIZE))
 			goto_out;
 		break;
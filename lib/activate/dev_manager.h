@@ -95,6 +95,11 @@ int dev_manager_preload(struct dev_manager *dm, const struct logical_volume *lv,
 int dev_manager_deactivate(struct dev_manager *dm, const struct logical_volume *lv);
 int dev_manager_transient(struct dev_manager *dm, const struct logical_volume *lv) __attribute__((nonnull(1, 2)));
 
+int dev_manager_check_pools(struct cmd_context *cmd, struct dm_list *pool_lvs,
+			    unsigned concurrency);
+void dev_manager_check_pools_destroy(struct cmd_context *cmd);
+void dev_manager_lv_state_release(struct cmd_context *cmd);
+
 int dev_manager_mknodes(const struct logical_volume *lv);
 
 /*
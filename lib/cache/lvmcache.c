@@ -14,6 +14,8 @@
  */
 
 #include "base/memory/zalloc.h"
+#include "base/data-struct/radix-tree.h"
+#include "base/memory/container_of.h"
 #include "lib/misc/lib.h"
 #include "lib/cache/lvmcache.h"
 #include "lib/commands/toolcontext.h"
@@ -73,13 +75,18 @@ struct lvmcache_vginfo {
 
 /*
  * Each VG found during scan gets a vginfo struct.
- * Each vginfo is in _vginfos and _vgid_hash, and
- * _vgname_hash (unless disabled due to duplicate vgnames).
+ * Each vginfo is in _vginfos, _vginfo_tree and _vgid_tree, and
+ * _vgname_tree (unless disabled due to duplicate vgnames).
+ *
+ * _vginfo_tree is keyed by "vgname\0vgid", so every vginfo using
+ * a given VG name is found by iterating the "vgname\0" prefix, and
+ * a full iteration visits the VGs sorted by name.
  */
 
-static struct dm_hash_table *_pvid_hash = NULL;
-static struct dm_hash_table *_vgid_hash = NULL;
-static struct dm_hash_table *_vgname_hash = NULL;
+static struct radix_tree *_pvid_tree = NULL;
+static struct radix_tree *_vgid_tree = NULL;
+static struct radix_tree *_vgname_tree = NULL;
+static struct radix_tree *_vginfo_tree = NULL;
 static DM_LIST_INIT(_vginfos);
 static DM_LIST_INIT(_initial_duplicates);
 static DM_LIST_INIT(_unused_duplicates);
@@ -101,18 +108,112 @@ int lvmcache_init(struct cmd_context *cmd)
 	dm_list_init(&_unused_duplicates);
 	dm_list_init(&_prev_unused_duplicate_devs);
 
-	if (!(_vgname_hash = dm_hash_create(127)))
+	if (!(_vgname_tree = radix_tree_create(NULL, NULL)))
+		return 0;
+
+	if (!(_vginfo_tree = radix_tree_create(NULL, NULL)))
 		return 0;
 
-	if (!(_vgid_hash = dm_hash_create(126)))
+	if (!(_vgid_tree = radix_tree_create(NULL, NULL)))
 		return 0;
 
-	if (!(_pvid_hash = dm_hash_create(125)))
+	if (!(_pvid_tree = radix_tree_create(NULL, NULL)))
 		return 0;
 
 	return 1;
 }
 
+/*
+ * Index helpers.  PVIDs and VGIDs are not always null terminated,
+ * so their keys are limited to ID_LEN (orphan vginfos use the
+ * shorter orphan VG name as their vgid).
+ */
+static void *_tree_lookup(struct radix_tree *rt, const char *key, size_t len)
+{
+	union radix_value v;
+
+	if (!rt || !radix_tree_lookup(rt, (uint8_t *) key, (uint8_t *) key + len, &v))
+		return NULL;
+
+	return v.ptr;
+}
+
+static int _tree_insert(struct radix_tree *rt, const char *key, size_t len, void *ptr)
+{
+	union radix_value v = { .ptr = ptr };
+
+	return radix_tree_insert(rt, (uint8_t *) key, (uint8_t *) key + len, v);
+}
+
+static void _tree_remove(struct radix_tree *rt, const char *key, size_t len)
+{
+	(void) radix_tree_remove(rt, (uint8_t *) key, (uint8_t *) key + len);
+}
+
+#define _id_len(id) strnlen((id), ID_LEN)
+
+static struct lvmcache_info *_pvid_lookup(const char *pvid)
+{
+	return _tree_lookup(_pvid_tree, pvid, _id_len(pvid));
+}
+
+static struct lvmcache_vginfo *_vgid_lookup(const char *vgid)
+{
+	return _tree_lookup(_vgid_tree, vgid, _id_len(vgid));
+}
+
+static struct lvmcache_vginfo *_vgname_lookup(const char *vgname)
+{
+	return _tree_lookup(_vgname_tree, vgname, strlen(vgname));
+}
+
+/*
+ * Build the "vgname\0vgid" key of _vginfo_tree in buf, or in
+ * an allocated buffer if the name is too long for it.
+ */
+static char *_vginfo_key(const char *vgname, const char *vgid,
+			 char *buf, size_t size, size_t *len)
+{
+	size_t name_len = strlen(vgname) + 1;
+	size_t id_len = vgid ? _id_len(vgid) : 0;
+	char *key = buf;
+
+	*len = name_len + id_len;
+
+	if ((*len > size) && !(key = malloc(*len)))
+		return_NULL;
+
+	memcpy(key, vgname, name_len);
+	if (id_len)
+		memcpy(key + name_len, vgid, id_len);
+
+	return key;
+}
+
+static int _vginfo_tree_update(struct lvmcache_vginfo *vginfo, int insert)
+{
+	char buf[NAME_LEN + ID_LEN + 2];
+	char *key;
+	size_t len;
+	int r = 1;
+
+	if (!(key = _vginfo_key(vginfo->vgname, vginfo->vgid, buf, sizeof(buf), &len)))
+		return_0;
+
+	if (insert)
+		r = _tree_insert(_vginfo_tree, key, len, vginfo);
+	else if (_tree_lookup(_vginfo_tree, key, len) == vginfo)
+		_tree_remove(_vginfo_tree, key, len);
+
+	if (key != buf)
+		free(key);
+
+	return r;
+}
+
+#define _vginfo_tree_insert(vginfo) _vginfo_tree_update((vginfo), 1)
+#define _vginfo_tree_remove(vginfo) _vginfo_tree_update((vginfo), 0)
+
 void lvmcache_lock_vgname(const char *vgname, int read_only __attribute__((unused)))
 {
 	_vgs_locked++;
@@ -302,22 +403,41 @@ static void _vginfo_detach_info(struct lvmcache_info *info)
 	info->vginfo = NULL;
 }
 
-static struct lvmcache_vginfo *_search_vginfos_list(const char *vgname, const char *vgid)
-{
+struct vginfo_search {
+	struct radix_tree_iterator it;
 	struct lvmcache_vginfo *vginfo;
+};
 
-	if (vgid) {
-		dm_list_iterate_items(vginfo, &_vginfos) {
-			if (!memcmp(vgid, vginfo->vgid, ID_LEN))
-				return vginfo;
-		}
-	} else {
-		dm_list_iterate_items(vginfo, &_vginfos) {
-			if (!strcmp(vgname, vginfo->vgname))
-				return vginfo;
-		}
-	}
-	return NULL;
+static bool _visit_first_vginfo(struct radix_tree_iterator *it,
+				uint8_t *kb, uint8_t *ke, union radix_value v)
+{
+	struct vginfo_search *vs = container_of(it, struct vginfo_search, it);
+
+	vs->vginfo = v.ptr;
+
+	return false;
+}
+
+static struct lvmcache_vginfo *_search_vginfos(const char *vgname, const char *vgid)
+{
+	struct vginfo_search vs = { .it.visit = _visit_first_vginfo };
+	char buf[NAME_LEN + 2];
+	char *key;
+	size_t len;
+
+	if (vgid)
+		return _vgid_lookup(vgid);
+
+	/* First of any vginfos using this name, i.e. the "vgname\0" prefix. */
+	if (!(key = _vginfo_key(vgname, NULL, buf, sizeof(buf), &len)))
+		return_NULL;
+
+	radix_tree_iterate(_vginfo_tree, (uint8_t *) key, (uint8_t *) key + len, &vs.it);
+
+	if (key != buf)
+		free(key);
+
+	return vs.vginfo;
 }
 
 static struct lvmcache_vginfo *_vginfo_lookup(const char *vgname, const char *vgid_arg)
@@ -330,10 +450,10 @@ static struct lvmcache_vginfo *_vginfo_lookup(const char *vgname, const char *vg
 		memcpy(vgid, vgid_arg, ID_LEN);
 
 	if (vgid_arg) {
-		if ((vginfo = dm_hash_lookup(_vgid_hash, vgid))) {
+		if ((vginfo = _vgid_lookup(vgid))) {
 			if (vgname && strcmp(vginfo->vgname, vgname)) {
 				log_warn("WARNING: lookup found duplicate VGID %s for VGs %s and %s.", vgid, vginfo->vgname, vgname);
-				if ((vginfo = dm_hash_lookup(_vgname_hash, vgname))) {
+				if ((vginfo = _vgname_lookup(vgname))) {
 					if (!memcmp(vginfo->vgid, vgid, ID_LEN))
 						return vginfo;
 				}
@@ -347,7 +467,7 @@ static struct lvmcache_vginfo *_vginfo_lookup(const char *vgname, const char *vg
 	}
 
 	if (vgname && !_found_duplicate_vgnames) {
-		if ((vginfo = dm_hash_lookup(_vgname_hash, vgname))) {
+		if ((vginfo = _vgname_lookup(vgname))) {
 			if (vginfo->has_duplicate_local_vgname) {
 				/* should never happen, found_duplicate_vgnames should be set */
 				log_error(INTERNAL_ERROR "vginfo_lookup %s has_duplicate_local_vgname.", vgname);
@@ -358,7 +478,7 @@ static struct lvmcache_vginfo *_vginfo_lookup(const char *vgname, const char *vg
 	}
 
 	if (vgname && _found_duplicate_vgnames) {
-		if ((vginfo = _search_vginfos_list(vgname, vgid[0] ? vgid : NULL))) {
+		if ((vginfo = _search_vginfos(vgname, vgid[0] ? vgid : NULL))) {
 			if (vginfo->has_duplicate_local_vgname) {
 				log_debug("vginfo_lookup %s has_duplicate_local_vgname return none.", vgname);
 				return NULL;
@@ -400,10 +520,10 @@ const char *lvmcache_vgid_from_vgname(struct cmd_context *cmd, const char *vgnam
 	struct lvmcache_vginfo *vginfo;
 
 	if (_found_duplicate_vgnames) {
-		if (!(vginfo = _search_vginfos_list(vgname, NULL)))
+		if (!(vginfo = _search_vginfos(vgname, NULL)))
 			return NULL;
 	} else {
-		if (!(vginfo = dm_hash_lookup(_vgname_hash, vgname)))
+		if (!(vginfo = _vgname_lookup(vgname)))
 			return NULL;
 	}
 
@@ -426,10 +546,10 @@ bool lvmcache_has_duplicate_local_vgname(const char *vgid, const char *vgname)
 	struct lvmcache_vginfo *vginfo;
 
 	if (_found_duplicate_vgnames) {
-		if (!(vginfo = _search_vginfos_list(vgname, vgid)))
+		if (!(vginfo = _search_vginfos(vgname, vgid)))
 			return false;
 	} else {
-		if (!(vginfo = dm_hash_lookup(_vgname_hash, vgname)))
+		if (!(vginfo = _vgname_lookup(vgname)))
 			return false;
 	}
 
@@ -450,13 +570,13 @@ struct lvmcache_info *lvmcache_info_from_pvid(const char *pvid_arg, struct devic
 	char pvid[ID_LEN + 1] __attribute__((aligned(8))) = { 0 };
 	struct lvmcache_info *info;
 
-	if (!_pvid_hash || !pvid_arg)
+	if (!_pvid_tree || !pvid_arg)
 		return NULL;
 
 	/* For cases where pvid_arg is not null terminated. */
 	memcpy(pvid, pvid_arg, ID_LEN);
 
-	if (!(info = dm_hash_lookup(_pvid_hash, pvid)))
+	if (!(info = _pvid_lookup(pvid)))
 		return NULL;
 
 	/*
@@ -1562,7 +1682,7 @@ void lvmcache_extra_md_component_checks(struct cmd_context *cmd)
 				cmd->filter->wipe(cmd, cmd->filter, dev, NULL);
 
 				/* If vginfo was deleted don't continue using vginfo->infos */
-				if (!_search_vginfos_list(NULL, vgid))
+				if (!_search_vginfos(NULL, vgid))
 					break;
 			}
 		}
@@ -1712,13 +1832,62 @@ int lvmcache_label_scan(struct cmd_context *cmd)
 	return 1;
 }
 
+struct vgnameid_visitor {
+	struct radix_tree_iterator it;
+	struct cmd_context *cmd;
+	struct dm_list *vgnameids;
+	struct dm_list orphans;
+	int include_internal;
+	int failed;
+};
+
+static bool _visit_vgnameid(struct radix_tree_iterator *it,
+			    uint8_t *kb, uint8_t *ke, union radix_value v)
+{
+	struct vgnameid_visitor *vv = container_of(it, struct vgnameid_visitor, it);
+	struct lvmcache_vginfo *vginfo = v.ptr;
+	struct vgnameid_list *vgnl;
+	int is_orphan = is_orphan_vg(vginfo->vgname);
+
+	if (!vv->include_internal && is_orphan)
+		return true;
+
+	if (!(vgnl = dm_pool_alloc(vv->cmd->mem, sizeof(*vgnl)))) {
+		log_error("vgnameid_list allocation failed.");
+		vv->failed = 1;
+		return false;
+	}
+
+	vgnl->vgid = dm_pool_strdup(vv->cmd->mem, vginfo->vgid);
+	vgnl->vg_name = dm_pool_strdup(vv->cmd->mem, vginfo->vgname);
+
+	if (!vgnl->vgid || !vgnl->vg_name) {
+		log_error("vgnameid_list member allocation failed.");
+		vv->failed = 1;
+		return false;
+	}
+
+	dm_list_add(is_orphan ? &vv->orphans : vv->vgnameids, &vgnl->list);
+
+	return true;
+}
+
+/*
+ * VGs are listed sorted by name (then vgid), followed by the orphan
+ * VGs when include_internal is set.
+ */
 int lvmcache_get_vgnameids(struct cmd_context *cmd,
 			   struct dm_list *vgnameids,
 			   const char *only_this_vgname,
 			   int include_internal)
 {
 	struct vgnameid_list *vgnl;
-	struct lvmcache_vginfo *vginfo;
+	struct vgnameid_visitor vv = {
+		.it.visit = _visit_vgnameid,
+		.cmd = cmd,
+		.vgnameids = vgnameids,
+		.include_internal = include_internal,
+	};
 
 	if (only_this_vgname) {
 		if (!(vgnl = dm_pool_alloc(cmd->mem, sizeof(*vgnl)))) {
@@ -1732,25 +1901,16 @@ int lvmcache_get_vgnameids(struct cmd_context *cmd,
 		return 1;
 	}
 
-	dm_list_iterate_items(vginfo, &_vginfos) {
-		if (!include_internal && is_orphan_vg(vginfo->vgname))
-			continue;
+	dm_list_init(&vv.orphans);
 
-		if (!(vgnl = dm_pool_alloc(cmd->mem, sizeof(*vgnl)))) {
-			log_error("vgnameid_list allocation failed.");
-			return 0;
-		}
+	if (_vginfo_tree)
+		radix_tree_iterate(_vginfo_tree, NULL, NULL, &vv.it);
 
-		vgnl->vgid = dm_pool_strdup(cmd->mem, vginfo->vgid);
-		vgnl->vg_name = dm_pool_strdup(cmd->mem, vginfo->vgname);
+	if (vv.failed)
+		return 0;
 
-		if (!vgnl->vgid || !vgnl->vg_name) {
-			log_error("vgnameid_list member allocation failed.");
-			return 0;
-		}
-
-		dm_list_add(vgnameids, &vgnl->list);
-	}
+	/* Orphans are processed last, after the PVs in VGs. */
+	dm_list_splice(vgnameids, &vv.orphans);
 
 	return 1;
 }
@@ -1800,10 +1960,13 @@ static void _drop_vginfo(struct lvmcache_info *info, struct lvmcache_vginfo *vgi
 	    !dm_list_empty(&vginfo->infos))
 		return;
 
-	if (dm_hash_lookup(_vgname_hash, vginfo->vgname) == vginfo)
-		dm_hash_remove(_vgname_hash, vginfo->vgname);
+	if (_vgname_lookup(vginfo->vgname) == vginfo)
+		_tree_remove(_vgname_tree, vginfo->vgname, strlen(vginfo->vgname));
+
+	if (_vgid_lookup(vginfo->vgid) == vginfo)
+		_tree_remove(_vgid_tree, vginfo->vgid, _id_len(vginfo->vgid));
 
-	dm_hash_remove(_vgid_hash, vginfo->vgid);
+	(void) _vginfo_tree_remove(vginfo);
 
 	dm_list_del(&vginfo->list); /* _vginfos list */
 
@@ -1812,8 +1975,8 @@ static void _drop_vginfo(struct lvmcache_info *info, struct lvmcache_vginfo *vgi
 
 void lvmcache_del(struct lvmcache_info *info)
 {
-	if (info->dev->pvid[0] && _pvid_hash)
-		dm_hash_remove(_pvid_hash, info->dev->pvid);
+	if (info->dev->pvid[0] && _pvid_tree)
+		_tree_remove(_pvid_tree, info->dev->pvid, _id_len(info->dev->pvid));
 
 	_drop_vginfo(info, info->vginfo);
 
@@ -1842,18 +2005,22 @@ static int _lvmcache_update_vgid(struct lvmcache_info *info,
 	    !memcmp(vginfo->vgid, vgid, ID_LEN))
 		return 1;
 
-	if (vginfo && *vginfo->vgid)
-		dm_hash_remove(_vgid_hash, vginfo->vgid);
+	if (vginfo && *vginfo->vgid && (_vgid_lookup(vginfo->vgid) == vginfo))
+		_tree_remove(_vgid_tree, vginfo->vgid, _id_len(vginfo->vgid));
 	if (!vgid) {
 		/* FIXME: unreachable code path */
 		log_debug_cache("lvmcache: %s: clearing VGID", info ? dev_name(info->dev) : vginfo->vgname);
 		return 1;
 	}
 
+	/* The vgid is part of the vginfo's key in _vginfo_tree. */
+	(void) _vginfo_tree_remove(vginfo);
+
 	memset(vginfo->vgid, 0, sizeof(vginfo->vgid));
 	memcpy(vginfo->vgid, vgid, ID_LEN);
-	if (!dm_hash_insert(_vgid_hash, vginfo->vgid, vginfo)) {
-		log_error("_lvmcache_update: vgid hash insertion failed: %s",
+	if (!_tree_insert(_vgid_tree, vginfo->vgid, _id_len(vginfo->vgid), vginfo) ||
+	    !_vginfo_tree_insert(vginfo)) {
+		log_error("_lvmcache_update: vgid index insertion failed: %s",
 			  vginfo->vgid);
 		return 0;
 	}
@@ -1903,13 +2070,15 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 		dm_list_init(&vginfo->pvsummaries);
 		vginfo->fmt = fmt;
 
-		if (!dm_hash_insert(_vgname_hash, vgname, vginfo)) {
+		if (!_tree_insert(_vgname_tree, vgname, strlen(vgname), vginfo)) {
 			free(vginfo->vgname);
 			free(vginfo);
 			return_0;
 		}
 
 		if (!_lvmcache_update_vgid(NULL, vginfo, vgid)) {
+			_tree_remove(_vgname_tree, vgname, strlen(vgname));
+			(void) _vginfo_tree_remove(vginfo);
 			free(vginfo->vgname);
 			free(vginfo);
 			return_0;
@@ -1953,16 +2122,16 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 		dm_list_init(&vginfo->outdated_infos);
 		dm_list_init(&vginfo->pvsummaries);
 
-		if ((other = dm_hash_lookup(_vgname_hash, vgname))) {
+		if ((other = _vgname_lookup(vgname))) {
 			log_debug_cache("lvmcache adding vginfo found duplicate VG name %s", vgname);
 
 			/*
 			 * A different VG (different uuid) can exist with the
 			 * same name.  In this case, the two VGs will have
 			 * separate vginfo structs, but one will be in the
-			 * vgname_hash.  If both vginfos are local/accessible,
+			 * vgname_tree.  If both vginfos are local/accessible,
 			 * then _found_duplicate_vgnames is set which will
-			 * disable any further use of the vgname_hash.
+			 * disable any further use of the vgname_tree.
 			 */
 
 			if (!memcmp(other->vgid, vgid, ID_LEN)) {
@@ -1996,22 +2165,30 @@ static int _lvmcache_update_vgname(struct cmd_context *cmd,
 			}
 
 			if (!other_is_allowed && vginfo_is_allowed) {
-				/* the accessible vginfo must be in vgnames_hash */
-				dm_hash_remove(_vgname_hash, vgname);
-				if (!dm_hash_insert(_vgname_hash, vgname, vginfo)) {
-					log_error("lvmcache adding vginfo to name hash failed %s", vgname);
+				/* the accessible vginfo must be in vgname_tree */
+				if (!_tree_insert(_vgname_tree, vgname, strlen(vgname), vginfo)) {
+					log_error("lvmcache adding vginfo to name index failed %s", vgname);
 					return 0;
 				}
 			}
 		} else {
-			if (!dm_hash_insert(_vgname_hash, vgname, vginfo)) {
-				log_error("lvmcache adding vg to name hash failed %s", vgname);
+			if (!_tree_insert(_vgname_tree, vgname, strlen(vgname), vginfo)) {
+				log_error("lvmcache adding vg to name index failed %s", vgname);
 				free(vginfo->vgname);
 				free(vginfo);
 				return 0;
 			}
 		}
 
+		if (!_vginfo_tree_insert(vginfo)) {
+			log_error("lvmcache adding vginfo to index failed %s", vgname);
+			if (_vgname_lookup(vgname) == vginfo)
+				_tree_remove(_vgname_tree, vgname, strlen(vgname));
+			free(vginfo->vgname);
+			free(vginfo);
+			return 0;
+		}
+
 		dm_list_add_h(&_vginfos, &vginfo->list);
 	}
 
@@ -2499,7 +2676,7 @@ struct lvmcache_info *lvmcache_add(struct cmd_context *cmd, struct labeller *lab
 	log_debug_cache("Found PVID %s on %s", pvid, dev_name(dev));
 
 	/*
-	 * Find existing info struct in _pvid_hash or create a new one.
+	 * Find existing info struct in _pvid_tree or create a new one.
 	 *
 	 * Don't pass the known "dev" as an arg here.  The mismatching
 	 * devs for the duplicate case is checked below.
@@ -2573,21 +2750,21 @@ struct lvmcache_info *lvmcache_add(struct cmd_context *cmd, struct labeller *lab
 	}
 
 	/*
-	 * Add or update the _pvid_hash mapping, pvid to info.
+	 * Add or update the _pvid_tree mapping, pvid to info.
 	 */
 
-	info_lookup = dm_hash_lookup(_pvid_hash, pvid);
+	info_lookup = _pvid_lookup(pvid);
 	if ((info_lookup == info) && !memcmp(info->dev->pvid, pvid, ID_LEN))
 		goto update_vginfo;
 
 	if (info->dev->pvid[0])
-		dm_hash_remove(_pvid_hash, info->dev->pvid);
+		_tree_remove(_pvid_tree, info->dev->pvid, _id_len(info->dev->pvid));
 
 	memset(info->dev->pvid, 0, sizeof(info->dev->pvid));
 	memcpy(info->dev->pvid, pvid, ID_LEN);
 
-	if (!dm_hash_insert(_pvid_hash, pvid, info)) {
-		log_error("Adding pvid to hash failed %s", pvid);
+	if (!_tree_insert(_pvid_tree, pvid, _id_len(pvid), info)) {
+		log_error("Adding pvid to index failed %s", pvid);
 		return NULL;
 	}
 
@@ -2599,7 +2776,7 @@ update_vginfo:
 
 	if (!lvmcache_update_vgname_and_id(cmd, info, &vgsummary)) {
 		if (created) {
-			dm_hash_remove(_pvid_hash, pvid);
+			_tree_remove(_pvid_tree, pvid, _id_len(pvid));
 			info->dev->pvid[0] = 0;
 			free(info->label);
 			free(info);
@@ -2618,26 +2795,41 @@ static void _lvmcache_destroy_info(struct lvmcache_info *info)
 	free(info);
 }
 
+static bool _visit_destroy_info(struct radix_tree_iterator *it,
+				uint8_t *kb, uint8_t *ke, union radix_value v)
+{
+	_lvmcache_destroy_info(v.ptr);
+
+	return true;
+}
+
 void lvmcache_destroy(struct cmd_context *cmd, int retain_orphans, int reset)
 {
 	struct lvmcache_vginfo *vginfo, *vginfo2;
 
 	log_debug_cache("Destroy lvmcache content");
 
-	if (_vgid_hash) {
-		dm_hash_destroy(_vgid_hash);
-		_vgid_hash = NULL;
+	if (_vgid_tree) {
+		radix_tree_destroy(_vgid_tree);
+		_vgid_tree = NULL;
+	}
+
+	if (_pvid_tree) {
+		struct radix_tree_iterator it = { .visit = _visit_destroy_info };
+
+		radix_tree_iterate(_pvid_tree, NULL, NULL, &it);
+		radix_tree_destroy(_pvid_tree);
+		_pvid_tree = NULL;
 	}
 
-	if (_pvid_hash) {
-		dm_hash_iter(_pvid_hash, (dm_hash_iterate_fn) _lvmcache_destroy_info);
-		dm_hash_destroy(_pvid_hash);
-		_pvid_hash = NULL;
+	if (_vgname_tree) {
+		radix_tree_destroy(_vgname_tree);
+		_vgname_tree = NULL;
 	}
 
-	if (_vgname_hash) {
-		dm_hash_destroy(_vgname_hash);
-		_vgname_hash = NULL;
+	if (_vginfo_tree) {
+		radix_tree_destroy(_vginfo_tree);
+		_vginfo_tree = NULL;
 	}
 
 	dm_list_iterate_items_safe(vginfo, vginfo2, &_vginfos) {
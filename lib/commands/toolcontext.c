@@ -372,6 +372,7 @@ static uint32_t _parse_log_journal(struct cmd_context *cmd, int cfg, const char
 static void _init_logging(struct cmd_context *cmd)
 {
 	int append = 1;
+	int flight_recorder_size;
 	time_t t;
 
 	const char *log_file;
@@ -429,6 +430,12 @@ static void _init_logging(struct cmd_context *cmd)
 
 	init_log_while_suspended(find_config_tree_bool(cmd, log_activation_CFG, NULL));
 
+	/* In-memory flight recorder */
+	if ((flight_recorder_size = find_config_tree_int(cmd, log_flight_recorder_size_CFG, NULL)) < 0)
+		flight_recorder_size = 0;
+	init_log_ring((size_t) flight_recorder_size * 1024,
+		      find_config_tree_str(cmd, log_flight_recorder_file_CFG, NULL));
+
 	cmd->default_settings.debug_classes = _parse_debug_classes(cmd);
 	log_debug("Setting log debug classes to %d", cmd->default_settings.debug_classes);
 	init_debug_classes_logged(cmd->default_settings.debug_classes);
@@ -808,6 +815,9 @@ static int _process_config(struct cmd_context *cmd)
 	init_pv_min_size((uint64_t)pv_min_kb * (1024 >> SECTOR_SHIFT));
 
 	cmd->check_pv_dev_sizes = find_config_tree_bool(cmd, metadata_check_pv_device_sizes_CFG, NULL);
+	cmd->defer_precommitted_import = find_config_tree_bool(cmd, metadata_defer_precommitted_import_CFG, NULL);
+	cmd->selective_import = find_config_tree_bool(cmd, metadata_selective_import_CFG, NULL);
+	cmd->use_lv_state_cache = find_config_tree_bool(cmd, activation_lv_state_cache_CFG, NULL);
 	cmd->event_activation = find_config_tree_bool(cmd, global_event_activation_CFG, NULL);
 
 	if (!process_profilable_config(cmd))
@@ -1505,7 +1515,7 @@ static int _init_backup(struct cmd_context *cmd)
 
 	if (!cmd->system_dir[0]) {
 		log_warn("WARNING: Metadata changes will NOT be backed up");
-		backup_init(cmd, "", 0);
+		backup_init(cmd, "", 0, 0);
 		archive_init(cmd, "", 0, 0, 0);
 		return 1;
 	}
@@ -1533,7 +1543,8 @@ static int _init_backup(struct cmd_context *cmd)
 	if (!(dir = find_config_tree_str(cmd, backup_backup_dir_CFG, NULL)))
 		return_0;
 
-	if (!backup_init(cmd, dir, cmd->default_settings.backup)) {
+	if (!backup_init(cmd, dir, cmd->default_settings.backup,
+			 find_config_tree_bool(cmd, backup_reuse_committed_text_CFG, NULL))) {
 		log_debug("backup_init failed.");
 		return 0;
 	}
@@ -1943,6 +1954,7 @@ int refresh_toolcontext(struct cmd_context *cmd)
 	hints_exit(cmd);
 	lvmcache_destroy(cmd, 0, 0);
 	label_scan_destroy(cmd);
+	label_scan_incremental_drop(cmd);
 	label_exit();
 	_destroy_segtypes(&cmd->segtypes);
 	_destroy_formats(cmd, &cmd->formats);
@@ -2076,6 +2088,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	_destroy_segtypes(&cmd->segtypes);
 	_destroy_formats(cmd, &cmd->formats);
 	_destroy_filters(cmd);
+	label_scan_incremental_drop(cmd);
 	dev_cache_exit();
 	_destroy_dev_types(cmd);
 	_destroy_tags(cmd);
@@ -2086,6 +2099,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	if (cmd->cft_def_hash)
 		dm_hash_destroy(cmd->cft_def_hash);
 
+	activation_lv_state_release(cmd);
 	dm_device_list_destroy(&cmd->cache_dm_devs);
 #ifndef VALGRIND_POOL
 	if (cmd->linebuffer) {
@@ -2119,6 +2133,7 @@ void destroy_toolcontext(struct cmd_context *cmd)
 	activation_exit();
 	reset_log_duplicated();
 	fin_log();
+	fin_log_ring();
 	fin_syslog();
 	reset_lvm_errno(0);
 }
@@ -151,6 +151,9 @@ struct cmd_context {
 	unsigned report_binary_values_as_numeric:1;
 	unsigned report_mark_hidden_devices:1;
 	unsigned metadata_read_only:1;
+	unsigned defer_precommitted_import:1;	/* import written VG only when used */
+	unsigned selective_import:1;		/* import only LVs needed to activate named LVs */
+	unsigned use_lv_state_cache:1;		/* keep LV activation state between commands */
 	unsigned threaded:1;			/* set if running within a thread e.g. clvmd */
 	unsigned unknown_system_id:1;
 	unsigned include_historical_lvs:1;	/* also process/report/display historical LVs */
@@ -197,6 +200,8 @@ struct cmd_context {
 	unsigned create_edit_devices_file:1;	/* command expects to create and/or edit devices file */
 	unsigned edit_devices_file:1;		/* command expects to edit devices file */
 	unsigned filter_deviceid_skip:1;	/* don't use filter-deviceid */
+	unsigned incremental:1;			/* keep device state between commands (lvm2cmd) */
+	unsigned reuse_dev_list:1;		/* label_scan reuses devices of previous command */
 	unsigned filter_regex_skip:1;		/* don't use filter-regex */
 	unsigned filter_regex_with_devices_file:1; /* use filter-regex even when devices file is enabled */
 	unsigned filter_nodata_only:1;          /* only use filters that do not require data from the dev */
@@ -229,6 +234,7 @@ struct cmd_context {
 	struct dm_list deviceslist;             /* from --devices option, struct dm_str_list */
 
 	struct dm_list *cache_dm_devs;		/* cache with UUIDs from DM_DEVICE_LIST (when available) */
+	struct dm_list *dmeventd_batch;		/* queued dmeventd (un)registrations, see monitor_dev_for_events_batch() */
 
 	/*
 	 * Configuration.
@@ -283,6 +289,10 @@ struct cmd_context {
 	unsigned rand_seed;
 	struct dm_list pending_delete;		/* list of LVs for removal */
 	struct dm_pool *pending_delete_mem;	/* memory pool for pending deletes */
+	struct pool_check_results *pool_check_results; /* pool metadata checks done before activation */
+	struct lv_state_cache *lv_state_cache;	/* LV activation states of the VG in use */
+	struct incremental_devs *incremental_devs; /* devices kept for next label_scan in incremental mode */
+	const struct dm_list *import_lv_names;	/* LV names for selective import in vg_read */
 	struct vdo_convert_params *lvcreate_vcp;/* params for LV to VDO conversion */
 };
 
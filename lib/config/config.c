@@ -18,6 +18,7 @@
 
 #include "lib/config/config.h"
 #include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/device/device.h"
 #include "lib/datastruct/str_list.h"
 #include "lib/commands/toolcontext.h"
@@ -496,13 +497,64 @@ int override_config_tree_from_profile(struct cmd_context *cmd,
  * and function avoids parsing of mda into config tree which
  * remains unmodified and should not be used.
  */
+/*
+ * Check that the text metadata begins with a valid name.
+ */
+static int _metadata_name_is_valid(struct device *dev, off_t offset, const char *buf)
+{
+	char namebuf[NAME_LEN + 1] __attribute__((aligned(8)));
+	int namelen = 0;
+
+	memcpy(namebuf, buf, NAME_LEN);
+
+	while (namebuf[namelen] && !isspace(namebuf[namelen]) && namebuf[namelen] != '{' && namelen < (NAME_LEN - 1))
+		namelen++;
+	namebuf[namelen] = '\0';
+
+	if (!validate_name(namebuf)) {
+		log_warn("WARNING: Metadata location on %s at offset %llu begins with invalid name.",
+			 dev_name(dev), (unsigned long long)offset);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Metadata written with metadata/compress is decompressed after its
+ * checksum is verified, the text replaces the compressed data in buf.
+ */
+static int _decompress_metadata(struct device *dev, off_t offset, char **buf, size_t *size)
+{
+	uint32_t text_size = lz_uncompressed_size(*buf, (uint32_t) *size);
+	char *text;
+
+	/* Ensure there is extra '\0' after end of buffer, as for read buffer */
+	if (!text_size || !(text = zalloc((size_t) text_size + NAME_LEN + 1))) {
+		log_warn("WARNING: Invalid compressed metadata on %s at offset %llu.",
+			 dev_name(dev), (unsigned long long)offset);
+		return 0;
+	}
+
+	if (!lz_decompress(*buf, (uint32_t) *size, text, text_size)) {
+		log_warn("WARNING: Failed to decompress metadata on %s at offset %llu.",
+			 dev_name(dev), (unsigned long long)offset);
+		free(text);
+		return 0;
+	}
+
+	free(*buf);
+	*buf = text;
+	*size = text_size;
+
+	return 1;
+}
+
 int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_reason_t reason,
 			off_t offset, size_t size, off_t offset2, size_t size2,
 			checksum_fn_t checksum_fn, uint32_t checksum,
-			int checksum_only, int no_dup_node_check)
+			int checksum_only, int no_dup_node_check, int compressed)
 {
-	char namebuf[NAME_LEN + 1] __attribute__((aligned(8)));
-	int namelen = 0;
 	int bad_name = 0;
 	char *fb, *fe;
 	int r = 0;
@@ -541,34 +593,25 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 				goto out;
 			}
 		}
+	} else if (size2) {
+		/* Metadata wrapping around the end of the area: read both parts together */
+		struct bcache_range ranges[2] = {
+			{ .start = offset, .len = size },
+			{ .start = offset2, .len = size2 }
+		};
+
+		if (!dev_read_ranges(dev, ranges, 2, buf))
+			goto out;
 	} else {
 		if (!dev_read_bytes(dev, offset, size, buf))
 			goto out;
-
-		if (size2) {
-			if (!dev_read_bytes(dev, offset2, size2, buf + size))
-				goto out;
-		}
 	}
 
 	fb = buf;
 
-	if (!(dev->flags & DEV_REGULAR)) {
-		memcpy(namebuf, buf, NAME_LEN);
-
-		while (namebuf[namelen] && !isspace(namebuf[namelen]) && namebuf[namelen] != '{' && namelen < (NAME_LEN - 1))
-			namelen++;
-		namebuf[namelen] = '\0';
-
-		/*
-		 * Check that the text metadata begins with a valid name.
-		 */
-		if (!validate_name(namebuf)) {
-			log_warn("WARNING: Metadata location on %s at offset %llu begins with invalid name.",
-				 dev_name(dev), (unsigned long long)offset);
-			bad_name = 1;
-		}
-	}
+	if (!(dev->flags & DEV_REGULAR) && !compressed &&
+	    !_metadata_name_is_valid(dev, offset, buf))
+		bad_name = 1;
 
 	/*
 	 * The checksum passed in is the checksum from the mda_header
@@ -586,6 +629,16 @@ int config_file_read_fd(struct dm_config_tree *cft, struct device *dev, dev_io_r
 	if (bad_name)
 		goto out;
 
+	if (!checksum_only && compressed) {
+		/* Wrapped parts are adjacent in buf */
+		size += size2;
+		size2 = 0;
+		if (!_decompress_metadata(dev, offset, &buf, &size) ||
+		    !_metadata_name_is_valid(dev, offset, buf))
+			goto out;
+		fb = buf;
+	}
+
 	if (!checksum_only) {
 		fe = fb + size + size2;
 		if (no_dup_node_check) {
@@ -634,7 +687,7 @@ int config_file_read(struct dm_config_tree *cft)
 	}
 
 	r = config_file_read_fd(cft, cf->dev, DEV_IO_MDA_CONTENT, 0, (size_t) info.st_size, 0, 0,
-				(checksum_fn_t) NULL, 0, 0, 0);
+				(checksum_fn_t) NULL, 0, 0, 0, 0);
 
 	if (!cf->keep_open) {
 		if (!dev_close(cf->dev))
@@ -172,7 +172,7 @@ cfg_section(global_CFG_SECTION, "global", root_CFG_SECTION, CFG_PROFILABLE, vsn(
 
 cfg_section(activation_CFG_SECTION, "activation", root_CFG_SECTION, CFG_PROFILABLE, vsn(1, 0, 0), 0, NULL, NULL)
 
-cfg_section(metadata_CFG_SECTION, "metadata", root_CFG_SECTION, CFG_DEFAULT_COMMENTED, vsn(1, 0, 0), 0, NULL, NULL)
+cfg_section(metadata_CFG_SECTION, "metadata", root_CFG_SECTION, CFG_PROFILABLE | CFG_DEFAULT_COMMENTED, vsn(1, 0, 0), 0, NULL, NULL)
 
 cfg_section(report_CFG_SECTION, "report", root_CFG_SECTION, CFG_PROFILABLE, vsn(1, 0, 0), 0, NULL,
 	"LVM report command output formatting.\n")
@@ -953,6 +953,23 @@ cfg_array(log_debug_output_fields_CFG, "debug_output_fields", log_CFG_SECTION, C
 	  "The fields included in debug output written to stderr.\n"
 	  "Use \"all\" to include everything (the default).\n")
 
+cfg(log_flight_recorder_size_CFG, "flight_recorder_size", log_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_FLIGHT_RECORDER_SIZE_KB, vsn(2, 3, 24), NULL, 0, NULL,
+	"Size in KiB of the in-memory log flight recorder.\n"
+	"All messages, including debug messages that are not logged\n"
+	"anywhere, are kept in a ring buffer in binary form and they are\n"
+	"formatted only when the buffer is written to flight_recorder_file.\n"
+	"Debug messages that are not logged anywhere else are recorded\n"
+	"without their arguments, so recording stays cheap at default\n"
+	"verbosity. Set to 0 to disable the flight recorder.\n"
+	"Smaller sizes than 4 KiB are rounded up to 4 KiB.\n")
+
+cfg(log_flight_recorder_file_CFG, "flight_recorder_file", log_CFG_SECTION, CFG_DEFAULT_UNDEFINED, CFG_TYPE_STRING, NULL, vsn(2, 3, 24), NULL, 0, NULL,
+	"Append the content of the flight recorder to this file.\n"
+	"The recorded messages are written when a command fails, when\n"
+	"the command is terminated by a fatal signal, or with the next\n"
+	"message after the command receives SIGUSR2, e.g. to see what\n"
+	"a slow command was doing.\n")
+
 cfg(backup_backup_CFG, "backup", backup_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_BACKUP_ENABLED, vsn(1, 0, 0), NULL, 0, NULL,
 	"Maintain a backup of the current metadata configuration.\n"
 	"Think very hard before turning this off!\n")
@@ -961,6 +978,12 @@ cfg_runtime(backup_backup_dir_CFG, "backup_dir", backup_CFG_SECTION, CFG_DEFAULT
 	"Location of the metadata backup files.\n"
 	"Remember to back up this directory regularly!\n")
 
+cfg(backup_reuse_committed_text_CFG, "reuse_committed_text", backup_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_BACKUP_REUSE_COMMITTED_TEXT, vsn(2, 3, 24), NULL, 0, NULL,
+	"Write the backup file from the metadata text just committed to disk.\n"
+	"This avoids formatting the metadata again after each change, which\n"
+	"is noticeable with large metadata. The backup file is then written\n"
+	"without the indentation and comments that help reading it.\n")
+
 cfg(backup_archive_CFG, "archive", backup_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_ARCHIVE_ENABLED, vsn(1, 0, 0), NULL, 0, NULL,
 	"Maintain an archive of old metadata configurations.\n"
 	"Think very hard before turning this off.\n")
@@ -1290,6 +1313,21 @@ cfg_array(global_cache_repair_options_CFG, "cache_repair_options", global_CFG_SE
 cfg_array(global_cache_restore_options_CFG, "cache_restore_options", global_CFG_SECTION, CFG_ALLOW_EMPTY | CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, DEFAULT_CACHE_RESTORE_OPTIONS_CONFIG, vsn(2, 3, 22), NULL, 0, NULL,
 	"List of options passed to the cache_restore command.\n")
 
+cfg(global_metadata_check_concurrency_CFG, "metadata_check_concurrency", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_METADATA_CHECK_CONCURRENCY, vsn(2, 3, 24), NULL, 0, NULL,
+	"Number of thin_check and cache_check commands run in parallel.\n"
+	"When vgchange activates the LVs of a VG, the metadata of all\n"
+	"inactive thin and cache pools is checked before the activation\n"
+	"starts, instead of one by one as each pool is activated.\n"
+	"Set to 0 or 1 to check each pool during its own activation.\n")
+
+cfg(global_metadata_check_cache_CFG, "metadata_check_cache", global_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_METADATA_CHECK_CACHE, vsn(2, 3, 24), NULL, 0, NULL,
+	"Skip thin_check and cache_check of unchanged pool metadata.\n"
+	"After a successful check, the pool transaction_id and a checksum of\n"
+	"the metadata superblock and of the check command line are stored\n"
+	"in a file in the run directory. Activation skips the check when\n"
+	"the pool still matches. Every metadata commit changes the superblock.\n"
+	"Disable to force the check, e.g. with --config global/metadata_check_cache=0.\n")
+
 cfg(global_vdo_format_executable_CFG, "vdo_format_executable", global_CFG_SECTION, CFG_ALLOW_EMPTY | CFG_DEFAULT_COMMENTED, CFG_TYPE_STRING, VDO_FORMAT_CMD, VDO_1ST_VSN, "@VDO_FORMAT_CMD@", 0, NULL,
 	"The full path to the vdoformat command.\n"
 	"LVM uses this command to initial data volume for VDO type logical volume\n")
@@ -1750,6 +1788,28 @@ cfg(activation_mode_CFG, "activation_mode", activation_CFG_SECTION, CFG_DEFAULT_
 	"    assist with data recovery.\n"
 	"#\n")
 
+cfg(activation_lv_state_cache_CFG, "lv_state_cache", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_LV_STATE_CACHE, vsn(2, 3, 24), NULL, 0, NULL,
+	"Keep the activation state of LVs between commands.\n"
+	"Commands record the state of active LVs of a VG in a file in the run\n"
+	"directory. Following commands list all dm devices with one ioctl and\n"
+	"use the recorded state of LVs whose device and event number did not\n"
+	"change since, instead of querying each LV separately. Recorded states\n"
+	"are dropped when the VG metadata changes or when LVM changes devices\n"
+	"of the VG. Open count, read ahead and status are always queried.\n"
+	"Devices changed with other tools without generating a dm event, e.g.\n"
+	"suspended with dmsetup, are not noticed, so keep this disabled when\n"
+	"managing LVM devices with dmsetup directly.\n"
+	"Requires a kernel listing dm devices with uuids and event numbers.\n")
+
+cfg(activation_suspend_concurrency_CFG, "suspend_concurrency", activation_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_SUSPEND_CONCURRENCY, vsn(2, 3, 24), NULL, 0, NULL,
+	"The number of devices suspended at the same time.\n"
+	"When an LV is suspended, its devices are suspended top-down, each\n"
+	"after all devices using it. Devices on the same level, e.g. the\n"
+	"images of a RAID LV or the LVs in a thin-pool, do not depend on each\n"
+	"other and are suspended concurrently from up to this many threads,\n"
+	"which shortens the time the LV is suspended when flushing I/O to\n"
+	"many devices is slow. The value 1 suspends devices one by one.\n")
+
 cfg_array(activation_lock_start_list_CFG, "lock_start_list", activation_CFG_SECTION, CFG_ALLOW_EMPTY|CFG_DEFAULT_UNDEFINED, CFG_TYPE_STRING, NULL, vsn(2, 2, 124), NULL, 0, NULL,
 	"Locking is started only for VGs selected by this list.\n"
 	"The rules are the same as those for volume_list.\n")
@@ -1778,6 +1838,46 @@ cfg(metadata_lvs_history_retention_time_CFG, "lvs_history_retention_time", metad
 	"historical logical volume is automatically destroyed.\n"
 	"A value of 0 disables this feature.\n")
 
+cfg(metadata_defer_precommitted_import_CFG, "defer_precommitted_import", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_DEFER_PRECOMMITTED_IMPORT, vsn(2, 3, 24), NULL, 0, NULL,
+	"Import the metadata written by a command back into a VG only if needed.\n"
+	"After writing new metadata, LVM parses the written text back to\n"
+	"get the precommitted, and later committed, copy of the VG. Commands\n"
+	"that do not activate, suspend or resume LVs never use this copy.\n"
+	"When enabled, the text is kept and verified by its checksum, and\n"
+	"parsed only when the copy is first used, which saves the cost of\n"
+	"parsing the whole VG on each write of large metadata. Errors in the\n"
+	"written text are then detected later, or by the next command.\n"
+	"With backup/reuse_committed_text the backup does not need it either.\n")
+
+cfg(metadata_selective_import_CFG, "selective_import", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_SELECTIVE_IMPORT, vsn(2, 3, 24), NULL, 0, NULL,
+	"Import only the LVs needed to activate the LVs named by lvchange -ay.\n"
+	"Without this, reading a VG imports all its LVs and segments, which\n"
+	"takes long in VGs with very many LVs even when a single LV is\n"
+	"activated. When enabled, only the named LVs and the LVs they are\n"
+	"connected with (e.g. pool, origin, sub LVs, external origin) are\n"
+	"imported. A thin LV is imported with its pool, but without the other\n"
+	"thin LVs of the pool. Such a partially imported VG is never written.\n"
+	"Shared VGs and named LVs used by other LVs are always fully imported.\n")
+
+cfg(metadata_size_warning_threshold_CFG, "size_warning_threshold", metadata_CFG_SECTION, CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_METADATA_SIZE_WARNING_THRESHOLD, vsn(2, 3, 24), NULL, 0, NULL,
+	"Warn when VG metadata uses more than this percent of the maximum\n"
+	"metadata size of a metadata area. The warning shows how much space\n"
+	"is left and about how many more LVs fit, so the metadata area can\n"
+	"be grown with pvresize --metadatasize before writing the metadata\n"
+	"fails. Setting this to 0 or 100 disables the warning.\n")
+
+cfg(metadata_compress_CFG, "compress", metadata_CFG_SECTION, CFG_PROFILABLE | CFG_PROFILABLE_METADATA | CFG_DEFAULT_COMMENTED, CFG_TYPE_BOOL, DEFAULT_METADATA_COMPRESS, vsn(2, 3, 24), NULL, 0, NULL,
+	"Store VG metadata compressed in metadata areas.\n"
+	"Compressed metadata takes several times less space, so more LVs fit\n"
+	"into a metadata area and less data is read and written with each\n"
+	"metadata update. Each metadata copy records whether it is compressed,\n"
+	"so both kinds of copies are read regardless of this setting.\n"
+	"A metadata area with compressed metadata has a newer header version,\n"
+	"which LVM versions without this feature reject, so they do not see\n"
+	"the VG on its PVs until metadata is written with compression disabled.\n"
+	"Metadata that does not get smaller is stored uncompressed.\n"
+	"This may be enabled for a single VG with a metadata profile.\n")
+
 cfg(metadata_pvmetadatacopies_CFG, "pvmetadatacopies", metadata_CFG_SECTION, CFG_ADVANCED | CFG_DEFAULT_COMMENTED, CFG_TYPE_INT, DEFAULT_PVMETADATACOPIES, vsn(1, 0, 0), NULL, 0, NULL,
 	"Number of copies of metadata to store on each PV.\n"
 	"The --pvmetadatacopies option overrides this setting.\n"
@@ -33,6 +33,7 @@
 
 #define DEFAULT_ARCHIVE_ENABLED 1
 #define DEFAULT_BACKUP_ENABLED 1
+#define DEFAULT_BACKUP_REUSE_COMMITTED_TEXT 0
 
 #define DEFAULT_CACHE_FILE_PREFIX ""
 
@@ -147,6 +148,9 @@
 #  define DEFAULT_CACHE_CHECK_OPTIONS_CONFIG "#S" DEFAULT_CACHE_CHECK_OPTION1
 #endif
 
+#define DEFAULT_METADATA_CHECK_CONCURRENCY 4
+#define DEFAULT_METADATA_CHECK_CACHE 1
+
 #define DEFAULT_CACHE_REPAIR_OPTION1 ""
 #define DEFAULT_CACHE_REPAIR_OPTIONS_CONFIG "#S" DEFAULT_CACHE_REPAIR_OPTION1
 #define DEFAULT_CACHE_RESTORE_OPTION1 ""
@@ -198,6 +202,10 @@
 
 #define DEFAULT_STRIPESIZE 64	/* KB */
 #define DEFAULT_RECORD_LVS_HISTORY 0
+#define DEFAULT_DEFER_PRECOMMITTED_IMPORT 0
+#define DEFAULT_SELECTIVE_IMPORT 0
+#define DEFAULT_METADATA_SIZE_WARNING_THRESHOLD 80
+#define DEFAULT_METADATA_COMPRESS 0
 #define DEFAULT_LVS_HISTORY_RETENTION_TIME 0
 #define DEFAULT_PVMETADATAIGNORE 0
 #define DEFAULT_PVMETADATACOPIES 1
@@ -219,6 +227,7 @@
 #define DEFAULT_CLUSTERED 0
 
 #define DEFAULT_MSG_PREFIX "  "
+#define DEFAULT_FLIGHT_RECORDER_SIZE_KB 64
 #define DEFAULT_CMD_NAME 0
 #define DEFAULT_OVERWRITE 0
 
@@ -253,6 +262,8 @@
 
 #define DEFAULT_AUTO_SET_ACTIVATION_SKIP 1
 #define DEFAULT_ACTIVATION_MODE "degraded"
+#define DEFAULT_LV_STATE_CACHE 0
+#define DEFAULT_SUSPEND_CONCURRENCY 1
 #define DEFAULT_USE_LINEAR_TARGET 1
 #define DEFAULT_STRIPE_FILLER "error"
 #define DEFAULT_RAID_REGION_SIZE   2048	/* KB */
@@ -337,6 +348,8 @@
 #define PVS_ONLINE_DIR DEFAULT_RUN_DIR "/pvs_online"
 #define VGS_ONLINE_DIR DEFAULT_RUN_DIR "/vgs_online"
 #define PVS_LOOKUP_DIR DEFAULT_RUN_DIR "/pvs_lookup"
+#define POOL_CHECK_DIR DEFAULT_RUN_DIR "/pool_check"
+#define LV_STATE_DIR DEFAULT_RUN_DIR "/lv_state"
 
 #define DEFAULT_DEVICE_ID_SYSFS_DIR "/sys/"  /* trailing / to match dm_sysfs_dir() */
 
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <libaio.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include <linux/fs.h>
 #include <sys/user.h>
 
@@ -61,6 +62,9 @@ struct control_block {
 	struct dm_list list;
 	void *context;
 	struct iocb cb;
+	struct iovec *iov;	/* vectored write, one iovec and context per block */
+	void **contexts;
+	unsigned nr_contexts;
 };
 
 struct cb_set {
@@ -108,6 +112,9 @@ static struct control_block *_cb_alloc(struct cb_set *cbs, void *context)
 
 	cb = dm_list_item(_list_pop(&cbs->free), struct control_block);
 	cb->context = context;
+	cb->iov = NULL;
+	cb->contexts = NULL;
+	cb->nr_contexts = 0;
 	dm_list_add(&cbs->allocated, &cb->list);
 
 	return cb;
@@ -299,6 +306,85 @@ static bool _async_issue(struct io_engine *ioe, enum dir d, int di,
 	return true;
 }
 
+/*
+ * Writes the blocks of a contiguous range with a single IOCB_CMD_PWRITEV.
+ */
+static bool _async_issue_writev(struct io_engine *ioe, int di, sector_t sb, sector_t se,
+				void **data, void **contexts, unsigned nr)
+{
+	int r;
+	unsigned i;
+	struct iocb *cb_array[1];
+	struct control_block *cb;
+	struct async_engine *e = _to_async(ioe);
+	size_t len = ((se - sb) << SECTOR_SHIFT) / nr;
+	struct iovec *iov;
+
+	for (i = 0; i < nr; i++)
+		if (((uintptr_t) data[i]) & e->page_mask) {
+			log_warn("misaligned data buffer");
+			return false;
+		}
+
+	if (!(iov = malloc(nr * (sizeof(*iov) + sizeof(*contexts))))) {
+		log_warn("couldn't allocate io vector");
+		return false;
+	}
+
+	if (!(cb = _cb_alloc(e->cbs, NULL))) {
+		log_warn("couldn't allocate control block");
+		free(iov);
+		return false;
+	}
+
+	cb->iov = iov;
+	cb->contexts = (void **) (iov + nr);
+	cb->nr_contexts = nr;
+
+	for (i = 0; i < nr; i++) {
+		iov[i].iov_base = data[i];
+		iov[i].iov_len = len;
+		cb->contexts[i] = contexts[i];
+	}
+
+	io_prep_pwritev(&cb->cb, (int) _fd_table[di], iov, (int) nr, sb << SECTOR_SHIFT);
+
+	cb_array[0] = &cb->cb;
+	do {
+		r = io_submit(e->aio_context, 1, cb_array);
+	} while (r == -EAGAIN);
+
+	if (r < 0) {
+		free(iov);
+		_cb_free(e->cbs, cb);
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Each block of a vectored write completes on its own.  After a short
+ * write the blocks it covered completely succeed, and the rest fail.
+ */
+static void _complete_vec(struct control_block *cb, long res, io_complete_fn fn)
+{
+	uint64_t done = 0;
+	unsigned i;
+
+	for (i = 0; i < cb->nr_contexts; i++) {
+		done += cb->iov[i].iov_len;
+
+		if (res < 0)
+			fn(cb->contexts[i], (int) res);
+		else
+			fn(cb->contexts[i], (done <= (uint64_t) res) ? 0 : -EIO);
+	}
+
+	free(cb->iov);
+	cb->iov = NULL;
+}
+
 /*
  * MAX_IO is returned to the layer above via bcache_max_prefetches() which
  * tells the caller how many devices to submit io for concurrently.  There will
@@ -330,7 +416,10 @@ static bool _async_wait(struct io_engine *ioe, io_complete_fn fn)
 
 		cb = _iocb_to_cb((struct iocb *) ev->obj);
 
-		if (ev->res == cb->cb.u.c.nbytes)
+		if (cb->iov)
+			_complete_vec(cb, (long) ev->res, fn);
+
+		else if (ev->res == cb->cb.u.c.nbytes)
 			fn((void *) cb->context, 0);
 
 		else if ((int) ev->res < 0)
@@ -372,6 +461,7 @@ struct io_engine *create_async_io_engine(void)
 
 	e->e.destroy = _async_destroy;
 	e->e.issue = _async_issue;
+	e->e.issue_writev = _async_issue_writev;
 	e->e.wait = _async_wait;
 	e->e.max_io = _async_max_io;
 
@@ -401,6 +491,7 @@ struct io_engine *create_async_io_engine(void)
 struct sync_io {
         struct dm_list list;
 	void *context;
+	int error;
 };
 
 struct sync_engine {
@@ -434,6 +525,8 @@ static bool _sync_issue(struct io_engine *ioe, enum dir d, int di,
         	return false;
 	}
 
+	io->error = 0;
+
 	where = sb * 512;
 	off = lseek(_fd_table[di], where, SEEK_SET);
 	if (off == (off_t) -1) {
@@ -576,13 +669,85 @@ static bool _sync_issue(struct io_engine *ioe, enum dir d, int di,
 	return true;
 }
 
+/*
+ * Writes the blocks of a contiguous range with pwritev().  A failure part
+ * way through is only reported for the blocks that were not written.
+ */
+static bool _sync_issue_writev(struct io_engine *ioe, int di, sector_t sb, sector_t se,
+			       void **data, void **contexts, unsigned nr)
+{
+	struct sync_engine *e = _to_sync(ioe);
+	uint64_t where = sb << SECTOR_SHIFT;
+	uint64_t len = ((se - sb) << SECTOR_SHIFT) / nr;
+	uint64_t pos = 0;
+	struct sync_io **ios;
+	struct iovec *iov;
+	unsigned i, first = 0;
+	ssize_t rv;
+	int error = 0;
+
+	if (!(iov = malloc(nr * (sizeof(*iov) + sizeof(*ios))))) {
+		log_warn("unable to allocate io vector");
+		return false;
+	}
+
+	ios = (struct sync_io **) (iov + nr);
+
+	for (i = 0; i < nr; i++) {
+		if (!(ios[i] = malloc(sizeof(*ios[i])))) {
+			log_warn("unable to allocate sync_io");
+			while (i--)
+				free(ios[i]);
+			free(iov);
+			return false;
+		}
+		iov[i].iov_base = data[i];
+		iov[i].iov_len = len;
+	}
+
+	while (pos < nr * len) {
+		rv = pwritev(_fd_table[di], iov + first, (int) (nr - first), (off_t) (where + pos));
+
+		if (rv == -1 && ((errno == EINTR) || (errno == EAGAIN)))
+			continue;
+
+		if (rv <= 0) {
+			error = rv ? -errno : -EIO;
+			log_debug("Device write error %d offset %llu len %llu", -error,
+				  (unsigned long long)(where + pos),
+				  (unsigned long long)(nr * len - pos));
+			break;
+		}
+
+		pos += rv;
+
+		/* Skip what was written */
+		while ((first < nr) && ((size_t) rv >= iov[first].iov_len))
+			rv -= iov[first++].iov_len;
+		if (rv) {
+			iov[first].iov_base = (char *) iov[first].iov_base + rv;
+			iov[first].iov_len -= rv;
+		}
+	}
+
+	for (i = 0; i < nr; i++) {
+		ios[i]->context = contexts[i];
+		ios[i]->error = ((i + 1) * len <= pos) ? 0 : error;
+		dm_list_add(&e->complete, &ios[i]->list);
+	}
+
+	free(iov);
+
+	return true;
+}
+
 static bool _sync_wait(struct io_engine *ioe, io_complete_fn fn)
 {
         struct sync_io *io, *tmp;
 	struct sync_engine *e = _to_sync(ioe);
 
 	dm_list_iterate_items_safe(io, tmp, &e->complete) {
-		fn(io->context, 0);
+		fn(io->context, io->error);
 		dm_list_del(&io->list);
 		free(io);
 	}
@@ -604,6 +769,7 @@ struct io_engine *create_sync_io_engine(void)
 
         e->e.destroy = _sync_destroy;
         e->e.issue = _sync_issue;
+        e->e.issue_writev = _sync_issue_writev;
         e->e.wait = _sync_wait;
         e->e.max_io = _sync_max_io;
 
@@ -617,6 +783,7 @@ struct io_engine *create_sync_io_engine(void)
 #define MIN_BLOCKS 16
 #define WRITEBACK_LOW_THRESHOLD_PERCENT 33
 #define WRITEBACK_HIGH_THRESHOLD_PERCENT 66
+#define WRITEBACK_MAX_BLOCKS 32		/* per coalesced write */
 
 //----------------------------------------------------------------
 
@@ -689,6 +856,12 @@ struct bcache {
 	unsigned write_hits;
 	unsigned write_misses;
 	unsigned prefetches;
+	unsigned waits;
+	unsigned range_reads;
+	unsigned range_prefetches;
+	unsigned range_waits_avoided;
+	unsigned coalesced_writes;
+	unsigned coalesced_blocks;
 };
 
 //----------------------------------------------------------------
@@ -894,6 +1067,8 @@ static inline void _issue_write(struct block *b)
 
 static bool _wait_io(struct bcache *cache)
 {
+	cache->waits++;
+
 	return cache->engine->wait(cache->engine, _complete_io);
 }
 
@@ -913,10 +1088,99 @@ static void _wait_specific(struct block *b)
 		_wait_io(b->cache);
 }
 
+static int _block_cmp(const void *lhs, const void *rhs)
+{
+	const struct block *l = *(const struct block * const *) lhs;
+	const struct block *r = *(const struct block * const *) rhs;
+
+	if (l->di != r->di)
+		return (l->di < r->di) ? -1 : 1;
+
+	if (l->index != r->index)
+		return (l->index < r->index) ? -1 : 1;
+
+	return 0;
+}
+
+// Writes to the last block before the last byte get clamped by the engine.
+static bool _can_coalesce(struct block *b)
+{
+	uint64_t block_size = b->cache->block_sectors << SECTOR_SHIFT;
+
+	return !(_last_byte_offset && (b->di == _last_byte_di) &&
+		 ((b->index + 1) * block_size > _last_byte_offset));
+}
+
+static void _issue_write_vec(struct bcache *cache, struct block **blocks, unsigned nr)
+{
+	void *data[WRITEBACK_MAX_BLOCKS];
+	void *contexts[WRITEBACK_MAX_BLOCKS];
+	sector_t sb = blocks[0]->index * cache->block_sectors;
+	sector_t se = (blocks[nr - 1]->index + 1) * cache->block_sectors;
+	struct block *b;
+	unsigned i;
+
+	for (i = 0; i < nr; i++) {
+		b = blocks[i];
+		b->io_dir = DIR_WRITE;
+		_set_flags(b, BF_IO_PENDING);
+		cache->nr_io_pending++;
+		dm_list_move(&cache->io_pending, &b->list);
+		data[i] = b->data;
+		contexts[i] = b;
+	}
+
+	cache->coalesced_writes++;
+	cache->coalesced_blocks += nr;
+
+	if (!cache->engine->issue_writev(cache->engine, blocks[0]->di, sb, se, data, contexts, nr))
+		for (i = 0; i < nr; i++)
+			_complete_io(blocks[i], -EIO);
+}
+
+/*
+ * Issue writes for the given unheld dirty blocks.  If the engine can
+ * do vectored writes, runs of contiguous blocks on the same device go
+ * out as one io, each block still completing (or failing) on its own.
+ */
+static void _issue_writes(struct bcache *cache, struct block **blocks, unsigned nr)
+{
+	unsigned i, run;
+
+	if (!cache->engine->issue_writev) {
+		for (i = 0; i < nr; i++)
+			_issue_write(blocks[i]);
+		return;
+	}
+
+	qsort(blocks, nr, sizeof(*blocks), _block_cmp);
+
+	for (i = 0; i < nr; i += run) {
+		run = 1;
+		if (_can_coalesce(blocks[i]))
+			while ((i + run < nr) && (run < WRITEBACK_MAX_BLOCKS) &&
+			       (blocks[i + run]->di == blocks[i]->di) &&
+			       (blocks[i + run]->index == blocks[i]->index + run) &&
+			       _can_coalesce(blocks[i + run]))
+				run++;
+
+		if (run == 1)
+			_issue_write(blocks[i]);
+		else
+			_issue_write_vec(cache, blocks + i, run);
+	}
+}
+
 static unsigned _writeback(struct bcache *cache, unsigned count)
 {
 	unsigned actual = 0;
-	struct block *b, *tmp;
+	struct block *b, *tmp, **blocks;
+
+	if (!count)
+		return 0;
+
+	if (!(blocks = malloc(count * sizeof(*blocks))))
+		log_warn("WARNING: Failed to allocate writeback list, not coalescing writes.");
 
 	dm_list_iterate_items_gen_safe (b, tmp, &cache->dirty, list) {
 		if (actual == count)
@@ -924,11 +1188,19 @@ static unsigned _writeback(struct bcache *cache, unsigned count)
 
 		// We can't writeback anything that's still in use.
 		if (!b->ref_count) {
-			_issue_write(b);
+			if (blocks)
+				blocks[actual] = b;
+			else
+				_issue_write(b);
 			actual++;
 		}
 	}
 
+	if (blocks) {
+		_issue_writes(cache, blocks, actual);
+		free(blocks);
+	}
+
 	return actual;
 }
 
@@ -1151,6 +1423,12 @@ struct bcache *bcache_create(sector_t block_sectors, unsigned nr_cache_blocks,
 	cache->write_hits = 0;
 	cache->write_misses = 0;
 	cache->prefetches = 0;
+	cache->waits = 0;
+	cache->range_reads = 0;
+	cache->range_prefetches = 0;
+	cache->range_waits_avoided = 0;
+	cache->coalesced_writes = 0;
+	cache->coalesced_blocks = 0;
 
 	if (!_init_free_list(cache, nr_cache_blocks, _pagesize)) {
 		cache->engine->destroy(cache->engine);
@@ -1205,6 +1483,22 @@ unsigned bcache_max_prefetches(struct bcache *cache)
 	return cache->max_io;
 }
 
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats)
+{
+	stats->read_hits = cache->read_hits;
+	stats->read_misses = cache->read_misses;
+	stats->write_zeroes = cache->write_zeroes;
+	stats->write_hits = cache->write_hits;
+	stats->write_misses = cache->write_misses;
+	stats->prefetches = cache->prefetches;
+	stats->waits = cache->waits;
+	stats->range_reads = cache->range_reads;
+	stats->range_prefetches = cache->range_prefetches;
+	stats->range_waits_avoided = cache->range_waits_avoided;
+	stats->coalesced_writes = cache->coalesced_writes;
+	stats->coalesced_blocks = cache->coalesced_blocks;
+}
+
 void bcache_prefetch(struct bcache *cache, int di, block_address i)
 {
 	struct block *b = _block_lookup(cache, di, i);
@@ -1220,6 +1514,34 @@ void bcache_prefetch(struct bcache *cache, int di, block_address i)
 	}
 }
 
+bool bcache_read_ranges(struct bcache *cache, int di, const struct bcache_range *ranges,
+			unsigned nr_ranges, void *data)
+{
+	unsigned prefetches = cache->prefetches;
+	unsigned waits = cache->waits;
+	unsigned i;
+
+	for (i = 0; i < nr_ranges; i++)
+		bcache_prefetch_bytes(cache, di, ranges[i].start, ranges[i].len);
+
+	prefetches = cache->prefetches - prefetches;
+
+	for (i = 0; i < nr_ranges; i++) {
+		if (!bcache_read_bytes(cache, di, ranges[i].start, ranges[i].len, data))
+			return false;
+		data = (char *) data + ranges[i].len;
+	}
+
+	// Misses read one range at a time could each have cost a wait.
+	waits = cache->waits - waits;
+	cache->range_reads++;
+	cache->range_prefetches += prefetches;
+	if (prefetches > waits)
+		cache->range_waits_avoided += prefetches - waits;
+
+	return true;
+}
+
 //----------------------------------------------------------------
 
 static void _recycle_block(struct bcache *cache, struct block *b)
@@ -1294,15 +1616,7 @@ bool bcache_flush(struct bcache *cache)
 	// try and rewrite everything.
 	dm_list_splice(&cache->dirty, &cache->errored);
 
-	while (!dm_list_empty(&cache->dirty)) {
-		struct block *b = dm_list_item(_list_pop(&cache->dirty), struct block);
-		if (b->ref_count || _test_flags(b, BF_IO_PENDING)) {
-			// The superblock may well be still locked.
-			continue;
-		}
-
-		_issue_write(b);
-	}
+	_writeback(cache, dm_list_size(&cache->dirty));
 
 	_wait_all(cache);
 
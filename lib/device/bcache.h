@@ -36,6 +36,12 @@ struct io_engine {
 	void (*destroy)(struct io_engine *e);
 	bool (*issue)(struct io_engine *e, enum dir d, int di,
 		      sector_t sb, sector_t se, void *data, void *context);
+	/*
+	 * Optional.  Writes [sb, se) from nr equally sized buffers in one io,
+	 * completing each context separately.
+	 */
+	bool (*issue_writev)(struct io_engine *e, int di, sector_t sb, sector_t se,
+			     void **data, void **contexts, unsigned nr);
 	bool (*wait)(struct io_engine *e, io_complete_fn fn);
 	unsigned (*max_io)(struct io_engine *e);
 };
@@ -87,6 +93,23 @@ sector_t bcache_block_sectors(struct bcache *cache);
 unsigned bcache_nr_cache_blocks(struct bcache *cache);
 unsigned bcache_max_prefetches(struct bcache *cache);
 
+struct bcache_stats {
+	unsigned read_hits;
+	unsigned read_misses;
+	unsigned write_zeroes;
+	unsigned write_hits;
+	unsigned write_misses;
+	unsigned prefetches;
+	unsigned waits;			/* calls waiting for io to complete */
+	unsigned range_reads;		/* bcache_read_ranges() calls */
+	unsigned range_prefetches;	/* blocks they issued before waiting */
+	unsigned range_waits_avoided;	/* blocks that did not need a wait of their own */
+	unsigned coalesced_writes;	/* vectored writes of contiguous dirty blocks */
+	unsigned coalesced_blocks;	/* blocks written by them */
+};
+
+void bcache_get_stats(struct bcache *cache, struct bcache_stats *stats);
+
 /*
  * Use the prefetch method to take advantage of asynchronous IO.  For example,
  * if you wanted to read a block from many devices concurrently you'd do
@@ -115,6 +138,19 @@ bool bcache_get(struct bcache *cache, int di, block_address index,
 	        unsigned flags, struct block **result);
 void bcache_put(struct block *b);
 
+/*
+ * Reads several byte ranges, one after another, into data.  Every block
+ * covering the ranges is prefetched before waiting for any of them, so
+ * the misses are waited for together rather than one at a time.
+ */
+struct bcache_range {
+	uint64_t start;
+	size_t len;
+};
+
+bool bcache_read_ranges(struct bcache *cache, int di, const struct bcache_range *ranges,
+			unsigned nr_ranges, void *data);
+
 /*
  * flush() does not attempt to writeback locked blocks.  flush will fail
  * (return false), if any unlocked dirty data cannot be written back.
@@ -18,6 +18,7 @@
 #include "lib/device/dev-type.h"
 #include "lib/device/device_id.h"
 #include "lib/datastruct/btree.h"
+#include "lib/datastruct/str_list.h"
 #include "lib/config/config.h"
 #include "lib/commands/toolcontext.h"
 #include "device_mapper/misc/dm-ioctl.h"
@@ -32,6 +33,7 @@
 #include <time.h>
 /* coverity[unnecessary_header] needed for MuslC */
 #include <sys/file.h>
+#include <poll.h>
 
 struct dev_iter {
 	struct btree_iter *current;
@@ -57,7 +59,9 @@ static struct {
 	dev_t st_dev;
 	struct dm_list dirs;
 	struct dm_list files;
-
+#ifdef UDEV_SYNC_SUPPORT
+	struct udev_monitor *monitor;
+#endif
 } _cache;
 
 #define _zalloc(x) dm_pool_zalloc(_cache.mem, (x))
@@ -66,6 +70,7 @@ static struct {
 
 static int _insert(const char *path, const struct stat *info,
 		   int rec, int check_with_udev_db);
+static void _drop_all_aliases(struct device *dev);
 
 /* Setup non-zero members of passed zeroed 'struct device' */
 static void _dev_init(struct device *dev)
@@ -1106,6 +1111,127 @@ static void _insert_dirs(struct dm_list *dirs)
 	}
 }
 
+/*
+ * Long-running processes in incremental mode keep dev-cache between
+ * commands.  The udev monitor is started before the first full listing,
+ * so every later block device add/change/remove is reported and can be
+ * applied to dev-cache without listing all devices again.
+ */
+#define DEV_CACHE_MONITOR_BUFFER_SIZE (4 * 1024 * 1024)
+
+int dev_cache_monitor_start(void)
+{
+	struct udev *udev;
+	struct udev_monitor *mon;
+
+	if (_cache.monitor)
+		return 1;
+
+	if (!obtain_device_list_from_udev() ||
+	    !(udev = udev_get_library_context()))
+		return 0;
+
+	if (!(mon = udev_monitor_new_from_netlink(udev, "udev"))) {
+		log_debug_devs("Failed to create udev monitor.");
+		return 0;
+	}
+
+	if (udev_monitor_filter_add_match_subsystem_devtype(mon, "block", NULL) ||
+	    udev_monitor_enable_receiving(mon)) {
+		log_debug_devs("Failed to enable udev monitor.");
+		udev_monitor_unref(mon);
+		return 0;
+	}
+
+	/* Bigger buffer needs privileges, events lost on overflow are detected. */
+	if (udev_monitor_set_receive_buffer_size(mon, DEV_CACHE_MONITOR_BUFFER_SIZE))
+		log_debug_devs("Failed to set udev monitor buffer size.");
+
+	log_debug_devs("Monitoring udev events for block devices.");
+	_cache.monitor = mon;
+
+	return 1;
+}
+
+int dev_cache_monitor_running(void)
+{
+	return _cache.monitor ? 1 : 0;
+}
+
+static void _monitor_stop(void)
+{
+	if (_cache.monitor) {
+		udev_monitor_unref(_cache.monitor);
+		_cache.monitor = NULL;
+	}
+}
+
+static int _monitor_apply_event(struct cmd_context *cmd, struct udev_device *device,
+				struct dm_list *changes)
+{
+	struct udev_list_entry *symlink_entry;
+	const char *name;
+	struct dm_list names;
+	dev_t devt;
+
+	if (!(devt = udev_device_get_devnum(device)))
+		return 1;
+
+	dm_list_init(&names);
+
+	if ((name = udev_device_get_devnode(device)) &&
+	    !str_list_add(cmd->mem, &names, name))
+		return_0;
+
+	udev_list_entry_foreach(symlink_entry, udev_device_get_devlinks_list_entry(device))
+		if ((name = udev_list_entry_get_name(symlink_entry)) &&
+		    !str_list_add(cmd->mem, &names, name))
+			return_0;
+
+	return dev_cache_apply_event(cmd, udev_device_get_action(device), devt, &names, changes);
+}
+
+/*
+ * Apply pending udev events to dev-cache and return the changed devices.
+ * Fails when dev-cache may have missed some change and all devices need
+ * to be listed again.
+ */
+int dev_cache_monitor_update(struct cmd_context *cmd, struct dm_list *changes)
+{
+	struct udev_device *device;
+	struct pollfd pfd = { .events = POLLIN };
+	unsigned events = 0;
+
+	if (!_cache.monitor || !_cache.has_scanned)
+		return 0;
+
+	pfd.fd = udev_monitor_get_fd(_cache.monitor);
+
+	while (poll(&pfd, 1, 0) > 0) {
+		errno = 0;
+		if (!(device = udev_monitor_receive_device(_cache.monitor))) {
+			/* Filtered messages return no device */
+			if (!errno || (errno == EAGAIN) || (errno == EINTR))
+				continue;
+			/* ENOBUFS: socket buffer overflowed, events were lost */
+			log_debug_devs("Failed to receive udev event: %s.", strerror(errno));
+			_monitor_stop();
+			return 0;
+		}
+
+		events++;
+		if (!_monitor_apply_event(cmd, device, changes)) {
+			udev_device_unref(device);
+			return_0;
+		}
+		udev_device_unref(device);
+	}
+
+	log_debug_devs("Applied %u udev events to device cache.", events);
+
+	return dev_cache_check_partitions(cmd, changes);
+}
+
 #else	/* UDEV_SYNC_SUPPORT */
 
 static int _device_in_udev_db(const dev_t d)
@@ -1129,6 +1255,25 @@ static void _insert_dirs(struct dm_list *dirs)
 	}
 }
 
+int dev_cache_monitor_start(void)
+{
+	return 0;
+}
+
+int dev_cache_monitor_running(void)
+{
+	return 0;
+}
+
+static void _monitor_stop(void)
+{
+}
+
+int dev_cache_monitor_update(struct cmd_context *cmd, struct dm_list *changes)
+{
+	return 0;
+}
+
 #endif	/* UDEV_SYNC_SUPPORT */
 
 static int _insert(const char *path, const struct stat *info,
@@ -1190,15 +1335,139 @@ static void _drop_all_aliases(struct device *dev)
 	}
 }
 
+static int _monitor_add_change(struct cmd_context *cmd, struct dm_list *changes,
+			       dev_t devt, int added, int removed)
+{
+	struct dev_cache_change *dc;
+
+	if (!(dc = dm_pool_zalloc(cmd->mem, sizeof(*dc))))
+		return_0;
+
+	dc->devt = devt;
+	dc->added = added;
+	dc->removed = removed;
+	dm_list_add(changes, &dc->list);
+
+	return 1;
+}
+
+/*
+ * Apply one block device event from the udev monitor to dev-cache.
+ * The names are the device node and its symlinks.
+ */
+int dev_cache_apply_event(struct cmd_context *cmd, const char *action, dev_t devt,
+			  struct dm_list *names, struct dm_list *changes)
+{
+	struct stat info = { .st_mode = S_IFBLK, .st_rdev = devt };
+	struct dm_str_list *sl;
+	struct device *dev;
+	int added, removed;
+
+	added = action && !strcmp(action, "add");
+	removed = action && !strcmp(action, "remove");
+
+	log_debug_devs("udev event %s for %d:%d.", action ? : "unknown",
+		       (int)MAJOR(devt), (int)MINOR(devt));
+
+	if (removed) {
+		if ((dev = (struct device *) btree_lookup(_cache.devices, (uint32_t) devt)))
+			_drop_all_aliases(dev);
+	} else
+		/*
+		 * Like _insert_udev_dir, the names come from udev and the
+		 * device may already be gone, its remove event follows.
+		 */
+		dm_list_iterate_items(sl, names)
+			(void) _insert(sl->str, &info, 0, 0);
+
+	return _monitor_add_change(cmd, changes, devt, added, removed);
+}
+
+static int _cmp_devt(const void *a, const void *b)
+{
+	dev_t da = *(const dev_t *) a, db = *(const dev_t *) b;
+
+	return (da > db) - (da < db);
+}
+
+/*
+ * Cross-check dev-cache with /proc/partitions.  A listed device missing
+ * in dev-cache means an event was lost.  Devices no longer listed are
+ * reported as removed (this includes devices with zero size).
+ */
+int dev_cache_check_partitions(struct cmd_context *cmd, struct dm_list *changes)
+{
+	char partitions[PATH_MAX], line[256];
+	struct btree_iter *iter;
+	struct device *dev;
+	dev_t *devts = NULL, *tmp;
+	unsigned major, minor, count = 0, alloc = 0;
+	FILE *fp;
+	int r = 0;
+
+	if (dm_snprintf(partitions, sizeof(partitions), "%s/partitions", cmd->proc_dir) < 0)
+		return_0;
+
+	if (!(fp = fopen(partitions, "r"))) {
+		log_sys_debug("fopen", partitions);
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%u %u", &major, &minor) != 2)
+			continue;
+
+		if (count == alloc) {
+			alloc = alloc ? alloc * 2 : 256;
+			if (!(tmp = realloc(devts, alloc * sizeof(*devts)))) {
+				log_error("Failed to allocate partitions list.");
+				goto out;
+			}
+			devts = tmp;
+		}
+		devts[count] = MKDEV(major, minor);
+
+		if (!(dev = (struct device *) btree_lookup(_cache.devices, (uint32_t) devts[count])) ||
+		    dm_list_empty(&dev->aliases)) {
+			log_debug_devs("Device %u:%u is missing in device cache.", major, minor);
+			goto out;
+		}
+		count++;
+	}
+
+	qsort(devts, count, sizeof(*devts), _cmp_devt);
+
+	for (iter = btree_first(_cache.devices); iter; iter = btree_next(iter)) {
+		dev = btree_get_data(iter);
+		if (!(dev->flags & DEV_REGULAR) &&
+		    !bsearch(&dev->dev, devts, count, sizeof(*devts), _cmp_devt) &&
+		    !_monitor_add_change(cmd, changes, dev->dev, 0, 1))
+			goto_out;
+	}
+
+	r = 1;
+out:
+	if (fclose(fp))
+		log_sys_debug("fclose", partitions);
+	free(devts);
+
+	return r;
+}
+
 void dev_cache_scan(struct cmd_context *cmd)
 {
-	log_debug_devs("Creating list of system devices.");
+	/* Incremental mode: devices have not changed since previous command */
+	if (cmd->reuse_dev_list && _cache.has_scanned)
+		log_debug_devs("Reusing list of system devices.");
+	else {
+		log_debug_devs("Creating list of system devices.");
 
-	_cache.has_scanned = 1;
+		_cache.has_scanned = 1;
 
-	setlocale(LC_COLLATE, "C"); /* Avoid sorting by locales */
-	_insert_dirs(&_cache.dirs);
-	setlocale(LC_COLLATE, "");
+		setlocale(LC_COLLATE, "C"); /* Avoid sorting by locales */
+		_insert_dirs(&_cache.dirs);
+		setlocale(LC_COLLATE, "");
+	}
 
 	if (cmd->check_devs_used)
 		(void) dev_cache_index_devs();
@@ -1371,6 +1640,8 @@ int dev_cache_exit(void)
 	if (_cache.lvid_index)
 		dm_hash_destroy(_cache.lvid_index);
 
+	_monitor_stop();
+
 	memset(&_cache, 0, sizeof(_cache));
 
 	return (!num_open);
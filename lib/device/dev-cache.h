@@ -51,6 +51,25 @@ int dev_cache_check_for_open_devices(void);
 void dev_cache_scan(struct cmd_context *cmd);
 int dev_cache_has_scanned(void);
 
+/*
+ * udev monitor keeping dev-cache up to date between commands
+ * in long-running processes (incremental mode).
+ */
+struct dev_cache_change {
+	struct dm_list list;
+	dev_t devt;
+	int added;
+	int removed;
+};
+
+int dev_cache_monitor_start(void);
+int dev_cache_monitor_running(void);
+int dev_cache_monitor_update(struct cmd_context *cmd, struct dm_list *changes);
+/* Used by dev_cache_monitor_update, tests feed events directly. */
+int dev_cache_apply_event(struct cmd_context *cmd, const char *action, dev_t devt,
+			  struct dm_list *names, struct dm_list *changes);
+int dev_cache_check_partitions(struct cmd_context *cmd, struct dm_list *changes);
+
 int dev_cache_add_dir(const char *path);
 struct device *dev_cache_get(struct cmd_context *cmd, const char *name, struct dev_filter *f);
 struct device *dev_cache_get_existing(struct cmd_context *cmd, const char *name, struct dev_filter *f);
@@ -23,6 +23,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <pthread.h>
 
 #ifdef __linux__
 #  define u64 uint64_t		/* Missing without __KERNEL__ */
@@ -285,6 +286,154 @@ int dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64_t size_
 	return _dev_discard_blocks(dev, offset_bytes, size_bytes);
 }
 
+#define DEV_DISCARD_MAX_THREADS 16
+
+struct dev_discard_job {
+	struct dev_discard_range *ranges;
+	unsigned count;
+	pthread_t thread;
+	int started;
+};
+
+static int _discard_range_cmp(const void *a, const void *b)
+{
+	const struct dev_discard_range *r1 = a, *r2 = b;
+
+	if (r1->dev != r2->dev)
+		return ((uintptr_t) r1->dev < (uintptr_t) r2->dev) ? -1 : 1;
+
+	if (r1->offset_bytes != r2->offset_bytes)
+		return (r1->offset_bytes < r2->offset_bytes) ? -1 : 1;
+
+	return 0;
+}
+
+/* Runs without any logging, errors are reported by the caller */
+static void *_discard_thread(void *arg)
+{
+	struct dev_discard_job *job = arg;
+	uint64_t discard_range[2];
+	unsigned i;
+
+	for (i = 0; i < job->count; ++i) {
+		discard_range[0] = job->ranges[i].offset_bytes;
+		discard_range[1] = job->ranges[i].size_bytes;
+		if (ioctl(job->ranges[i].dev->fd, BLKDISCARD, &discard_range) < 0)
+			job->ranges[i].error = errno;
+	}
+
+	return NULL;
+}
+
+static void _discard_jobs_finish(struct dev_discard_job *jobs, unsigned count)
+{
+	struct dev_discard_range *range;
+	unsigned i;
+
+	for (i = 0; i < count; ++i) {
+		if (jobs[i].started && pthread_join(jobs[i].thread, NULL))
+			log_sys_debug("pthread_join", dev_name(jobs[i].ranges[0].dev));
+
+		for (range = jobs[i].ranges; range < jobs[i].ranges + jobs[i].count; ++range)
+			if (range->error)
+				log_warn("WARNING: %s: ioctl BLKDISCARD at offset " FMTu64
+					 " size " FMTu64 " failed: %s.",
+					 dev_name(range->dev), range->offset_bytes,
+					 range->size_bytes, strerror(range->error));
+
+		if (!dev_close_immediate(jobs[i].ranges[0].dev))
+			stack;
+	}
+}
+
+/*
+ * Sort ranges by device and offset and merge overlapping or adjacent
+ * ranges on the same device.  Returns the number of ranges left.
+ */
+unsigned dev_discard_ranges_merge(struct dev_discard_range *ranges, unsigned count)
+{
+	unsigned i, merged = 0;
+
+	if (!count)
+		return 0;
+
+	qsort(ranges, count, sizeof(*ranges), _discard_range_cmp);
+
+	for (i = 1; i < count; ++i) {
+		if ((ranges[i].dev == ranges[merged].dev) &&
+		    (ranges[i].offset_bytes <= ranges[merged].offset_bytes + ranges[merged].size_bytes)) {
+			if (ranges[i].offset_bytes + ranges[i].size_bytes >
+			    ranges[merged].offset_bytes + ranges[merged].size_bytes)
+				ranges[merged].size_bytes = ranges[i].offset_bytes + ranges[i].size_bytes -
+					ranges[merged].offset_bytes;
+			continue;
+		}
+		ranges[++merged] = ranges[i];
+	}
+
+	return merged + 1;
+}
+
+/*
+ * Discard many ranges at once. Ranges are merged as above and every
+ * device gets its own thread, so slow discards on one device do not
+ * serialize the others.
+ * As with dev_discard_blocks() a failed discard is only reported.
+ */
+int dev_discard_ranges(struct dev_discard_range *ranges, unsigned count)
+{
+	struct dev_discard_job jobs[DEV_DISCARD_MAX_THREADS], *job;
+	unsigned i, njobs = 0;
+
+	if (!(count = dev_discard_ranges_merge(ranges, count)))
+		return 1;
+
+	for (i = 0; i < count; ++i) {
+		ranges[i].error = 0;
+		log_debug_devs("Discarding " FMTu64 " bytes offset " FMTu64 " bytes on %s.%s",
+			       ranges[i].size_bytes, ranges[i].offset_bytes, dev_name(ranges[i].dev),
+			       test_mode() ? " (test mode - suppressed)" : "");
+	}
+
+	if (test_mode())
+		return 1;
+
+	for (i = 0; i < count; i += job->count) {
+		if (njobs == DEV_DISCARD_MAX_THREADS) {
+			_discard_jobs_finish(jobs, njobs);
+			njobs = 0;
+		}
+
+		job = &jobs[njobs];
+		memset(job, 0, sizeof(*job));
+		job->ranges = &ranges[i];
+		for (job->count = 1; (i + job->count < count) &&
+		     (ranges[i + job->count].dev == ranges[i].dev); job->count++)
+			;
+
+		if (ranges[i].dev->flags & DEV_REGULAR)
+			continue;
+
+		if (!dev_open(ranges[i].dev)) {
+			log_warn("WARNING: %s: Failed to open device, skipping discard of %u ranges.",
+				 dev_name(ranges[i].dev), job->count);
+			continue;
+		}
+
+		if (pthread_create(&job->thread, NULL, _discard_thread, job))
+			/* Discard within this thread instead */
+			(void) _discard_thread(job);
+		else
+			job->started = 1;
+
+		njobs++;
+	}
+
+	_discard_jobs_finish(jobs, njobs);
+
+	return 1;
+}
+
 void dev_flush(struct device *dev)
 {
 	if (!(dev->flags & DEV_REGULAR) && ioctl(dev->fd, BLKFLSBUF, 0) >= 0)
@@ -215,6 +215,16 @@ int dev_get_size(struct device *dev, uint64_t *size);
 int dev_get_read_ahead(struct device *dev, uint32_t *read_ahead);
 int dev_discard_blocks(struct device *dev, uint64_t offset_bytes, uint64_t size_bytes);
 
+struct dev_discard_range {
+	struct device *dev;
+	uint64_t offset_bytes;
+	uint64_t size_bytes;
+	int error;
+};
+
+unsigned dev_discard_ranges_merge(struct dev_discard_range *ranges, unsigned count);
+int dev_discard_ranges(struct dev_discard_range *ranges, unsigned count);
+
 /* Use quiet version if device number could change e.g. when opening LV */
 int dev_open(struct device *dev);
 int dev_open_quiet(struct device *dev);
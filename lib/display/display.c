@@ -409,7 +409,8 @@ int lvdisplay_full(struct cmd_context *cmd,
 	struct lv_segment *snap_seg = NULL, *mirror_seg = NULL;
 	struct lv_segment *seg = NULL;
 	int lvm1compat;
-	dm_percent_t snap_percent;
+	dm_percent_t snap_percent, *snap_percents;
+	unsigned i;
 	int thin_pool_active = 0;
 	dm_percent_t thin_data_percent = 0, thin_metadata_percent = 0;
 	int thin_active = 0;
@@ -461,13 +462,18 @@ int lvdisplay_full(struct cmd_context *cmd,
 	if (lv_is_origin(lv)) {
 		log_print("LV snapshot status     source of");
 
+		if (!(snap_percents = dm_pool_alloc(cmd->mem, sizeof(*snap_percents) *
+						    dm_list_size(&lv->snapshot_segs))))
+			return_0;
+
+		if (!inkernel || !lv_origin_snapshots_percent(lv, snap_percents))
+			for (i = 0; i < dm_list_size(&lv->snapshot_segs); ++i)
+				snap_percents[i] = DM_PERCENT_INVALID;
+
+		i = 0;
 		dm_list_iterate_items_gen(snap_seg, &lv->snapshot_segs,
 				       origin_list) {
-			if (inkernel &&
-			    (snap_active = lv_snapshot_percent(snap_seg->cow,
-							       &snap_percent)))
-				if (snap_percent == DM_PERCENT_INVALID)
-					snap_active = 0;
+			snap_active = (snap_percents[i++] != DM_PERCENT_INVALID);
 			if (lvm1compat)
 				log_print("                       %s%s/%s [%s]",
 					  lv->vg->cmd->dev_dir, lv->vg->name,
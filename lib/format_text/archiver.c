@@ -36,6 +36,7 @@ struct backup_params {
 	int enabled;
 	char *dir;
 	int suppress;
+	int reuse_committed_text;
 };
 
 int archive_init(struct cmd_context *cmd, const char *dir,
@@ -183,7 +184,7 @@ int archive_display_file(struct cmd_context *cmd, const char *file)
 }
 
 int backup_init(struct cmd_context *cmd, const char *dir,
-		int enabled)
+		int enabled, int reuse_committed_text)
 {
 	backup_exit(cmd);
 
@@ -201,6 +202,7 @@ int backup_init(struct cmd_context *cmd, const char *dir,
 		return 0;
 	}
 	backup_enable(cmd, enabled);
+	cmd->backup_params->reuse_committed_text = reuse_committed_text;
 
 	return 1;
 }
@@ -274,6 +276,13 @@ int backup_locally(struct volume_group *vg)
 	return 1;
 }
 
+/* Can backup write the committed text of the VG without formatting it? */
+int backup_can_reuse_committed_text(const struct volume_group *vg)
+{
+	return (vg->cmd->backup_params->reuse_committed_text &&
+		text_vg_has_committed_text(vg)) ? 1 : 0;
+}
+
 int backup(struct volume_group *vg)
 {
 
@@ -581,6 +590,7 @@ int backup_to_file(const char *file, const char *desc, struct volume_group *vg)
 	struct cmd_context *cmd;
 
 	cmd = vg->cmd;
+	tc.reuse_committed_text = cmd->backup_params->reuse_committed_text;
 
 	log_verbose("Creating volume group backup \"%s\" (seqno %u).", file, vg->seqno);
 
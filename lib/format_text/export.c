@@ -71,6 +71,7 @@ struct formatter {
 	int indent;		/* current level of indentation */
 	int error;
 	int header;		/* 1 => comments at start; 0 => end */
+	uint32_t vg_size;	/* raw: size of text preceding trailing header */
 };
 
 static struct utsname _utsname;
@@ -1024,8 +1025,11 @@ static int _text_vg_export(struct formatter *f,
 	if (!out_text(f, "}"))
 		goto_out;
 
-	if (!f->header && !_print_header(vg->cmd, f, desc))
-		goto_out;
+	if (!f->header) {
+		f->vg_size = f->data.buf.used;
+		if (!_print_header(vg->cmd, f, desc))
+			goto_out;
+	}
 
 	r = 1;
 
@@ -1062,8 +1066,12 @@ int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp)
 	return r;
 }
 
-/* Returns amount of buffer used incl. terminating NUL */
-size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *buf_size)
+/*
+ * Returns amount of buffer used incl. terminating NUL.
+ * The header comes after the VG text, which is vg_size bytes long.
+ */
+size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
+			  uint32_t *buf_size, uint32_t *vg_size)
 {
 	size_t r;
 	struct formatter f = {
@@ -1092,12 +1100,47 @@ size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
 	if (buf_size)
 		*buf_size = f.data.buf.size;
 
+	if (vg_size)
+		*vg_size = f.vg_size;
+
 	return r;
 }
 
+/*
+ * Formats just the header placed at the start of a metadata file,
+ * for files written from VG text produced by text_vg_export_raw().
+ * Returns the length of the header text.
+ */
+size_t text_vg_export_header_raw(struct volume_group *vg, const char *desc, char **buf)
+{
+	struct formatter f = {
+		.indent = 0,
+		.header = 1,
+		.out_with_comment = &_out_with_comment_raw,
+		.nl = &_nl_raw,
+		.data.buf.size = 1024,
+	};
+
+	_init();
+
+	if (!(f.data.buf.start = zalloc(f.data.buf.size))) {
+		log_error("text_export header buffer allocation failed");
+		return 0;
+	}
+
+	if (!_print_header(vg->cmd, &f, desc)) {
+		free(f.data.buf.start);
+		return 0;
+	}
+
+	*buf = f.data.buf.start;
+
+	return f.data.buf.used;
+}
+
 static size_t _export_vg_to_buffer(struct volume_group *vg, char **buf)
 {
-	return text_vg_export_raw(vg, "", buf, NULL);
+	return text_vg_export_raw(vg, "", buf, NULL, NULL);
 }
 
 struct dm_config_tree *export_vg_to_config_tree(struct volume_group *vg)
@@ -25,6 +25,7 @@
 #include "lib/misc/lvm-string.h"
 #include "lib/uuid/uuid.h"
 #include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/mm/xlate.h"
 #include "lib/label/label.h"
 #include "lib/cache/lvmcache.h"
@@ -32,6 +33,7 @@
 
 #include <unistd.h>
 #include <limits.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <ctype.h>
 
@@ -42,8 +44,20 @@ struct text_fid_context {
 	char *write_buf;         /* buffer containing metadata text to write to disk */
 	uint32_t write_buf_size; /* mem size of write_buf, increases in 64K multiples */
 	uint32_t new_metadata_size; /* size of text metadata in buf */
+	uint32_t new_vg_size;    /* size of VG text in buf, before the trailing header */
 	uint32_t checksum;       /* crc32 checksum for new metadata */
 	unsigned preserve:1;
+	char *committed_buf;     /* write_buf kept after commit, for the backup file */
+	uint32_t committed_vg_size;
+	uint32_t committed_seqno;
+	char *deferred_buf;      /* text of the written VG not imported yet */
+	uint32_t deferred_size;
+	uint32_t deferred_checksum;
+	unsigned size_warned:1;  /* headroom warning given for write_buf */
+	char *compressed_buf;    /* write_buf compressed with metadata/compress */
+	uint32_t compressed_buf_size;
+	uint32_t compressed_size;
+	uint32_t compressed_checksum; /* crc32 checksum of compressed metadata */
 };
 
 void preserve_text_fidtc(struct volume_group *vg)
@@ -55,6 +69,15 @@ void preserve_text_fidtc(struct volume_group *vg)
 		fidtc->preserve = 1;
 }
 
+static void _free_compressed_text(struct text_fid_context *fidtc)
+{
+	free(fidtc->compressed_buf);
+	fidtc->compressed_buf = NULL;
+	fidtc->compressed_buf_size = 0;
+	fidtc->compressed_size = 0;
+	fidtc->compressed_checksum = 0;
+}
+
 void free_text_fidtc(struct volume_group *vg)
 {
 	struct format_instance *fid = vg->fid;
@@ -63,12 +86,145 @@ void free_text_fidtc(struct volume_group *vg)
 	if (!fidtc)
 		return;
 
+	/* The VG may still need to be imported from write_buf */
+	if ((vg->precommitted_deferred || vg->committed_deferred) &&
+	    fidtc->deferred_buf && (fidtc->deferred_buf == fidtc->write_buf) &&
+	    !text_vg_import_deferred(vg))
+		stack;
+
 	fidtc->preserve = 0;
 
 	free(fidtc->write_buf);
 	fidtc->write_buf = NULL;
 	fidtc->write_buf_size = 0;
 	fidtc->new_metadata_size = 0;
+	fidtc->new_vg_size = 0;
+	_free_compressed_text(fidtc);
+}
+
+/*
+ * Once committed, the metadata text is exactly what a backup of the
+ * VG needs, so keep it rather than formatting it all again.
+ */
+static void _keep_committed_text(struct text_fid_context *fidtc, uint32_t seqno)
+{
+	if (!fidtc->write_buf)
+		return;
+
+	free(fidtc->committed_buf);
+	fidtc->committed_buf = fidtc->write_buf;
+	fidtc->committed_vg_size = fidtc->new_vg_size;
+	fidtc->committed_seqno = seqno;
+
+	fidtc->write_buf = NULL;
+	fidtc->write_buf_size = 0;
+	fidtc->new_metadata_size = 0;
+	fidtc->new_vg_size = 0;
+	_free_compressed_text(fidtc);
+}
+
+static void _free_committed_text(struct text_fid_context *fidtc)
+{
+	free(fidtc->committed_buf);
+	fidtc->committed_buf = NULL;
+	fidtc->committed_vg_size = 0;
+}
+
+/* Is the committed metadata text of the VG seqno still kept? */
+int text_vg_has_committed_text(const struct volume_group *vg)
+{
+	const struct text_fid_context *fidtc = vg->fid ? (const struct text_fid_context *) vg->fid->private : NULL;
+
+	return (fidtc && fidtc->committed_buf && fidtc->committed_vg_size &&
+		(fidtc->committed_seqno == vg->seqno)) ? 1 : 0;
+}
+
+/*
+ * Keep buf with size bytes of metadata text exported for the VG as its
+ * write buffer and import vg_precommitted from it when first needed.
+ */
+int text_vg_defer_import(struct volume_group *vg, char *buf, uint32_t size, uint32_t checksum)
+{
+	struct text_fid_context *fidtc = vg->fid ? (struct text_fid_context *) vg->fid->private : NULL;
+
+	if (!fidtc)
+		return_0;
+
+	if (fidtc->write_buf != buf) {
+		free(fidtc->write_buf);
+		fidtc->write_buf = buf;
+		fidtc->write_buf_size = size;
+		fidtc->new_metadata_size = size;
+	}
+
+	release_vg(vg->vg_precommitted);
+	vg->vg_precommitted = NULL;
+	vg->precommitted_deferred = 1;
+	fidtc->deferred_buf = buf;
+	fidtc->deferred_size = size;
+	fidtc->deferred_checksum = checksum;
+
+	return 1;
+}
+
+/*
+ * With metadata/defer_precommitted_import the text written by vg_write
+ * is not parsed back into vg_precommitted straight away.  It stays in
+ * write_buf and, once committed, in committed_buf, and is imported from
+ * there when something first needs the copy.  The checksum calculated
+ * for the metadata area verifies the text is still what was written.
+ */
+int text_vg_import_deferred(struct volume_group *vg)
+{
+	struct text_fid_context *fidtc = vg->fid ? (struct text_fid_context *) vg->fid->private : NULL;
+	struct volume_group **vg_copy;
+	struct dm_config_tree *cft;
+	int r = 0;
+
+	if (vg->precommitted_deferred)
+		vg_copy = &vg->vg_precommitted;
+	else if (vg->committed_deferred)
+		vg_copy = &vg->vg_committed;
+	else
+		return 1;
+
+	if (!fidtc || !fidtc->deferred_buf ||
+	    ((fidtc->deferred_buf != fidtc->write_buf) &&
+	     (fidtc->deferred_buf != fidtc->committed_buf))) {
+		log_error(INTERNAL_ERROR "Missing written metadata text for VG %s.", vg->name);
+		goto out;
+	}
+
+	if (calc_crc(INITIAL_CRC, (uint8_t *)fidtc->deferred_buf,
+		     fidtc->deferred_size) != fidtc->deferred_checksum) {
+		log_error(INTERNAL_ERROR "Written metadata text for VG %s has changed.", vg->name);
+		goto out;
+	}
+
+	log_debug_metadata("Importing %scommitted VG %s seqno %u from written metadata (%u bytes).",
+			   vg->precommitted_deferred ? "pre" : "", vg->name, vg->seqno,
+			   fidtc->deferred_size);
+
+	if (!(cft = config_tree_from_string_without_dup_node_check(fidtc->deferred_buf))) {
+		log_error("Error parsing metadata for VG %s.", vg->name);
+		goto out;
+	}
+
+	release_vg(*vg_copy);
+	*vg_copy = import_vg_from_config_tree(vg->cmd, vg->fid, cft);
+	dm_config_destroy(cft);
+
+	if (!*vg_copy)
+		goto_out;
+
+	r = 1;
+out:
+	vg->precommitted_deferred = 0;
+	vg->committed_deferred = 0;
+	if (fidtc)
+		fidtc->deferred_buf = NULL;
+
+	return r;
 }
 
 int rlocn_is_ignored(const struct raw_locn *rlocn)
@@ -114,6 +270,21 @@ static uint64_t _mda_total_sectors_raw(struct metadata_area *mda)
 	return mdac->area.size >> SECTOR_SHIFT;
 }
 
+static int _mda_grow_raw(struct metadata_area *mda, uint64_t sectors)
+{
+	struct mda_context *mdac = (struct mda_context *) mda->metadata_locn;
+
+	if ((sectors << SECTOR_SHIFT) <= mdac->area.size) {
+		log_error(INTERNAL_ERROR "Metadata area on %s cannot grow to %llu sectors.",
+			  dev_name(mdac->area.dev), (unsigned long long)sectors);
+		return 0;
+	}
+
+	mdac->area.size = sectors << SECTOR_SHIFT;
+
+	return 1;
+}
+
 /*
  * Check if metadata area belongs to vg
  */
@@ -220,7 +391,7 @@ static int _raw_read_mda_header(struct mda_header *mdah, struct device_area *dev
 		*bad_fields |= BAD_MDA_MAGIC;
 	}
 
-	if (mdah->version != FMTT_VERSION) {
+	if ((mdah->version != FMTT_VERSION) && (mdah->version != FMTT_VERSION_COMPRESSED)) {
 		log_warn("WARNING: wrong version %u in mda header on %s at %llu",
 			  mdah->version,
 			  dev_name(dev_area->dev), (unsigned long long)dev_area->start);
@@ -262,12 +433,23 @@ struct mda_header *raw_read_mda_header(const struct format_type *fmt,
 	return mdah;
 }
 
+static uint32_t _mdah_version(struct mda_header *mdah)
+{
+	struct raw_locn *rl;
+
+	for (rl = &mdah->raw_locns[0]; rl->offset; rl++)
+		if (rl->flags & RAW_LOCN_COMPRESSED)
+			return FMTT_VERSION_COMPRESSED;
+
+	return FMTT_VERSION;
+}
+
 static int _raw_write_mda_header(const struct format_type *fmt,
 				 struct device *dev, int primary_mda,
 				 uint64_t start_byte, struct mda_header *mdah)
 {
 	memcpy(mdah->magic, FMTT_MAGIC, sizeof(mdah->magic));
-	mdah->version = FMTT_VERSION;
+	mdah->version = _mdah_version(mdah);
 	mdah->start = start_byte;
 
 	_xlate_mdah(mdah);
@@ -426,6 +608,7 @@ static struct volume_group *_vg_read_raw_area(struct cmd_context *cmd,
 				wrap,
 				calc_crc,
 				rlocn->checksum,
+				(rlocn->flags & RAW_LOCN_COMPRESSED) ? 1 : 0,
 				&when, &desc);
 
 	if (!vg && (!use_previous_vg || !*use_previous_vg)) {
@@ -505,6 +688,76 @@ static struct volume_group *_vg_read_precommit_raw(struct cmd_context *cmd,
 	return vg;
 }
 
+/*
+ * With metadata/compress the metadata text is written to disk compressed
+ * and RAW_LOCN_COMPRESSED is set in the raw_locn pointing to it.  The
+ * raw_locn checksum is calculated over the compressed data, as it is on
+ * disk.  Text that does not get smaller is written uncompressed.
+ */
+static int _compress_write_buf(struct volume_group *vg, struct text_fid_context *fidtc)
+{
+	uint32_t bound = lz_compress_bound(fidtc->new_metadata_size);
+	uint32_t buf_size;
+	uint32_t size;
+	char *buf;
+
+	/* Writes are extended with zeroes from the buffer up to 512 bytes */
+	buf_size = (bound + 1023) & ~511;
+
+	if (!(buf = zalloc(buf_size))) {
+		log_error("Failed to allocate buffer for compressed metadata.");
+		return 0;
+	}
+
+	if (!(size = lz_compress(fidtc->write_buf, fidtc->new_metadata_size, buf,
+				 fidtc->new_metadata_size))) {
+		log_debug_metadata("VG %s %u metadata not compressible.", vg->name, vg->seqno);
+		free(buf);
+		return 1;
+	}
+
+	fidtc->compressed_buf = buf;
+	fidtc->compressed_buf_size = buf_size;
+	fidtc->compressed_size = size;
+	fidtc->compressed_checksum = calc_crc(INITIAL_CRC, (uint8_t *)buf, size);
+
+	log_debug_metadata("VG %s %u metadata compressed from %u to %u bytes.",
+			   vg->name, vg->seqno, fidtc->new_metadata_size, size);
+
+	return 1;
+}
+
+/*
+ * Warn while there is still room to grow the metadata area, before
+ * the metadata size reaches max_size and writing metadata fails.
+ * The number of LVs that still fit is estimated from the average
+ * text size per LV in the new metadata.
+ */
+static void _check_size_headroom(struct volume_group *vg, struct text_fid_context *fidtc,
+				 const char *devname, uint64_t new_size, uint64_t max_size)
+{
+	int threshold = find_config_tree_int(vg->cmd, metadata_size_warning_threshold_CFG, NULL);
+	uint64_t per_lv;
+
+	if ((threshold <= 0) || (threshold >= 100) || fidtc->size_warned)
+		return;
+
+	if (new_size * 100 <= max_size * threshold)
+		return;
+
+	fidtc->size_warned = 1;
+
+	per_lv = new_size / (dm_list_size(&vg->lvs) + 1);
+
+	log_warn("WARNING: VG %s metadata on %s uses %llu of %llu bytes (%u%%), %llu bytes left for about %llu more LVs.",
+		 vg->name, devname,
+		 (unsigned long long)new_size, (unsigned long long)max_size,
+		 (unsigned)(new_size * 100 / max_size),
+		 (unsigned long long)(max_size - new_size),
+		 (unsigned long long)((max_size - new_size) / per_lv));
+	log_warn("WARNING: Use pvresize --metadatasize to grow the metadata area.");
+}
+
 /*
  * VG metadata updates:
  *
@@ -558,6 +811,7 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	struct mda_header *mdah;
 	struct pv_list *pvl;
 	uint64_t mda_start = mdac->area.start;
+	uint64_t mda_size;
 	uint64_t max_size;
 	uint64_t old_start = 0, old_last = 0, old_size = 0, old_wrap = 0;
 	uint64_t new_start = 0, new_last = 0, new_size = 0, new_wrap = 0;
@@ -632,7 +886,8 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		else
 			(void) dm_snprintf(desc, sizeof(desc), "Write[%u] from %s.", vg->write_count, vg->cmd->cmd_line);
 
-		new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size);
+		new_size = text_vg_export_raw(vg, desc, &write_buf, &write_buf_size,
+					      &fidtc->new_vg_size);
 		if (!new_size || !write_buf) {
 			log_error("VG %s metadata writing failed", vg->name);
 			goto out;
@@ -641,23 +896,47 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		fidtc->write_buf = write_buf;
 		fidtc->write_buf_size = write_buf_size;
 		fidtc->new_metadata_size = new_size;
+		fidtc->size_warned = 0;
 
-		/* Immediatelly reuse existing buffer for parsing metadata back.
-		 * Such VG is then used for as precommitted VG and later committed VG.
-		 *
-		 * 'Lazy' creation of such VG might improve performance, but we
-		 * lose important validation that written metadata can be parsed. */
-		if (!(cft = config_tree_from_string_without_dup_node_check(write_buf))) {
-			log_error("Error parsing metadata for VG %s.", vg->name);
-			goto out;
-		}
-		release_vg(vg->vg_precommitted);
-		vg->vg_precommitted = import_vg_from_config_tree(vg->cmd, vg->fid, cft);
-		dm_config_destroy(cft);
-		if (!vg->vg_precommitted)
+		/* Text of the previous commit is going away */
+		if (!text_vg_import_deferred(vg))
 			goto_out;
+		_free_committed_text(fidtc);
 
 		fidtc->checksum = checksum = calc_crc(INITIAL_CRC, (uint8_t *)write_buf, new_size);
+
+		if (vg->cmd->defer_precommitted_import) {
+			/* Parse write_buf back only when the precommitted VG is used. */
+			if (!text_vg_defer_import(vg, write_buf, new_size, checksum))
+				goto_out;
+		} else {
+			/* Immediatelly reuse existing buffer for parsing metadata back.
+			 * Such VG is then used for as precommitted VG and later committed VG.
+			 *
+			 * 'Lazy' creation of such VG might improve performance, but we
+			 * lose important validation that written metadata can be parsed. */
+			if (!(cft = config_tree_from_string_without_dup_node_check(write_buf))) {
+				log_error("Error parsing metadata for VG %s.", vg->name);
+				goto out;
+			}
+			release_vg(vg->vg_precommitted);
+			vg->vg_precommitted = import_vg_from_config_tree(vg->cmd, vg->fid, cft);
+			dm_config_destroy(cft);
+			if (!vg->vg_precommitted)
+				goto_out;
+		}
+
+		_free_compressed_text(fidtc);
+		if (find_config_tree_bool(vg->cmd, metadata_compress_CFG, vg->profile) &&
+		    !_compress_write_buf(vg, fidtc))
+			goto_out;
+	}
+
+	if (fidtc->compressed_buf) {
+		write_buf = fidtc->compressed_buf;
+		write_buf_size = fidtc->compressed_buf_size;
+		new_size = fidtc->compressed_size;
+		checksum = fidtc->compressed_checksum;
 	}
 
 	log_debug_metadata("VG %s seqno %u metadata write to %s mda_start %llu mda_size %llu mda_last %llu",
@@ -676,7 +955,14 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	 * single copy of metadata is rounded to begin on a sector boundary.
 	 */
 
-	max_size = ((mdah->size - MDA_HEADER_SIZE) / 2) - 512;
+	/*
+	 * When the metadata area is being grown (mda_grow), mdac->area.size
+	 * is already the new size, while mdah->size on disk is the old size
+	 * until vg_commit writes the new size with the new raw_locn.
+	 */
+	mda_size = (mdac->area.size > mdah->size) ? mdac->area.size : mdah->size;
+
+	max_size = ((mda_size - MDA_HEADER_SIZE) / 2) - 512;
 
 	if (new_size > max_size) {
 		log_error("VG %s %u metadata on %s (%llu bytes) exceeds maximum metadata size (%llu bytes)",
@@ -686,6 +972,8 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		goto out;
 	}
 
+	_check_size_headroom(vg, fidtc, devname, new_size, max_size);
+
 	/*
 	 * rlocn_old is the current, committed, raw_locn data in slot0 on disk.
 	 *
@@ -752,8 +1040,30 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	 */
 	new_start = _next_rlocn_offset(vg, rlocn_old, old_last, mdah, mda_start, MDA_ORIGINAL_ALIGNMENT);
 
-	if (new_start + new_size > mdah->size) {
-		new_wrap = (new_start + new_size) - mdah->size;
+	/*
+	 * A growing metadata area gets the new metadata in the added space
+	 * after the old end, so the old copy stays intact (wrapped or not)
+	 * and the new copy does not wrap.
+	 */
+	if (mda_size > mdah->size) {
+		new_start = mdah->size;
+
+		if (new_start + new_size > mda_size) {
+			log_error("VG %s %u metadata on %s (%llu bytes) does not fit into %llu bytes added to metadata area.",
+				  vg->name, vg->seqno, devname,
+				  (unsigned long long)new_size,
+				  (unsigned long long)(mda_size - mdah->size));
+			goto out;
+		}
+
+		log_debug_metadata("VG %s %u growing metadata area from %llu to %llu",
+				   vg->name, vg->seqno,
+				   (unsigned long long)mdah->size,
+				   (unsigned long long)mda_size);
+	}
+
+	if (new_start + new_size > mda_size) {
+		new_wrap = (new_start + new_size) - mda_size;
 		new_last = new_wrap + MDA_HEADER_SIZE - 1;
 
 		log_debug_metadata("VG %s %u wrapping metadata new_start %llu new_size %llu to size1 %llu size2 %llu",
@@ -774,6 +1084,7 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	rlocn_new = &mdac->rlocn;
 	rlocn_new->offset = new_start;
 	rlocn_new->size = new_size;
+	rlocn_new->flags = fidtc->compressed_buf ? RAW_LOCN_COMPRESSED : 0;
 
 	log_debug_metadata("VG %s %u metadata area location old start %llu last %llu size %llu wrap %llu",
 			   vg->name, vg->seqno,
@@ -801,7 +1112,12 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	 * overlap between old and new.
 	 */
 
-	if (new_wrap && old_wrap) {
+	if (mda_size > mdah->size) {
+
+		/* new metadata is located in the space added to the area */
+		overlap = false;
+
+	} else if (new_wrap && old_wrap) {
 
 		/* old and new can't both wrap without overlapping */
 		overlap = true;
@@ -953,7 +1269,7 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 		goto out;
 	}
 
-	dev_set_last_byte(mdac->area.dev, mda_start + mdah->size);
+	dev_set_last_byte(mdac->area.dev, mda_start + mda_size);
 
 	log_debug_metadata("VG %s %u metadata write at %llu size %llu (wrap %llu)", 
 			   vg->name, vg->seqno,
@@ -992,6 +1308,54 @@ static int _vg_write_raw(struct format_instance *fid, struct volume_group *vg,
 	return r;
 }
 
+struct _grow_label_mda_baton {
+	uint64_t start;
+	uint64_t size;
+};
+
+static int _grow_label_mda(struct metadata_area *mda, void *baton)
+{
+	struct _grow_label_mda_baton *p = baton;
+	struct mda_context *mdac = (struct mda_context *) mda->metadata_locn;
+
+	if (mdac->area.start == p->start)
+		mdac->area.size = p->size;
+
+	return 1;
+}
+
+/*
+ * After vg_commit switched a grown metadata area to its new size,
+ * the PV label is updated with the new metadata area size and the
+ * new data area offset (pe_start moved by the extents given to the
+ * metadata area).  Until then, the label describes the old layout,
+ * which still leads to the mda header that has the real size.
+ */
+static int _grow_label(struct physical_volume *pv, struct mda_context *mdac)
+{
+	struct _grow_label_mda_baton baton = {
+		.start = mdac->area.start,
+		.size = mdac->area.size,
+	};
+	struct lvmcache_info *info;
+
+	if (!(info = lvmcache_info_from_pvid(pv->dev->pvid, pv->dev, 0))) {
+		log_error("No cached info for PV %s to update its label.", pv_dev_name(pv));
+		return 0;
+	}
+
+	if (!lvmcache_foreach_mda(info, _grow_label_mda, &baton) ||
+	    !lvmcache_update_das(info, pv))
+		return_0;
+
+	if (!label_write(pv->dev, lvmcache_get_label(info))) {
+		log_error("Failed to write label with grown metadata area to %s.", pv_dev_name(pv));
+		return 0;
+	}
+
+	return 1;
+}
+
 /*
  * Writes new raw_locn to disk that was saved by vg_write_raw (in mdac->rlocn).
  * The new raw_locn points to the new metadata that was written by vg_write_raw.
@@ -1017,6 +1381,7 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 	struct raw_locn *rlocn_new;
 	struct pv_list *pvl;
 	uint32_t bad_fields = 0;
+	int grow;
 	int r = 0;
 	int found = 0;
 
@@ -1071,6 +1436,27 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 
 	rlocn_new = &mdac->rlocn;
 
+	/*
+	 * A growing metadata area switches to the new size and the new
+	 * metadata with the single header write of vg_commit.  There is
+	 * no precommitted state, the header could not describe both the
+	 * old copy with the old size and the new copy with the new size.
+	 */
+	if ((grow = (rlocn_new->size && (mdac->area.size > mdab->size)))) {
+		if (precommit) {
+			log_debug_metadata("VG %s metadata precommit skipped on growing mda on %s.",
+					   vg->name, dev_name(mdac->area.dev));
+			dm_pool_free(fid->fmt->cmd->mem, mdab);
+			return 1;
+		}
+
+		log_debug_metadata("VG %s metadata commit grows mda on %s from %llu to %llu.",
+				   vg->name, dev_name(mdac->area.dev),
+				   (unsigned long long)mdab->size,
+				   (unsigned long long)mdac->area.size);
+		mdab->size = mdac->area.size;
+	}
+
 	if (!rlocn_new->size) {
 		/*
 		 * When there is no new metadata, the precommit slot is
@@ -1079,6 +1465,7 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn_slot1->offset   = 0;
 		rlocn_slot1->size     = 0;
 		rlocn_slot1->checksum = 0;
+		rlocn_slot1->flags   &= ~RAW_LOCN_COMPRESSED;
 
 	} else if (precommit) {
 		/*
@@ -1088,6 +1475,8 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn_slot1->offset   = rlocn_new->offset;
 		rlocn_slot1->size     = rlocn_new->size;
 		rlocn_slot1->checksum = rlocn_new->checksum;
+		rlocn_slot1->flags    = (rlocn_slot1->flags & ~RAW_LOCN_COMPRESSED) |
+					(rlocn_new->flags & RAW_LOCN_COMPRESSED);
 	} else {
 		/*
 		 * vg_commit writes the new raw_locn into slot 0,
@@ -1096,10 +1485,13 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		rlocn_slot0->offset   = rlocn_new->offset;
 		rlocn_slot0->size     = rlocn_new->size;
 		rlocn_slot0->checksum = rlocn_new->checksum;
+		rlocn_slot0->flags    = (rlocn_slot0->flags & ~RAW_LOCN_COMPRESSED) |
+					(rlocn_new->flags & RAW_LOCN_COMPRESSED);
 
 		rlocn_slot1->offset   = 0;
 		rlocn_slot1->size     = 0;
 		rlocn_slot1->checksum = 0;
+		rlocn_slot1->flags   &= ~RAW_LOCN_COMPRESSED;
 	}
 
 	rlocn_set_ignored(rlocn_slot0, mda_is_ignored(mda));
@@ -1130,11 +1522,18 @@ static int _vg_commit_raw_rlocn(struct format_instance *fid,
 		goto out;
 	}
 
+	if (grow && !_grow_label(pvl->pv, mdac))
+		goto_out;
+
 	r = 1;
 
       out:
-	if (!precommit && !fidtc->preserve)
-		free_text_fidtc(vg);
+	if (!precommit && !fidtc->preserve) {
+		if (r)
+			_keep_committed_text(fidtc, vg->seqno);
+		else
+			free_text_fidtc(vg);
+	}
 
 	return r;
 }
@@ -1290,13 +1689,77 @@ static struct volume_group *_vg_read_precommit_file(struct cmd_context *cmd, str
 	return vg;
 }
 
+static int _writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t n;
+
+	while (iovcnt) {
+		if ((n = writev(fd, iov, iovcnt)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return 0;
+		}
+
+		while (iovcnt && ((size_t) n >= iov->iov_len)) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt) {
+			iov->iov_base = (char *) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * Write the file from the metadata text committed to disk for this
+ * VG seqno, preceded by a file header, with a single vectored write.
+ * Returns -1 if there is no such text and the VG must be formatted.
+ */
+static int _vg_write_file_committed_text(struct volume_group *vg, const char *desc,
+					 int fd, const char *temp_file)
+{
+	struct text_fid_context *fidtc;
+	struct iovec iov[2];
+	char *header;
+	size_t header_size;
+	int r;
+
+	if (!text_vg_has_committed_text(vg))
+		return -1;
+
+	fidtc = (struct text_fid_context *) vg->fid->private;
+
+	if (!(header_size = text_vg_export_header_raw(vg, desc, &header)))
+		return_0;
+
+	log_debug_metadata("Writing %s metadata to %s from committed text (%u bytes)",
+			   vg->name, temp_file, fidtc->committed_vg_size);
+
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_size;
+	iov[1].iov_base = fidtc->committed_buf;
+	iov[1].iov_len = fidtc->committed_vg_size;
+
+	if (!(r = _writev_all(fd, iov, 2)))
+		log_sys_error("writev", temp_file);
+
+	free(header);
+
+	return r;
+}
+
 static int _vg_write_file(struct format_instance *fid __attribute__((unused)),
 			  struct volume_group *vg, struct metadata_area *mda)
 {
 	struct text_context *tc = (struct text_context *) mda->metadata_locn;
 
 	FILE *fp;
-	int fd;
+	int fd, r;
 	char *slash;
 	char temp_file[PATH_MAX], temp_dir[PATH_MAX];
 
@@ -1318,6 +1781,30 @@ static int _vg_write_file(struct format_instance *fid __attribute__((unused)),
 		return 0;
 	}
 
+	if (tc->reuse_committed_text &&
+	    ((r = _vg_write_file_committed_text(vg, tc->desc, fd, temp_file)) >= 0)) {
+		if (!r) {
+			log_error("Failed to write metadata to %s.", temp_file);
+			if (close(fd))
+				log_sys_error("close", temp_file);
+			return 0;
+		}
+
+		if (fsync(fd) && (errno != EROFS) && (errno != EINVAL)) {
+			log_sys_error("fsync", tc->path_edit);
+			if (close(fd))
+				log_sys_error("close", tc->path_edit);
+			return 0;
+		}
+
+		if (close(fd)) {
+			log_sys_error("close", tc->path_edit);
+			return 0;
+		}
+
+		goto do_rename;
+	}
+
 	if (!(fp = fdopen(fd, "w"))) {
 		log_sys_error("fdopen", temp_file);
 		if (close(fd))
@@ -1344,6 +1831,7 @@ static int _vg_write_file(struct format_instance *fid __attribute__((unused)),
 	if (lvm_fclose(fp, tc->path_edit))
 		return_0;
 
+do_rename:
 	log_debug_metadata("Renaming %s to %s", temp_file, tc->path_edit);
 	if (rename(temp_file, tc->path_edit)) {
 		log_error("%s: rename to %s failed: %s", temp_file,
@@ -1557,6 +2045,7 @@ int read_metadata_location_summary(const struct format_type *fmt,
 				(uint32_t) (rlocn->size - wrap),
 				(off_t) (dev_area->start + MDA_HEADER_SIZE),
 				wrap, calc_crc, vgsummary->vgname ? 1 : 0,
+				(rlocn->flags & RAW_LOCN_COMPRESSED) ? 1 : 0,
 				vgsummary)) {
 		log_warn("WARNING: metadata on %s at %llu has invalid summary for VG.",
 			  dev_name(dev_area->dev),
@@ -1943,6 +2432,8 @@ static int _text_pv_initialise(const struct format_type *fmt,
 static void _text_destroy_instance(struct format_instance *fid)
 {
 	if (--fid->ref_count <= 1) {
+		if (fid->private)
+			_free_committed_text((struct text_fid_context *) fid->private);
 		if (fid->metadata_areas_index)
 			dm_hash_destroy(fid->metadata_areas_index);
 		dm_pool_destroy(fid->mem);
@@ -1986,6 +2477,7 @@ static struct metadata_area_ops _metadata_text_raw_ops = {
 	.mda_metadata_locn_offset = _metadata_locn_offset_raw,
 	.mda_free_sectors = _mda_free_sectors_raw,
 	.mda_total_sectors = _mda_total_sectors_raw,
+	.mda_grow = _mda_grow_raw,
 	.mda_in_vg = _mda_in_vg_raw,
 	.mda_locns_match = _mda_locns_match_raw,
 	.mda_get_device = _mda_get_device_raw,
@@ -2111,6 +2603,8 @@ static void *_create_text_context(struct dm_pool *mem, struct text_context *tc)
 				      : dm_pool_strdup(mem, "")))
 		goto_bad;
 
+	new_tc->reuse_committed_text = tc->reuse_committed_text;
+
 	return (void *) new_tc;
 
       bad:
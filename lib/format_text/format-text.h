@@ -47,6 +47,7 @@ struct text_context {
 	const char *path_live;	/* Path to file holding live metadata */
 	const char *path_edit;	/* Path to file holding edited metadata */
 	const char *desc;	/* Description placed inside file */
+	unsigned reuse_committed_text:1; /* Write file from committed metadata text */
 };
 struct format_type *create_text_format(struct cmd_context *cmd);
 
@@ -82,5 +83,8 @@ int text_wipe_outdated_pv_mda(struct cmd_context *cmd, struct device *dev,
 
 void preserve_text_fidtc(struct volume_group *vg);
 void free_text_fidtc(struct volume_group *vg);
+int text_vg_defer_import(struct volume_group *vg, char *buf, uint32_t size, uint32_t checksum);
+int text_vg_import_deferred(struct volume_group *vg);
+int text_vg_has_committed_text(const struct volume_group *vg);
 
 #endif
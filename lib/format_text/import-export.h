@@ -70,7 +70,9 @@ int print_segtype_lvflags(char *buffer, size_t size, uint64_t status);
 int read_segtype_lvflags(uint64_t *status, char *segtype_str);
 
 int text_vg_export_file(struct volume_group *vg, const char *desc, FILE *fp);
-size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf, uint32_t *alloc_size);
+size_t text_vg_export_raw(struct volume_group *vg, const char *desc, char **buf,
+			  uint32_t *alloc_size, uint32_t *vg_size);
+size_t text_vg_export_header_raw(struct volume_group *vg, const char *desc, char **buf);
 struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 const char *file,
 					 time_t *when, char **desc);
@@ -82,7 +84,7 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 				       off_t offset, uint32_t size,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
-				       uint32_t checksum,
+				       uint32_t checksum, int compressed,
 				       time_t *when, char **desc);
 
 int text_read_metadata_summary(const struct format_type *fmt,
@@ -90,7 +92,7 @@ int text_read_metadata_summary(const struct format_type *fmt,
 		       off_t offset, uint32_t size,
 		       off_t offset2, uint32_t size2,
 		       checksum_fn_t checksum_fn,
-		       int checksum_only,
+		       int checksum_only, int compressed,
 		       struct lvmcache_vgsummary *vgsummary);
 
 #endif
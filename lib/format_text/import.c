@@ -41,7 +41,7 @@ int text_read_metadata_summary(const struct format_type *fmt,
 		       off_t offset, uint32_t size,
 		       off_t offset2, uint32_t size2,
 		       checksum_fn_t checksum_fn,
-		       int checksum_only,
+		       int checksum_only, int compressed,
 		       struct lvmcache_vgsummary *vgsummary)
 {
 	struct dm_config_tree *cft;
@@ -61,7 +61,7 @@ int text_read_metadata_summary(const struct format_type *fmt,
 		if (!config_file_read_fd(cft, dev, reason, offset, size,
 					 offset2, size2, checksum_fn,
 					 vgsummary->mda_checksum,
-					 checksum_only, 1)) {
+					 checksum_only, 1, compressed)) {
 			log_warn("WARNING: invalid metadata text from %s at %llu.",
 				 dev_name(dev), (unsigned long long)offset);
 			goto out;
@@ -112,7 +112,7 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 				       off_t offset, uint32_t size,
 				       off_t offset2, uint32_t size2,
 				       checksum_fn_t checksum_fn,
-				       uint32_t checksum,
+				       uint32_t checksum, int compressed,
 				       time_t *when, char **desc)
 {
 	struct volume_group *vg = NULL;
@@ -156,7 +156,7 @@ struct volume_group *text_read_metadata(struct format_instance *fid,
 
 		if (!config_file_read_fd(cft, dev, MDA_CONTENT_REASON(primary_mda), offset, size,
 					 offset2, size2, checksum_fn, checksum,
-					 skip_parse, 1)) {
+					 skip_parse, 1, compressed)) {
 			log_warn("WARNING: couldn't read volume group metadata from %s.", dev_name(dev));
 			goto out;
 		}
@@ -210,7 +210,7 @@ struct volume_group *text_read_metadata_file(struct format_instance *fid,
 					 time_t *when, char **desc)
 {
 	return text_read_metadata(fid, file, NULL, NULL, NULL, 0,
-				  (off_t)0, 0, (off_t)0, 0, NULL, 0,
+				  (off_t)0, 0, (off_t)0, 0, NULL, 0, 0,
 				  when, desc);
 }
 
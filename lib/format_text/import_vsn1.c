@@ -1013,6 +1013,169 @@ static int _read_lvsegs(struct cmd_context *cmd,
 	return 1;
 }
 
+/*
+ * Selective import (metadata/selective_import): activating a few named
+ * LVs in a VG with very many LVs does not need to import all of them.
+ * Only the named LVs and the LVs connected to them are imported, and
+ * the VG is marked as partially imported so it cannot be written.
+ *
+ * LV references are string values in segment sections naming another
+ * LV (pool, origin, sub-LVs, external origin, pvmove...).  Both LVs
+ * used by a selected LV and LVs using it are selected, except that
+ * users of a thin pool are not followed, so a thin LV comes with its
+ * pool but without the other thin LVs of the pool.  Named LVs that are
+ * used by another LV, pools with pending messages and shared VGs are
+ * always imported fully.
+ */
+struct import_lv_ref {
+	struct import_lv_ref *next;
+	struct import_lv *ilv;
+};
+
+struct import_lv {
+	struct import_lv *next_selected;
+	struct import_lv_ref *refs;	/* LVs used by this LV */
+	struct import_lv_ref *users;	/* LVs using this LV */
+	unsigned selected:1;
+	unsigned thin_pool:1;
+	unsigned messages:1;
+};
+
+static int _add_import_lv_ref(struct dm_pool *mem, struct import_lv_ref **list,
+			      struct import_lv *ilv)
+{
+	struct import_lv_ref *ref;
+
+	if (!(ref = dm_pool_alloc(mem, sizeof(*ref))))
+		return_0;
+
+	ref->ilv = ilv;
+	ref->next = *list;
+	*list = ref;
+
+	return 1;
+}
+
+static int _read_import_lv_refs(struct dm_pool *mem, struct dm_hash_table *ilvs,
+				struct import_lv *ilv, const struct dm_config_node *cn)
+{
+	const struct dm_config_value *cv;
+	struct import_lv *used;
+
+	for (; cn; cn = cn->sib) {
+		if (!cn->v) {
+			/* Thin pool messages reference LVs to create or delete */
+			if (!strncmp(cn->key, "message", 7))
+				ilv->messages = 1;
+			if (!_read_import_lv_refs(mem, ilvs, ilv, cn->child))
+				return_0;
+			continue;
+		}
+
+		for (cv = cn->v; cv; cv = cv->next) {
+			if (cv->type != DM_CFG_STRING)
+				continue;
+			if (!strcmp(cn->key, "type") && !strcmp(cv->v.str, SEG_TYPE_NAME_THIN_POOL))
+				ilv->thin_pool = 1;
+			else if ((used = dm_hash_lookup(ilvs, cv->v.str)) && (used != ilv) &&
+				 (!_add_import_lv_ref(mem, &ilv->refs, used) ||
+				  !_add_import_lv_ref(mem, &used->users, ilv)))
+				return_0;
+		}
+	}
+
+	return 1;
+}
+
+static int _select_import_lvs(const char *vg_name, const struct dm_config_node *lvsn,
+			      const struct dm_list *lv_names, struct dm_pool *mem,
+			      struct dm_hash_table **selected)
+{
+	const struct dm_config_node *lvn, *cn;
+	const struct dm_str_list *sl;
+	struct dm_hash_table *ilvs;
+	struct import_lv *ilv, *todo = NULL;
+	struct import_lv_ref *ref;
+	unsigned count = 0, selected_count = 0;
+
+	for (lvn = lvsn->child; lvn; lvn = lvn->sib)
+		count++;
+
+	if (!(ilvs = dm_hash_create(count * 2 + 1))) {
+		log_error("Couldn't create hash table for selected LVs.");
+		return 0;
+	}
+
+	for (lvn = lvsn->child; lvn; lvn = lvn->sib)
+		if (!(ilv = dm_pool_zalloc(mem, sizeof(*ilv))) ||
+		    !dm_hash_insert(ilvs, lvn->key, ilv))
+			goto_bad;
+
+	/* Segment sections hold the references */
+	for (lvn = lvsn->child; lvn; lvn = lvn->sib)
+		for (cn = lvn->child; cn; cn = cn->sib)
+			if (!cn->v &&
+			    !_read_import_lv_refs(mem, ilvs, dm_hash_lookup(ilvs, lvn->key), cn->child))
+				goto_bad;
+
+	dm_list_iterate_items(sl, lv_names) {
+		if (!(ilv = dm_hash_lookup(ilvs, sl->str)) || ilv->users) {
+			log_debug_metadata("Importing all LVs of VG %s for %s.", vg_name, sl->str);
+			goto bad;
+		}
+		if (!ilv->selected) {
+			ilv->selected = 1;
+			ilv->next_selected = todo;
+			todo = ilv;
+		}
+	}
+
+	while ((ilv = todo)) {
+		todo = ilv->next_selected;
+		selected_count++;
+
+		if (ilv->messages) {
+			log_debug_metadata("Importing all LVs of VG %s with pending thin pool messages.", vg_name);
+			goto bad;
+		}
+
+		for (ref = ilv->refs; ref; ref = ref->next)
+			if (!ref->ilv->selected) {
+				ref->ilv->selected = 1;
+				ref->ilv->next_selected = todo;
+				todo = ref->ilv;
+			}
+
+		if (!ilv->thin_pool)
+			for (ref = ilv->users; ref; ref = ref->next)
+				if (!ref->ilv->selected) {
+					ref->ilv->selected = 1;
+					ref->ilv->next_selected = todo;
+					todo = ref->ilv;
+				}
+	}
+
+	if (selected_count == count)
+		goto bad;
+
+	log_debug_metadata("Importing %u of %u LVs of VG %s.", selected_count, count, vg_name);
+
+	*selected = ilvs;
+
+	return 1;
+bad:
+	dm_hash_destroy(ilvs);
+
+	return 0;
+}
+
+static int _lv_is_selected(struct dm_hash_table *selected, const char *lv_name)
+{
+	struct import_lv *ilv;
+
+	return (ilv = dm_hash_lookup(selected, lv_name)) && ilv->selected;
+}
+
 static int _read_sections(struct cmd_context *cmd,
 			  const struct format_type *fmt,
 			  struct format_instance *fid,
@@ -1023,7 +1186,8 @@ static int _read_sections(struct cmd_context *cmd,
 			  const struct dm_config_node *vgn,
 			  struct dm_hash_table *pv_hash,
 			  struct dm_hash_table *lv_hash,
-			  int optional)
+			  int optional,
+			  struct dm_hash_table *selected_lvs)
 {
 	const struct dm_config_node *n;
 
@@ -1037,6 +1201,8 @@ static int _read_sections(struct cmd_context *cmd,
 	}
 
 	for (n = n->child; n; n = n->sib) {
+		if (selected_lvs && !_lv_is_selected(selected_lvs, n->key))
+			continue;
 		if (!fn(cmd, (struct format_type *)fmt, fid, mem, vg, vgsummary, n, vgn, pv_hash, lv_hash))
 			return_0;
 	}
@@ -1049,12 +1215,12 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 				     struct format_instance *fid,
 				     const struct dm_config_tree *cft)
 {
-	struct dm_pool *mem;
-	const struct dm_config_node *vgn;
+	struct dm_pool *mem, *select_mem = NULL;
+	const struct dm_config_node *vgn, *lvsn;
 	const struct dm_config_value *cv;
 	const char *str, *format_str, *system_id;
 	struct volume_group *vg;
-	struct dm_hash_table *pv_hash = NULL, *lv_hash = NULL;
+	struct dm_hash_table *pv_hash = NULL, *lv_hash = NULL, *selected_lvs = NULL;
 	uint64_t vgstatus;
 
 	/* skip any top-level values */
@@ -1204,7 +1370,7 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	}
 
 	if (!_read_sections(cmd, fmt, fid, mem, "physical_volumes", _read_pv, vg, NULL,
-			    vgn, pv_hash, lv_hash, 0)) {
+			    vgn, pv_hash, lv_hash, 0, NULL)) {
 		log_error("Couldn't find all physical volumes for volume "
 			  "group %s.", vg->name);
 		goto bad;
@@ -1217,29 +1383,40 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 		goto bad;
 	}
 
+	if (cmd->import_lv_names && !vg_is_shared(vg) &&
+	    dm_config_get_section(vgn, "logical_volumes", &lvsn)) {
+		if (!(select_mem = dm_pool_create("selective_import", 4096)))
+			goto_bad;
+		if (_select_import_lvs(vg->name, lvsn, cmd->import_lv_names, select_mem, &selected_lvs))
+			vg->partial_import = 1;
+	}
+
 	if (!_read_sections(cmd, fmt, fid, mem, "logical_volumes", _read_lvnames, vg, NULL,
-			    vgn, pv_hash, lv_hash, 1)) {
+			    vgn, pv_hash, lv_hash, 1, selected_lvs)) {
 		log_error("Couldn't read all logical volume names for volume "
 			  "group %s.", vg->name);
 		goto bad;
 	}
 
-	if (!_read_sections(cmd, fmt, fid, mem, "historical_logical_volumes", _read_historical_lvnames, vg, NULL,
-			    vgn, pv_hash, lv_hash, 1)) {
+	/* Historical LVs refer to any LVs, they are not needed for activation */
+	if (!selected_lvs &&
+	    !_read_sections(cmd, fmt, fid, mem, "historical_logical_volumes", _read_historical_lvnames, vg, NULL,
+			    vgn, pv_hash, lv_hash, 1, NULL)) {
 		log_error("Couldn't read all historical logical volumes for volume "
 			  "group %s.", vg->name);
 		goto bad;
 	}
 
 	if (!_read_sections(cmd, fmt, fid, mem, "logical_volumes", _read_lvsegs, vg, NULL,
-			    vgn, pv_hash, lv_hash, 1)) {
+			    vgn, pv_hash, lv_hash, 1, selected_lvs)) {
 		log_error("Couldn't read all logical volumes for "
 			  "volume group %s.", vg->name);
 		goto bad;
 	}
 
-	if (!_read_sections(cmd, fmt, fid, mem, "historical_logical_volumes", _read_historical_lvnames_interconnections,
-			    vg, NULL, vgn, pv_hash, lv_hash, 1)) {
+	if (!selected_lvs &&
+	    !_read_sections(cmd, fmt, fid, mem, "historical_logical_volumes", _read_historical_lvnames_interconnections,
+			    vg, NULL, vgn, pv_hash, lv_hash, 1, NULL)) {
 		log_error("Couldn't read all removed logical volume interconnections "
 			  "for volume group %s.", vg->name);
 		goto bad;
@@ -1254,6 +1431,11 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	dm_hash_destroy(pv_hash);
 	dm_hash_destroy(lv_hash);
 
+	if (selected_lvs)
+		dm_hash_destroy(selected_lvs);
+	if (select_mem)
+		dm_pool_destroy(select_mem);
+
 	if (fid)
 		vg_set_fid(vg, fid);
 
@@ -1269,6 +1451,11 @@ static struct volume_group *_read_vg(struct cmd_context *cmd,
 	if (lv_hash)
 		dm_hash_destroy(lv_hash);
 
+	if (selected_lvs)
+		dm_hash_destroy(selected_lvs);
+	if (select_mem)
+		dm_pool_destroy(select_mem);
+
 	release_vg(vg);
 	return NULL;
 }
@@ -1352,7 +1539,7 @@ static int _read_vgsummary(const struct format_type *fmt, const struct dm_config
 	}
 
 	if (!_read_sections(fmt->cmd, NULL, NULL, mem, "physical_volumes", _read_pvsummary, NULL, vgsummary,
-			    vgn, NULL, NULL, 0)) {
+			    vgn, NULL, NULL, 0, NULL)) {
 		log_debug("Couldn't read pv summaries");
 	}
 
@@ -56,6 +56,13 @@ struct pv_header {
  */
 #define RAW_LOCN_IGNORED 0x00000001
 
+/*
+ * The metadata text at this location is compressed (metadata/compress).
+ * The checksum is calculated over the compressed data.  An mda_header
+ * with a compressed location has FMTT_VERSION_COMPRESSED.
+ */
+#define RAW_LOCN_COMPRESSED 0x00000002
+
 /* On disk */
 struct raw_locn {
 	uint64_t offset;	/* Offset in bytes to start sector */
@@ -98,6 +105,12 @@ struct mda_context {
 /* FIXME Convert this at runtime */
 #define FMTT_MAGIC "\040\114\126\115\062\040\170\133\065\101\045\162\060\116\052\076"
 #define FMTT_VERSION 1
+/*
+ * mda_header version while a raw_locn has RAW_LOCN_COMPRESSED, older
+ * versions reject the mda_header instead of reading compressed data
+ * as text.
+ */
+#define FMTT_VERSION_COMPRESSED 2
 #define MDA_HEADER_SIZE 512
 #define LVM2_LABEL "LVM2 001"
 #define MDA_SIZE_MIN (8 * (unsigned) lvm_getpagesize())
@@ -1239,6 +1239,202 @@ bad:
 	return 0;
 }
 
+/*
+ * Incremental mode (lvm2cmd users running many commands on one handle):
+ * the devices that passed the nodata filters in a full label_scan are
+ * reused by the next label_scan, which skips dev_cache_scan and nodata
+ * filtering, as long as the block devices listed in /proc/partitions
+ * (including their sizes) and the devices file stay the same.
+ *
+ * With the udev monitor running, changed block devices are applied
+ * to dev-cache and the saved devices instead of listing all again.
+ */
+int label_scan_incremental_token(struct cmd_context *cmd, uint32_t *token,
+				 uint32_t *devices_file_token)
+{
+	char partitions[PATH_MAX];
+	uint8_t buf[16384];
+	uint32_t crc = INITIAL_CRC;
+	struct stat info;
+	ssize_t len;
+	int fd, r = 1;
+
+	if (!*cmd->proc_dir ||
+	    (dm_snprintf(partitions, sizeof(partitions), "%s/partitions", cmd->proc_dir) < 0))
+		return 0;
+
+	if ((fd = open(partitions, O_RDONLY | O_CLOEXEC)) < 0) {
+		log_sys_debug("open", partitions);
+		return 0;
+	}
+
+	while ((len = read(fd, buf, sizeof(buf)))) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			log_sys_debug("read", partitions);
+			r = 0;
+			break;
+		}
+		crc = calc_crc(crc, buf, (uint32_t) len);
+	}
+
+	if (close(fd))
+		log_sys_debug("close", partitions);
+
+	if (!r)
+		return 0;
+
+	*token = crc;
+	crc = INITIAL_CRC;
+
+	if (cmd->enable_devices_file) {
+		crc = calc_crc(crc, (const uint8_t *) cmd->devices_file_path,
+			       strlen(cmd->devices_file_path));
+		if (stat(cmd->devices_file_path, &info))
+			memset(&info, 0, sizeof(info));
+		crc = calc_crc(crc, (const uint8_t *) &info.st_ino, sizeof(info.st_ino));
+		crc = calc_crc(crc, (const uint8_t *) &info.st_size, sizeof(info.st_size));
+		crc = calc_crc(crc, (const uint8_t *) &info.st_mtim, sizeof(info.st_mtim));
+	}
+
+	*devices_file_token = crc;
+
+	return 1;
+}
+
+void label_scan_incremental_save(struct cmd_context *cmd, uint32_t token,
+				 uint32_t devices_file_token, struct dm_list *devs)
+{
+	struct device_list *devl;
+	unsigned count = 0;
+
+	label_scan_incremental_drop(cmd);
+
+	if (!(cmd->incremental_devs = malloc(sizeof(*cmd->incremental_devs) +
+					     dm_list_size(devs) * sizeof(dev_t)))) {
+		log_debug_devs("Failed to save devices for incremental scan.");
+		return;
+	}
+
+	dm_list_iterate_items(devl, devs)
+		cmd->incremental_devs->devs[count++] = devl->dev->dev;
+
+	cmd->incremental_devs->count = count;
+	cmd->incremental_devs->token = token;
+	cmd->incremental_devs->devices_file_token = devices_file_token;
+}
+
+static int _incremental_devs_find(struct incremental_devs *idevs, dev_t devt, int drop)
+{
+	unsigned i;
+
+	for (i = 0; i < idevs->count; i++)
+		if (idevs->devs[i] == devt) {
+			if (drop)
+				idevs->devs[i] = idevs->devs[--idevs->count];
+			return 1;
+		}
+
+	return 0;
+}
+
+/*
+ * Apply block device changes from the udev monitor to the saved devices,
+ * changed devices are checked with nodata filters again.  Adding or
+ * removing dm or md devices may change filtering of their components,
+ * then all devices need to be filtered again and this fails.
+ */
+int label_scan_incremental_update(struct cmd_context *cmd, uint32_t token,
+				  struct dm_list *changes)
+{
+	struct incremental_devs *idevs;
+	struct dev_cache_change *dc;
+	struct device *dev;
+	unsigned major;
+
+	dm_list_iterate_items(dc, changes) {
+		major = MAJOR(dc->devt);
+		if ((_incremental_devs_find(cmd->incremental_devs, dc->devt, 1) ?
+		     dc->removed : dc->added) &&
+		    ((major == cmd->dev_types->device_mapper_major) ||
+		     (major == cmd->dev_types->md_major))) {
+			log_debug_devs("Changed stacked device %d:%d, filtering all devices.",
+				       (int)major, (int)MINOR(dc->devt));
+			return 0;
+		}
+	}
+
+	if (!(idevs = realloc(cmd->incremental_devs, sizeof(*idevs) +
+			      (cmd->incremental_devs->count + dm_list_size(changes)) * sizeof(dev_t))))
+		return_0;
+
+	cmd->incremental_devs = idevs;
+
+	cmd->filter_nodata_only = 1;
+	dm_list_iterate_items(dc, changes) {
+		/* Removed devices have no aliases */
+		if (dc->removed || !(dev = dev_cache_get_by_devt(cmd, dc->devt)) ||
+		    dm_list_empty(&dev->aliases) ||
+		    _incremental_devs_find(idevs, dc->devt, 0))
+			continue;
+
+		dev->size_seqno = 0; /* Size may have changed */
+
+		if (cmd->filter->passes_filter(cmd, cmd->filter, dev, NULL))
+			idevs->devs[idevs->count++] = dc->devt;
+		else if (dev->pvid[0]) {
+			log_print_unless_silent("Clear pvid and info for filtered dev %s.",
+						dev_name(dev));
+			lvmcache_del_dev(dev);
+			memset(dev->pvid, 0, sizeof(dev->pvid));
+		}
+
+		cmd->filter->wipe(cmd, cmd->filter, dev, NULL);
+	}
+	cmd->filter_nodata_only = 0;
+
+	idevs->token = token;
+
+	log_debug_devs("Updated saved devices with %d device changes.", dm_list_size(changes));
+
+	return 1;
+}
+
+/*
+ * Add saved devices to the list, fails when they cannot be reused.
+ */
+static int _incremental_devs_get(struct cmd_context *cmd, struct dm_list *devs)
+{
+	struct device_list *devl, *devl2;
+	struct device *dev;
+	unsigned i;
+
+	for (i = 0; i < cmd->incremental_devs->count; i++) {
+		if (!(dev = dev_cache_get_by_devt(cmd, cmd->incremental_devs->devs[i])) ||
+		    !(devl = zalloc(sizeof(*devl)))) {
+			dm_list_iterate_items_safe(devl, devl2, devs) {
+				dm_list_del(&devl->list);
+				free(devl);
+			}
+			return 0;
+		}
+		devl->dev = dev;
+		dm_list_add(devs, &devl->list);
+		label_scan_invalidate(dev);
+	}
+
+	log_debug_devs("Reusing %u devices from previous scan.", cmd->incremental_devs->count);
+
+	return 1;
+}
+
+void label_scan_incremental_drop(struct cmd_context *cmd)
+{
+	free(cmd->incremental_devs);
+	cmd->incremental_devs = NULL;
+}
+
 /*
  * Scan devices on the system to discover which are LVM devices.
  * Info about the LVM devices (PVs) is saved in lvmcache in a
@@ -1257,8 +1453,11 @@ int label_scan(struct cmd_context *cmd)
 	struct device_list *devl, *devl2;
 	struct device *dev;
 	uint64_t max_metadata_size_bytes;
+	struct dm_list dev_changes;
+	uint32_t token = 0, devices_file_token = 0;
 	int using_hints;
 	int create_hints = 0; /* NEWHINTS_NONE */
+	int incremental = 0, monitored, apply_changes = 0;
 
 	log_debug_devs("Finding devices to scan");
 
@@ -1270,6 +1469,28 @@ int label_scan(struct cmd_context *cmd)
 	if (!label_scan_setup_bcache())
 		return_0;
 
+	/*
+	 * The token is taken before the devices are listed, so any later
+	 * change to the devices is seen by the next command.
+	 */
+	dm_list_init(&dev_changes);
+
+	if (cmd->incremental && !cmd->enable_devices_list) {
+		if (!setup_devices_file(cmd))
+			return_0;
+		/* Changes before the monitor is started are not reported. */
+		if (!(monitored = dev_cache_monitor_running()))
+			(void) dev_cache_monitor_start();
+		if ((incremental = label_scan_incremental_token(cmd, &token, &devices_file_token)) &&
+		    cmd->incremental_devs &&
+		    (cmd->incremental_devs->devices_file_token == devices_file_token)) {
+			if (cmd->incremental_devs->token == token)
+				cmd->reuse_dev_list = 1;
+			else if (monitored && dev_cache_monitor_update(cmd, &dev_changes))
+				cmd->reuse_dev_list = apply_changes = 1;
+		}
+	}
+
 	/*
 	 * Creates a list of available devices, does not open or read any,
 	 * and does not filter them.  The list of all available devices
@@ -1279,10 +1500,24 @@ int label_scan(struct cmd_context *cmd)
 	 * are what filters the devs.
 	 */
 	if (!setup_devices(cmd)) {
+		cmd->reuse_dev_list = 0;
 		log_error("Failed to set up devices.");
 		return 0;
 	}
 
+	if (cmd->reuse_dev_list) {
+		cmd->reuse_dev_list = 0;
+		if (apply_changes && !label_scan_incremental_update(cmd, token, &dev_changes))
+			/* dev-cache is up to date, only filter all devices again. */
+			log_debug_devs("Filtering all devices after changes.");
+		else if (_incremental_devs_get(cmd, &all_devs)) {
+			incremental = 0; /* Keep saved devs */
+			goto filtered;
+		} else
+			/* Saved devices do not match dev-cache, list them again. */
+			dev_cache_scan(cmd);
+	}
+
 	/*
 	 * If we know that there will be md components with an end
 	 * superblock, then enable the full md filter before label
@@ -1308,6 +1543,9 @@ int label_scan(struct cmd_context *cmd)
 		return 0;
 	}
 	while ((dev = dev_iter_get(cmd, iter))) {
+		/* Device removed since it was cached by a previous command */
+		if (dm_list_empty(&dev->aliases))
+			continue;
 		if (!(devl = zalloc(sizeof(*devl))))
 			continue;
 		devl->dev = dev;
@@ -1356,6 +1594,10 @@ int label_scan(struct cmd_context *cmd)
 
 	cmd->filter_nodata_only = 0;
 
+	if (incremental)
+		label_scan_incremental_save(cmd, token, devices_file_token, &all_devs);
+
+filtered:
 	dm_list_iterate_items(devl, &all_devs)
 		cmd->filter->wipe(cmd, cmd->filter, devl->dev, NULL);
 	dm_list_iterate_items(devl, &filtered_devs)
@@ -1729,11 +1971,19 @@ void label_scan_drop(struct cmd_context *cmd)
 
 void label_scan_destroy(struct cmd_context *cmd)
 {
+	struct bcache_stats stats;
+
 	if (!scan_bcache)
 		return;
 
 	label_scan_drop(cmd);
 
+	bcache_get_stats(scan_bcache, &stats);
+	if (stats.range_reads)
+		log_debug_devs("Range reads %u prefetched %u blocks and avoided %u io waits.",
+			       stats.range_reads, stats.range_prefetches,
+			       stats.range_waits_avoided);
+
 	bcache_destroy(scan_bcache);
 	scan_bcache = NULL;
 }
@@ -1911,6 +2161,39 @@ bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 
 }
 
+/*
+ * Read several byte ranges of the device into data, one after another,
+ * waiting for all of them together.
+ */
+bool dev_read_ranges(struct device *dev, const struct bcache_range *ranges,
+		     unsigned nr_ranges, void *data)
+{
+	if (!scan_bcache) {
+		/* Should not happen */
+		log_error("dev_read bcache not set up %s", dev_name(dev));
+		return false;
+	}
+
+	if (dev->bcache_di < 0) {
+		if (!label_scan_open(dev)) {
+			log_error("Error opening device %s for reading at %llu length %u.",
+				  dev_name(dev), (unsigned long long)ranges[0].start,
+				  (uint32_t)ranges[0].len);
+			return false;
+		}
+	}
+
+	if (!bcache_read_ranges(scan_bcache, dev->bcache_di, ranges, nr_ranges, data)) {
+		log_error("Error reading device %s at %llu length %u and %u more ranges.",
+			  dev_name(dev), (unsigned long long)ranges[0].start,
+			  (uint32_t)ranges[0].len, nr_ranges - 1);
+		label_scan_invalidate(dev);
+		return false;
+	}
+
+	return true;
+}
+
 bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data)
 {
 	if (test_mode())
@@ -102,6 +102,14 @@ void label_destroy(struct label *label);
 
 extern struct bcache *scan_bcache;
 
+/* Devices saved by label_scan for the next command in incremental mode */
+struct incremental_devs {
+	uint32_t token;
+	uint32_t devices_file_token;
+	unsigned count;
+	dev_t devs[0];
+};
+
 int label_scan(struct cmd_context *cmd);
 int label_scan_devs(struct cmd_context *cmd, struct dev_filter *f, struct dm_list *devs);
 int label_scan_devs_cached(struct cmd_context *cmd, struct dev_filter *f, struct dm_list *devs);
@@ -113,6 +121,13 @@ void label_scan_invalidate_lv(struct cmd_context *cmd, struct logical_volume *lv
 void label_scan_invalidate_lvs(struct cmd_context *cmd, struct dm_list *lvs);
 void label_scan_drop(struct cmd_context *cmd);
 void label_scan_destroy(struct cmd_context *cmd);
+void label_scan_incremental_drop(struct cmd_context *cmd);
+int label_scan_incremental_token(struct cmd_context *cmd, uint32_t *token,
+				 uint32_t *devices_file_token);
+void label_scan_incremental_save(struct cmd_context *cmd, uint32_t token,
+				 uint32_t devices_file_token, struct dm_list *devs);
+int label_scan_incremental_update(struct cmd_context *cmd, uint32_t token,
+				  struct dm_list *changes);
 int label_scan_setup_bcache(void);
 int label_scan_open(struct device *dev);
 int label_scan_open_excl(struct device *dev);
@@ -130,6 +145,8 @@ int label_scan_for_pvid(struct cmd_context *cmd, char *pvid, struct device **dev
  * (these make it easier to disable bcache and revert to direct rw if needed)
  */
 bool dev_read_bytes(struct device *dev, uint64_t start, size_t len, void *data);
+bool dev_read_ranges(struct device *dev, const struct bcache_range *ranges,
+		     unsigned nr_ranges, void *data);
 bool dev_write_bytes(struct device *dev, uint64_t start, size_t len, void *data);
 bool dev_write_zeros(struct device *dev, uint64_t start, size_t len);
 bool dev_set_bytes(struct device *dev, uint64_t start, size_t len, uint8_t val);
@@ -57,6 +57,8 @@ int lock_vol(struct cmd_context *cmd, const char *vol, uint32_t flags, const str
 #define unlock_vg(cmd, vg, vol)	\
 	do { \
 		if (is_real_vg(vol)) { \
+			if (!vg_issue_discards(vg, 0)) \
+				stack; \
 			if (!sync_local_dev_names(cmd)) \
 				stack; \
 			vg_backup_if_needed(vg); \
@@ -215,6 +215,27 @@ int reopen_standard_stream(FILE **stream, const char *mode)
 void init_log_fn(lvm2_log_fn_t log_fn)
 {
 	_lvm2_log_fn = log_fn;
+	update_log_debug_gate();
+}
+
+int log_debug_classes_wanted = 0;
+
+/*
+ * Recalculate which debug messages could reach any output.
+ * Must be called whenever any of the inputs changes.
+ */
+void update_log_debug_gate(void)
+{
+	int wanted = 0;
+
+	/* Flight recorder records other debug messages by their format only */
+	if (_lvm2_log_fn || (_log_journal & LOG_JOURNAL_DEBUG))
+		wanted = -1;	/* Sees everything regardless of class */
+	else if ((verbose_level() >= _LOG_DEBUG) ||
+		 ((debug_level() >= _LOG_DEBUG) && (_log_to_file || _syslog)))
+		wanted = debug_classes_logged() | LOG_CLASS_ANY;
+
+	log_debug_classes_wanted = wanted;
 }
 
 /* Read /proc/self/stat to extract pid and starttime */
@@ -310,6 +331,7 @@ no_epoch:
 	}
 
 	_log_to_file = 1;
+	update_log_debug_gate();
 }
 
 /*
@@ -346,6 +368,7 @@ void init_syslog(int enable, int facility)
 {
 	if (!enable) {
 		_syslog = 0;
+		update_log_debug_gate();
 		return;
 	}
 
@@ -354,6 +377,7 @@ void init_syslog(int enable, int facility)
 
 	openlog("lvm", LOG_PID, facility);
 	_syslog = 1;
+	update_log_debug_gate();
 }
 
 int log_suppress(int suppress)
@@ -377,6 +401,7 @@ void fin_log(void)
 
 		}
 		_log_to_file = 0;
+		update_log_debug_gate();
 	}
 }
 
@@ -385,6 +410,7 @@ void fin_syslog(void)
 	if (_syslog)
 		closelog();
 	_syslog = 0;
+	update_log_debug_gate();
 }
 
 void init_msg_prefix(const char *prefix)
@@ -496,6 +522,7 @@ void init_debug_output_fields(uint32_t debug_fields)
 void init_log_journal(uint32_t fields)
 {
 	_log_journal = fields;
+	update_log_debug_gate();
 }
 
 static void _set_time_prefix(char *prefix, int buflen)
@@ -551,6 +578,8 @@ static void _vprint_log(int level, const char *file, int line, int dm_errno_or_c
 
 	level = log_level(level);
 
+	log_ring_record(level, file, line, format, orig_ap);
+
 	if (_abort_on_internal_errors_env_present < 0) {
 		if ((env_str = getenv("DM_ABORT_ON_INTERNAL_ERRORS"))) {
 			_abort_on_internal_errors_env_present = 1;
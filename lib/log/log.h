@@ -84,6 +84,7 @@
 #define LOG_CLASS_LVMPOLLD	0x0100	/* "lvmpolld" */
 #define LOG_CLASS_DBUS		0x0200	/* "dbus" */
 #define LOG_CLASS_IO		0x0400	/* "io" */
+#define LOG_CLASS_ANY		0x40000000	/* Any debug output, see LOG_WANTED */
 
 #define log_debug(x...) LOG_LINE(_LOG_DEBUG, x)
 #define log_debug_mem(x...) LOG_LINE_WITH_CLASS(_LOG_DEBUG, LOG_CLASS_MEM, x)
@@ -0,0 +1,760 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Flight recorder: every log message, including debug messages that
+ * are not printed anywhere, is stored in a ring buffer in binary form
+ * (pointers to format and file name plus raw arguments) so recording
+ * costs no formatting. Messages are formatted only when the ring is
+ * dumped - after a failed command, on a fatal signal, on SIGUSR2, or
+ * when requested through log_ring_dump().
+ *
+ * Debug messages that are not logged anywhere else are recorded by their
+ * format only, the log macros do not evaluate their arguments.
+ *
+ * SIGUSR2 only sets a flag and the ring is dumped with the next recorded
+ * message. Fatal signals dump right away with a minimal formatter that
+ * uses only async-signal-safe calls. Signals sent while a record is
+ * stored are deferred till it is complete, like a blocked signal, so
+ * a handler never sees a half updated ring. That costs no system call
+ * per record, unlike sigprocmask().
+ */
+
+#include "lib/misc/lib.h"
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LOG_RING_MAX_RECORD	2048	/* Longer records are truncated */
+#define LOG_RING_MAX_STR	256	/* Longer string arguments are truncated */
+#define LOG_RING_MIN_SIZE	(2 * LOG_RING_MAX_RECORD)	/* Smaller rings are enlarged */
+#define LOG_RING_ALIGN(x)	(((x) + 7) & ~(size_t)7)
+
+struct log_ring_rec {
+	uint32_t size;		/* Whole record, 0 marks wrap to ring start */
+	uint32_t line;
+	int32_t level;
+	uint32_t args;		/* Number of recorded conversions */
+	uint64_t usec;		/* CLOCK_MONOTONIC */
+	const char *file;
+	const char *format;
+	/* Followed by recorded arguments in 8 byte aligned slots */
+};
+
+/* Argument classes of printf conversions */
+enum {
+	_ARG_NONE,
+	_ARG_INT,
+	_ARG_LONG,
+	_ARG_LLONG,
+	_ARG_SIZE,
+	_ARG_INTMAX,
+	_ARG_PTRDIFF,
+	_ARG_DOUBLE,
+	_ARG_LDOUBLE,
+	_ARG_STR,
+	_ARG_PTR,
+	_ARG_UNSUPPORTED
+};
+
+static char *_ring;
+static size_t _ring_size;
+static size_t _head;		/* Offset for next record */
+static size_t _tail;		/* Offset of oldest record */
+static unsigned _count;		/* Number of records in ring */
+static char _dump_file[PATH_MAX];
+static const int _dump_signals[] = { SIGSEGV, SIGBUS, SIGABRT, SIGFPE, SIGILL, SIGUSR2 };
+static volatile sig_atomic_t _dump_requested;
+static volatile sig_atomic_t _storing;		/* Ring is being updated */
+static volatile sig_atomic_t _deferred_signal;	/* Arrived while storing */
+
+int log_ring_active = 0;
+
+static void _handle_signal(int sig);
+
+#define PRECISION_NONE	-1
+#define PRECISION_STAR	-2
+
+/*
+ * Parse printf conversion starting at '%'.
+ * Returns pointer past the conversion, its argument class, the number
+ * of '*' width and precision arguments preceding the converted value
+ * and the precision (PRECISION_STAR when passed as argument).
+ */
+static const char *_parse_conversion(const char *p, int *type, int *stars,
+				     int *precision)
+{
+	int length = 0;	/* 'h' < 0, 'l' 1, 'll' 2 ... */
+
+	*stars = 0;
+	*type = _ARG_UNSUPPORTED;
+	*precision = PRECISION_NONE;
+
+	if (*++p == '%') {
+		*type = _ARG_NONE;
+		return p + 1;
+	}
+
+	while (*p && strchr("-+ #0'I", *p))
+		p++;
+
+	if (*p == '*') {
+		(*stars)++;
+		p++;
+	} else
+		while (isdigit(*p))
+			p++;
+
+	if (*p == '.') {
+		if (*++p == '*') {
+			(*stars)++;
+			*precision = PRECISION_STAR;
+			p++;
+		} else
+			for (*precision = 0; isdigit(*p); p++)
+				if (*precision < LOG_RING_MAX_STR)
+					*precision = *precision * 10 + (*p - '0');
+	}
+
+	for (;; p++) {
+		switch (*p) {
+		case 'h': length = -1; continue;
+		case 'l': length++; continue;
+		case 'q':
+		case 'L': length = 2; continue;
+		case 'j': length = 'j'; continue;
+		case 'z':
+		case 'Z': length = 'z'; continue;
+		case 't': length = 't'; continue;
+		}
+		break;
+	}
+
+	switch (*p) {
+	case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+		*type = (length == 1) ? _ARG_LONG :
+			(length == 2) ? _ARG_LLONG :
+			(length == 'j') ? _ARG_INTMAX :
+			(length == 'z') ? _ARG_SIZE :
+			(length == 't') ? _ARG_PTRDIFF : _ARG_INT;
+		if ((*p == 'c') && (length > 0))
+			*type = _ARG_UNSUPPORTED; /* wide char */
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		*type = (length == 2) ? _ARG_LDOUBLE : _ARG_DOUBLE;
+		break;
+	case 's':
+		if (length <= 0)
+			*type = _ARG_STR;
+		break;
+	case 'p':
+		*type = _ARG_PTR;
+		break;
+	default:
+		return p; /* %n, %m and unknown stop recording */
+	}
+
+	return p + 1;
+}
+
+static int _drop_oldest(void)
+{
+	uint32_t size;
+
+	if (!_count)
+		return 0;
+
+	if ((_tail + sizeof(uint32_t) > _ring_size) ||
+	    !(size = *(uint32_t *)(_ring + _tail))) {
+		_tail = 0;
+		size = *(uint32_t *)_ring;
+	}
+
+	_tail += size;
+	_count--;
+
+	return 1;
+}
+
+static void _store(const char *rec, size_t size)
+{
+	int sig;
+
+	/* Never with LOG_RING_MIN_SIZE, but must not overrun the ring */
+	if (size > _ring_size)
+		return;
+
+	_storing = 1;
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+	if (_head + size > _ring_size) {
+		/* Records behind head till the end of ring are the oldest */
+		while ((_tail >= _head) && _drop_oldest())
+			;
+		if (_head + sizeof(uint32_t) <= _ring_size)
+			*(uint32_t *)(_ring + _head) = 0;
+		_head = 0;
+	}
+
+	while ((_tail >= _head) && (_tail < _head + size) && _drop_oldest())
+		;
+
+	if (!_count)
+		_tail = _head;
+
+	memcpy(_ring + _head, rec, size);
+	_head += size;
+	_count++;
+
+	__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	_storing = 0;
+
+	if ((sig = _deferred_signal)) {
+		_deferred_signal = 0;
+		_handle_signal(sig);
+	}
+}
+
+/* Dump requested by SIGUSR2, now outside of the signal handler */
+static void _dump_if_requested(void)
+{
+	if (!_dump_requested)
+		return;
+
+	_dump_requested = 0;
+	(void) log_ring_dump_to_file("dump requested");
+}
+
+void log_ring_record(int level, const char *file, int line,
+		     const char *format, va_list orig_ap)
+{
+	uint64_t rec_buf[LOG_RING_MAX_RECORD / sizeof(uint64_t)];
+	struct log_ring_rec *rec = (struct log_ring_rec *) rec_buf;
+	char *pos = (char *)(rec + 1), *end = (char *) rec_buf + sizeof(rec_buf);
+	struct timespec ts;
+	const char *p = format, *str;
+	uint32_t len;
+	va_list ap;
+	int type, stars, precision;
+	int64_t star = 0;
+
+	if (!_ring_size)
+		return;
+
+	_dump_if_requested();
+
+	rec->line = (uint32_t) line;
+	rec->level = level;
+	rec->args = 0;
+	rec->file = file;
+	rec->format = format;
+	rec->usec = clock_gettime(CLOCK_MONOTONIC, &ts) ? 0 :
+		(uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	va_copy(ap, orig_ap);
+	while ((p = strchr(p, '%'))) {
+		p = _parse_conversion(p, &type, &stars, &precision);
+
+		if (type == _ARG_UNSUPPORTED)
+			break;
+
+		/* Every argument needs a slot, string needs one more for its data */
+		if (pos + (stars + 1 + (type == _ARG_STR)) * sizeof(uint64_t) > end)
+			break;
+
+		for (; stars; stars--, pos += sizeof(uint64_t))
+			*(int64_t *) pos = star = va_arg(ap, int);
+
+		/* Precision argument is the last one before the value */
+		if (precision == PRECISION_STAR)
+			precision = (star < 0) ? PRECISION_NONE : (int) star;
+
+		switch (type) {
+		case _ARG_NONE:
+			break;
+		case _ARG_INT:
+			*(int64_t *) pos = va_arg(ap, int);
+			break;
+		case _ARG_LONG:
+			*(int64_t *) pos = va_arg(ap, long);
+			break;
+		case _ARG_LLONG:
+			*(int64_t *) pos = va_arg(ap, long long);
+			break;
+		case _ARG_SIZE:
+			*(uint64_t *) pos = va_arg(ap, size_t);
+			break;
+		case _ARG_INTMAX:
+			*(int64_t *) pos = va_arg(ap, intmax_t);
+			break;
+		case _ARG_PTRDIFF:
+			*(int64_t *) pos = va_arg(ap, ptrdiff_t);
+			break;
+		case _ARG_DOUBLE:
+			*(double *) pos = va_arg(ap, double);
+			break;
+		case _ARG_LDOUBLE:
+			*(double *) pos = (double) va_arg(ap, long double);
+			break;
+		case _ARG_PTR:
+			*(const void **) pos = va_arg(ap, const void *);
+			break;
+		case _ARG_STR:
+			if (!(str = va_arg(ap, const char *)))
+				str = "(null)";
+			/* String need not be terminated within its precision */
+			len = (uint32_t) strnlen(str, ((precision >= 0) && (precision < LOG_RING_MAX_STR)) ?
+						 (size_t) precision : LOG_RING_MAX_STR);
+			if (pos + sizeof(uint64_t) + LOG_RING_ALIGN(len + 1) > end)
+				len = (uint32_t)(end - pos - sizeof(uint64_t) - 1);
+			*(uint64_t *) pos = len;
+			memcpy(pos + sizeof(uint64_t), str, len);
+			pos[sizeof(uint64_t) + len] = 0;
+			pos += LOG_RING_ALIGN(len + 1);
+			break;
+		}
+
+		if (type != _ARG_NONE)
+			pos += sizeof(uint64_t);
+		rec->args++;
+	}
+	va_end(ap);
+
+	rec->size = (uint32_t)(pos - (char *) rec);
+
+	_store((const char *) rec, rec->size);
+}
+
+/*
+ * Record message without other consumer by its format only,
+ * the log macros skip evaluation of its arguments.
+ */
+void log_ring_record_format(int level, const char *file, int line, const char *format)
+{
+	struct log_ring_rec rec = {
+		.size = sizeof(rec),
+		.line = (uint32_t) line,
+		.level = level,
+		.file = file,
+		.format = format,
+	};
+	struct timespec ts;
+
+	if (!_ring_size)
+		return;
+
+	_dump_if_requested();
+
+	if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+		rec.usec = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+
+	_store((const char *) &rec, rec.size);
+}
+
+/*
+ * Format recorded message into buf with snprintf.
+ * Not async-signal-safe, signal handlers use _format_record_safe().
+ */
+static void _format_record(const struct log_ring_rec *rec, char *buf, size_t size)
+{
+	const char *pos = (const char *)(rec + 1);
+	const char *p = rec->format, *conv;
+	char spec[64];
+	size_t used = 0, len;
+	int64_t star[2];
+	uint32_t args;
+	int type, stars, precision, i, n = 0;
+
+	for (args = 0; *p && (used < size - 1); ) {
+		if ((*p != '%') || (args >= rec->args)) {
+			buf[used++] = *p++;
+			continue;
+		}
+
+		conv = p;
+		p = _parse_conversion(p, &type, &stars, &precision);
+		args++;
+
+		if (type == _ARG_NONE) {
+			buf[used++] = '%';
+			continue;
+		}
+
+		for (i = 0; i < stars; i++, pos += sizeof(uint64_t))
+			star[i] = *(const int64_t *) pos;
+
+		/* Copy conversion spec dropping 'L' since long double is stored as double */
+		for (len = 0; (conv < p) && (len < sizeof(spec) - 1); conv++)
+			if ((type != _ARG_LDOUBLE) || (*conv != 'L'))
+				spec[len++] = *conv;
+		spec[len] = 0;
+
+#define FMT_ARG(value) \
+		n = (stars == 2) ? snprintf(buf + used, size - used, spec, (int) star[0], (int) star[1], value) : \
+		    (stars == 1) ? snprintf(buf + used, size - used, spec, (int) star[0], value) : \
+		    snprintf(buf + used, size - used, spec, value)
+
+		switch (type) {
+		case _ARG_INT:
+			FMT_ARG((int) *(const int64_t *) pos);
+			break;
+		case _ARG_LONG:
+			FMT_ARG((long) *(const int64_t *) pos);
+			break;
+		case _ARG_LLONG:
+			FMT_ARG((long long) *(const int64_t *) pos);
+			break;
+		case _ARG_SIZE:
+			FMT_ARG((size_t) *(const uint64_t *) pos);
+			break;
+		case _ARG_INTMAX:
+			FMT_ARG((intmax_t) *(const int64_t *) pos);
+			break;
+		case _ARG_PTRDIFF:
+			FMT_ARG((ptrdiff_t) *(const int64_t *) pos);
+			break;
+		case _ARG_DOUBLE:
+		case _ARG_LDOUBLE:
+			FMT_ARG(*(const double *) pos);
+			break;
+		case _ARG_PTR:
+			FMT_ARG(*(const void * const *) pos);
+			break;
+		case _ARG_STR:
+			FMT_ARG(pos + sizeof(uint64_t));
+			pos += LOG_RING_ALIGN(*(const uint64_t *) pos + 1);
+			break;
+		}
+#undef FMT_ARG
+
+		pos += sizeof(uint64_t);
+
+		if (n < 0)
+			break;
+		used += ((size_t) n < size - used) ? (size_t) n : size - used - 1;
+	}
+
+	buf[used] = 0;
+}
+
+/*
+ * Write all recorded messages, oldest first, to file descriptor.
+ */
+int log_ring_dump(int fd)
+{
+	char message[4096], line[4096 + PATH_MAX + 64];
+	const struct log_ring_rec *rec;
+	size_t pos = _tail;
+	unsigned i;
+	int len;
+
+	for (i = 0; i < _count; i++) {
+		if ((pos + sizeof(uint32_t) > _ring_size) ||
+		    !*(uint32_t *)(_ring + pos))
+			pos = 0;
+
+		rec = (const struct log_ring_rec *)(_ring + pos);
+		pos += rec->size;
+
+		_format_record(rec, message, sizeof(message));
+
+		if ((len = snprintf(line, sizeof(line), "%5u.%06u %d %s:%u  %s\n",
+				    (unsigned)(rec->usec / 1000000), (unsigned)(rec->usec % 1000000),
+				    rec->level, rec->file, rec->line, message)) < 0)
+			continue;
+
+		if (len >= (int) sizeof(line))
+			len = sizeof(line) - 1;
+
+		if (write(fd, line, len) != len)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Append ring content to the configured dump file.
+ */
+int log_ring_dump_to_file(const char *reason)
+{
+	char header[256];
+	int fd, len, r;
+
+	if (!_count || !_dump_file[0])
+		return 1;
+
+	if ((fd = open(_dump_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600)) < 0)
+		return 0;
+
+	len = snprintf(header, sizeof(header), "--- lvm flight recorder pid %d: %s ---\n",
+		       (int) getpid(), reason);
+
+	if (len >= (int) sizeof(header)) {
+		len = sizeof(header) - 1;
+		header[len - 1] = '\n';
+	}
+
+	r = ((len > 0) && (write(fd, header, len) == len)) ? log_ring_dump(fd) : 0;
+
+	if (close(fd))
+		r = 0;
+
+	return r;
+}
+
+/*
+ * Async-signal-safe formatting for dumps from fatal signal handlers.
+ * Integers, characters, strings and pointers are converted ignoring
+ * flags and width, other conversions are copied unconverted.
+ */
+static void _put_str(char *buf, size_t size, size_t *used, const char *str, size_t len)
+{
+	while (len-- && *str && (*used < size - 1))
+		buf[(*used)++] = *str++;
+}
+
+static void _put_uint(char *buf, size_t size, size_t *used, uint64_t value, unsigned base)
+{
+	static const char _digits[] = "0123456789abcdef";
+	char tmp[24];
+	size_t len = 0;
+
+	do {
+		tmp[sizeof(tmp) - ++len] = _digits[value % base];
+		value /= base;
+	} while (value);
+
+	_put_str(buf, size, used, tmp + sizeof(tmp) - len, len);
+}
+
+static void _format_record_safe(const struct log_ring_rec *rec, char *buf, size_t size)
+{
+	const char *pos = (const char *)(rec + 1);
+	const char *p = rec->format, *conv;
+	size_t used = 0;
+	uint32_t args;
+	uint64_t value;
+	int type, stars, precision;
+	char c;
+
+	for (args = 0; *p && (used < size - 1); ) {
+		if ((*p != '%') || (args >= rec->args)) {
+			buf[used++] = *p++;
+			continue;
+		}
+
+		conv = p;
+		p = _parse_conversion(p, &type, &stars, &precision);
+		args++;
+
+		if (type == _ARG_NONE) {
+			buf[used++] = '%';
+			continue;
+		}
+
+		pos += stars * sizeof(uint64_t);
+		c = p[-1];
+		value = *(const uint64_t *) pos;
+
+		switch (type) {
+		case _ARG_STR:
+			_put_str(buf, size, &used, pos + sizeof(uint64_t), value);
+			pos += LOG_RING_ALIGN(value + 1);
+			break;
+		case _ARG_PTR:
+			_put_str(buf, size, &used, "0x", 2);
+			_put_uint(buf, size, &used, value, 16);
+			break;
+		case _ARG_DOUBLE:
+		case _ARG_LDOUBLE:
+			_put_str(buf, size, &used, conv, (size_t)(p - conv));
+			break;
+		default:
+			if (c == 'c') {
+				buf[used++] = (char) value;
+				break;
+			}
+			if ((c == 'd') || (c == 'i')) {
+				if ((int64_t) value < 0) {
+					buf[used++] = '-';
+					value = -value;
+				}
+			} else if (type == _ARG_INT)
+				value &= UINT32_MAX; /* unsigned int was sign extended */
+			_put_uint(buf, size, &used, value,
+				  ((c == 'x') || (c == 'X')) ? 16 : (c == 'o') ? 8 : 10);
+		}
+
+		pos += sizeof(uint64_t);
+	}
+
+	buf[used] = 0;
+}
+
+/*
+ * Append ring content to the dump file from a fatal signal handler.
+ * Dump signals are blocked while records are stored, so the ring is
+ * consistent here.
+ */
+static void _dump_from_signal_handler(int sig)
+{
+	char message[1024], line[1024 + PATH_MAX + 64];
+	const struct log_ring_rec *rec;
+	size_t pos = _tail, used;
+	unsigned i;
+	int fd;
+
+	if ((fd = open(_dump_file, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600)) < 0)
+		return;
+
+	used = 0;
+	_put_str(line, sizeof(line), &used, "--- lvm flight recorder pid ", SIZE_MAX);
+	_put_uint(line, sizeof(line), &used, (uint64_t) getpid(), 10);
+	_put_str(line, sizeof(line), &used, ": fatal signal ", SIZE_MAX);
+	_put_uint(line, sizeof(line), &used, (uint64_t) sig, 10);
+	_put_str(line, sizeof(line), &used, " ---\n", SIZE_MAX);
+
+	if (write(fd, line, used) != (ssize_t) used)
+		goto out;
+
+	for (i = 0; i < _count; i++) {
+		if ((pos + sizeof(uint32_t) > _ring_size) ||
+		    !*(uint32_t *)(_ring + pos))
+			pos = 0;
+
+		rec = (const struct log_ring_rec *)(_ring + pos);
+		pos += rec->size;
+
+		_format_record_safe(rec, message, sizeof(message));
+
+		used = 0;
+		_put_uint(line, sizeof(line), &used, rec->usec / 1000000, 10);
+		_put_str(line, sizeof(line), &used, ".", 1);
+		_put_uint(line, sizeof(line), &used, rec->usec % 1000000, 10);
+		_put_str(line, sizeof(line), &used, " ", 1);
+		if (rec->level < 0)
+			_put_str(line, sizeof(line), &used, "-", 1);
+		_put_uint(line, sizeof(line), &used, (uint64_t) (rec->level < 0 ? -rec->level : rec->level), 10);
+		_put_str(line, sizeof(line), &used, " ", 1);
+		_put_str(line, sizeof(line), &used, rec->file, SIZE_MAX);
+		_put_str(line, sizeof(line), &used, ":", 1);
+		_put_uint(line, sizeof(line), &used, rec->line, 10);
+		_put_str(line, sizeof(line), &used, "  ", 2);
+		_put_str(line, sizeof(line), &used, message, SIZE_MAX);
+		_put_str(line, sizeof(line), &used, "\n", 1);
+
+		if (write(fd, line, used) != (ssize_t) used)
+			break;
+	}
+out:
+	(void) close(fd);
+}
+
+static void _handle_signal(int sig)
+{
+	if (sig == SIGUSR2) {
+		/* Dumped with the next recorded message */
+		_dump_requested = 1;
+		return;
+	}
+
+	if (_count && _dump_file[0])
+		_dump_from_signal_handler(sig);
+
+	/* Continue with default action */
+	(void) signal(sig, SIG_DFL);
+	(void) raise(sig);
+}
+
+static void _dump_signal_handler(int sig, siginfo_t *info, void *context)
+{
+	if (_storing) {
+		/* Signal sent by a process waits like a blocked signal */
+		if (info->si_code <= 0) {
+			_deferred_signal = sig;
+			return;
+		}
+
+		/* Fault while storing, half updated ring cannot be dumped */
+		(void) signal(sig, SIG_DFL);
+		(void) raise(sig);
+		return;
+	}
+
+	_handle_signal(sig);
+}
+
+/*
+ * Dump on fatal signals and on SIGUSR2.
+ * Without configured dump file signals keep their default action.
+ */
+void log_ring_catch_signals(void)
+{
+	struct sigaction act = { .sa_sigaction = _dump_signal_handler, .sa_flags = SA_RESTART | SA_SIGINFO };
+	unsigned i;
+
+	if (!_ring_size || !_dump_file[0])
+		return;
+
+	for (i = 0; i < DM_ARRAY_SIZE(_dump_signals); i++)
+		if (sigaction(_dump_signals[i], &act, NULL))
+			log_sys_debug("sigaction", "flight recorder");
+}
+
+/*
+ * Set ring size (0 disables recording) and file for dumps.
+ * Sizes below LOG_RING_MIN_SIZE are rounded up so the longest record fits.
+ * Ring content is kept when the size does not change.
+ */
+void init_log_ring(size_t size, const char *dump_file)
+{
+	char *ring;
+
+	if (!dump_file || (dm_strncpy(_dump_file, dump_file, sizeof(_dump_file)) < 0))
+		_dump_file[0] = 0;
+
+	if (size && (size < LOG_RING_MIN_SIZE))
+		size = LOG_RING_MIN_SIZE;
+
+	if (size == _ring_size)
+		return;
+
+	if (size && !(ring = malloc(size)))
+		size = 0;
+
+	free(_ring);
+	_ring = size ? ring : NULL;
+	_ring_size = size;
+	_head = _tail = 0;
+	_count = 0;
+	log_ring_active = size ? 1 : 0;
+
+	update_log_debug_gate();
+}
+
+int log_ring_enabled(void)
+{
+	return _ring_size ? 1 : 0;
+}
+
+void fin_log_ring(void)
+{
+	init_log_ring(0, NULL);
+}
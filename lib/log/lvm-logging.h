@@ -26,14 +26,34 @@ __attribute__ ((format(printf, 5, 6)))
 void print_log_libdm(int level, const char *file, int line, int dm_errno_or_class,
 		     const char *format, ...);
 
+void log_ring_record_format(int level, const char *file, int line, const char *format);
+
+/*
+ * Debug classes with some consumer of debug messages (LOG_CLASS_ANY is set
+ * when there is any consumer). Debug messages nobody would see are skipped
+ * before their arguments are evaluated, the flight recorder, when active,
+ * gets only their format.
+ */
+extern int log_debug_classes_wanted;
+extern int log_ring_active;
+
+#define LOG_WANTED(l, c) \
+    ((log_level(l) < _LOG_DEBUG) || \
+     __builtin_expect(!!(log_debug_classes_wanted & ((c) ? : LOG_CLASS_ANY)), 0))
+
+#define LOG_FORMAT(f, x...) (f)
+
+#define LOG_RING_FORMAT(l, x...) \
+    (log_ring_active ? log_ring_record_format(log_level(l), __FILE__, __LINE__, LOG_FORMAT(x)) : (void) 0)
+
 #define LOG_LINE(l, x...) \
-    print_log(l, __FILE__, __LINE__ , 0, ## x)
+    (LOG_WANTED(l, 0) ? print_log(l, __FILE__, __LINE__ , 0, ## x) : LOG_RING_FORMAT(l, x))
 
 #define LOG_LINE_WITH_ERRNO(l, e, x...) \
-    print_log(l, __FILE__, __LINE__ , e, ## x)
+    (LOG_WANTED(l, 0) ? print_log(l, __FILE__, __LINE__ , e, ## x) : LOG_RING_FORMAT(l, x))
 
 #define LOG_LINE_WITH_CLASS(l, c, x...) \
-    print_log(l, __FILE__, __LINE__ , c, ## x)
+    (LOG_WANTED(l, c) ? print_log(l, __FILE__, __LINE__ , c, ## x) : LOG_RING_FORMAT(l, x))
 
 #include "lib/log/log.h"
 
@@ -44,6 +64,7 @@ typedef void (*lvm2_log_fn_t) (int level, const char *file, int line,
 			       int dm_errno_or_class, const char *message);
 
 void init_log_fn(lvm2_log_fn_t log_fn);
+void update_log_debug_gate(void);
 
 void init_indent(int indent);
 void init_msg_prefix(const char *prefix);
@@ -63,6 +84,15 @@ void init_syslog(int enable, int facility);
 void fin_syslog(void);
 
 void init_log_journal(uint32_t fields);
+
+void init_log_ring(size_t size, const char *dump_file);
+void fin_log_ring(void);
+int log_ring_enabled(void);
+void log_ring_record(int level, const char *file, int line,
+		     const char *format, va_list ap);
+int log_ring_dump(int fd);
+int log_ring_dump_to_file(const char *reason);
+void log_ring_catch_signals(void);
 uint32_t log_journal_str_to_val(const char *str);
 
 void log_command(const char *cmd_line, const char *cmd_name, const char *cmd_id);
@@ -3809,6 +3809,10 @@ struct alloc_handle *allocate_extents(struct volume_group *vg,
 	if (alloc >= ALLOC_INHERIT)
 		alloc = vg->alloc;
 
+	/* Released extents may get reused, discard them now */
+	if (!vg_issue_discards(vg, 1))
+		return_NULL;
+
 	if (!(ah = _alloc_init(vg->cmd, segtype, alloc, approx_alloc,
 			       lv ? lv->le_count : 0, extents, mirrors, stripes, log_count,
 			       vg->extent_size, region_size,
@@ -194,6 +194,7 @@
 #define PROCESS_SKIP_SCAN	0x00200000U /* skip lvmcache_label_scan in process_each_pv */
 #define READ_FOR_ACTIVATE	0x00400000U /* command tells vg_read it plans to activate the vg */
 #define READ_WITHOUT_LOCK	0x00800000U /* caller responsible for vg lock */
+#define PROCESS_IMPORT_NAMED_LVS 0x01000000U /* process_each_lv imports only named LVs for activation */
 
 /* vg_read returns these in error_flags */
 #define FAILED_NOT_ENABLED	0x00000001U
@@ -721,6 +722,7 @@ void pvcreate_params_set_defaults(struct pvcreate_params *pp);
 int vg_write(struct volume_group *vg);
 int vg_commit(struct volume_group *vg);
 void vg_revert(struct volume_group *vg);
+int vg_import_deferred_copy(struct volume_group *vg);
 
 /*
  * Add/remove LV to/from volume group
@@ -767,6 +769,11 @@ int pv_resize_single(struct cmd_context *cmd,
 			     const uint64_t new_size,
 			     int yes);
 
+int pv_grow_metadata_area(struct cmd_context *cmd,
+			  struct volume_group *vg,
+			  struct physical_volume *pv,
+			  uint64_t mda_size);
+
 int pv_analyze(struct cmd_context *cmd, struct device *dev,
 	       uint64_t label_sector);
 
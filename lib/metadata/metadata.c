@@ -991,6 +991,7 @@ static void _vg_wipe_cached_precommitted(struct volume_group *vg)
 {
 	release_vg(vg->vg_precommitted);
 	vg->vg_precommitted = NULL;
+	vg->precommitted_deferred = 0;
 }
 
 static void _vg_move_cached_precommitted_to_committed(struct volume_group *vg)
@@ -998,9 +999,23 @@ static void _vg_move_cached_precommitted_to_committed(struct volume_group *vg)
 	release_vg(vg->vg_committed);
 	vg->vg_committed = vg->vg_precommitted;
 	vg->vg_precommitted = NULL;
+	vg->committed_deferred = vg->precommitted_deferred;
+	vg->precommitted_deferred = 0;
 	vg->needs_backup = 1;
 }
 
+/*
+ * Import the precommitted or committed copy of the VG whose import
+ * was deferred by vg_write (metadata/defer_precommitted_import).
+ */
+int vg_import_deferred_copy(struct volume_group *vg)
+{
+	if (!vg->precommitted_deferred && !vg->committed_deferred)
+		return 1;
+
+	return text_vg_import_deferred(vg);
+}
+
 int lv_has_unknown_segments(const struct logical_volume *lv)
 {
 	struct lv_segment *seg;
@@ -2926,6 +2941,11 @@ int vg_write(struct volume_group *vg)
 
 	log_debug("Writing metadata for VG %s.", vg->name);
 
+	if (vg->partial_import) {
+		log_error(INTERNAL_ERROR "Attempt to write partially imported VG %s.", vg->name);
+		return 0;
+	}
+
 	if (vg_is_shared(vg)) {
 		dm_list_iterate_items(lvl, &vg->lvs) {
 			if (lvl->lv->lock_args && !strcmp(lvl->lv->lock_args, "pending")) {
@@ -2981,8 +3001,14 @@ int vg_write(struct volume_group *vg)
 	if (vg->cmd->wipe_outdated_pvs)
 		_wipe_outdated_pvs(vg->cmd, vg);
 
-	if (!vg_is_archived(vg) && vg->vg_committed && !archive(vg->vg_committed))
-		return_0;
+	if (!vg_is_archived(vg)) {
+		/* Archive the copy committed by a previous vg_write */
+		if (!vg_import_deferred_copy(vg))
+			return_0;
+
+		if (vg->vg_committed && !archive(vg->vg_committed))
+			return_0;
+	}
 
 	if (critical_section())
 		log_error(INTERNAL_ERROR
@@ -3153,6 +3179,8 @@ int vg_commit(struct volume_group *vg)
 		/* This *is* the original now that it's commited. */
 		_vg_move_cached_precommitted_to_committed(vg);
 
+		dm_list_splice(&vg->committed_discards, &vg->pending_discards);
+
 		if (vg->needs_write_and_commit){
 			/* Print buffered messages that have been finished with this commit. */
 			dm_list_iterate_items(sl, &vg->msg_list)
@@ -3181,6 +3209,9 @@ void vg_revert(struct volume_group *vg)
 
 	_vg_wipe_cached_precommitted(vg); /* VG is no longer needed */
 
+	/* Released extents are still in use */
+	dm_list_init(&vg->pending_discards);
+
 	dm_list_iterate_items(mda, &vg->fid->metadata_areas_in_use) {
 		if (mda->ops->vg_revert &&
 		    !mda->ops->vg_revert(vg->fid, vg, mda)) {
@@ -4327,6 +4358,10 @@ const struct logical_volume *lv_committed(const struct logical_volume *lv)
 	if (!lv)
 		return NULL;
 
+	if (lv->vg->committed_deferred &&
+	    !vg_import_deferred_copy(lv->vg))
+		log_error("Failed to import committed metadata for VG %s.", lv->vg->name);
+
 	if (!lv->vg->vg_committed)
 		return lv;
 
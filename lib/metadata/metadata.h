@@ -134,6 +134,13 @@ struct metadata_area_ops {
 	 */
 	uint64_t (*mda_total_sectors) (struct metadata_area *mda);
 
+	/*
+	 * Grow metadata area to the given number of sectors.
+	 * The new size is used by the next vg_write and written
+	 * to disk together with the new metadata by vg_commit.
+	 */
+	int (*mda_grow) (struct metadata_area *mda, uint64_t sectors);
+
 	/*
 	 * Check if metadata area belongs to vg
 	 */
@@ -232,11 +232,11 @@ int discard_pv_segment(struct pv_segment *peg, uint32_t discard_area_reduction)
 		discard_area_reduction--;
 	}
 
-	log_debug_alloc("Discarding %" PRIu32 " extents offset %" PRIu64 " sectors on %s.",
+	log_debug_alloc("Queueing discard of %" PRIu32 " extents offset %" PRIu64 " sectors on %s.",
 			discard_area_reduction, discard_offset_sectors, dev_name(peg->pv->dev));
 	if (discard_area_reduction &&
-	    !dev_discard_blocks(peg->pv->dev, discard_offset_sectors << SECTOR_SHIFT,
-				discard_area_reduction * (uint64_t) peg->pv->vg->extent_size * SECTOR_SIZE))
+	    !vg_queue_discard(peg->pv->vg, peg->pv->dev, discard_offset_sectors << SECTOR_SHIFT,
+			      discard_area_reduction * (uint64_t) peg->pv->vg->extent_size * SECTOR_SIZE))
 		return_0;
 
 	return 1;
@@ -697,3 +697,117 @@ out:
 			  "to repair from archived metadata.");
 	return r;
 }
+
+/*
+ * Grow the metadata area at the start of the PV (mda0) to at least
+ * mda_size sectors.  The space up to pe_start is used first, then
+ * the first extents of the PV, which must be free, are taken by
+ * moving pe_start.  Allocated extents keep their location on disk,
+ * only their numbers on the PV change, so active LVs are unaffected.
+ *
+ * The new size, the new pe_start and the new metadata are committed
+ * together by vg_commit writing the mda header.  Metadata areas can
+ * only be at the start and at the end of a PV, so an area is grown
+ * in place rather than relocated; allocated extents in the way can
+ * be moved away with pvmove.
+ */
+int pv_grow_metadata_area(struct cmd_context *cmd,
+			  struct volume_group *vg,
+			  struct physical_volume *pv,
+			  uint64_t mda_size)
+{
+	const char *pv_name = pv_dev_name(pv);
+	struct metadata_area *mda;
+	struct pv_segment *peg, *pegt;
+	uint64_t mda_start, mda_end;
+	uint32_t extents = 0;
+
+	if (is_orphan_vg(pv->vg_name)) {
+		log_error("Physical volume %s is not in a volume group, use pvcreate --metadatasize.",
+			  pv_name);
+		return 0;
+	}
+
+	if (!(mda = fid_get_mda_indexed(vg->fid, (const char *) &pv->id, ID_LEN, 0)) ||
+	    !mda->ops->mda_grow || !mda->ops->mda_metadata_locn_offset) {
+		log_error("Physical volume %s has no metadata area at the start to grow.",
+			  pv_name);
+		return 0;
+	}
+
+	if (mda_is_ignored(mda)) {
+		log_error("Metadata area on physical volume %s is ignored.", pv_name);
+		return 0;
+	}
+
+	if (pv->ba_size) {
+		log_error("Physical volume %s has a bootloader area after the metadata area.",
+			  pv_name);
+		return 0;
+	}
+
+	mda_start = mda->ops->mda_metadata_locn_offset(mda->metadata_locn) >> SECTOR_SHIFT;
+
+	if (mda_size <= mda->ops->mda_total_sectors(mda)) {
+		log_error("Metadata area on physical volume %s is already %s.", pv_name,
+			  display_size(cmd, mda->ops->mda_total_sectors(mda)));
+		return 0;
+	}
+
+	mda_end = mda_start + mda_size;
+
+	if (mda_end > pv->pe_start) {
+		if (!pv->pe_size ||
+		    ((mda_end - pv->pe_start + pv->pe_size - 1) / pv->pe_size >= pv->pe_count)) {
+			log_error("Physical volume %s is too small for metadata area of %s.",
+				  pv_name, display_size(cmd, mda_size));
+			return 0;
+		}
+
+		extents = (uint32_t) ((mda_end - pv->pe_start + pv->pe_size - 1) / pv->pe_size);
+
+		dm_list_iterate_items(peg, &pv->segments)
+			if ((peg->pe < extents) && peg->lvseg) {
+				log_error("Physical volume %s: first %" PRIu32 " extents must be "
+					  "free to grow the metadata area, move them with pvmove.",
+					  pv_name, extents);
+				return 0;
+			}
+
+		if (!pv_split_segment(vg->vgmem, pv, extents, NULL))
+			return_0;
+
+		dm_list_iterate_items_safe(peg, pegt, &pv->segments) {
+			if (peg->pe < extents)
+				dm_list_del(&peg->list);
+			else
+				peg->pe -= extents;
+		}
+
+		pv->pe_start += (uint64_t) extents * pv->pe_size;
+		pv->pe_count -= extents;
+
+		vg->extent_count -= extents;
+		vg->free_count -= extents;
+	}
+
+	/* The metadata area takes all space up to the first extent. */
+	mda_size = pv->pe_start - mda_start;
+
+	log_verbose("Growing metadata area on %s to %s using %" PRIu32 " extents.",
+		    pv_name, display_size(cmd, mda_size), extents);
+
+	if (!mda->ops->mda_grow(mda, mda_size))
+		return_0;
+
+	if (!vg_write(vg) || !vg_commit(vg)) {
+		log_error("Failed to grow metadata area on physical volume \"%s\" in "
+			  "volume group \"%s\"", pv_name, vg->name);
+		return 0;
+	}
+
+	log_print_unless_silent("Metadata area on physical volume \"%s\" grown to %s.",
+				pv_name, display_size(cmd, mda_size));
+
+	return 1;
+}
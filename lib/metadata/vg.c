@@ -61,6 +61,8 @@ struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
 	dm_list_init(&vg->removed_historical_lvs);
 	dm_list_init(&vg->removed_pvs);
 	dm_list_init(&vg->msg_list);
+	dm_list_init(&vg->pending_discards);
+	dm_list_init(&vg->committed_discards);
 
 	log_debug_mem("Allocated VG %s at %p.", vg->name ? : "<no name>", (void *)vg);
 
@@ -90,6 +92,11 @@ void release_vg(struct volume_group *vg)
 	if (!vg || is_orphan_vg(vg->name))
 		return;
 
+	/* VG lock may be already gone, extents could be reused by now */
+	if (!dm_list_empty(&vg->committed_discards))
+		log_debug_alloc("Dropping %u discards for released VG %s.",
+				dm_list_size(&vg->committed_discards), vg->name);
+
 	release_vg(vg->vg_committed);
 	release_vg(vg->vg_precommitted);
 	_free_vg(vg);
@@ -762,5 +769,98 @@ void vg_backup_if_needed(struct volume_group *vg)
 		return;
 
 	vg->needs_backup = 0;
+
+	/*
+	 * The backup is written straight from the committed text, so
+	 * a copy of the VG deferred by vg_write needs no import for it.
+	 */
+	if (vg->committed_deferred && backup_can_reuse_committed_text(vg)) {
+		backup(vg);
+		return;
+	}
+
+	if (!vg_import_deferred_copy(vg)) {
+		log_error("Failed to import committed metadata for backup of VG %s.", vg->name);
+		return;
+	}
+
 	backup(vg->vg_committed);
 }
+
+struct vg_discard {
+	struct dm_list list;
+	struct device *dev;
+	uint64_t offset_bytes;
+	uint64_t size_bytes;
+};
+
+/*
+ * Remember discard of released extents. It is issued by
+ * vg_issue_discards() together with discards of other LVs.
+ */
+int vg_queue_discard(struct volume_group *vg, struct device *dev,
+		     uint64_t offset_bytes, uint64_t size_bytes)
+{
+	struct vg_discard *vd;
+
+	if (!(vd = dm_pool_alloc(vg->vgmem, sizeof(*vd)))) {
+		log_error("Failed to queue discard for %s.", dev_name(dev));
+		return 0;
+	}
+
+	vd->dev = dev;
+	vd->offset_bytes = offset_bytes;
+	vd->size_bytes = size_bytes;
+	dm_list_add(&vg->pending_discards, &vd->list);
+
+	return 1;
+}
+
+/*
+ * Issue queued discards of committed metadata changes, merged per device
+ * and running on all devices concurrently. With 'uncommitted' discards of
+ * not yet committed changes are issued as well (before reusing extents),
+ * otherwise they are dropped (metadata change was abandoned).
+ */
+int vg_issue_discards(struct volume_group *vg, int uncommitted)
+{
+	struct dev_discard_range *ranges;
+	struct vg_discard *vd;
+	unsigned count = 0;
+	int r;
+
+	if (!vg)
+		return 1;
+
+	if (uncommitted)
+		dm_list_splice(&vg->committed_discards, &vg->pending_discards);
+	else if (!dm_list_empty(&vg->pending_discards)) {
+		log_debug_alloc("Dropping %u discards of uncommitted changes in VG %s.",
+				dm_list_size(&vg->pending_discards), vg->name);
+		dm_list_init(&vg->pending_discards);
+	}
+
+	if (dm_list_empty(&vg->committed_discards))
+		return 1;
+
+	if (!(ranges = malloc(dm_list_size(&vg->committed_discards) * sizeof(*ranges)))) {
+		log_error("Failed to allocate discard ranges for VG %s.", vg->name);
+		return 0;
+	}
+
+	dm_list_iterate_items(vd, &vg->committed_discards) {
+		ranges[count].dev = vd->dev;
+		ranges[count].offset_bytes = vd->offset_bytes;
+		ranges[count].size_bytes = vd->size_bytes;
+		count++;
+	}
+
+	dm_list_init(&vg->committed_discards);
+
+	log_debug_alloc("Issuing %u queued discards in VG %s.", count, vg->name);
+
+	r = dev_discard_ranges(ranges, count);
+	free(ranges);
+
+	return r;
+}
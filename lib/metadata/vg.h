@@ -44,6 +44,9 @@ struct volume_group {
 	unsigned skip_validate_lock_args : 1;
 	unsigned needs_backup : 1;
 	unsigned needs_write_and_commit : 1;
+	unsigned precommitted_deferred : 1; /* vg_precommitted not imported from written text yet */
+	unsigned committed_deferred : 1; /* vg_committed not imported from written text yet */
+	unsigned partial_import : 1; /* only LVs selected for activation imported, never written */
 	uint32_t write_count; /* count the number of vg_write calls */
 	uint32_t buffer_size_hint; /* hint with buffer size of parsed VG */
 
@@ -132,6 +135,13 @@ struct volume_group {
 	struct logical_volume *pool_metadata_spare_lv; /* one per VG */
 	struct logical_volume *sanlock_lv; /* one per VG */
 	struct dm_list msg_list;
+
+	/*
+	 * Discards of released PV extents, issued together
+	 * before new extents get allocated or the VG is unlocked.
+	 */
+	struct dm_list pending_discards;	/* not committed yet */
+	struct dm_list committed_discards;
 };
 
 struct volume_group *alloc_vg(const char *pool_name, struct cmd_context *cmd,
@@ -173,6 +183,11 @@ int vg_set_mda_copies(struct volume_group *vg, uint32_t mda_copies);
 char *vg_profile_dup(const struct volume_group *vg);
 void vg_backup_if_needed(struct volume_group *vg);
 
+struct device;
+int vg_queue_discard(struct volume_group *vg, struct device *dev,
+		     uint64_t offset_bytes, uint64_t size_bytes);
+int vg_issue_discards(struct volume_group *vg, int uncommitted);
+
 /*
  * Returns visible LV count - number of LVs from user perspective
  */
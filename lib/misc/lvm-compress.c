@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "lib/misc/lib.h"
+#include "lib/misc/lvm-compress.h"
+
+/*
+ * Sequence: token byte with literal length in the high and match
+ * length - LZ_MIN_MATCH in the low 4 bits, where 15 continues with
+ * bytes added to the length until a byte is not 255, then the literal
+ * bytes, then the 2 byte little endian offset back to the match and
+ * the continued match length.  The last sequence has literals only.
+ */
+#define LZ_MIN_MATCH	4
+#define LZ_MAX_OFFSET	65535
+#define LZ_HASH_BITS	14
+
+static const unsigned char _lz_magic[4] = { 0x89, 'L', 'Z', 0x01 };
+
+static uint32_t _read32(const char *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+
+	return v;
+}
+
+static uint32_t _hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+uint32_t lz_compress_bound(uint32_t size)
+{
+	return LZ_HEADER_SIZE + size + size / 255 + 16;
+}
+
+static char *_put_length(char *op, const char *oend, uint32_t len)
+{
+	for (; len >= 255; len -= 255) {
+		if (op >= oend)
+			return NULL;
+		*op++ = (char) 255;
+	}
+
+	if (op >= oend)
+		return NULL;
+	*op++ = (char) len;
+
+	return op;
+}
+
+static char *_put_sequence(char *op, const char *oend, const char *lit, uint32_t lit_len,
+			   uint32_t offset, uint32_t match_len)
+{
+	uint32_t ml = offset ? match_len - LZ_MIN_MATCH : 0;
+
+	if (op >= oend)
+		return NULL;
+	*op++ = (char) (((lit_len < 15 ? lit_len : 15) << 4) | (ml < 15 ? ml : 15));
+
+	if ((lit_len >= 15) && !(op = _put_length(op, oend, lit_len - 15)))
+		return NULL;
+
+	if ((uint32_t) (oend - op) < lit_len)
+		return NULL;
+	memcpy(op, lit, lit_len);
+	op += lit_len;
+
+	if (!offset)
+		return op;
+
+	if (oend - op < 2)
+		return NULL;
+	*op++ = (char) (offset & 0xff);
+	*op++ = (char) (offset >> 8);
+
+	if ((ml >= 15) && !(op = _put_length(op, oend, ml - 15)))
+		return NULL;
+
+	return op;
+}
+
+uint32_t lz_compress(const char *in, uint32_t size, char *out, uint32_t out_size)
+{
+	const char *oend = out + out_size;
+	char *op = out + LZ_HEADER_SIZE;
+	uint32_t ip = 0, anchor = 0, ref, len, h;
+	uint32_t *table;
+	uint32_t r = 0;
+
+	if (out_size < LZ_HEADER_SIZE)
+		return 0;
+
+	if (!(table = malloc(sizeof(*table) << LZ_HASH_BITS))) {
+		log_error("Failed to allocate compression table.");
+		return 0;
+	}
+	memset(table, 0xff, sizeof(*table) << LZ_HASH_BITS);
+
+	memcpy(out, _lz_magic, sizeof(_lz_magic));
+	out[4] = (char) (size & 0xff);
+	out[5] = (char) ((size >> 8) & 0xff);
+	out[6] = (char) ((size >> 16) & 0xff);
+	out[7] = (char) (size >> 24);
+
+	while ((size >= LZ_MIN_MATCH) && (ip <= size - LZ_MIN_MATCH)) {
+		h = _hash(_read32(in + ip));
+		ref = table[h];
+		table[h] = ip;
+
+		if ((ref == UINT32_MAX) || (ip - ref > LZ_MAX_OFFSET) ||
+		    (_read32(in + ref) != _read32(in + ip))) {
+			ip++;
+			continue;
+		}
+
+		for (len = LZ_MIN_MATCH; (ip + len < size) && (in[ref + len] == in[ip + len]); len++)
+			;
+
+		if (!(op = _put_sequence(op, oend, in + anchor, ip - anchor, ip - ref, len)))
+			goto out;
+
+		ip += len;
+		anchor = ip;
+	}
+
+	if ((anchor < size) &&
+	    !(op = _put_sequence(op, oend, in + anchor, size - anchor, 0, 0)))
+		goto out;
+
+	r = (uint32_t) (op - out);
+out:
+	free(table);
+
+	return r;
+}
+
+uint32_t lz_uncompressed_size(const char *in, uint32_t size)
+{
+	const unsigned char *p = (const unsigned char *) in;
+
+	if ((size < LZ_HEADER_SIZE) || memcmp(p, _lz_magic, sizeof(_lz_magic)))
+		return 0;
+
+	return (uint32_t) p[4] | ((uint32_t) p[5] << 8) |
+		((uint32_t) p[6] << 16) | ((uint32_t) p[7] << 24);
+}
+
+static int _get_length(const unsigned char **ip, const unsigned char *iend, uint32_t *len)
+{
+	unsigned char b;
+
+	do {
+		if (*ip >= iend || (*len > UINT32_MAX - 255))
+			return 0;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+
+	return 1;
+}
+
+uint32_t lz_decompress_prefix(const char *in, uint32_t size, char *out, uint32_t out_size)
+{
+	const unsigned char *ip = (const unsigned char *) in + LZ_HEADER_SIZE;
+	const unsigned char *iend = (const unsigned char *) in + size;
+	uint32_t op = 0, lit, ml, offset;
+	unsigned char token;
+
+	if (!out_size || (lz_uncompressed_size(in, size) != out_size))
+		return 0;
+
+	while (op < out_size) {
+		if (ip >= iend)
+			return 0;
+		token = *ip++;
+
+		lit = token >> 4;
+		if ((lit == 15) && !_get_length(&ip, iend, &lit))
+			return 0;
+		if ((lit > (uint32_t) (iend - ip)) || (lit > out_size - op))
+			return 0;
+		memcpy(out + op, ip, lit);
+		ip += lit;
+		op += lit;
+
+		if (op == out_size)
+			break;
+
+		if (iend - ip < 2)
+			return 0;
+		offset = (uint32_t) ip[0] | ((uint32_t) ip[1] << 8);
+		ip += 2;
+		if (!offset || (offset > op))
+			return 0;
+
+		ml = token & 15;
+		if ((ml == 15) && !_get_length(&ip, iend, &ml))
+			return 0;
+		if ((ml > out_size - op) || (out_size - op - ml < LZ_MIN_MATCH))
+			return 0;
+		ml += LZ_MIN_MATCH;
+
+		if (offset >= ml) {
+			memcpy(out + op, out + op - offset, ml);
+			op += ml;
+		} else
+			/* Overlapping match repeats the last offset bytes */
+			for (; ml; ml--, op++)
+				out[op] = out[op - offset];
+	}
+
+	return (uint32_t) (ip - (const unsigned char *) in);
+}
+
+int lz_decompress(const char *in, uint32_t size, char *out, uint32_t out_size)
+{
+	return (lz_decompress_prefix(in, size, out, out_size) == size);
+}
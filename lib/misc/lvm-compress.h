@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU Lesser General Public License v.2.1.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _LVM_COMPRESS_H
+#define _LVM_COMPRESS_H
+
+#include <inttypes.h>
+
+/*
+ * Built-in LZ77 codec for metadata text.
+ *
+ * Compressed data starts with an 8 byte header, a magic number (which
+ * is never the start of text metadata) and the uncompressed size.
+ * It is followed by sequences of literal bytes and back references
+ * into the already decompressed data, encoded like LZ4 blocks.
+ */
+#define LZ_HEADER_SIZE 8
+
+/* Largest compressed size of size bytes, for sizing the output buffer. */
+uint32_t lz_compress_bound(uint32_t size);
+
+/*
+ * Returns the compressed size, or 0 when the compressed data
+ * would not fit into out_size bytes.
+ */
+uint32_t lz_compress(const char *in, uint32_t size, char *out, uint32_t out_size);
+
+/* Returns the uncompressed size, or 0 when in is not compressed data. */
+uint32_t lz_uncompressed_size(const char *in, uint32_t size);
+
+/*
+ * Decompresses all of in into exactly out_size bytes of out.
+ * Returns 0 on corrupted data, never accessing beyond in or out.
+ */
+int lz_decompress(const char *in, uint32_t size, char *out, uint32_t out_size);
+
+/*
+ * Like lz_decompress, but in may continue with other data after the
+ * compressed data.  Returns the compressed size, or 0 on corrupted data.
+ */
+uint32_t lz_decompress_prefix(const char *in, uint32_t size, char *out, uint32_t out_size);
+
+#endif
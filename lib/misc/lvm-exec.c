@@ -44,18 +44,14 @@ static char *_verbose_args(const char *const argv[], char *buf, size_t sz)
 }
 
 /*
- * Execute and wait for external command
+ * Start external command without waiting for its completion
  */
-int exec_cmd(struct cmd_context *cmd, const char *const argv[],
-	     int *rstatus, int sync_needed)
+pid_t exec_cmd_start(struct cmd_context *cmd, const char *const argv[],
+		     int sync_needed)
 {
 	pid_t pid;
-	int status = 0;
 	char buf[PATH_MAX * 2];
 
-	if (rstatus)
-		*rstatus = -1;
-
 	if (!argv[0]) {
 		log_error(INTERNAL_ERROR "Missing command.");
 		return 0;
@@ -86,13 +82,14 @@ int exec_cmd(struct cmd_context *cmd, const char *const argv[],
 		_exit(errno);
 	}
 
-	/* Parent */
-	if (wait4(pid, &status, 0, NULL) != pid) {
-		log_error("wait4 child process %u failed: %s", pid,
-			  strerror(errno));
-		return 0;
-	}
+	return pid;
+}
 
+/*
+ * Evaluate wait status of command started with exec_cmd_start()
+ */
+int exec_cmd_finish(const char *const argv[], pid_t pid, int status, int *rstatus)
+{
 	if (!WIFEXITED(status)) {
 		log_error("Child %u exited abnormally", pid);
 		return 0;
@@ -113,6 +110,31 @@ int exec_cmd(struct cmd_context *cmd, const char *const argv[],
 	return 1;
 }
 
+/*
+ * Execute and wait for external command
+ */
+int exec_cmd(struct cmd_context *cmd, const char *const argv[],
+	     int *rstatus, int sync_needed)
+{
+	pid_t pid;
+	int status = 0;
+
+	if (rstatus)
+		*rstatus = -1;
+
+	if (!(pid = exec_cmd_start(cmd, argv, sync_needed)))
+		return_0;
+
+	/* Parent */
+	if (wait4(pid, &status, 0, NULL) != pid) {
+		log_error("wait4 child process %u failed: %s", pid,
+			  strerror(errno));
+		return 0;
+	}
+
+	return exec_cmd_finish(argv, pid, status, rstatus);
+}
+
 static int _reopen_fd_to_null(int fd)
 {
 	int null_fd;
@@ -37,6 +37,24 @@ struct cmd_context;
 int exec_cmd(struct cmd_context *cmd, const char *const argv[],
 	     int *rstatus, int sync_needed);
 
+/**
+ * Start command with parameters without waiting for its completion.
+ *
+ * \return
+ * pid of the started child or 0 (failure).
+ */
+pid_t exec_cmd_start(struct cmd_context *cmd, const char *const argv[],
+		     int sync_needed);
+
+/**
+ * Evaluate wait status of child started by exec_cmd_start()
+ * the same way as exec_cmd() does.
+ *
+ * \return
+ * 1 (success) or 0 (failure).
+ */
+int exec_cmd_finish(const char *const argv[], pid_t pid, int status, int *rstatus);
+
 
 struct FILE;
 struct pipe_data {
@@ -58,6 +58,7 @@ static int _io_memory_size_kb = DEFAULT_IO_MEMORY_SIZE_KB;
 void init_verbose(int level)
 {
 	_verbose_level = level;
+	update_log_debug_gate();
 }
 
 void init_silent(int silent)
@@ -318,11 +319,18 @@ int ignore_lvm_mirrors(void)
 void init_debug(int level)
 {
 	_debug_level = level;
+	update_log_debug_gate();
 }
 
 void init_debug_classes_logged(int classes)
 {
 	_debug_classes_logged = classes;
+	update_log_debug_gate();
+}
+
+int debug_classes_logged(void)
+{
+	return _debug_classes_logged;
 }
 
 int debug_class_is_logged(int class)
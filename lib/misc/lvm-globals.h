@@ -69,6 +69,7 @@ int verbose_level(void);
 int silent_mode(void);
 int debug_level(void);
 int debug_class_is_logged(int class);
+int debug_classes_logged(void);
 int security_level(void);
 int mirror_in_sync(void);
 int background_polling(void);
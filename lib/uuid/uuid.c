@@ -21,6 +21,21 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <ctype.h>
+#ifdef HAVE_GETRANDOM
+#  include <sys/random.h>
+#endif
+
+/*
+ * Random bytes for new ids are taken from a pool filled in large chunks,
+ * so commands creating many LVs (or sub LVs) do not read /dev/urandom
+ * for each one. The pool is dropped in a forked child so the child
+ * never repeats ids generated by its parent.
+ */
+#define ID_RANDOM_POOL_SIZE	4096
+
+static uint8_t _random_pool[ID_RANDOM_POOL_SIZE];
+static size_t _random_pool_used = sizeof(_random_pool);
+static pid_t _random_pool_pid;
 
 static const char _c[] =
     "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ!#";
@@ -92,13 +107,60 @@ int lvid_in_restricted_range(union lvid *lvid)
 }
 
 
+static int _fill_random_pool(void)
+{
+#ifdef HAVE_GETRANDOM
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < sizeof(_random_pool)) {
+		if ((r = getrandom(_random_pool + done, sizeof(_random_pool) - done, 0)) < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == ENOSYS)
+				break; /* Kernel without getrandom */
+			log_sys_error("getrandom", "");
+			return 0;
+		}
+		done += r;
+	}
+
+	if (done == sizeof(_random_pool))
+		return 1;
+#endif
+	return read_urandom(_random_pool, sizeof(_random_pool));
+}
+
+static int _get_random_bytes(void *buf, size_t len)
+{
+	pid_t pid = getpid();
+
+	if (len > sizeof(_random_pool))
+		return read_urandom(buf, len);
+
+	if ((pid != _random_pool_pid) ||
+	    (len > sizeof(_random_pool) - _random_pool_used)) {
+		if (!_fill_random_pool())
+			return_0;
+		_random_pool_used = 0;
+		_random_pool_pid = pid;
+	}
+
+	memcpy(buf, _random_pool + _random_pool_used, len);
+	/* Never hand out the same bytes twice */
+	memset(_random_pool + _random_pool_used, 0, len);
+	_random_pool_used += len;
+
+	return 1;
+}
+
 int id_create(struct id *id)
 {
 	unsigned i;
 	size_t len = sizeof(id->uuid);
 
 	memset(id->uuid, 0, len);
-	if (!read_urandom(&id->uuid, len)) {
+	if (!_get_random_bytes(&id->uuid, len)) {
 		return 0;
 	}
 
@@ -22,8 +22,13 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <dirent.h>
 #include <ctype.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
 
 #ifdef __linux__
 #  include "libdm/misc/kdev_t.h"
@@ -42,7 +47,10 @@
 #define FILEMAPD_NOFILE_WAIT_USECS 100000
 #define FILEMAPD_NOFILE_WAIT_TRIES 10
 
+struct filemapd_device;
+
 struct filemap_monitor {
+	struct dm_list list;
 	dm_filemapd_mode_t mode;
 	const char *program_id;
 	uint64_t group_id;
@@ -56,13 +64,27 @@ struct filemap_monitor {
 	int64_t blocks; /* allocated blocks, from stat.st_blocks */
 	uint64_t nr_regions;
 	int deleted;
+	int open;
+
+	/* server mode */
+	struct filemapd_device *dev;
+	int shared_notify;	/* inotify_fd belongs to the server */
+	int modified;		/* IN_MODIFY seen since the last update */
+	int changed;		/* link count or file at path may have changed */
+	int missing;		/* passes without a file at path */
+	ino_t ino;
 };
 
 static int _foreground;
 static int _verbose;
 
 const char *const _usage = "dmfilemapd <fd> <group_id> <abs_path> <mode> "
-			   "[<foreground>[<log_level>]]";
+			   "[<foreground>[<log_level>]]\n"
+			   "       dmfilemapd --server <socket_path> "
+			   "[<foreground>[<log_level>]]\n"
+			   "       dmfilemapd --client <socket_path> "
+			   "add <group_id> <mode> <abs_path> | "
+			   "remove <abs_path> | list";
 
 /*
  * Daemon logging. By default, all messages are thrown away: messages
@@ -130,38 +152,45 @@ static void _setup_logging(void)
 	dm_log_with_errno_init(_dmfilemapd_log_with_errno);
 }
 
-#define PROC_FD_DELETED_STR "(deleted)"
+#define PROC_FD_DELETED_STR " (deleted)"
+
+/*
+ * Test whether link is the kernel 'file (deleted)' form of path.
+ */
+static int _is_deleted_link(const char *link, size_t len, const char *path)
+{
+	size_t path_len = strlen(path);
+
+	return ((len == path_len + sizeof(PROC_FD_DELETED_STR) - 1) &&
+		!strncmp(link, path, path_len) &&
+		!strcmp(link + path_len, PROC_FD_DELETED_STR));
+}
+
 /*
- * Scan the /proc/<pid>/fd directory for pid and check for an fd
- * symlink whose contents match path.
+ * Scan the /proc/<pid>/fd directory for pid and check for fd
+ * symlinks whose contents match the path of any deleted monitor
+ * on the list that is not yet known to be open. Returns the number
+ * of monitors found open.
  */
-static int _is_open_in_pid(pid_t pid, const char *path)
+static unsigned _is_open_in_pid(pid_t pid, struct dm_list *monitors)
 {
-	char deleted_path[PATH_MAX + sizeof(PROC_FD_DELETED_STR)];
+	struct filemap_monitor *fm;
 	struct dirent *pid_dp = NULL;
 	char path_buf[PATH_MAX];
 	char link_buf[PATH_MAX];
 	DIR *pid_d = NULL;
+	unsigned found = 0;
 	ssize_t len;
 
 	if (pid == getpid())
 		return 0;
 
 	if (dm_snprintf(path_buf, sizeof(path_buf),
-			DEFAULT_PROC_DIR "%d/fd", pid) < 0) {
+			DEFAULT_PROC_DIR "/%d/fd", pid) < 0) {
 		log_error("Could not format pid path.");
 		return 0;
 	}
 
-	/*
-	 * Test for the kernel 'file (deleted)' form when scanning.
-	 */
-	if (dm_snprintf(deleted_path, sizeof(deleted_path), "%s %s",
-			path, PROC_FD_DELETED_STR) < 0) {
-		log_error("Could not format check path.");
-		return 0;
-	}
-
 	pid_d = opendir(path_buf);
 	if (!pid_d) {
 		log_error("Could not open proc path: %s.", path_buf);
@@ -178,22 +207,23 @@ static int _is_open_in_pid(pid_t pid, const char *path)
 			goto bad;
 		}
 		link_buf[len] = '\0';
-		if (!strcmp(deleted_path, link_buf)) {
-			if (closedir(pid_d))
-				log_sys_debug("closedir", path_buf);
-			return 1;
-		}
+		dm_list_iterate_items(fm, monitors)
+			if (fm->deleted && !fm->open &&
+			    _is_deleted_link(link_buf, (size_t) len, fm->path)) {
+				fm->open = 1;
+				found++;
+			}
 	}
 
 bad:
 	if (closedir(pid_d))
 		log_sys_debug("closedir", path_buf);
 
-	return 0;
+	return found;
 }
 
 /*
- * Attempt to determine whether a file is open by any process by
+ * Attempt to determine whether files are open by any process by
  * scanning symbolic links in /proc/<pid>/fd.
  *
  * This is a heuristic since it cannot guarantee to detect brief
@@ -209,18 +239,32 @@ bad:
  * files can no longer be newly opened by processes.
  *
  * In this situation !is_open(path) provides an indication that
- * the daemon should shut down: the file has been unlinked from
- * the file system and we appear to hold the final reference.
+ * the daemon should stop monitoring: the file has been unlinked
+ * from the file system and we appear to hold the final reference.
+ *
+ * All deleted monitors on the list are checked by a single walk
+ * of /proc, which stops as soon as every one has been found open.
  */
-static int _is_open(const char *path)
+static void _check_open(struct dm_list *monitors)
 {
+	struct filemap_monitor *fm;
 	struct dirent *proc_dp = NULL;
 	DIR *proc_d = NULL;
+	unsigned deleted = 0;
 	pid_t pid;
 
+	dm_list_iterate_items(fm, monitors) {
+		fm->open = 0;
+		if (fm->deleted)
+			deleted++;
+	}
+
+	if (!deleted)
+		return;
+
 	proc_d = opendir(DEFAULT_PROC_DIR);
 	if (!proc_d)
-		return 0;
+		return;
 	while ((proc_dp = readdir(proc_d)) != NULL) {
 		if (!isdigit(proc_dp->d_name[0]))
 			continue;
@@ -228,17 +272,24 @@ static int _is_open(const char *path)
 		pid = (pid_t) strtol(proc_dp->d_name, NULL, 10);
 		if (errno || !pid)
 			continue;
-		if (_is_open_in_pid(pid, path)) {
-			if (closedir(proc_d))
-				log_sys_debug("closedir", DEFAULT_PROC_DIR);
-			return 1;
-		}
+		if ((deleted -= _is_open_in_pid(pid, monitors)) == 0)
+			break;
 	}
 
 	if (closedir(proc_d))
 		log_sys_debug("closedir", DEFAULT_PROC_DIR);
+}
 
-	return 0;
+static int _is_open(struct filemap_monitor *fm)
+{
+	struct dm_list monitors;
+
+	dm_list_init(&monitors);
+	dm_list_add(&monitors, &fm->list);
+	_check_open(&monitors);
+	dm_list_del(&fm->list);
+
+	return fm->open;
 }
 
 static void _filemap_monitor_wait(uint64_t usecs)
@@ -252,6 +303,41 @@ static void _filemap_monitor_wait(uint64_t usecs)
 	usleep((useconds_t) usecs);
 }
 
+/*
+ * Parse the optional [<foreground>[<verbose>]] arguments.
+ */
+static int _parse_debug_args(int argc, char **argv)
+{
+	char *endptr;
+
+	if (argc) {
+		errno = 0;
+		_foreground = (int) strtol(argv[0], &endptr, 10);
+		if (errno || *endptr) {
+			_early_log("Could not parse debug argument: %s.",
+				   argv[0]);
+			return 0;
+		}
+		argc--;
+		argv++;
+		if (argc) {
+			errno = 0;
+			_verbose = (int) strtol(argv[0], &endptr, 10);
+			if (errno || *endptr) {
+				_early_log("Could not parse verbose "
+					   "argument: %s", argv[0]);
+				return 0;
+			}
+			if (_verbose < 0 || _verbose > 3) {
+				_early_log("Verbose argument out of range: %d.",
+					   _verbose);
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
 static int _parse_args(int argc, char **argv, struct filemap_monitor *fm)
 {
 	char *endptr;
@@ -333,32 +419,7 @@ static int _parse_args(int argc, char **argv, struct filemap_monitor *fm)
 	argv++;
 
 	/* parse [<foreground>[<verbose>]] */
-	if (argc) {
-		errno = 0;
-		_foreground = (int) strtol(argv[0], &endptr, 10);
-		if (errno || *endptr) {
-			_early_log("Could not parse debug argument: %s.",
-				   argv[0]);
-			return 0;
-		}
-		argc--;
-		argv++;
-		if (argc) {
-			errno = 0;
-			_verbose = (int) strtol(argv[0], &endptr, 10);
-			if (errno || *endptr) {
-				_early_log("Could not parse verbose "
-					   "argument: %s", argv[0]);
-				return 0;
-			}
-			if (_verbose < 0 || _verbose > 3) {
-				_early_log("Verbose argument out of range: %d.",
-					   _verbose);
-				return 0;
-			}
-		}
-	}
-	return 1;
+	return _parse_debug_args(argc, argv);
 }
 
 static int _filemap_fd_update_blocks(struct filemap_monitor *fm)
@@ -406,20 +467,27 @@ static void _filemap_monitor_end_notify(struct filemap_monitor *fm)
 
 static int _filemap_monitor_set_notify(struct filemap_monitor *fm)
 {
+	uint32_t mask = IN_MODIFY | IN_DELETE_SELF;
 	int inotify_fd, watch_fd;
 
 	/*
 	 * Set IN_NONBLOCK since we do not want to block in event read()
 	 * calls. Do not set IN_CLOEXEC as dmfilemapd is single-threaded
 	 * and does not fork or exec.
+	 *
+	 * In server mode all watches share the server's instance and
+	 * IN_ATTRIB reports link count changes, so that unlinked files
+	 * are noticed without re-opening paths on every iteration.
 	 */
-	if ((inotify_fd = inotify_init1(IN_NONBLOCK)) < 0) {
+	if (fm->shared_notify) {
+		inotify_fd = fm->inotify_fd;
+		mask |= IN_ATTRIB;
+	} else if ((inotify_fd = inotify_init1(IN_NONBLOCK)) < 0) {
 		log_sys_error("inotify_init1", "IN_NONBLOCK");
 		return 0;
 	}
 
-	if ((watch_fd = inotify_add_watch(inotify_fd, fm->path,
-					  IN_MODIFY | IN_DELETE_SELF)) < 0) {
+	if ((watch_fd = inotify_add_watch(inotify_fd, fm->path, mask)) < 0) {
 		log_sys_error("inotify_add_watch", fm->path);
 		return 0;
 	}
@@ -626,7 +694,7 @@ check_unlinked:
 	return 1;
 }
 
-static int _daemonise(struct filemap_monitor *fm)
+static int _daemonise(int keep_fd)
 {
 	pid_t pid = 0;
 	int fd, ffd;
@@ -672,7 +740,7 @@ static int _daemonise(struct filemap_monitor *fm)
 	}
 	/* TODO: Use libdaemon/server/daemon-server.c _daemonise() */
 	for (ffd = (int) sysconf(_SC_OPEN_MAX) - 1; ffd > STDERR_FILENO; --ffd)
-		if (ffd != fm->fd)
+		if (ffd != keep_fd)
 			(void) close(ffd);
 
 	/* coverity[leaked_handle] no leak */
@@ -778,7 +846,7 @@ wait:
 		if (fm->mode == DM_FILEMAPD_FOLLOW_INODE) {
 			if (!_filemap_monitor_check_file_unlinked(fm))
 				goto bad;
-			if (fm->deleted && !(open = _is_open(fm->path))) {
+			if (fm->deleted && !(open = _is_open(fm))) {
 				log_info("File unlinked and closed: exiting.");
 				running = 0;
 			} else if (fm->deleted && open)
@@ -809,6 +877,761 @@ static const char * const _mode_names[] = {
 	"path"
 };
 
+/*
+ * Server mode: a single daemon monitors any number of filemap groups,
+ * possibly on different devices, using one inotify instance and a
+ * poll() loop. Files are added and removed through a control socket;
+ * each request is one line and each reply ends with a line that is
+ * either "OK" or "ERROR <message>":
+ *
+ *   add <group_id> <inode|path> <abs_path>
+ *   remove <abs_path>
+ *   list
+ *
+ * Events only mark a monitor for attention: updates are batched and
+ * run at most once per FILEMAPD_WAIT_USECS, listing each device with
+ * pending events once per pass and walking /proc once for all unlinked
+ * follow-inode files. Idle devices are listed every
+ * FILEMAPD_IDLE_LIST_USECS to notice removed groups.
+ *
+ * Monitors of one inode (hard links or several groups) share the
+ * inotify watch descriptor: events are passed to each of them and the
+ * watch is removed with the last one.
+ *
+ * In follow-path mode the server does not hold the file open between
+ * passes, and re-watches the path when the file found there changes.
+ */
+#define FILEMAPD_REQUEST_MAX (PATH_MAX + 64)
+#define FILEMAPD_EVENT_BUF_SIZE 4096
+#define FILEMAPD_IDLE_LIST_USECS 10000000
+
+struct filemapd_device {
+	struct dm_list list;
+	dev_t dev;
+	struct dm_stats *dms;
+	unsigned users;
+	int pending;		/* a monitor on the device has events */
+	uint64_t listed;	/* time of the last dm_stats_list() */
+};
+
+struct filemapd_server {
+	const char *socket_path;
+	int socket_fd;
+	int inotify_fd;
+	struct dm_list devices;
+	struct dm_list monitors;
+};
+
+static volatile sig_atomic_t _server_exit;
+
+static void _server_exit_handler(int sig __attribute__((unused)))
+{
+	_server_exit = 1;
+}
+
+static uint64_t _now_usecs(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_MONOTONIC, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * 1000000 + (uint64_t) ts.tv_nsec / 1000;
+}
+
+static struct filemapd_device *_server_get_device(struct filemapd_server *server,
+						  int fd)
+{
+	struct filemapd_device *dev;
+	struct stat buf;
+
+	if (fstat(fd, &buf)) {
+		log_error("Failed to fstat filemap file descriptor.");
+		return NULL;
+	}
+
+	dm_list_iterate_items(dev, &server->devices)
+		if (dev->dev == buf.st_dev) {
+			dev->users++;
+			return dev;
+		}
+
+	if (!(dev = calloc(1, sizeof(*dev)))) {
+		log_error("Could not allocate filemap device.");
+		return NULL;
+	}
+
+	/*
+	 * The handle is shared by every group on the device, whatever
+	 * program created it: list all programs' regions.
+	 */
+	if (!(dev->dms = dm_stats_create(NULL)) ||
+	    !dm_stats_set_program_id(dev->dms, 1, DM_STATS_ALL_PROGRAMS))
+		goto_bad;
+
+	if (!dm_stats_bind_from_fd(dev->dms, fd)) {
+		log_error("Could not bind dm_stats handle to file descriptor "
+			  "%d", fd);
+		goto bad;
+	}
+
+	if (!dm_stats_list(dev->dms, DM_STATS_ALL_PROGRAMS)) {
+		log_error("Failed to list stats handle.");
+		goto bad;
+	}
+
+	dev->dev = buf.st_dev;
+	dev->users = 1;
+	dev->listed = _now_usecs();
+	dm_list_add(&server->devices, &dev->list);
+
+	return dev;
+bad:
+	if (dev->dms)
+		dm_stats_destroy(dev->dms);
+	free(dev);
+	return NULL;
+}
+
+static void _server_put_device(struct filemapd_device *dev)
+{
+	if (--dev->users)
+		return;
+
+	dm_list_del(&dev->list);
+	dm_stats_destroy(dev->dms);
+	free(dev);
+}
+
+static struct filemap_monitor *_server_find_path(struct filemapd_server *server,
+						 const char *path)
+{
+	struct filemap_monitor *fm;
+
+	dm_list_iterate_items(fm, &server->monitors)
+		if (!strcmp(fm->path, path))
+			return fm;
+
+	return NULL;
+}
+
+/*
+ * Drop the monitor's watch, removing it from the inotify instance
+ * unless another monitor of the same inode still uses it.
+ */
+static void _server_end_notify(struct filemapd_server *server,
+			       struct filemap_monitor *fm)
+{
+	struct filemap_monitor *other;
+
+	if (fm->inotify_watch_fd < 0)
+		return;
+
+	dm_list_iterate_items(other, &server->monitors)
+		if ((other != fm) &&
+		    (other->inotify_watch_fd == fm->inotify_watch_fd))
+			goto out;
+
+	_filemap_monitor_end_notify(fm);
+out:
+	fm->inotify_watch_fd = -1;
+}
+
+static void _server_free(struct filemapd_server *server,
+			 struct filemap_monitor *fm)
+{
+	_server_end_notify(server, fm);
+	if (fm->fd >= 0)
+		_filemap_monitor_close_fd(fm);
+	if (fm->dev)
+		_server_put_device(fm->dev);
+	dm_list_del(&fm->list);
+	free((void *) fm->program_id);
+	free(fm->path);
+	free(fm);
+}
+
+static void _server_remove(struct filemapd_server *server,
+			   struct filemap_monitor *fm)
+{
+	log_info("Stopped monitoring group_id=" FMTu64 " path=\"%s\"",
+		 fm->group_id, fm->path);
+	_server_free(server, fm);
+}
+
+/*
+ * Open the monitored file when it is not held open. Follow-path
+ * monitors are flagged for attention if the file at the path is
+ * no longer the one being watched.
+ */
+static int _server_open(struct filemap_monitor *fm)
+{
+	struct stat buf;
+
+	if (fm->fd >= 0)
+		return 1;
+
+	if ((fm->fd = open(fm->path, O_RDONLY)) < 0)
+		return 0;
+
+	if (fstat(fm->fd, &buf)) {
+		_filemap_monitor_close_fd(fm);
+		return 0;
+	}
+
+	if (buf.st_ino != fm->ino)
+		fm->changed = 1;
+
+	return 1;
+}
+
+static void _server_close(struct filemap_monitor *fm)
+{
+	if ((fm->mode == DM_FILEMAPD_FOLLOW_PATH) && (fm->fd >= 0))
+		_filemap_monitor_close_fd(fm);
+}
+
+static int _server_add(struct filemapd_server *server, uint64_t group_id,
+		       dm_filemapd_mode_t mode, const char *path,
+		       const char **err)
+{
+	struct filemap_monitor *fm;
+	const char *program_id;
+	struct stat buf;
+
+	if (_server_find_path(server, path)) {
+		*err = "Path is already monitored.";
+		return 0;
+	}
+
+	if (!(fm = calloc(1, sizeof(*fm))) || !(fm->path = strdup(path))) {
+		free(fm);
+		*err = "Could not allocate monitor.";
+		return 0;
+	}
+
+	fm->mode = mode;
+	fm->group_id = group_id;
+	fm->nr_regions = 1;
+	fm->inotify_fd = server->inotify_fd;
+	fm->inotify_watch_fd = -1;
+	fm->shared_notify = 1;
+	dm_list_add(&server->monitors, &fm->list);
+
+	if ((fm->fd = open(path, O_RDONLY)) < 0) {
+		*err = "Could not open path.";
+		goto bad;
+	}
+
+	if (fstat(fm->fd, &buf) || !S_ISREG(buf.st_mode)) {
+		*err = "Path is not a regular file.";
+		goto bad;
+	}
+	fm->ino = buf.st_ino;
+	fm->blocks = buf.st_blocks;
+
+	if (!(fm->dev = _server_get_device(server, fm->fd))) {
+		*err = "Could not bind to the device holding the file.";
+		goto bad;
+	}
+
+	if (!dm_stats_group_present(fm->dev->dms, group_id) &&
+	    (!dm_stats_list(fm->dev->dms, DM_STATS_ALL_PROGRAMS) ||
+	     !dm_stats_group_present(fm->dev->dms, group_id))) {
+		*err = "Group does not exist.";
+		goto bad;
+	}
+
+	program_id = dm_stats_get_region_program_id(fm->dev->dms, group_id);
+	if (program_id && !(fm->program_id = strdup(program_id))) {
+		*err = "Could not allocate program_id.";
+		goto bad;
+	}
+
+	if (!_filemap_monitor_set_notify(fm)) {
+		*err = "Could not watch path.";
+		goto bad;
+	}
+
+	_server_close(fm);
+
+	log_info("Monitoring group_id=" FMTu64 " mode=%s, path=\"%s\"",
+		 group_id, _mode_names[mode], path);
+
+	return 1;
+bad:
+	_server_free(server, fm);
+	return 0;
+}
+
+static void _server_read_events(struct filemapd_server *server)
+{
+	/* alignment as per man(7) inotify */
+	char buf[FILEMAPD_EVENT_BUF_SIZE]
+		__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *event;
+	struct filemap_monitor *fm;
+	ssize_t len;
+	char *ptr;
+
+	while ((len = read(server->inotify_fd, buf, sizeof(buf))) > 0)
+		for (ptr = buf; ptr < buf + len;
+		     ptr += sizeof(*event) + event->len) {
+			event = (struct inotify_event *) ptr;
+			dm_list_iterate_items(fm, &server->monitors) {
+				if (fm->inotify_watch_fd != event->wd)
+					continue;
+				if (event->mask & IN_MODIFY)
+					fm->modified = 1;
+				if (event->mask & (IN_ATTRIB | IN_DELETE_SELF))
+					fm->changed = 1;
+				/* The kernel removed the watch: the inode is gone. */
+				if (event->mask & IN_IGNORED) {
+					fm->inotify_watch_fd = -1;
+					fm->changed = 1;
+				}
+			}
+		}
+
+	if ((len < 0) && (errno != EAGAIN) && (errno != EINTR))
+		log_sys_error("read", "inotify");
+}
+
+/*
+ * Re-evaluate a monitor flagged as changed. Returns 0 if the monitor
+ * should be removed.
+ */
+static int _server_check_changed(struct filemapd_server *server,
+				 struct filemap_monitor *fm)
+{
+	struct stat buf;
+
+	fm->changed = 0;
+
+	if (fm->mode == DM_FILEMAPD_FOLLOW_INODE) {
+		if (fstat(fm->fd, &buf)) {
+			log_error("Failed to fstat filemap file descriptor.");
+			return 0;
+		}
+		fm->deleted = !buf.st_nlink;
+		return 1;
+	}
+
+	if (stat(fm->path, &buf)) {
+		if (++fm->missing < FILEMAPD_NOFILE_WAIT_TRIES) {
+			fm->changed = 1;
+			return 1;
+		}
+		log_info("No file at path \"%s\": removing.", fm->path);
+		return 0;
+	}
+	fm->missing = 0;
+
+	if ((buf.st_ino == fm->ino) && (fm->inotify_watch_fd >= 0))
+		return 1;
+
+	if (buf.st_dev != fm->dev->dev) {
+		log_error("File at path \"%s\" moved to a different device.",
+			  fm->path);
+		return 0;
+	}
+
+	_server_end_notify(server, fm);
+
+	if (!_filemap_monitor_set_notify(fm))
+		return 0;
+
+	/* A new file: its regions must be re-mapped. */
+	fm->ino = buf.st_ino;
+	fm->blocks = -1;
+	fm->modified = 1;
+
+	return 1;
+}
+
+/*
+ * One batched update pass over all monitors.
+ */
+static void _server_update(struct filemapd_server *server, uint64_t now)
+{
+	struct filemap_monitor *fm, *tmp;
+	struct filemapd_device *dev;
+	struct dm_list deleted;
+	int check;
+
+	dm_list_iterate_items(fm, &server->monitors)
+		if (fm->modified || fm->changed)
+			fm->dev->pending = 1;
+
+	dm_list_iterate_items(dev, &server->devices) {
+		if (!dev->pending && (now - dev->listed < FILEMAPD_IDLE_LIST_USECS))
+			continue;
+		dev->pending = 0;
+		dev->listed = now;
+		if (!dm_stats_list(dev->dms, DM_STATS_ALL_PROGRAMS))
+			log_error("Failed to list stats handle.");
+	}
+
+	dm_list_iterate_items_safe(fm, tmp, &server->monitors) {
+		if (!dm_stats_group_present(fm->dev->dms, fm->group_id)) {
+			log_info("Filemap group removed: group_id=" FMTu64 ".",
+				 fm->group_id);
+			_server_remove(server, fm);
+			continue;
+		}
+
+		if (fm->changed && !_server_check_changed(server, fm)) {
+			_server_remove(server, fm);
+			continue;
+		}
+
+		if (!fm->modified)
+			continue;
+
+		if (!_server_open(fm)) {
+			fm->changed = 1;
+			continue;
+		}
+
+		if (fm->changed && !_server_check_changed(server, fm)) {
+			_server_remove(server, fm);
+			continue;
+		}
+
+		fm->modified = 0;
+
+		if ((check = _filemap_fd_check_changed(fm)) < 0) {
+			_server_remove(server, fm);
+			continue;
+		}
+
+		if (check) {
+			(void) dm_stats_set_program_id(fm->dev->dms, 1,
+						       fm->program_id);
+			if (!_update_regions(fm->dev->dms, fm))
+				fm->nr_regions = 0;
+			(void) dm_stats_set_program_id(fm->dev->dms, 1,
+						       DM_STATS_ALL_PROGRAMS);
+		}
+
+		_server_close(fm);
+
+		if (!fm->nr_regions)
+			_server_remove(server, fm);
+	}
+
+	/* mode=inode termination conditions, with one walk of /proc */
+	dm_list_init(&deleted);
+	dm_list_iterate_items_safe(fm, tmp, &server->monitors)
+		if (fm->deleted)
+			dm_list_move(&deleted, &fm->list);
+
+	_check_open(&deleted);
+
+	dm_list_iterate_items_safe(fm, tmp, &deleted) {
+		dm_list_move(&server->monitors, &fm->list);
+		if (!fm->open) {
+			log_info("File \"%s\" unlinked and closed.", fm->path);
+			_server_remove(server, fm);
+		}
+	}
+}
+
+static void _server_reply(int fd, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static void _server_reply(int fd, const char *fmt, ...)
+{
+	char buf[FILEMAPD_REQUEST_MAX];
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	len = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+
+	if ((len < 0) || ((size_t) len >= sizeof(buf)))
+		return;
+
+	if (write(fd, buf, (size_t) len) != len)
+		log_sys_debug("write", "control socket");
+}
+
+static void _server_request(struct filemapd_server *server, int fd, char *req)
+{
+	struct filemap_monitor *fm;
+	dm_filemapd_mode_t mode;
+	const char *err = NULL;
+	uint64_t group_id;
+	char *arg, *endptr;
+
+	if (!strcmp(req, "list")) {
+		dm_list_iterate_items(fm, &server->monitors)
+			_server_reply(fd, FMTu64 " %s %s\n", fm->group_id,
+				      _mode_names[fm->mode], fm->path);
+	} else if (!strncmp(req, "remove ", 7)) {
+		if (!(fm = _server_find_path(server, req + 7)))
+			err = "Path is not monitored.";
+		else
+			_server_remove(server, fm);
+	} else if (!strncmp(req, "add ", 4)) {
+		errno = 0;
+		group_id = strtoull(req + 4, &endptr, 10);
+		arg = (*endptr == ' ') ? endptr + 1 : NULL;
+		if (errno || (endptr == req + 4) || !arg)
+			err = "Could not parse group identifier.";
+		else if (!(endptr = strchr(arg, ' ')) || (endptr[1] != '/'))
+			err = "Mode and absolute path are required.";
+		else {
+			*endptr = '\0';
+			mode = dm_filemapd_mode_from_string(arg);
+			if (mode == DM_FILEMAPD_FOLLOW_NONE)
+				err = "Unknown mode.";
+			else
+				(void) _server_add(server, group_id, mode,
+						   endptr + 1, &err);
+			*endptr = ' ';
+		}
+	} else
+		err = "Unknown request.";
+
+	if (err) {
+		log_verbose("Request \"%s\" failed: %s", req, err);
+		_server_reply(fd, "ERROR %s\n", err);
+	} else
+		_server_reply(fd, "OK\n");
+}
+
+static void _server_accept(struct filemapd_server *server)
+{
+	struct timeval tv = { .tv_sec = 1 };
+	char req[FILEMAPD_REQUEST_MAX];
+	size_t used = 0;
+	ssize_t len;
+	char *nl;
+	int fd;
+
+	if ((fd = accept(server->socket_fd, NULL, NULL)) < 0) {
+		log_sys_debug("accept", server->socket_path);
+		return;
+	}
+
+	/* Do not let a stuck client stall monitoring. */
+	(void) setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	(void) setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	while (used < sizeof(req) - 1) {
+		if ((len = read(fd, req + used, sizeof(req) - 1 - used)) <= 0)
+			break;
+		used += (size_t) len;
+		req[used] = '\0';
+		if ((nl = strchr(req, '\n'))) {
+			*nl = '\0';
+			_server_request(server, fd, req);
+			break;
+		}
+	}
+
+	if (close(fd))
+		log_sys_debug("close", "control connection");
+}
+
+static int _server_listen(struct filemapd_server *server)
+{
+	struct sockaddr_un sun = { .sun_family = AF_UNIX };
+
+	if (dm_strncpy(sun.sun_path, server->socket_path,
+		       sizeof(sun.sun_path)) < 0) {
+		log_error("Socket path %s is too long.", server->socket_path);
+		return 0;
+	}
+
+	if ((server->socket_fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		log_sys_error("socket", server->socket_path);
+		return 0;
+	}
+
+	/* Remove a stale socket left by a previous daemon. */
+	if (unlink(server->socket_path) && (errno != ENOENT))
+		log_sys_debug("unlink", server->socket_path);
+
+	if (bind(server->socket_fd, (struct sockaddr *) &sun, sizeof(sun)) ||
+	    listen(server->socket_fd, 16)) {
+		log_sys_error("bind", server->socket_path);
+		return 0;
+	}
+
+	return 1;
+}
+
+static int _dmfilemapd_server(struct filemapd_server *server)
+{
+	struct filemap_monitor *fm, *tmp;
+	struct pollfd fds[2];
+	uint64_t now, last = 0;
+	int timeout, r = 1;
+
+	if ((server->inotify_fd = inotify_init1(IN_NONBLOCK)) < 0) {
+		log_sys_error("inotify_init1", "IN_NONBLOCK");
+		goto out;
+	}
+
+	if (!_server_listen(server))
+		goto out;
+
+	fds[0].fd = server->socket_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = server->inotify_fd;
+	fds[1].events = POLLIN;
+
+	while (!_server_exit) {
+		now = _now_usecs();
+		timeout = (now - last >= FILEMAPD_WAIT_USECS) ? 0 :
+			(int) ((FILEMAPD_WAIT_USECS - (now - last)) / 1000);
+
+		if ((poll(fds, 2, timeout) < 0) && (errno != EINTR)) {
+			log_sys_error("poll", "");
+			goto out;
+		}
+
+		if (fds[0].revents & POLLIN)
+			_server_accept(server);
+
+		if (fds[1].revents & POLLIN)
+			_server_read_events(server);
+
+		if ((now = _now_usecs()) - last >= FILEMAPD_WAIT_USECS) {
+			_server_update(server, now);
+			last = now;
+		}
+	}
+
+	log_info("Exiting on signal.");
+	r = 0;
+out:
+	dm_list_iterate_items_safe(fm, tmp, &server->monitors)
+		_server_remove(server, fm);
+
+	if (server->socket_fd >= 0) {
+		(void) close(server->socket_fd);
+		if (unlink(server->socket_path))
+			log_sys_debug("unlink", server->socket_path);
+	}
+
+	if ((server->inotify_fd >= 0) && close(server->inotify_fd))
+		log_sys_debug("close", "inotify");
+
+	return r;
+}
+
+/*
+ * dmfilemapd --server <socket_path> [<foreground>[<log_level>]]
+ */
+static int _dmfilemapd_server_main(int argc, char **argv)
+{
+	struct filemapd_server server = {
+		.socket_fd = -1,
+		.inotify_fd = -1,
+	};
+	struct sigaction sa = { .sa_handler = _server_exit_handler };
+
+	if ((argc < 3) || (*argv[2] != '/')) {
+		_early_log("An absolute socket path is required.");
+		_early_log("usage: %s", _usage);
+		return 1;
+	}
+
+	if (!_parse_debug_args(argc - 3, argv + 3))
+		return 1;
+
+	server.socket_path = argv[2];
+	dm_list_init(&server.devices);
+	dm_list_init(&server.monitors);
+
+	_setup_logging();
+
+	log_info("Starting dmfilemapd server with socket=\"%s\"",
+		 server.socket_path);
+
+	if (!_foreground && !_daemonise(-1))
+		return 1;
+
+	if (sigaction(SIGTERM, &sa, NULL) || sigaction(SIGINT, &sa, NULL) ||
+	    (signal(SIGPIPE, SIG_IGN) == SIG_ERR)) {
+		log_sys_error("sigaction", "");
+		return 1;
+	}
+
+	return _dmfilemapd_server(&server);
+}
+
+/*
+ * dmfilemapd --client <socket_path> <request>...
+ *
+ * Send one request to a server and print the reply.
+ */
+static int _dmfilemapd_client(int argc, char **argv)
+{
+	struct sockaddr_un sun = { .sun_family = AF_UNIX };
+	char buf[FILEMAPD_REQUEST_MAX];
+	size_t used = 0, len;
+	ssize_t r;
+	int i, fd, ok;
+
+	if (argc < 4) {
+		_early_log("usage: %s", _usage);
+		return 1;
+	}
+
+	for (i = 3; i < argc; i++) {
+		len = strlen(argv[i]);
+		if (used + len + 2 > sizeof(buf)) {
+			_early_log("Request is too long.");
+			return 1;
+		}
+		memcpy(buf + used, argv[i], len);
+		used += len;
+		buf[used++] = (i < argc - 1) ? ' ' : '\n';
+	}
+
+	if (dm_strncpy(sun.sun_path, argv[2], sizeof(sun.sun_path)) < 0) {
+		_early_log("Socket path %s is too long.", argv[2]);
+		return 1;
+	}
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+		_early_log("Failed to create socket: %s", strerror(errno));
+		return 1;
+	}
+
+	if (connect(fd, (struct sockaddr *) &sun, sizeof(sun)) ||
+	    (write(fd, buf, used) != (ssize_t) used)) {
+		_early_log("Failed to send request to %s: %s", argv[2],
+			   strerror(errno));
+		(void) close(fd);
+		return 1;
+	}
+
+	used = 0;
+	while ((used < sizeof(buf) - 1) &&
+	       ((r = read(fd, buf + used, sizeof(buf) - 1 - used)) > 0)) {
+		if (fwrite(buf + used, 1, (size_t) r, stdout) != (size_t) r)
+			break;
+		used += (size_t) r;
+		/* keep only the tail to find the final status line */
+		if (used > sizeof(buf) / 2) {
+			memmove(buf, buf + used - sizeof(buf) / 4, sizeof(buf) / 4);
+			used = sizeof(buf) / 4;
+		}
+	}
+	buf[used] = '\0';
+	(void) close(fd);
+
+	ok = (used >= 3) && !strcmp(buf + used - 3, "OK\n");
+
+	return ok ? 0 : 1;
+}
+
 /*
  * dmfilemapd <fd> <group_id> <path> <mode> [<foreground>[<log_level>]]
  */
@@ -818,6 +1641,12 @@ int main(int argc, char **argv)
 
 	memset(&fm, 0, sizeof(fm));
 
+	if ((argc > 1) && !strcmp(argv[1], "--server"))
+		return _dmfilemapd_server_main(argc, argv);
+
+	if ((argc > 1) && !strcmp(argv[1], "--client"))
+		return _dmfilemapd_client(argc, argv);
+
 	if (!_parse_args(argc, argv, &fm)) {
 		free(fm.path);
 		return 1;
@@ -829,7 +1658,7 @@ int main(int argc, char **argv)
 		 "mode=%s, path=\"%s\"", fm.fd, fm.group_id,
 		 _mode_names[fm.mode], fm.path);
 
-	if (!_foreground && !_daemonise(&fm)) {
+	if (!_foreground && !_daemonise(fm.fd)) {
 		free(fm.path);
 		return 1;
 	}
@@ -178,6 +178,7 @@ enum {
 	AREAS_ARG,
 	AREA_ARG,
 	AREA_SIZE_ARG,
+	BINARY_ARG,
 	BOUNDS_ARG,
 	CHECKS_ARG,
 	CLEAR_ARG,
@@ -298,6 +299,10 @@ static int _timer_fd = -1; /* timerfd file descriptor. */
 #endif /* !HAVE_SYS_TIMERFD_H */
 
 static uint64_t _interval = 0; /* configured interval in nsecs */
+
+/* binary stats report output */
+static struct dm_stats_stream *_stats_stream = NULL;
+static uint64_t _stream_timestamp = 0; /* wall clock of current interval */
 static uint64_t _new_interval = 0; /* flag top-of-interval */
 static uint64_t _last_interval = 0; /* approx. measured interval in nsecs */
 
@@ -762,6 +767,17 @@ static int _timer_running(void)
 
 #endif /* HAVE_SYS_TIMERFD_H */
 
+/* Wall clock time in nanoseconds for binary report records. */
+static uint64_t _realtime_ns(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_REALTIME, &ts))
+		return 0;
+
+	return (uint64_t) ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
 static int _update_interval_times(void)
 {
 	static struct dm_timestamp *this_timestamp = NULL;
@@ -955,6 +971,14 @@ static int _display_info_cols(struct dm_task *dmt, struct dm_info *info)
 		goto out;
 	}
 
+	if (_stats_stream && (_report_type & DR_STATS)) {
+		if (!dm_stats_stream_write(_stats_stream, stdout, obj.stats,
+					   _stream_timestamp))
+			goto_out;
+		r = 1;
+		goto out;
+	}
+
 	dm_stats_walk_init(obj.stats, walk_flags);
 	dm_stats_walk_do(obj.stats) {
 		if (!dm_report_object(_report, &obj))
@@ -5875,6 +5899,19 @@ static int _stats_report(CMD_ARGS)
 		_statstype |= (DM_STATS_WALK_ALL
 			       | DM_STATS_WALK_SKIP_SINGLE_AREA);
 
+	if (_switches[BINARY_ARG] && !_stats_stream) {
+		if (!subcommand || strcmp(subcommand, "report")) {
+			log_error("--binary is only supported by stats report.");
+			return 0;
+		}
+		if (isatty(STDOUT_FILENO)) {
+			log_error("Refusing to write binary stats to a terminal.");
+			return 0;
+		}
+		if (!(_stats_stream = dm_stats_stream_create()))
+			return_0;
+	}
+
 	if (names)
 		name = names->name;
 	else {
@@ -6211,7 +6248,7 @@ static int _stats_help(CMD_ARGS);
 #define FILEMAP_OPTS "--filemap [--nogroup] " FILE_MONITOR_OPTS INDENT ID_OPTS INDENT EXTRA_OPTS
 #define PRINT_OPTS "[--clear] " ALL_PROGS_REGIONS_DEVICES
 #define REPORT_OPTS "[--interval <seconds>] [--count <cnt>]" INDENT \
-"[--units <u>] " SELECT_OPTS INDENT DM_REPORT_OPTS INDENT ALL_PROGS_OPT
+"[--units <u>] [--binary] " SELECT_OPTS INDENT DM_REPORT_OPTS INDENT ALL_PROGS_OPT
 #define GROUP_OPTS "[--alias NAME] --regions <regions>" INDENT ALL_PROGS_OPT ALL_DEVICES_OPT
 #define UNGROUP_OPTS GROUP_ID_OPT ALL_PROGS_OPT INDENT ALL_DEVICES_OPT
 #define UPDATE_OPTS GROUP_ID_OPT INDENT FILE_MONITOR_OPTS " <file_path>"
@@ -6865,6 +6902,7 @@ static int _process_switches(int *argcp, char ***argvp, const char *dev_dir)
 		{"area", 0, 0, AREA_ARG},
 		{"areas", 1, 0, AREAS_ARG},
 		{"areasize", 1, 0, AREA_SIZE_ARG},
+		{"binary", 0, 0, BINARY_ARG},
 		{"bounds", 1, 0, BOUNDS_ARG},
 		{"checks", 0, 0, CHECKS_ARG},
 		{"clear", 0, 0, CLEAR_ARG},
@@ -7044,6 +7082,9 @@ static int _process_switches(int *argcp, char ***argvp, const char *dev_dir)
 		case CONCISE_ARG:
 			_switches[CONCISE_ARG]++;
 			break;
+		case BINARY_ARG:
+			_switches[BINARY_ARG]++;
+			break;
 		case BOUNDS_ARG:
 			_switches[BOUNDS_ARG]++;
 			_string_args[BOUNDS_ARG] = optarg;
@@ -7549,19 +7590,25 @@ doit:
 			    (argc || (!_switches[UUID_ARG] && !_switches[MAJOR_ARG])));
 
 	do {
+		if (_switches[BINARY_ARG])
+			_stream_timestamp = _realtime_ns();
 		r = _perform_command_for_all_repeatable_args(cmd, subcommand, argc, argv, NULL, multiple_devices);
 		if (_concise_output_produced) {
 			putchar('\n');
 			fflush(stdout);
 		}
 		if (_report) {
-			/* only output headings for repeating reports */
-			if (_int_args[COUNT_ARG] != 1 && !dm_report_is_empty(_report))
-				dm_report_column_headings(_report);
-			dm_report_output(_report);
+			/* binary records were written directly by the stream */
+			if (!_stats_stream) {
+				/* only output headings for repeating reports */
+				if (_int_args[COUNT_ARG] != 1 && !dm_report_is_empty(_report))
+					dm_report_column_headings(_report);
+				dm_report_output(_report);
+			}
 
 			if (_count > 1 && r) {
-				putchar('\n');
+				if (!_stats_stream)
+					putchar('\n');
 				fflush(stdout);
 				/* wait for --interval and update timestamps */
 				if (!_do_report_wait()) {
@@ -7581,6 +7628,11 @@ out:
 	if (_report)
 		dm_report_free(_report);
 
+	if (_stats_stream) {
+		fflush(stdout);
+		dm_stats_stream_destroy(_stats_stream);
+	}
+
 	if (_dtree)
 		dm_tree_free(_dtree);
 
@@ -1358,6 +1358,10 @@ uint64_t *dm_stats_create_regions_from_fd(struct dm_stats *dms, int fd,
  * containing the IDs of the updated regions (including any existing
  * regions that were not modified by the call).
  *
+ * Only regions for extents that are new, or that are no longer
+ * allocated, are created or deleted: regions for unchanged extents
+ * are retained together with their counters.
+ *
  * The region_id array is terminated by the special value
  * DM_STATS_REGION_NOT_PRESENT and should be freed using dm_free()
  * when no longer required.
@@ -3454,6 +3458,81 @@ dm_percent_t dm_histogram_get_bin_percent(const struct dm_histogram *dmh,
  */
 uint64_t dm_histogram_get_sum(const struct dm_histogram *dmh);
 
+/*
+ * Estimate a latency percentile (0 < percentile <= 100, for example
+ * 50.0 or 99.0) from the bin counts of the histogram: the upper bound
+ * of the first bin at which the cumulative count reaches that share of
+ * all observations. If the percentile falls in the final, unbounded,
+ * bin its lower bound is returned instead. The value is returned in
+ * nanoseconds.
+ *
+ * Returns 0 if the histogram has no observations or if percentile is
+ * out of range.
+ */
+uint64_t dm_histogram_get_percentile(const struct dm_histogram *dmh,
+				     double percentile);
+
+/*
+ * Estimate a latency percentile for the histogram returned by
+ * dm_stats_get_histogram() for region_id and area_id.
+ *
+ * Aggregate histograms and counters for regions and groups are
+ * computed once and cached until the next dm_stats_list() or
+ * dm_stats_populate(), so reading several percentiles or counters of
+ * the same group does not re-sum its areas.
+ */
+uint64_t dm_stats_get_histogram_percentile(const struct dm_stats *dms,
+					   double percentile,
+					   uint64_t region_id,
+					   uint64_t area_id);
+
+/*
+ * Compact binary stats streams.
+ *
+ * A dm_stats_stream encodes the counters and histogram bins of every
+ * area of a populated handle as variable length deltas against the
+ * values written for the same device, region and area in the previous
+ * call, giving a small fixed-schema record per area and interval that
+ * is cheap to produce and to post-process.
+ *
+ * The same stream state object is used to decode: successive calls to
+ * dm_stats_stream_read() return one area record at a time with the
+ * absolute counter values reconstructed.
+ */
+struct dm_stats_stream;
+
+struct dm_stats_stream_record {
+	uint64_t timestamp_ns;	/* as passed to dm_stats_stream_write() */
+	uint64_t interval_ns;	/* sampling interval of the handle */
+	uint32_t major;
+	uint32_t minor;
+	const char *name;	/* valid until the next read */
+	uint64_t region_id;
+	uint64_t area_id;
+	uint64_t counters[DM_STATS_NR_COUNTERS]; /* dm_stats_counter_t order */
+	int nr_bins;		/* zero if the region has no histogram */
+	const uint64_t *bins;	/* bin counts, valid until the next read */
+};
+
+struct dm_stats_stream *dm_stats_stream_create(void);
+void dm_stats_stream_destroy(struct dm_stats_stream *dss);
+
+/*
+ * Append the current values of all present regions of dms to out,
+ * writing the stream header on first use. timestamp_ns is recorded
+ * once per distinct value and is normally the wall clock time of the
+ * dm_stats_populate() call. Returns 1 on success or 0 on error.
+ */
+int dm_stats_stream_write(struct dm_stats_stream *dss, FILE *out,
+			  const struct dm_stats *dms, uint64_t timestamp_ns);
+
+/*
+ * Read the next area record from in. Returns 1 when rec was filled,
+ * 0 at the end of the stream and -1 if the input is malformed.
+ */
+int dm_stats_stream_read(struct dm_stats_stream *dss, FILE *in,
+			 struct dm_stats_stream_record *rec);
+
 /*
  * Histogram formatting flags.
  */
@@ -17,6 +17,7 @@
 
 #include "libdm/misc/dmlib.h"
 #include "libdm/misc/kdev_t.h"
+#include "libdm/misc/dm-ioctl.h"
 
 #include "math.h" /* log10() */
 
@@ -48,7 +49,8 @@
 
 #define STATS_ROW_BUF_LEN 4096
 #define STATS_MSG_BUF_LEN 1024
-#define STATS_FIE_BUF_LEN 2048
+/* FIEMAP chunk: room for 290 extents per ioctl */
+#define STATS_FIE_BUF_LEN 16384
 
 #define SECTOR_SHIFT 9L
 
@@ -101,6 +103,8 @@ struct dm_stats_region {
 	struct dm_histogram *bounds; /* histogram configuration */
 	struct dm_histogram *histogram; /* aggregate cache */
 	struct dm_stats_counters *counters;
+	struct dm_stats_counters aggregate; /* sum of all areas */
+	int aggregate_valid;
 };
 
 struct dm_stats_group {
@@ -108,6 +112,8 @@ struct dm_stats_group {
 	const char *alias;
 	dm_bitset_t regions;
 	struct dm_histogram *histogram;
+	struct dm_stats_counters aggregate; /* sum of all member areas */
+	int aggregate_valid;
 };
 
 struct dm_stats {
@@ -360,6 +366,9 @@ static void _stats_region_destroy(struct dm_stats_region *region)
 	region->counters = NULL;
 	region->bounds = NULL;
 
+	dm_free(region->histogram);
+	region->histogram = NULL;
+	region->aggregate_valid = 0;
 	dm_free(region->program_id);
 	region->program_id = NULL;
 	dm_free(region->aux_data);
@@ -390,7 +399,9 @@ static void _stats_group_destroy(struct dm_stats_group *group)
 	if (!_stats_group_present(group))
 		return;
 
+	dm_free(group->histogram);
 	group->histogram = NULL;
+	group->aggregate_valid = 0;
 
 	if (group->alias) {
 		dm_free((char *) group->alias);
@@ -1030,6 +1041,7 @@ static int _stats_parse_list_region(struct dm_stats *dms,
 	}
 
 	region->histogram = NULL;
+	region->aggregate_valid = 0;
 	region->group_id = DM_STATS_GROUP_NOT_PRESENT;
 
 	if (!(region->program_id = dm_strdup(program_id))) {
@@ -2392,6 +2404,17 @@ static int _dm_stats_populate_region(struct dm_stats *dms, uint64_t region_id,
 		return 0;
 	}
 	region->region_id = region_id;
+
+	/* drop cached aggregates that include the old counter values */
+	dm_free(region->histogram);
+	region->histogram = NULL;
+	region->aggregate_valid = 0;
+	if (_stats_region_is_grouped(dms, region_id)) {
+		dm_free(dms->groups[region->group_id].histogram);
+		dms->groups[region->group_id].histogram = NULL;
+		dms->groups[region->group_id].aggregate_valid = 0;
+	}
+
 	return 1;
 }
 
@@ -2549,11 +2572,68 @@ static uint64_t _stats_get_counter(const struct dm_stats *dms,
 	return 0;
 }
 
+static void _stats_sum_counters(struct dm_stats_counters *sum,
+				const struct dm_stats_counters *area)
+{
+	sum->reads += area->reads;
+	sum->reads_merged += area->reads_merged;
+	sum->read_sectors += area->read_sectors;
+	sum->read_nsecs += area->read_nsecs;
+	sum->writes += area->writes;
+	sum->writes_merged += area->writes_merged;
+	sum->write_sectors += area->write_sectors;
+	sum->write_nsecs += area->write_nsecs;
+	sum->io_in_progress += area->io_in_progress;
+	sum->io_nsecs += area->io_nsecs;
+	sum->weighted_io_nsecs += area->weighted_io_nsecs;
+	sum->total_read_nsecs += area->total_read_nsecs;
+	sum->total_write_nsecs += area->total_write_nsecs;
+}
+
+/*
+ * Aggregate counters for a region and for a group are summed once, on
+ * first use, and cached until the next dm_stats_list() or
+ * dm_stats_populate() replaces the counter values.
+ */
+static const struct dm_stats_counters *_stats_region_aggregate(const struct dm_stats *dms,
+							       uint64_t region_id)
+{
+	struct dm_stats_region *region = &dms->regions[region_id];
+	uint64_t j;
+
+	if (!region->aggregate_valid) {
+		memset(&region->aggregate, 0, sizeof(region->aggregate));
+		_foreach_region_area(dms, region_id, j)
+			_stats_sum_counters(&region->aggregate,
+					    &region->counters[j]);
+		region->aggregate_valid = 1;
+	}
+
+	return &region->aggregate;
+}
+
+static const struct dm_stats_counters *_stats_group_aggregate(const struct dm_stats *dms,
+							      uint64_t group_id)
+{
+	struct dm_stats_group *group = &dms->groups[group_id];
+	uint64_t i;
+
+	if (!group->aggregate_valid) {
+		memset(&group->aggregate, 0, sizeof(group->aggregate));
+		_foreach_group_region(dms, group_id, i)
+			_stats_sum_counters(&group->aggregate,
+					    _stats_region_aggregate(dms, i));
+		group->aggregate_valid = 1;
+	}
+
+	return &group->aggregate;
+}
+
 uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 			      dm_stats_counter_t counter,
 			      uint64_t region_id, uint64_t area_id)
 {
-	uint64_t i, j, sum = 0; /* aggregation */
+	uint64_t i, sum = 0; /* aggregation */
 	int sum_regions = 0;
 	struct dm_stats_region *region;
 	struct dm_stats_counters *area;
@@ -2582,10 +2662,8 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 	if (_stats_region_is_grouped(dms, region_id) && (sum_regions)) {
 		/* group */
 		if (area_id & DM_STATS_WALK_GROUP)
-			_foreach_group_area(dms, region->group_id, i, j) {
-				area = &dms->regions[i].counters[j];
-				sum += _stats_get_counter(dms, area, counter);
-			}
+			sum = _stats_get_counter(dms, _stats_group_aggregate(dms, region->group_id),
+						 counter);
 		else
 			_foreach_group_region(dms, region->group_id, i) {
 				area = &dms->regions[i].counters[area_id];
@@ -2593,10 +2671,8 @@ uint64_t dm_stats_get_counter(const struct dm_stats *dms,
 			}
 	} else if (area_id == DM_STATS_WALK_REGION) {
 		/* aggregate region */
-		_foreach_region_area(dms, region_id, j) {
-			area = &dms->regions[region_id].counters[j];
-			sum += _stats_get_counter(dms, area, counter);
-		}
+		sum = _stats_get_counter(dms, _stats_region_aggregate(dms, region_id),
+					 counter);
 	} else {
 		/* plain region / area */
 		area = &region->counters[area_id];
@@ -3447,7 +3523,11 @@ static struct dm_histogram *_aggregate_histogram(const struct dm_stats *dms,
 	hist_size = sizeof(*dmh_aggr)
 		     + nr_bins * sizeof(struct dm_histogram_bin);
 
-	if (!(dmh_aggr = dm_pool_zalloc(dms->hist_mem, hist_size))) {
+	/*
+	 * Not allocated from hist_mem: the cache is freed when it is
+	 * replaced, without releasing area histograms parsed after it.
+	 */
+	if (!(dmh_aggr = dm_zalloc(hist_size))) {
 		log_error("Could not allocate group histogram");
 		return 0;
 	}
@@ -3534,6 +3614,47 @@ uint64_t dm_histogram_get_bin_width(const struct dm_histogram *dmh, int bin)
 	return (upper - lower);
 }
 
+uint64_t dm_histogram_get_percentile(const struct dm_histogram *dmh,
+				     double percentile)
+{
+	uint64_t total = 0, seen = 0;
+	double rank;
+	int bin;
+
+	if (!dmh || (percentile <= 0.0) || (percentile > 100.0))
+		return 0;
+
+	for (bin = 0; bin < dmh->nr_bins; bin++)
+		total += dmh->bins[bin].count;
+
+	if (!total)
+		return 0;
+
+	rank = (double) total * percentile / 100.0;
+
+	for (bin = 0; bin < dmh->nr_bins; bin++) {
+		seen += dmh->bins[bin].count;
+		if ((double) seen >= rank)
+			break;
+	}
+
+	if (bin >= dmh->nr_bins - 1)
+		/* the final bin has no upper bound */
+		return dm_histogram_get_bin_lower(dmh, dmh->nr_bins - 1);
+
+	return dm_histogram_get_bin_upper(dmh, bin);
+}
+
+uint64_t dm_stats_get_histogram_percentile(const struct dm_stats *dms,
+					   double percentile,
+					   uint64_t region_id,
+					   uint64_t area_id)
+{
+	return dm_histogram_get_percentile(dm_stats_get_histogram(dms, region_id,
+								  area_id),
+					   percentile);
+}
+
 uint64_t dm_histogram_get_bin_count(const struct dm_histogram *dmh, int bin)
 {
 	return dmh->bins[bin].count;
@@ -3977,6 +4098,8 @@ static int _stats_create_group(struct dm_stats *dms, dm_bitset_t regions,
 
 	group->group_id = *group_id;
 	group->regions = regions;
+	group->histogram = NULL;
+	group->aggregate_valid = 0;
 
 	if (alias)
 		group->alias = dm_strdup(alias);
@@ -4525,6 +4648,12 @@ static struct _extent *_stats_get_extents_for_file(struct dm_pool *mem, int fd,
 			goto bad;
 		}
 
+		/*
+		 * The file was synced by the first call: continue from
+		 * fm_start without flushing it again for each chunk.
+		 */
+		flags &= ~FIEMAP_FLAG_SYNC;
+
 		/* If 0 extents are returned, more ioctls are not needed */
 		if (fiemap->fm_mapped_extents == 0)
 			break;
@@ -4560,17 +4689,21 @@ bad:
 	return NULL;
 }
 
-#define MATCH_EXTENT(e, s, l) \
-(((e).start == (s)) && ((e).len == (l)))
-
-static struct _extent *_find_extent(uint64_t nr_extents, struct _extent *extents,
-				    uint64_t start, uint64_t len)
+/*
+ * Comparison function to sort extents in ascending start and length order.
+ */
+static int _extent_compare(const void *p1, const void *p2)
 {
-	size_t i;
-	for (i = 0; i < nr_extents; i++)
-		if (MATCH_EXTENT(extents[i], start, len))
-			return extents + i;
-	return NULL;
+	const struct _extent *r1 = (const struct _extent *) p1;
+	const struct _extent *r2 = (const struct _extent *) p2;
+
+	if (r1->start != r2->start)
+		return (r1->start < r2->start) ? -1 : 1;
+
+	if (r1->len != r2->len)
+		return (r1->len < r2->len) ? -1 : 1;
+
+	return 0;
 }
 
 /*
@@ -4589,82 +4722,157 @@ static void _stats_cleanup_region_ids(struct dm_stats *dms, uint64_t *regions,
 }
 
 /*
- * First update pass: prune no-longer-allocated extents from the group
- * and build a table of the remaining extents so that their creation
- * can be skipped in the second pass.
+ * Diff the count extents of a file against the nr_old extents mapped by
+ * the regions of a group, whose id fields hold the region_id values.
+ * Fill kept with the region_id of the old region that maps each extent,
+ * or DM_STATS_REGION_NOT_PRESENT if a region must be created, and move
+ * the old extents that are no longer allocated to the front of
+ * old_extents. new_extents is scratch space for count extents.
+ *
+ * Both sides are sorted by start and length and merged, so the diff is
+ * O(n log n) in the number of extents. Returns the number of old
+ * extents to delete.
  */
-static int _stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
-				struct dm_pool *mem, struct _extent *extents,
-				struct _extent **old_extents, uint64_t *count,
-				int *regroup)
+static uint64_t _stats_diff_extents(struct _extent *old_extents, uint64_t nr_old,
+				    const struct _extent *extents,
+				    struct _extent *new_extents, uint64_t count,
+				    uint64_t *kept)
 {
-	struct dm_stats_region *region = NULL;
-	struct dm_stats_group *group = NULL;
-	uint64_t nr_kept, nr_old;
-	struct _extent ext = { .id = 0 };
-	int64_t i;
-
-	group = &dms->groups[group_id];
+	uint64_t nr_deleted = 0, o, n, i;
+	int cmp;
 
-	log_very_verbose("Checking for changed file extents in group ID "
-			 FMTu64, group_id);
-
-	if (!dm_pool_begin_object(mem, sizeof(**old_extents))) {
-		log_error("Could not allocate extent table.");
-		return 0;
+	for (i = 0; i < count; i++) {
+		new_extents[i] = extents[i];
+		new_extents[i].id = i;
+		kept[i] = DM_STATS_REGION_NOT_PRESENT;
 	}
 
-	nr_kept = nr_old = 0; /* counts of old and retained extents */
+	qsort(old_extents, nr_old, sizeof(*old_extents), _extent_compare);
+	qsort(new_extents, count, sizeof(*new_extents), _extent_compare);
 
 	/*
-	 * First pass: delete de-allocated extents and set regroup=1 if
-	 * deleting the current group leader.
+	 * Merge: matching extents are kept, unmatched old extents are
+	 * collected at the front of old_extents for deletion.
 	 */
-	i = dm_bit_get_last(group->regions);
-	for (; i >= 0; i = dm_bit_get_prev(group->regions, i)) {
-		region = &dms->regions[i];
-		nr_old++;
+	for (o = n = 0; (o < nr_old) || (n < count);) {
+		if (o == nr_old)
+			cmp = 1;
+		else if (n == count)
+			cmp = -1;
+		else
+			cmp = _extent_compare(old_extents + o, new_extents + n);
+
+		if (!cmp) {
+			kept[new_extents[n].id] = old_extents[o].id;
+			log_very_verbose("Kept region " FMTu64,
+					 old_extents[o].id);
+			o++;
+			n++;
+		} else if (cmp < 0)
+			old_extents[nr_deleted++] = old_extents[o++];
+		else
+			n++;
+	}
 
-		if (extents && _find_extent(*count, extents,
-				  region->start, region->len)) {
-			ext.start = region->start;
-			ext.len = region->len;
-			ext.id = i;
-			nr_kept++;
+	return nr_deleted;
+}
 
-			if (!dm_pool_grow_object(mem, &ext, sizeof(ext)))
-				goto out;
+/*
+ * First update pass: diff the current extents of the file against the
+ * regions of the group, prune regions whose extents are no longer
+ * allocated and return a table giving, for each of the count extents,
+ * the region_id of the retained region that maps it or
+ * DM_STATS_REGION_NOT_PRESENT if a region must be created.
+ *
+ * Retained regions keep their counters, and the group descriptor is
+ * rewritten once for the whole set of pruned regions rather than once
+ * per region.
+ */
+static uint64_t *_stats_unmap_regions(struct dm_stats *dms, uint64_t group_id,
+				      struct dm_pool *mem,
+				      struct _extent *extents, uint64_t count,
+				      uint64_t *nr_deleted, int *regroup)
+{
+	struct dm_stats_group *group = &dms->groups[group_id];
+	struct _extent *old_extents, *new_extents;
+	uint64_t *kept, nr_old = 0, o;
+	int64_t r;
 
-			log_very_verbose("Kept region " FMTu64, i);
-		} else {
+	log_very_verbose("Checking for changed file extents in group ID "
+			 FMTu64, group_id);
 
-			if (i == (int64_t)group_id)
-				*regroup = 1;
+	for (r = dm_bit_get_first(group->regions); r >= 0;
+	     r = dm_bit_get_next(group->regions, r))
+		nr_old++;
 
-			if (!_stats_delete_region(dms, i)) {
-				log_error("Could not remove region ID " FMTu64,
-					  i);
-				goto out;
-			}
+	if (!(kept = dm_pool_alloc(mem, (count + 1) * sizeof(*kept))) ||
+	    !(old_extents = dm_pool_alloc(mem, (nr_old + 1) * sizeof(*old_extents))) ||
+	    !(new_extents = dm_pool_alloc(mem, (count + 1) * sizeof(*new_extents)))) {
+		log_error("Could not allocate extent table.");
+		return NULL;
+	}
+
+	for (o = 0, r = dm_bit_get_first(group->regions); r >= 0;
+	     r = dm_bit_get_next(group->regions, r), o++) {
+		old_extents[o].start = dms->regions[r].start;
+		old_extents[o].len = dms->regions[r].len;
+		old_extents[o].id = (uint64_t) r;
+	}
+
+	*nr_deleted = _stats_diff_extents(old_extents, nr_old, extents,
+					  new_extents, count, kept);
 
-			log_very_verbose("Deleted region " FMTu64, i);
+	for (o = 0; o < *nr_deleted; o++)
+		if (old_extents[o].id == group_id)
+			*regroup = 1;
+
+	/*
+	 * Deleting the group leader destroys the group, and the caller
+	 * re-creates it: the remaining members are then ungrouped and
+	 * can be deleted without updating the group descriptor.
+	 *
+	 * Otherwise, drop all the pruned members from the group with a
+	 * single descriptor update before deleting them.
+	 */
+	if (*regroup) {
+		if (!_stats_delete_region(dms, group_id)) {
+			log_error("Could not remove region ID " FMTu64,
+				  group_id);
+			return NULL;
+		}
+		log_very_verbose("Deleted region " FMTu64, group_id);
+	} else if (*nr_deleted) {
+		for (o = 0; o < *nr_deleted; o++) {
+			dm_bit_clear(group->regions, old_extents[o].id);
+			dms->regions[old_extents[o].id].group_id =
+				DM_STATS_GROUP_NOT_PRESENT;
+		}
+		if (!_stats_set_aux(dms, group_id,
+				    dms->regions[group_id].aux_data)) {
+			log_error("Could not update group ID " FMTu64, group_id);
+			return NULL;
 		}
 	}
 
-	*old_extents = dm_pool_end_object(mem);
-	if (!*old_extents) {
-		log_error("Could not finalize region extent table.");
-		goto out;
+	for (o = 0; o < *nr_deleted; o++) {
+		if (old_extents[o].id == group_id)
+			continue;
+
+		if (!_stats_delete_region(dms, old_extents[o].id)) {
+			log_error("Could not remove region ID " FMTu64,
+				  old_extents[o].id);
+			return NULL;
+		}
+
+		log_very_verbose("Deleted region " FMTu64, old_extents[o].id);
 	}
-	log_very_verbose("Kept " FMTd64 " of " FMTd64 " old extents",
-			 nr_kept, nr_old);
+
+	log_very_verbose("Kept " FMTu64 " of " FMTu64 " old extents",
+			 nr_old - *nr_deleted, nr_old);
 	log_very_verbose("Found " FMTu64 " new extents",
-			 *count - nr_kept);
+			 count - (nr_old - *nr_deleted));
 
-	return (int) nr_kept;
-out:
-	dm_pool_abandon_object(mem);
-	return -1;
+	return kept;
 }
 
 /*
@@ -4676,25 +4884,28 @@ out:
  * If group_id is not equal to DM_STATS_GROUP_NOT_PRESENT, it is assumed
  * that group_id corresponds to a group containing existing regions that
  * were mapped to this file at an earlier time: regions will be added or
- * removed to reflect the current status of the file.
+ * removed to reflect the current status of the file. The number of
+ * regions that were created or deleted is returned in the memory
+ * pointed to by nr_changed.
  */
 static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 					 struct dm_histogram *bounds,
 					 int precise, uint64_t group_id,
-					 uint64_t *count, int *regroup)
+					 uint64_t *count, int *regroup,
+					 uint64_t *nr_changed)
 {
-	struct _extent *extents = NULL, *old_extents = NULL;
-	uint64_t *regions = NULL, fail_region, i, num_bits;
+	uint64_t *regions = NULL, *kept = NULL, fail_region, i, num_bits;
+	uint64_t nr_created = 0, nr_deleted = 0;
+	struct _extent *extents = NULL;
 	struct dm_stats_group *group = NULL;
 	struct dm_pool *extent_mem = NULL;
-	struct _extent *old_ext;
 	char *hist_arg = NULL;
 	struct statfs fsbuf = { 0 };
-	int64_t nr_kept = 0;
 	struct stat buf;
 	int update;
 
 	*count = 0;
+	*nr_changed = 0;
 	update = _stats_group_id_present(dms, group_id);
 
 #ifdef BTRFS_SUPER_MAGIC
@@ -4753,9 +4964,9 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 
 	if (update) {
 		group = &dms->groups[group_id];
-		if ((nr_kept = _stats_unmap_regions(dms, group_id, extent_mem,
-						     extents, &old_extents,
-						     count, regroup)) < 0)
+		if (!(kept = _stats_unmap_regions(dms, group_id, extent_mem,
+						  extents, *count, &nr_deleted,
+						  regroup)))
 			goto_out;
 	}
 
@@ -4778,14 +4989,9 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 	 * created regions in the group leader bitmap.
 	 */
 	for (i = 0; i < *count; i++) {
-		if (update) {
-			if ((old_ext = _find_extent((uint64_t) nr_kept,
-						    old_extents,
-						    extents[i].start,
-						    extents[i].len))) {
-				regions[i] = old_ext->id;
-				continue;
-			}
+		if (update && (kept[i] != DM_STATS_REGION_NOT_PRESENT)) {
+			regions[i] = kept[i];
+			continue;
 		}
 		if (!_stats_create_region(dms, regions + i, extents[i].start,
 					  extents[i].len, -1, precise, hist_arg,
@@ -4799,6 +5005,7 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 		log_very_verbose("Created new region mapping " FMTu64 "+" FMTu64
 				 " with region ID " FMTu64, extents[i].start,
 				 extents[i].len, regions[i]);
+		nr_created++;
 
 		if (!*regroup && update) {
 			/* expand group bitmap */
@@ -4817,11 +5024,13 @@ static uint64_t *_stats_map_file_regions(struct dm_stats *dms, int fd,
 	regions[*count] = DM_STATS_REGION_NOT_PRESENT;
 
 	/* Update group leader aux_data for new group members. */
-	if (!*regroup && update)
+	if (!*regroup && update && nr_created)
 		if (!_stats_set_aux(dms, group_id,
 				    dms->regions[group_id].aux_data))
 			log_error("Failed to update group aux_data.");
 
+	*nr_changed = nr_created + nr_deleted;
+
 	if (bounds)
 		dm_free(hist_arg);
 
@@ -4860,7 +5069,7 @@ uint64_t *dm_stats_create_regions_from_fd(struct dm_stats *dms, int fd,
 					  struct dm_histogram *bounds,
 					  const char *alias)
 {
-	uint64_t *regions, count;
+	uint64_t *regions, count, nr_changed;
 	int regroup = 1;
 
 	if (alias && !group) {
@@ -4870,7 +5079,7 @@ uint64_t *dm_stats_create_regions_from_fd(struct dm_stats *dms, int fd,
 
 	if (!(regions = _stats_map_file_regions(dms, fd, bounds, precise,
 						DM_STATS_GROUP_NOT_PRESENT,
-						&count, &regroup)))
+						&count, &regroup, &nr_changed)))
 		return NULL;
 
 	if (!group)
@@ -4895,7 +5104,7 @@ uint64_t *dm_stats_update_regions_from_fd(struct dm_stats *dms, int fd,
 {
 	struct dm_histogram *bounds = NULL;
 	int nr_bins, precise, regroup;
-	uint64_t *regions = NULL, count = 0;
+	uint64_t *regions = NULL, count = 0, nr_changed = 0;
 	const char *alias = NULL;
 
 	if (!dms->regions || !dm_stats_group_present(dms, group_id)) {
@@ -4952,12 +5161,14 @@ uint64_t *dm_stats_update_regions_from_fd(struct dm_stats *dms, int fd,
 	precise = (dms->regions[group_id].timescale == 1);
 
 	regions = _stats_map_file_regions(dms, fd, bounds, precise,
-					  group_id, &count, &regroup);
+					  group_id, &count, &regroup,
+					  &nr_changed);
 
 	if (!regions)
 		goto_out;
 
-	if (!dm_stats_list(dms, NULL))
+	/* The handle is still listed if no region was created or deleted. */
+	if (nr_changed && !dm_stats_list(dms, NULL))
 		goto_bad;
 
 	/* regroup if there are regions to group */
@@ -5146,6 +5357,363 @@ int dm_stats_start_filemapd(int fd, uint64_t group_id, const char *path,
 }
 #endif /* DMFILEMAPD */
 
+/*
+ * Binary stats stream.
+ *
+ * A compact, machine oriented encoding of the per-area counters and
+ * histogram bins of populated handles, one interval after another:
+ *
+ *   stream    := "DMST" version(varint) record*
+ *   interval  := 'I' timestamp_delta(varint) interval_ns(varint)
+ *   device    := 'D' major(varint) minor(varint) name_len(varint) name
+ *   area      := 'A' region_id(varint) area_id(varint)
+ *                counter(zigzag varint) * DM_STATS_NR_COUNTERS
+ *                nr_bins(varint) bin(zigzag varint) * nr_bins
+ *
+ * Varints are unsigned LEB128. Each counter and bin value is written as
+ * the signed difference from the value sent for the same device, region
+ * and area in the previous interval (zero when first seen, or when the
+ * number of bins changes), so steady workloads encode in a few bytes
+ * per area.
+ */
+#define DM_STATS_STREAM_MAGIC "DMST"
+#define DM_STATS_STREAM_VERSION 1
+
+/*
+ * Histogram bounds come from a single @stats_list row and each takes
+ * at least two characters, which limits the bins a region can have.
+ */
+#define DM_STATS_STREAM_MAX_BINS (STATS_ROW_BUF_LEN / 2 + 1)
+
+#define STREAM_REC_INTERVAL 'I'
+#define STREAM_REC_DEVICE 'D'
+#define STREAM_REC_AREA 'A'
+
+struct _stream_key {
+	uint32_t major;
+	uint32_t minor;
+	uint64_t region_id;
+	uint64_t area_id;
+};
+
+struct _stream_area {
+	uint64_t counters[DM_STATS_NR_COUNTERS];
+	int nr_bins;
+	uint64_t *bins;
+};
+
+struct dm_stats_stream {
+	struct dm_hash_table *areas; /* previous values by _stream_key */
+	int started;		/* stream header written or read */
+	uint64_t timestamp_ns;	/* of the last interval record */
+	uint64_t interval_ns;
+	uint32_t major;		/* of the last device record */
+	uint32_t minor;
+	char *name;
+};
+
+struct dm_stats_stream *dm_stats_stream_create(void)
+{
+	struct dm_stats_stream *dss;
+
+	if (!(dss = dm_zalloc(sizeof(*dss)))) {
+		log_error("Could not allocate stats stream.");
+		return NULL;
+	}
+
+	if (!(dss->areas = dm_hash_create(1024))) {
+		dm_free(dss);
+		return_NULL;
+	}
+
+	return dss;
+}
+
+static void _stream_area_free(void *data)
+{
+	struct _stream_area *sa = data;
+
+	dm_free(sa->bins);
+	dm_free(sa);
+}
+
+void dm_stats_stream_destroy(struct dm_stats_stream *dss)
+{
+	if (!dss)
+		return;
+
+	dm_hash_iter(dss->areas, _stream_area_free);
+	dm_hash_destroy(dss->areas);
+	dm_free(dss->name);
+	dm_free(dss);
+}
+
+static struct _stream_area *_stream_get_area(struct dm_stats_stream *dss,
+					     uint64_t region_id,
+					     uint64_t area_id, int nr_bins)
+{
+	struct _stream_key key;
+	struct _stream_area *sa;
+	uint64_t *bins = NULL;
+
+	memset(&key, 0, sizeof(key));
+	key.major = dss->major;
+	key.minor = dss->minor;
+	key.region_id = region_id;
+	key.area_id = area_id;
+
+	if (!(sa = dm_hash_lookup_binary(dss->areas, &key, sizeof(key)))) {
+		if (!(sa = dm_zalloc(sizeof(*sa))))
+			goto_bad;
+		if (!dm_hash_insert_binary(dss->areas, &key, sizeof(key), sa)) {
+			dm_free(sa);
+			goto_bad;
+		}
+	}
+
+	/* a changed histogram layout starts again from zero */
+	if ((nr_bins >= 0) && (sa->nr_bins != nr_bins)) {
+		if (nr_bins && !(bins = dm_zalloc(nr_bins * sizeof(*bins))))
+			goto_bad;
+		dm_free(sa->bins);
+		sa->bins = bins;
+		sa->nr_bins = nr_bins;
+	}
+
+	return sa;
+bad:
+	log_error("Could not allocate stats stream area state.");
+	return NULL;
+}
+
+static int _stream_put(FILE *out, uint64_t v)
+{
+	unsigned char buf[10];
+	size_t len = 0;
+
+	do {
+		buf[len] = v & 0x7f;
+		if ((v >>= 7))
+			buf[len] |= 0x80;
+		len++;
+	} while (v);
+
+	return fwrite(buf, 1, len, out) == len;
+}
+
+/* Write the difference cur - prev, zigzag encoded, and update prev. */
+static int _stream_put_delta(FILE *out, uint64_t *prev, uint64_t cur)
+{
+	int64_t delta = (int64_t) (cur - *prev);
+
+	*prev = cur;
+
+	return _stream_put(out, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+}
+
+static int _stream_get(FILE *in, uint64_t *v)
+{
+	unsigned shift = 0;
+	int c;
+
+	*v = 0;
+	do {
+		if ((shift > 63) || ((c = fgetc(in)) == EOF))
+			return 0;
+		*v |= (uint64_t) (c & 0x7f) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return 1;
+}
+
+static int _stream_get_delta(FILE *in, uint64_t *prev)
+{
+	uint64_t v;
+
+	if (!_stream_get(in, &v))
+		return 0;
+
+	*prev += (uint64_t) ((int64_t) (v >> 1) ^ -(int64_t) (v & 1));
+
+	return 1;
+}
+
+int dm_stats_stream_write(struct dm_stats_stream *dss, FILE *out,
+			  const struct dm_stats *dms, uint64_t timestamp_ns)
+{
+	const char *name = dms->name ? : (dms->bind_name ? : "");
+	const struct dm_stats_counters *area;
+	struct dm_stats_region *region;
+	struct _stream_area *sa;
+	uint64_t i, j, nr_areas;
+	size_t name_len = strlen(name);
+	int c, bin, nr_bins;
+
+	if (!dms->regions) {
+		log_error("Cannot write stats stream for unpopulated handle.");
+		return 0;
+	}
+
+	if (!dss->started) {
+		if ((fwrite(DM_STATS_STREAM_MAGIC, 1, 4, out) != 4) ||
+		    !_stream_put(out, DM_STATS_STREAM_VERSION))
+			goto_bad;
+		dss->started = 1;
+	}
+
+	if ((timestamp_ns != dss->timestamp_ns) ||
+	    (dms->interval_ns != dss->interval_ns)) {
+		if ((fputc(STREAM_REC_INTERVAL, out) == EOF) ||
+		    !_stream_put(out, timestamp_ns - dss->timestamp_ns) ||
+		    !_stream_put(out, dms->interval_ns))
+			goto_bad;
+		dss->timestamp_ns = timestamp_ns;
+		dss->interval_ns = dms->interval_ns;
+	}
+
+	dss->major = (uint32_t) dms->bind_major;
+	dss->minor = (uint32_t) dms->bind_minor;
+	if ((fputc(STREAM_REC_DEVICE, out) == EOF) ||
+	    !_stream_put(out, dss->major) || !_stream_put(out, dss->minor) ||
+	    !_stream_put(out, name_len) ||
+	    (fwrite(name, 1, name_len, out) != name_len))
+		goto_bad;
+
+	for (i = 0; i <= dms->max_region; i++) {
+		region = &dms->regions[i];
+		if (!_stats_region_present(region) || !region->counters)
+			continue;
+
+		nr_areas = _nr_areas_region(region);
+		for (j = 0; j < nr_areas; j++) {
+			area = &region->counters[j];
+			nr_bins = area->histogram ? area->histogram->nr_bins : 0;
+
+			if (!(sa = _stream_get_area(dss, i, j, nr_bins)))
+				return_0;
+
+			if ((fputc(STREAM_REC_AREA, out) == EOF) ||
+			    !_stream_put(out, i) || !_stream_put(out, j))
+				goto_bad;
+
+			for (c = 0; c < DM_STATS_NR_COUNTERS; c++)
+				if (!_stream_put_delta(out, sa->counters + c,
+						       _stats_get_counter(dms, area, c)))
+					goto_bad;
+
+			if (!_stream_put(out, (uint64_t) nr_bins))
+				goto_bad;
+
+			for (bin = 0; bin < nr_bins; bin++)
+				if (!_stream_put_delta(out, sa->bins + bin,
+						       area->histogram->bins[bin].count))
+					goto_bad;
+		}
+	}
+
+	return 1;
+bad:
+	log_error("Failed to write stats stream.");
+	return 0;
+}
+
+int dm_stats_stream_read(struct dm_stats_stream *dss, FILE *in,
+			 struct dm_stats_stream_record *rec)
+{
+	char magic[4];
+	uint64_t v, major, minor, len, region_id, area_id, nr_bins;
+	struct _stream_area *sa;
+	char *name;
+	int c, i;
+
+	if (!dss->started) {
+		if ((fread(magic, 1, sizeof(magic), in) != sizeof(magic)) ||
+		    memcmp(magic, DM_STATS_STREAM_MAGIC, sizeof(magic)) ||
+		    !_stream_get(in, &v)) {
+			log_error("Input is not a stats stream.");
+			return -1;
+		}
+		if (v != DM_STATS_STREAM_VERSION) {
+			log_error("Unsupported stats stream version " FMTu64 ".", v);
+			return -1;
+		}
+		dss->started = 1;
+	}
+
+	while ((c = fgetc(in)) != EOF) {
+		switch (c) {
+		case STREAM_REC_INTERVAL:
+			if (!_stream_get(in, &v) ||
+			    !_stream_get(in, &dss->interval_ns))
+				goto bad;
+			dss->timestamp_ns += v;
+			break;
+		case STREAM_REC_DEVICE:
+			if (!_stream_get(in, &major) || !_stream_get(in, &minor) ||
+			    !_stream_get(in, &len) || (len > DM_NAME_LEN))
+				goto bad;
+			if (!(name = dm_malloc(len + 1))) {
+				log_error("Could not allocate device name.");
+				return -1;
+			}
+			if (fread(name, 1, len, in) != len) {
+				dm_free(name);
+				goto bad;
+			}
+			name[len] = '\0';
+			dm_free(dss->name);
+			dss->name = name;
+			dss->major = (uint32_t) major;
+			dss->minor = (uint32_t) minor;
+			break;
+		case STREAM_REC_AREA:
+			if (!dss->name || !_stream_get(in, &region_id) ||
+			    !_stream_get(in, &area_id))
+				goto bad;
+
+			/* bins are resized once their count has been read */
+			if (!(sa = _stream_get_area(dss, region_id, area_id,
+						    -1)))
+				return -1;
+
+			for (i = 0; i < DM_STATS_NR_COUNTERS; i++)
+				if (!_stream_get_delta(in, sa->counters + i))
+					goto bad;
+
+			if (!_stream_get(in, &nr_bins) || (nr_bins > DM_STATS_STREAM_MAX_BINS))
+				goto bad;
+
+			if (!(sa = _stream_get_area(dss, region_id, area_id,
+						    (int) nr_bins)))
+				return -1;
+
+			for (i = 0; i < (int) nr_bins; i++)
+				if (!_stream_get_delta(in, sa->bins + i))
+					goto bad;
+
+			rec->timestamp_ns = dss->timestamp_ns;
+			rec->interval_ns = dss->interval_ns;
+			rec->major = dss->major;
+			rec->minor = dss->minor;
+			rec->name = dss->name;
+			rec->region_id = region_id;
+			rec->area_id = area_id;
+			memcpy(rec->counters, sa->counters, sizeof(rec->counters));
+			rec->nr_bins = sa->nr_bins;
+			rec->bins = sa->bins;
+			return 1;
+		default:
+			goto bad;
+		}
+	}
+
+	return 0;
+bad:
+	log_error("Malformed or truncated stats stream.");
+	return -1;
+}
+
 /*
  * Backward compatible dm_stats_create_region() implementations.
  *
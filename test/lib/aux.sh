@@ -1551,6 +1551,7 @@ global/detect_internal_vg_cache_corruption = 1
 global/fallback_to_local_locking = 0
 global/etc = "$LVM_SYSTEM_DIR"
 global/locking_type=$LVM_TEST_LOCKING
+global/metadata_check_cache = 0
 global/notify_dbus = 0
 global/si_unit_consistency = 1
 global/thin_check_executable = "$LVM_TEST_THIN_CHECK_CMD"
@@ -0,0 +1 @@
+/root/repo/conf/lvmdbusd.profile
\ No newline at end of file
@@ -0,0 +1,42 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test backup written from the committed metadata text
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 2
+
+aux lvmconf "backup/backup = 1" \
+	    "backup/reuse_committed_text = 1"
+
+lvcreate -an -Zn -l1 -n $lv1 $vg
+
+# backup file has the usual header and the new LV
+grep "description = \"Created \*after\* executing 'lvcreate" "etc/backup/$vg"
+grep "^$lv1 {" "etc/backup/$vg"
+grep "^seqno = " "etc/backup/$vg"
+
+# and is usable for restore
+cp "etc/backup/$vg" saved
+lvremove -f $vg/$lv1
+vgcfgrestore -f saved $vg
+check lv_exists $vg $lv1
+
+# vgcfgbackup has no committed text and formats (indents) the metadata
+vgcfgbackup -f formatted $vg
+grep "$lv1 {" formatted
+not grep "^$lv1 {" formatted
+
+vgremove -ff $vg
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test vgchange --monitor (un)registers all LVs of a VG
+# with dmeventd in one batch request.
+
+SKIP_WITH_LVMPOLLD=1
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_dmeventd
+aux prepare_vg 2
+
+for i in 1 2 3; do
+	lvcreate -L4M -T $vg/pool$i
+done
+
+_batches() {
+	grep -c ">>> CMD:BATCH" debug.log_DMEVENTD_out || true
+}
+
+BEFORE=$(_batches)
+
+vgchange --monitor n $vg
+grep "Sending 3 unregistrations to dmeventd" debug.log
+
+for i in 1 2 3; do
+	check lv_field $vg/pool$i seg_monitor "not monitored"
+done
+
+test "$(_batches)" -eq $(( BEFORE + 1 ))
+
+vgchange --monitor y $vg
+grep "Sending 3 registrations to dmeventd" debug.log
+
+for i in 1 2 3; do
+	check lv_field $vg/pool$i seg_monitor "monitored"
+done
+
+test "$(_batches)" -eq $(( BEFORE + 2 ))
+
+vgremove -ff $vg
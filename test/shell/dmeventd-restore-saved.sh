@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test dmeventd -m restores monitoring of a killed dmeventd -m
+# only for devices lvm2 asked to monitor.
+
+SKIP_WITH_LVMPOLLD=1
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_dmeventd -m
+aux prepare_vg 2
+
+lvcreate -L4M -T $vg/pool
+# Not monitored when created
+lvcreate -L4M -T $vg/pool_ignore --ignoremonitoring
+lvcreate -L4M -T $vg/pool_config --config 'activation/monitoring = 0'
+# Monitoring disabled later
+lvcreate -L4M -T $vg/pool_off
+lvchange --monitor n $vg/pool_off
+
+check lv_field $vg/pool seg_monitor "monitored"
+check lv_field $vg/pool_ignore seg_monitor "not monitored"
+check lv_field $vg/pool_config seg_monitor "not monitored"
+check lv_field $vg/pool_off seg_monitor "not monitored"
+
+# No chance to hand registrations over
+kill -9 "$(< LOCAL_DMEVENTD)"
+rm -f LOCAL_DMEVENTD "$DMEVENTD_PIDFILE"
+
+aux prepare_dmeventd -m
+
+check lv_field $vg/pool seg_monitor "monitored"
+check lv_field $vg/pool_ignore seg_monitor "not monitored"
+check lv_field $vg/pool_config seg_monitor "not monitored"
+check lv_field $vg/pool_off seg_monitor "not monitored"
+
+# Unmonitoring is saved as well
+lvchange --monitor n $vg/pool
+
+kill -9 "$(< LOCAL_DMEVENTD)"
+rm -f LOCAL_DMEVENTD "$DMEVENTD_PIDFILE"
+
+aux prepare_dmeventd -m
+
+check lv_field $vg/pool seg_monitor "not monitored"
+
+vgremove -ff $vg
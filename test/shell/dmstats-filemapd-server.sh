@@ -0,0 +1,120 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test dmfilemapd --server and --client requests
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+which mkfs.xfs || skip
+
+DMFILEMAPD="${abs_top_builddir-}/libdm/dm-tools/dmfilemapd"
+test -x "$DMFILEMAPD" || DMFILEMAPD=$(which dmfilemapd) || skip
+
+# Don't attempt to test stats with driver < 4.33.00
+aux driver_at_least 4 33 || skip
+
+aux prepare_devs 1 2048
+
+mount_dir="$PWD/mnt"
+socket="$PWD/dmfilemapd.socket"
+file="$mount_dir/file"
+link="$mount_dir/link"
+SERVER_PID=
+
+mkdir -p "$mount_dir"
+
+cleanup_server_and_teardown()
+{
+	test -z "$SERVER_PID" || kill "$SERVER_PID" 2>/dev/null || true
+	dmstats delete --allregions --alldevices 2>/dev/null || true
+	umount "$mount_dir" 2>/dev/null || true
+	aux teardown
+}
+
+trap 'cleanup_server_and_teardown' EXIT
+
+client() {
+	"$DMFILEMAPD" --client "$socket" "$@"
+}
+
+nr_regions() {
+	dmstats list --regions --noheadings -o region_id | wc -l
+}
+
+# Append to the file after a spacer so the new data is a new extent,
+# then wait for the server to map it.
+append_and_wait() {
+	local before
+
+	before=$(nr_regions)
+	fallocate -l 4m "$mount_dir/spacer$1"
+	dd if=/dev/zero of="$file" bs=1M count=4 oflag=append conv=notrunc,fsync
+	for i in $(seq 1 50); do
+		test "$(nr_regions)" -gt "$before" && return 0
+		sleep .1
+	done
+	die "Regions of $file were not updated."
+}
+
+mkfs.xfs "$dev1"
+mount "$dev1" "$mount_dir"
+
+fallocate -l 4m "$file"
+ln "$file" "$link"
+dmstats create --nomonitor --filemap "$file"
+group_id=$(dmstats list --group --noheadings -o group_id | tr -d ' ')
+test -n "$group_id"
+
+"$DMFILEMAPD" --server "$socket" 1 3 &
+SERVER_PID=$!
+for i in $(seq 1 50); do
+	test -S "$socket" && break
+	sleep .1
+done
+test -S "$socket"
+
+not client bogus
+not client add "$group_id" inode relative/path
+not client add "$group_id" bogus "$file"
+not client remove "$file"
+
+client add "$group_id" inode "$file"
+not client add "$group_id" inode "$file"
+client list | tee out
+grep "^$group_id inode $file\$" out
+tail -1 out | grep "^OK\$"
+
+append_and_wait 1
+
+# A hard link shares the inotify watch of the file: removing the
+# first monitor must not stop the second one.
+client add "$group_id" path "$link"
+client list | tee out
+grep "^$group_id path $link\$" out
+
+client remove "$file"
+client list | tee out
+not grep "inode $file" out
+append_and_wait 2
+
+client remove "$link"
+client list | tee out
+test "$(wc -l < out)" -eq 1
+not client remove "$link"
+
+kill "$SERVER_PID"
+wait "$SERVER_PID" || true
+SERVER_PID=
+test ! -e "$socket"
@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test released extents are discarded once with devices/issue_discards=1,
+# using a PV on a thin volume, so the discard shows in the pool usage.
+
+SKIP_WITH_LVMPOLLD=1
+SKIP_WITH_LVMLOCKD=1
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_vg 1 64
+aux lvmconf "devices/issue_discards = 1"
+
+lvcreate -L40M -T $vg/pool --discards passdown
+lvcreate -V32M -T $vg/pool -n pv
+dev="$DM_DEV_DIR/$vg/pv"
+
+vgcreate -s 1M ${vg}_1 "$dev"
+
+# Segments of lv1 are not in disk order, but the released extents
+# are adjacent on disk and are discarded as a single range.
+lvcreate -l4 -n lv1 ${vg}_1 "$dev:8-11"
+lvextend -l+4 ${vg}_1/lv1 "$dev:0-3"
+lvextend -l+4 ${vg}_1/lv1 "$dev:4-7"
+
+dd if=/dev/urandom of="$DM_DEV_DIR/${vg}_1/lv1" bs=1M count=12 oflag=direct
+full=$(get lv_field $vg/pool data_percent)
+
+lvremove -f ${vg}_1/lv1
+
+test "$(grep -c "Discarding 12582912 bytes offset" debug.log)" -eq 1
+
+# Discard got through to the pool and released its chunks
+after=$(get lv_field $vg/pool data_percent)
+test "${after%%.*}" -lt "${full%%.*}"
+
+vgremove -ff ${vg}_1
+vgremove -ff $vg
@@ -0,0 +1,55 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Benchmark label scanning of many devices at default verbosity,
+# where debug messages have no consumer and are skipped before
+# their arguments are evaluated.
+#
+# Runs only with LVM_TEST_BENCHMARK set, e.g.:
+#   make check_local LVM_TEST_BENCHMARK=1 T=label-scan-many-devs.sh
+#
+# 300 loop devices with a PV each, 200x 'pvs' (user time):
+#
+#   debug messages always formatted  ~13.9ms per command
+#   debug messages gated in macros   ~12.2ms per command
+#
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+[ -z "$LVM_TEST_BENCHMARK" ] && skip
+
+LVM_TEST_PVS=${LVM_TEST_PVS:-100}
+LVM_TEST_LOOPS=${LVM_TEST_LOOPS:-20}
+
+aux prepare_devs "$LVM_TEST_PVS" 1
+pvcreate "${DEVICES[@]}"
+
+# Test suite logs everything into debug.log, use default log level
+DEFAULT_LOG="log/level=0 log/verbose=0"
+
+START=$(date +%s%N)
+for i in $(seq 1 "$LVM_TEST_LOOPS"); do
+	pvs --config "$DEFAULT_LOG" >/dev/null
+done
+END=$(date +%s%N)
+echo "Default verbosity: $(( (END - START) / LVM_TEST_LOOPS / 1000 ))us per pvs"
+
+START=$(date +%s%N)
+for i in $(seq 1 "$LVM_TEST_LOOPS"); do
+	pvs --config "$DEFAULT_LOG log/flight_recorder_size=0" >/dev/null
+done
+END=$(date +%s%N)
+echo "Without flight recorder: $(( (END - START) / LVM_TEST_LOOPS / 1000 ))us per pvs"
+
+test "$(pvs --config "$DEFAULT_LOG" --noheadings "${DEVICES[@]}" | wc -l)" -eq "$LVM_TEST_PVS"
@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Debug messages without consumer are skipped before their arguments
+# are evaluated, the flight recorder gets only their format
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_devs 1
+pvcreate "$dev1"
+
+FLIGHT="$PWD/flight.log"
+RECORDER="log/flight_recorder_size=4096 log/flight_recorder_file=\"$FLIGHT\""
+
+# Test suite logs everything into debug.log, use default log level
+DEFAULT_LOG="log/level=0 log/verbose=0 $RECORDER"
+
+# Failing command dumps the flight recorder
+not pvs --config "$DEFAULT_LOG" "$dev1" "$DM_DEV_DIR/nonexistent"
+grep "Command pid: %d$" "$FLIGHT"
+not grep "Command pid: [0-9]" "$FLIGHT"
+rm -f "$FLIGHT"
+
+# Debug messages are printed with -vvvv
+not pvs -vvvv --config "$DEFAULT_LOG" "$DM_DEV_DIR/nonexistent" 2>err
+grep "Command pid: [0-9]" err
+grep "Command pid: [0-9]" "$FLIGHT"
+not grep "Command pid: %d" "$FLIGHT"
+rm -f "$FLIGHT"
+
+# Debug messages are logged with log/file set
+not pvs --config "log/level=7 log/verbose=0 log/file=\"$PWD/file.log\" $RECORDER" "$DM_DEV_DIR/nonexistent"
+grep "Command pid: [0-9]" file.log
+grep "Command pid: [0-9]" "$FLIGHT"
+
+# Successful command does not dump
+rm -f "$FLIGHT"
+pvs --config "$DEFAULT_LOG" "$dev1"
+test ! -e "$FLIGHT"
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test activation/lv_state_cache skipping queries of unchanged LVs
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+RUNDIR="/run"
+test -d "$RUNDIR" || RUNDIR="/var/run"
+
+. lib/inittest
+
+aux lvmconf "activation/lv_state_cache = 1"
+
+aux prepare_vg 1
+
+lvcreate -l1 -n $lv1 $vg
+lvcreate -an -l1 -n $lv2 $vg
+
+VGID=$(get vg_field $vg vg_uuid | tr -d -)
+STATE="$RUNDIR/lvm/lv_state/$VGID"
+rm -f "$STATE"
+
+# First command records the state of the active LV
+lvs -o lv_name,lv_active_locally -vvvv $vg 2>&1 | tee out
+grep "Listed as inactive $vg-$lv2" out
+not grep "Cached as active" out
+test -s "$STATE"
+
+# Following command uses it
+lvs -o lv_name,lv_active_locally -vvvv $vg 2>&1 | tee out
+grep "Cached as active $vg-$lv1" out
+check lv_field $vg/$lv1 lv_active_locally "active locally"
+check lv_field $vg/$lv2 lv_active_locally ""
+
+# Changes made by LVM are seen by following commands
+lvchange -ay $vg/$lv2
+check lv_field $vg/$lv2 lv_active_locally "active locally"
+lvchange -an $vg/$lv1
+check lv_field $vg/$lv1 lv_active_locally ""
+lvs -o lv_name,lv_active_locally -vvvv $vg 2>&1 | tee out
+not grep "Cached as active $vg-$lv1" out
+
+# Disabled cache queries every LV
+lvs -o lv_name,lv_active_locally -vvvv --config "activation/lv_state_cache = 0" $vg 2>&1 | tee out
+not grep "Cached as active" out
+not grep "Listed as inactive" out
+
+vgremove -ff $vg
@@ -0,0 +1,59 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Activation of named LVs with metadata/selective_import
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+
+aux prepare_vg 2
+
+aux lvmconf "metadata/selective_import = 1"
+
+for i in 1 2 3 4 5; do
+	lvcreate -an -l1 -n lv$i $vg
+done
+lvcreate -L4M -T $vg/pool
+lvcreate -an -V4M -n thin1 $vg/pool
+lvcreate -an -V4M -n thin2 $vg/pool
+lvcreate -l2 -n origin $vg
+lvcreate -s -l2 -n snap $vg/origin
+lvchange -an $vg
+
+# Linear LV alone
+lvchange -ay -vvvv $vg/lv3 2>&1 | tee out
+grep "Importing 1 of" out
+check active $vg lv3
+check inactive $vg lv2
+
+# Thin LV with its pool, without other thin LVs
+lvchange -ay -vvvv $vg/thin2 2>&1 | tee out
+grep "Importing 4 of" out
+check active $vg thin2
+check inactive $vg thin1
+
+# Origin and snapshot are used by the snapshot segment, whole VG is imported
+lvchange -ay -vvvv $vg/origin 2>&1 | tee out
+grep "Importing all LVs" out
+check active $vg origin
+check active $vg snap
+
+# Writing commands still see the whole VG
+lvchange -an $vg
+lvcreate -an -l1 -n lv6 $vg
+check lv_field $vg/lv6 lv_name lv6
+test "$(get vg_field $vg lv_count)" -eq 11
+
+vgremove -ff $vg
@@ -0,0 +1,73 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# dmeventd runs lvm commands with one lvm2cmd handle in incremental mode,
+# devices added or removed after its first command must be seen by the next
+
+
+SKIP_WITH_LVMPOLLD=1
+
+export LVM_TEST_THIN_REPAIR_CMD=${LVM_TEST_THIN_REPAIR_CMD-/bin/false}
+
+. lib/inittest
+
+wait_for_log_() {
+	for i in $(seq 1 60) ; do
+		grep -q "$1" debug.log_DMEVENTD_out && return 0
+		sleep 1
+	done
+	return 1
+}
+
+aux have_thin 1 10 0 || skip
+
+aux lvmconf "activation/thin_pool_autoextend_percent = 10" \
+	    "activation/thin_pool_autoextend_threshold = 75"
+
+aux prepare_dmeventd
+
+aux prepare_pvs 3 16
+get_devs
+
+vgcreate $SHARED -s 256K "$vg" "$dev1"
+
+lvcreate -L1M -c 64k -T $vg/pool
+lvcreate -V4M $vg/pool -n $lv1
+# No space left for autoextension
+lvcreate -l100%FREE -n filler $vg
+
+# dev3 appears only after the first command of dmeventd
+aux disable_dev "$dev3"
+
+# Cross the threshold, dmeventd fails to extend the pool
+dd if=/dev/zero of="$DM_DEV_DIR/mapper/$vg-$lv1" bs=786432c count=1 conv=fdatasync
+dd if=/dev/zero of="$DM_DEV_DIR/mapper/$vg-$lv1" bs=1c count=1 seek=786433 conv=fdatasync
+wait_for_log_ "Failed command for $vg-pool-tpool" || die "dmeventd did not try to extend pool!"
+check lv_field $vg/pool size "1.00m"
+
+# dev2 disappears and the new dev3 is added to the VG
+aux disable_dev "$dev2"
+aux enable_dev "$dev3"
+vgextend $vg "$dev3"
+
+# dmeventd retries the failing command and uses the new PV
+for i in $(seq 1 60) ; do
+	test "$(get lv_field $vg/pool size)" != "1.00m" && break
+	sleep 1
+done
+
+lvs -a -o+devices $vg
+check lv_on $vg pool_tdata "$dev1" "$dev3"
+
+aux enable_dev "$dev2"
+
+vgremove -f $vg
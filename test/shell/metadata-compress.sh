@@ -0,0 +1,78 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test metadata/compress storing compressed metadata text
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_devs 2
+
+vgcreate $SHARED $vg "$dev1" "$dev2"
+
+aux lvmconf "metadata/compress = 1"
+
+for i in $(seq 1 20); do
+	lvcreate -an -l1 -n lv$i $vg
+done
+
+pvck --dump headers "$dev1" | tee out
+grep "raw_locn\[0\].flags 0x2 # RAW_LOCN_COMPRESSED" out
+# Older versions reject the mda_header instead of reading it as text
+grep "mda_header_1.version 2" out
+
+pvck --dump metadata "$dev1" | tee out
+grep "vgname $vg" out
+grep "lv20 {" out
+
+check lv_exists $vg lv1 lv20
+vgck $vg
+
+# Compressed copies are found by searching the metadata area
+pvck --dump metadata_search "$dev1" | tee out
+grep "seqno 21 .* compressed length" out
+pvck --dump metadata_all -f all "$dev1" | tee out
+grep "seqno 21 .* compressed length" out
+grep "seqno 20 .* compressed length" out
+grep "lv20 {" all
+
+# Compressed metadata is read without the setting
+aux lvmconf "metadata/compress = 0"
+check lv_exists $vg lv1 lv20
+lvremove -f $vg/lv20
+
+pvck --dump headers "$dev1" | tee out
+not grep "RAW_LOCN_COMPRESSED" out
+grep "mda_header_1.version 1" out
+check lv_exists $vg lv1 lv19
+
+# VG metadata profile enables compression for a single VG
+aux profileconf compress_metadata "metadata/compress = 1"
+vgchange --metadataprofile compress_metadata $vg
+check vg_field $vg vg_profile compress_metadata
+
+pvck --dump headers "$dev2" | tee out
+grep "RAW_LOCN_COMPRESSED" out
+
+# Repair writes the decompressed text found in the metadata area
+pvck --dump metadata -f meta "$dev2"
+grep "lv19 {" meta
+dd if=/dev/zero of="$dev2" bs=512 seek=9 count=1 conv=fdatasync
+pvck --repairtype metadata -y -f meta "$dev2"
+pvck --dump headers "$dev2" | tee out
+not grep "RAW_LOCN_COMPRESSED" out
+grep "mda_header_1.version 1" out
+vgck $vg
+check lv_exists $vg lv1 lv19
+
+vgremove -ff $vg
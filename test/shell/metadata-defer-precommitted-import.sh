@@ -0,0 +1,47 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Test precommitted VG is imported from the written metadata when used
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_vg 2
+
+aux lvmconf "metadata/defer_precommitted_import = 1"
+
+# metadata only changes
+lvcreate -an -Zn -l1 -n $lv1 $vg
+lvrename $vg $lv1 $lv2
+lvchange --addtag tag1 $vg/$lv2
+check lv_field $vg/$lv2 lv_tags "tag1"
+
+# activation, suspend and resume use the committed copies
+lvcreate -l1 -n $lv1 $vg
+lvextend -l+1 $vg/$lv1
+check lv_field $vg/$lv1 lv_size "8.00m"
+lvchange -an $vg/$lv1
+
+# same with the backup written from committed text
+aux lvmconf "backup/reuse_committed_text = 1"
+lvextend -l+1 $vg/$lv2
+lvreduce -f -l-1 $vg/$lv1
+grep "^$lv2 {" "etc/backup/$vg"
+
+cp "etc/backup/$vg" saved
+lvremove -f $vg
+vgcfgrestore -f saved $vg
+check lv_field $vg/$lv1 lv_size "4.00m"
+check lv_field $vg/$lv2 lv_size "8.00m"
+
+vgremove -ff $vg
@@ -0,0 +1,66 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Grow the metadata area of a PV in a VG with pvresize --metadatasize
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux prepare_devs 2 32
+
+pvcreate --metadatasize 32k --dataalignment 64k "$dev1" "$dev2"
+vgcreate $SHARED -s 64k $vg "$dev1" "$dev2"
+
+lvcreate -an -l4 -n $lv1 $vg "$dev1"
+lvcreate -l4 -n $lv2 $vg "$dev1"
+echo "data of $lv2" | dd of="$DM_DEV_DIR/$vg/$lv2" oflag=direct conv=sync bs=512 count=1
+
+# Metadata close to the maximum size is warned about
+aux lvmconf "metadata/size_warning_threshold = 5"
+lvcreate -an -l1 -n $lv3 $vg "$dev2" 2>&1 | tee out
+grep "WARNING: VG $vg metadata on .* bytes left" out
+aux lvmconf "metadata/size_warning_threshold = 80"
+
+# First extent is allocated
+not pvresize --metadatasize 256k "$dev1" 2>&1 | tee out
+grep "must be free" out
+check pv_field "$dev1" pe_start 64.00k
+
+lvremove -f $vg/$lv1
+
+PE_COUNT=$(get pv_field "$dev1" pv_pe_count)
+
+pvresize --metadatasize 256k "$dev1"
+check pv_field "$dev1" pe_start 320.00k
+check pv_field "$dev1" pv_mda_size 316.00k
+check pv_field "$dev1" pv_pe_count $(( PE_COUNT - 4 ))
+check pv_field "$dev2" pv_mda_size 60.00k
+check lv_field $vg/$lv2 seg_pe_ranges "$dev1:0-3"
+
+# Data of the active LV stays where it was
+dd if="$DM_DEV_DIR/$vg/$lv2" iflag=direct bs=512 count=1 | grep "data of $lv2"
+lvchange -an $vg/$lv2
+lvchange -ay $vg/$lv2
+dd if="$DM_DEV_DIR/$vg/$lv2" iflag=direct bs=512 count=1 | grep "data of $lv2"
+
+# Grown metadata area keeps working
+for i in $(seq 1 20); do
+	lvcreate -an -l1 -n lv$i $vg
+done
+vgck $vg
+pvck "$dev1"
+
+# Metadata area can only grow
+not pvresize --metadatasize 128k "$dev1"
+
+vgremove -ff $vg
@@ -0,0 +1,98 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Existing snapshots keep running while a new snapshot of the origin
+# is created, only the origin is suspended
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+_write() {
+	echo "$3" | dd of="$DM_DEV_DIR/$vg/$1" bs=512 seek="$2" count=1 conv=sync oflag=direct
+}
+
+_read() {
+	dd if="$DM_DEV_DIR/$vg/$1" bs=512 skip="$2" count=1 iflag=direct 2>/dev/null | tr -d '\0'
+}
+
+_sums() {
+	for i in "$@"; do
+		echo "$i $(md5sum < "$DM_DEV_DIR/$vg/$i")"
+	done
+}
+
+aux prepare_vg 2
+
+lvcreate -L8 -n $lv1 $vg
+_write $lv1 0 "origin"
+
+for i in 1 2 3; do
+	lvcreate -s -L4 -n snap$i $vg/$lv1
+	_write $lv1 $i "origin after snap$i"
+	_write snap$i 10 "snap$i own"
+done
+
+_sums $lv1 snap1 snap2 snap3 > before
+
+lvcreate -s -L4 -n snap4 $vg/$lv1 -vvvv 2>err
+
+# Only the origin was suspended and reloaded
+grep "Not suspending existing snapshots of $vg/$lv1" err
+grep "Suspending $vg-$lv1 (" err
+for i in 1 2 3; do
+	grep "Keeping snapshot $vg/snap$i running" err
+	not grep "Suspending $vg-snap$i[ -]" err
+	not grep "Loading table for $vg-snap$i[ -]" err
+	not grep "Resuming $vg-snap$i[ -]" err
+done
+
+# Data of origin and snapshots is intact
+_sums $lv1 snap1 snap2 snap3 > after
+diff before after
+
+test "$(_read snap4 3)" = "origin after snap3"
+for i in 1 2 3; do
+	test "$(_read snap$i 10)" = "snap$i own"
+	check lv_attr_bit state $vg/snap$i "a"
+done
+
+# Snapshots keep their own data after origin changes
+_write $lv1 20 "origin after snap4"
+test "$(_read $lv1 20)" = "origin after snap4"
+for i in 1 2 3 4; do
+	test "$(_read snap$i 20)" = ""
+done
+test "$(_read snap1 1)" = ""
+test "$(_read snap2 1)" = "origin after snap1"
+
+# Removal of a snapshot suspends all devices as before
+_sums $lv1 snap1 snap3 snap4 > before
+lvremove -f $vg/snap2 -vvvv 2>err
+not grep "Not suspending existing snapshots" err
+_sums $lv1 snap1 snap3 snap4 > after
+diff before after
+
+# Creating a snapshot after removal keeps the remaining ones running
+lvcreate -s -L4 -n snap5 $vg/$lv1 -vvvv 2>err
+grep "Keeping snapshot $vg/snap1 running" err
+not grep "Suspending $vg-snap1[ -]" err
+_sums $lv1 snap1 snap3 snap4 > after
+diff before after
+test "$(_read snap5 20)" = "origin after snap4"
+
+lvremove -f $vg/snap1 $vg/snap3
+grep -v snap1 before | grep -v snap3 > before.rest
+_sums $lv1 snap4 > after.rest
+diff before.rest after.rest
+
+vgremove -ff $vg
@@ -0,0 +1,43 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Suspend devices on the same tree level concurrently
+
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_raid 1 3 0 || skip
+
+aux prepare_vg 3
+
+lvcreate --type raid1 -m2 -l2 -n $lv1 $vg
+aux wait_for_sync $vg $lv1
+echo "data of $lv1" | dd of="$DM_DEV_DIR/$vg/$lv1" oflag=direct conv=sync bs=512 count=1
+
+aux lvmconf "activation/suspend_concurrency = 3"
+
+# Images and metadata devices of the raid LV are suspended together
+lvchange --refresh -vvvv $vg/$lv1 2>&1 | tee out
+grep "Suspending [0-9]* devices with up to 3 at once" out
+
+check lv_field $vg/$lv1 lv_active_locally "active locally"
+not dmsetup info -c -o suspended --noheadings | grep Suspended
+dd if="$DM_DEV_DIR/$vg/$lv1" iflag=direct bs=512 count=1 | grep "data of $lv1"
+
+aux lvmconf "activation/suspend_concurrency = 1"
+
+lvchange --refresh -vvvv $vg/$lv1 2>&1 | tee out
+not grep "devices with up to" out
+dd if="$DM_DEV_DIR/$vg/$lv1" iflag=direct bs=512 count=1 | grep "data of $lv1"
+
+vgremove -ff $vg
@@ -0,0 +1,70 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test thin_check is skipped for unchanged pool metadata
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+aux have_tool_at_least "$LVM_TEST_THIN_CHECK_CMD" 0 3 1 || skip
+
+# Wrapper counting executed checks
+cat > thin_check_wrapper.sh <<EOT
+#!/bin/sh
+echo "\$@" >> "$PWD/CHECKS"
+exec "$LVM_TEST_THIN_CHECK_CMD" "\$@"
+EOT
+chmod +x thin_check_wrapper.sh
+
+aux lvmconf "global/thin_check_executable = \"$PWD/thin_check_wrapper.sh\"" \
+	    "global/metadata_check_cache = 1"
+
+aux prepare_vg 2
+
+lvcreate -T -L10M -V10M -n $lv1 $vg/pool
+lvchange -an $vg
+
+# Check on deactivation is remembered, activation skips it
+rm -f CHECKS
+lvchange -ay $vg/pool
+not test -e CHECKS
+lvchange -an $vg/pool
+test -s CHECKS
+
+# Forced check
+rm -f CHECKS
+lvchange -ay --config 'global/metadata_check_cache = 0' $vg/pool
+test -s CHECKS
+lvchange -an $vg/pool
+
+# New transaction_id is checked on deactivation, then skipped again
+lvchange -ay $vg/$lv1
+lvcreate -s -n snap $vg/$lv1
+rm -f CHECKS
+vgchange -an $vg
+test -s CHECKS
+rm -f CHECKS
+lvchange -ay $vg/pool
+not test -e CHECKS
+lvchange -an $vg/pool
+
+# Changed command line is checked again
+aux lvmconf "global/thin_check_options = [ \"-q\" ]"
+rm -f CHECKS
+lvchange -ay $vg/pool
+test -s CHECKS
+lvchange -an $vg/pool
+
+vgremove -ff $vg
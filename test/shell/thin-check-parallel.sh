@@ -0,0 +1,76 @@
+#!/usr/bin/env bash
+
+# Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+#
+# This copyrighted material is made available to anyone wishing to use,
+# modify, copy, or redistribute it subject to the terms and conditions
+# of the GNU General Public License v.2.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software Foundation,
+# Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+
+# test vgchange -ay checks pool metadata in parallel
+
+SKIP_WITH_LVMLOCKD=1
+SKIP_WITH_LVMPOLLD=1
+
+. lib/inittest
+
+aux have_thin 1 0 0 || skip
+aux have_tool_at_least "$LVM_TEST_THIN_CHECK_CMD" 0 3 1 || skip
+
+# Wrapper logging executed checks, failing the 'bad' pool on request
+cat > thin_check_wrapper.sh <<EOT
+#!/bin/sh
+echo "start \$*" >> "$PWD/CHECKS"
+sleep 1
+echo "end \$*" >> "$PWD/CHECKS"
+case "\$*" in
+*bad_tmeta*) test -e "$PWD/FAIL_BAD" && exit 1 ;;
+esac
+exec "$LVM_TEST_THIN_CHECK_CMD" "\$@"
+EOT
+chmod +x thin_check_wrapper.sh
+
+aux lvmconf "global/thin_check_executable = \"$PWD/thin_check_wrapper.sh\"" \
+	    "global/metadata_check_cache = 0"
+
+aux prepare_vg 2
+
+lvcreate -T -L10M -V10M -n $lv1 $vg/good
+lvcreate -T -L10M -V10M -n $lv2 $vg/bad
+vgchange -an $vg
+
+touch FAIL_BAD
+
+# Failing pool fails vgchange, the other pool is activated
+rm -f CHECKS
+not vgchange -ay $vg 2>err
+grep "bad" err
+check active $vg $lv1
+check inactive $vg $lv2
+
+# Both checks ran at once and only once
+test "$(grep -c "^start" CHECKS)" -eq 2
+head -2 CHECKS | not grep "^end"
+
+vgchange -an $vg
+
+# One at a time gives the same result
+rm -f CHECKS
+not vgchange -ay --config "global/metadata_check_concurrency = 1" $vg
+check active $vg $lv1
+check inactive $vg $lv2
+test "$(grep -c "^start" CHECKS)" -eq 2
+sed -n 2p CHECKS | grep "^end"
+
+vgchange -an $vg
+
+# Fixed pool activates again
+rm -f FAIL_BAD
+vgchange -ay $vg
+check active $vg $lv1
+check active $vg $lv2
+
+vgremove -ff $vg
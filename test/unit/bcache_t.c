@@ -36,6 +36,7 @@ struct mock_engine {
 enum method {
 	E_DESTROY,
 	E_ISSUE,
+	E_ISSUE_WRITEV,
 	E_WAIT,
 	E_MAX_IO
 };
@@ -50,6 +51,8 @@ struct mock_call {
 	block_address b;
 	bool issue_r;
 	bool wait_r;
+	unsigned nr;		/* blocks in a vectored write */
+	unsigned fail_from;	/* first of them to fail */
 };
 
 struct mock_io {
@@ -60,6 +63,9 @@ struct mock_io {
 	void *data;
 	void *context;
 	bool r;
+	void **contexts;
+	unsigned nr;
+	unsigned fail_from;
 };
 
 static const char *_show_method(enum method m)
@@ -69,6 +75,8 @@ static const char *_show_method(enum method m)
 		return "destroy()";
 	case E_ISSUE:
 		return "issue()";
+	case E_ISSUE_WRITEV:
+		return "issue_writev()";
 	case E_WAIT:
 		return "wait()";
 	case E_MAX_IO:
@@ -190,6 +198,24 @@ static void _expect_write_bad_wait(struct mock_engine *e, int di, block_address
 	dm_list_add(&e->expected_calls, &mc->list);
 }
 
+static void _expect_writev(struct mock_engine *e, int di, block_address b,
+			   unsigned nr, unsigned fail_from)
+{
+	struct mock_call *mc = malloc(sizeof(*mc));
+
+	T_ASSERT(mc);
+	mc->m = E_ISSUE_WRITEV;
+	mc->match_args = true;
+	mc->d = DIR_WRITE;
+	mc->di = di;
+	mc->b = b;
+	mc->issue_r = true;
+	mc->wait_r = true;
+	mc->nr = nr;
+	mc->fail_from = fail_from;
+	dm_list_add(&e->expected_calls, &mc->list);
+}
+
 static struct mock_call *_match_pop(struct mock_engine *e, enum method m)
 {
 
@@ -273,6 +299,8 @@ static bool _mock_issue(struct io_engine *e, enum dir d, int di,
 		io->data = data;
 		io->context = context;
 		io->r = wait_r;
+		io->contexts = NULL;
+		io->nr = 0;
 
 		dm_list_add(&me->issued_io, &io->list);
 	}
@@ -280,10 +308,48 @@ static bool _mock_issue(struct io_engine *e, enum dir d, int di,
 	return r;
 }
 
+static bool _mock_issue_writev(struct io_engine *e, int di, sector_t sb, sector_t se,
+			       void **data, void **contexts, unsigned nr)
+{
+	bool r;
+	struct mock_io *io;
+	struct mock_call *mc;
+	struct mock_engine *me = _to_mock(e);
+
+	mc = _match_pop(me, E_ISSUE_WRITEV);
+	T_ASSERT(di == mc->di);
+	T_ASSERT(nr == mc->nr);
+	T_ASSERT(sb == mc->b * me->block_size);
+	T_ASSERT(se == (mc->b + nr) * me->block_size);
+
+	r = mc->issue_r;
+	if (r) {
+		io = malloc(sizeof(*io));
+		if (!io || !(io->contexts = malloc(nr * sizeof(*contexts))))
+			abort();
+
+		io->di = di;
+		io->sb = sb;
+		io->se = se;
+		io->data = data[0];
+		io->context = NULL;
+		io->r = true;
+		io->nr = nr;
+		io->fail_from = mc->fail_from;
+		memcpy(io->contexts, contexts, nr * sizeof(*contexts));
+
+		dm_list_add(&me->issued_io, &io->list);
+	}
+	free(mc);
+
+	return r;
+}
+
 static bool _mock_wait(struct io_engine *e, io_complete_fn fn)
 {
 	struct mock_io *io;
 	struct mock_engine *me = _to_mock(e);
+	unsigned i;
 	_match(me, E_WAIT);
 
 	// FIXME: provide a way to control how many are completed and whether
@@ -291,7 +357,12 @@ static bool _mock_wait(struct io_engine *e, io_complete_fn fn)
 	T_ASSERT(!dm_list_empty(&me->issued_io));
 	io = dm_list_item(me->issued_io.n, struct mock_io);
 	dm_list_del(&io->list);
-	fn(io->context, io->r ? 0 : -EIO);
+	if (io->nr) {
+		for (i = 0; i < io->nr; i++)
+			fn(io->contexts[i], (i < io->fail_from) ? 0 : -EIO);
+		free(io->contexts);
+	} else
+		fn(io->context, io->r ? 0 : -EIO);
 	free(io);
 
 	return true;
@@ -312,6 +383,7 @@ static struct mock_engine *_mock_create(unsigned max_io, sector_t block_size)
 
 	m->e.destroy = _mock_destroy;
 	m->e.issue = _mock_issue;
+	m->e.issue_writev = NULL;	/* tests of coalesced writes enable it */
 	m->e.wait = _mock_wait;
 	m->e.max_io = _mock_max_io;
 
@@ -915,6 +987,93 @@ static void test_abort_only_specific_di(void *context)
 	T_ASSERT(bcache_flush(cache));
 }
 
+static void _dirty_block(struct bcache *cache, int di, block_address i)
+{
+	struct block *b;
+
+	T_ASSERT(bcache_get(cache, di, i, GF_ZERO, &b));
+	bcache_put(b);
+}
+
+static void test_flush_coalesces_contiguous_writes(void *context)
+{
+	struct fixture *f = context;
+	struct mock_engine *me = f->me;
+	struct bcache *cache = f->cache;
+	struct bcache_stats stats;
+	int di1 = 17, di2 = 18;
+
+	me->e.issue_writev = _mock_issue_writev;
+
+	// out of order, with a gap and a second device
+	_dirty_block(cache, di1, 3);
+	_dirty_block(cache, di2, 5);
+	_dirty_block(cache, di1, 0);
+	_dirty_block(cache, di1, 6);
+	_dirty_block(cache, di1, 2);
+	_dirty_block(cache, di2, 4);
+	_dirty_block(cache, di1, 1);
+
+	_expect_writev(me, di1, 0, 4, 4);
+	_expect_write(me, di1, 6);
+	_expect_writev(me, di2, 4, 2, 2);
+	_expect(me, E_WAIT);
+	_expect(me, E_WAIT);
+	_expect(me, E_WAIT);
+
+	T_ASSERT(bcache_flush(cache));
+	_no_outstanding_expectations(me);
+
+	bcache_get_stats(cache, &stats);
+	T_ASSERT_EQUAL(stats.coalesced_writes, 2);
+	T_ASSERT_EQUAL(stats.coalesced_blocks, 6);
+}
+
+static void test_coalesced_write_partial_failure(void *context)
+{
+	struct fixture *f = context;
+	struct mock_engine *me = f->me;
+	struct bcache *cache = f->cache;
+	struct block *b;
+	unsigned i;
+	int di = 17;
+
+	me->e.issue_writev = _mock_issue_writev;
+
+	for (i = 0; i < 4; i++)
+		_dirty_block(cache, di, i);
+
+	// only the first two blocks make it to disk
+	_expect_writev(me, di, 0, 4, 2);
+	_expect(me, E_WAIT);
+	T_ASSERT(!bcache_flush(cache));
+	_no_outstanding_expectations(me);
+
+	// the written blocks are clean, and can be used without io
+	T_ASSERT(bcache_get(cache, di, 0, 0, &b));
+	bcache_put(b);
+	T_ASSERT(bcache_get(cache, di, 1, 0, &b));
+	bcache_put(b);
+
+	// the failed ones are rewritten by the next flush, together
+	_expect_writev(me, di, 2, 2, 2);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_flush(cache));
+	_no_outstanding_expectations(me);
+
+	// a vectored write that cannot be issued fails all its blocks
+	for (i = 0; i < 2; i++)
+		_dirty_block(cache, di, i);
+
+	_expect_writev(me, di, 0, 2, 2);
+	((struct mock_call *) dm_list_last(&me->expected_calls))->issue_r = false;
+	T_ASSERT(!bcache_flush(cache));
+
+	_expect_writev(me, di, 0, 2, 2);
+	_expect(me, E_WAIT);
+	T_ASSERT(bcache_flush(cache));
+}
+
 //----------------------------------------------------------------
 // Chasing a bug reported by dct
 
@@ -1009,6 +1168,9 @@ static struct test_suite *_small_tests(void)
 	T("abort-forces-read", "if a block has been discarded then another read is necc.", test_abort_forces_reread);
 	T("abort-specific-di", "abort doesn't effect other dis", test_abort_only_specific_di);
 
+	T("flush-coalesces-writes", "contiguous dirty blocks are written together", test_flush_coalesces_contiguous_writes);
+	T("coalesced-write-partial-failure", "errors of a coalesced write are per block", test_coalesced_write_partial_failure);
+
 	T("concurrent-reads-after-invalidate", "prefetch should still issue concurrent reads after invalidate",
           test_concurrent_reads_after_invalidate);
 
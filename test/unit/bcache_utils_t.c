@@ -393,6 +393,53 @@ static void _test_set_many_boundaries(void *fixture)
         _set_cycle(fixture, byte(13, 13), byte(23, 13));
 }
 
+// A wrapped metadata text: the end of the area followed by its start.
+static void _test_read_ranges(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct bcache_range ranges[3] = {
+		{ .start = byte(NR_BLOCKS - 3, 100), .len = 3 * T_BLOCK_SIZE - 100 },
+		{ .start = byte(0, 512), .len = T_BLOCK_SIZE },
+		{ .start = byte(20, 7), .len = 5 }
+	};
+	struct bcache_stats stats;
+	uint8_t *buffer, *data;
+	size_t len = 0;
+	unsigned i, j, prefetches;
+
+	for (i = 0; i < 3; i++)
+		len += ranges[i].len;
+
+	T_ASSERT((buffer = malloc(len)));
+
+	T_ASSERT(bcache_read_ranges(f->cache, f->di, ranges, 3, buffer));
+
+	for (data = buffer, i = 0; i < 3; data += ranges[i].len, i++)
+		for (j = 0; j < ranges[i].len; j++)
+			T_ASSERT_EQUAL(data[j], _pattern_at(INIT_PATTERN, ranges[i].start + j));
+
+	// all six blocks are issued before the first wait, if the engine allows
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.range_reads, 1);
+	T_ASSERT(stats.range_waits_avoided < stats.range_prefetches);
+	if (bcache_max_prefetches(f->cache) >= 6) {
+		T_ASSERT_EQUAL(stats.range_prefetches, 6);
+		T_ASSERT(stats.range_waits_avoided);
+	}
+	prefetches = stats.range_prefetches;
+
+	// second read is served from the cache
+	memset(buffer, 0, len);
+	T_ASSERT(bcache_read_ranges(f->cache, f->di, ranges, 3, buffer));
+	T_ASSERT_EQUAL(buffer[len - 1], _pattern_at(INIT_PATTERN, ranges[2].start + ranges[2].len - 1));
+
+	bcache_get_stats(f->cache, &stats);
+	T_ASSERT_EQUAL(stats.range_reads, 2);
+	T_ASSERT_EQUAL(stats.range_prefetches, prefetches);
+
+	free(buffer);
+}
+
 //----------------------------------------------------------------
 
 #define T(path, desc, fn) register_test(ts, "/base/device/bcache/utils/async/" path, desc, fn)
@@ -426,6 +473,8 @@ static struct test_suite *_async_tests(void)
         T("set-within-single-block", "set within single block", _test_set_within_single_block);
         T("set-cross-one-boundary", "set across one boundary", _test_set_cross_one_boundary);
         T("set-many-boundaries", "set many boundaries", _test_set_many_boundaries);
+
+        T("read-ranges", "read several ranges together", _test_read_ranges);
 #undef T
 
         return ts;
@@ -461,6 +510,8 @@ static struct test_suite *_sync_tests(void)
         T("set-within-single-block", "set within single block", _test_set_within_single_block);
         T("set-cross-one-boundary", "set across one boundary", _test_set_cross_one_boundary);
         T("set-many-boundaries", "set many boundaries", _test_set_many_boundaries);
+
+        T("read-ranges", "read several ranges together", _test_read_ranges);
 #undef T
 
         return ts;
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/misc/lvm-compress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+/* Text looking like VG metadata with many LVs */
+static char *_metadata_text(unsigned lvs, uint32_t *size)
+{
+	char *buf, *p;
+	unsigned i;
+
+	T_ASSERT(buf = malloc(lvs * 512 + 64));
+	p = buf + sprintf(buf, "vg {\nid = \"Zz1Yy2-Xx3W-w4Vv-5Uu6-Tt7S-s8Rr-9Qq0Pp\"\nlogical_volumes {\n");
+
+	for (i = 0; i < lvs; i++)
+		p += sprintf(p, "lvol%u {\nid = \"%06u-aB3d-Ef5h-Ij7l-Mn9p-Qr1t-%06u\"\n"
+			     "status = [\"READ\", \"WRITE\", \"VISIBLE\"]\nsegment_count = 1\n"
+			     "segment1 {\nstart_extent = 0\nextent_count = %u\ntype = \"striped\"\n"
+			     "stripes = [\n\"pv0\", %u\n]\n}\n}\n", i, i * 7919, i, i + 1, i * 3);
+
+	p += sprintf(p, "}\n}\n");
+	*size = (uint32_t) (p - buf);
+
+	return buf;
+}
+
+static void _roundtrip(const char *in, uint32_t size, uint32_t *csize)
+{
+	uint32_t bound = lz_compress_bound(size);
+	char *cbuf, *out;
+
+	T_ASSERT(cbuf = malloc(bound));
+	T_ASSERT(out = malloc(size + 1));
+
+	T_ASSERT(*csize = lz_compress(in, size, cbuf, bound));
+	T_ASSERT(*csize <= bound);
+	T_ASSERT_EQUAL(lz_uncompressed_size(cbuf, *csize), size);
+	T_ASSERT(lz_decompress(cbuf, *csize, out, size));
+	T_ASSERT(!memcmp(in, out, size));
+
+	free(out);
+	free(cbuf);
+}
+
+static void test_roundtrip_metadata(void *fixture)
+{
+	uint32_t size, csize;
+	char *text = _metadata_text(10000, &size);
+
+	_roundtrip(text, size, &csize);
+
+	/* Repeated keys and id structure compress well */
+	T_ASSERT(csize * 4 < size);
+
+	free(text);
+}
+
+static void test_roundtrip_small(void *fixture)
+{
+	static const char _text[] = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+	uint32_t csize, i;
+
+	for (i = 1; i < sizeof(_text); i++)
+		_roundtrip(_text, i, &csize);
+}
+
+static void test_roundtrip_random(void *fixture)
+{
+	uint32_t size = 100000, csize, i;
+	char *buf;
+
+	T_ASSERT(buf = malloc(size));
+
+	srand(1);
+	for (i = 0; i < size; i++)
+		buf[i] = (char) rand();
+
+	_roundtrip(buf, size, &csize);
+
+	/* Incompressible data does not fit into a buffer of its size */
+	T_ASSERT(!lz_compress(buf, size, buf + size / 2, size / 2));
+
+	free(buf);
+}
+
+static void test_reject_corrupted(void *fixture)
+{
+	uint32_t size, csize, bound, i;
+	char *text = _metadata_text(100, &size);
+	char *cbuf, *out;
+
+	bound = lz_compress_bound(size);
+	T_ASSERT(cbuf = malloc(bound));
+	T_ASSERT(out = malloc(size));
+	T_ASSERT(csize = lz_compress(text, size, cbuf, bound));
+
+	/* Text is not compressed data */
+	T_ASSERT(!lz_uncompressed_size(text, size));
+
+	/* Wrong expected size */
+	T_ASSERT(!lz_decompress(cbuf, csize, out, size - 1));
+
+	/* Truncated data */
+	for (i = LZ_HEADER_SIZE; i < csize; i += 97)
+		T_ASSERT(!lz_decompress(cbuf, i, out, size));
+
+	/* Damaged data never accesses beyond the buffers */
+	for (i = LZ_HEADER_SIZE; i < csize; i += 13) {
+		cbuf[i] ^= 0x5a;
+		(void) lz_decompress(cbuf, csize, out, size);
+		cbuf[i] ^= 0x5a;
+	}
+
+	T_ASSERT(lz_decompress(cbuf, csize, out, size));
+
+	free(out);
+	free(cbuf);
+	free(text);
+}
+
+static void test_decompress_prefix(void *fixture)
+{
+	uint32_t size, csize, bound;
+	char *text = _metadata_text(100, &size);
+	char *cbuf, *out;
+
+	/* Compressed data followed by other data, like in a metadata area */
+	bound = lz_compress_bound(size);
+	T_ASSERT(cbuf = malloc(bound + 512));
+	T_ASSERT(out = malloc(size));
+	T_ASSERT(csize = lz_compress(text, size, cbuf, bound));
+	memset(cbuf + csize, 'x', 512);
+
+	T_ASSERT(!lz_decompress(cbuf, csize + 512, out, size));
+	T_ASSERT_EQUAL(lz_decompress_prefix(cbuf, csize + 512, out, size), csize);
+	T_ASSERT(!memcmp(text, out, size));
+
+	/* Truncated data */
+	T_ASSERT(!lz_decompress_prefix(cbuf, csize - 1, out, size));
+
+	free(out);
+	free(cbuf);
+	free(text);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/misc/compress/" path, desc, fn)
+
+void compress_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("roundtrip-metadata", "metadata text compresses and decompresses", test_roundtrip_metadata);
+	T("roundtrip-small", "short inputs decompress to the same bytes", test_roundtrip_small);
+	T("roundtrip-random", "incompressible data decompresses to the same bytes", test_roundtrip_random);
+	T("decompress-prefix", "compressed data followed by other data", test_decompress_prefix);
+	T("reject-corrupted", "corrupted compressed data is rejected", test_reject_corrupted);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
@@ -162,6 +162,181 @@ static void test_cascade(void *fixture)
 	dm_config_destroy(t2);
 }
 
+/*
+ * Written metadata may be imported back only when it is used, relying
+ * on the text surviving the round trip through the parser unchanged.
+ * Write trees with random awkward strings with dm_config_write_node(),
+ * which quotes values the same way as the metadata export, and check
+ * what the parser returns.
+ */
+#define RT_ROUNDS 500
+#define RT_VALUES 16
+#define RT_STR_MAX 48
+
+static uint32_t _rt_state = 0x2545f491;
+
+static uint32_t _rt_rand(void)
+{
+	/* xorshift32, reproducible between runs */
+	_rt_state ^= _rt_state << 13;
+	_rt_state ^= _rt_state >> 17;
+	_rt_state ^= _rt_state << 5;
+
+	return _rt_state;
+}
+
+static void _rt_random_str(char *str)
+{
+	static const char _chars[] = "abcxyzABCXYZ0189 -_.+/:@\"\\\n\t#{}[]=,'";
+	unsigned i, len = _rt_rand() % RT_STR_MAX;
+
+	for (i = 0; i < len; i++)
+		str[i] = _chars[_rt_rand() % (sizeof(_chars) - 1)];
+	str[len] = '\0';
+}
+
+static struct dm_config_value *_rt_str_value(struct dm_config_tree *cft, const char *str)
+{
+	struct dm_config_value *cv;
+
+	T_ASSERT((cv = dm_config_create_value(cft)));
+	cv->type = DM_CFG_STRING;
+	T_ASSERT((cv->v.str = dm_pool_strdup(cft->mem, str)));
+
+	return cv;
+}
+
+static void _rt_add_node(struct dm_config_tree *cft, struct dm_config_node *parent,
+			 const char *key, struct dm_config_value *cv)
+{
+	struct dm_config_node *cn;
+
+	T_ASSERT((cn = dm_config_create_node(cft, key)));
+	cn->parent = parent;
+	cn->v = cv;
+	cn->sib = parent->child;
+	parent->child = cn;
+}
+
+static int _rt_putline(const char *line, void *baton)
+{
+	struct dm_pool *mem = baton;
+
+	return dm_pool_grow_object(mem, line, 0) && dm_pool_grow_object(mem, "\n", 1);
+}
+
+static void test_round_trip(void *fixture)
+{
+	struct dm_pool *mem = fixture;
+	struct dm_config_tree *cft, *cft_read;
+	struct dm_config_value *cv;
+	const struct dm_config_value *cv_read;
+	char str[RT_VALUES][RT_STR_MAX];
+	uint64_t num[RT_VALUES];
+	char path[64];
+	char *text;
+	unsigned i, j;
+
+	for (i = 0; i < RT_ROUNDS; i++) {
+		T_ASSERT((cft = dm_config_create()));
+		T_ASSERT((cft->root = dm_config_create_node(cft, "vg")));
+
+		for (j = 0; j < RT_VALUES; j++) {
+			_rt_random_str(str[j]);
+			num[j] = ((uint64_t) _rt_rand() << 32) | _rt_rand();
+			num[j] >>= 1 + _rt_rand() % 63;
+
+			(void) dm_snprintf(path, sizeof(path), "s%u", j);
+			_rt_add_node(cft, cft->root, path, _rt_str_value(cft, str[j]));
+
+			T_ASSERT((cv = dm_config_create_value(cft)));
+			cv->type = DM_CFG_INT;
+			cv->v.i = (int64_t) num[j];
+			(void) dm_snprintf(path, sizeof(path), "n%u", j);
+			_rt_add_node(cft, cft->root, path, cv);
+
+			cv = _rt_str_value(cft, str[j]);
+			cv->next = _rt_str_value(cft, "");
+			(void) dm_snprintf(path, sizeof(path), "l%u", j);
+			_rt_add_node(cft, cft->root, path, cv);
+		}
+
+		T_ASSERT(dm_pool_begin_object(mem, 4096));
+		T_ASSERT(dm_config_write_node(cft->root, _rt_putline, mem));
+		T_ASSERT(dm_pool_grow_object(mem, "\0", 1));
+		T_ASSERT((text = dm_pool_end_object(mem)));
+		dm_config_destroy(cft);
+
+		T_ASSERT((cft_read = dm_config_create()));
+		T_ASSERT(dm_config_parse_without_dup_node_check(cft_read, text, text + strlen(text)));
+
+		for (j = 0; j < RT_VALUES; j++) {
+			(void) dm_snprintf(path, sizeof(path), "vg/s%u", j);
+			T_ASSERT(!strcmp(dm_config_find_str_allow_empty(cft_read->root, path, "-"), str[j]));
+			(void) dm_snprintf(path, sizeof(path), "vg/n%u", j);
+			T_ASSERT_EQUAL((uint64_t) dm_config_find_int64(cft_read->root, path, 0), num[j]);
+			(void) dm_snprintf(path, sizeof(path), "vg/l%u", j);
+			T_ASSERT(dm_config_get_list(cft_read->root, path, &cv_read));
+			T_ASSERT_EQUAL(cv_read->type, DM_CFG_STRING);
+			T_ASSERT(!strcmp(cv_read->v.str, str[j]));
+			T_ASSERT(cv_read->next && (cv_read->next->type == DM_CFG_STRING));
+			T_ASSERT(!*cv_read->next->v.str && !cv_read->next->next);
+		}
+
+		dm_config_destroy(cft_read);
+		dm_pool_free(mem, text);
+	}
+}
+
+static void test_parse_escaped(void *fixture)
+{
+	struct dm_config_tree *cft;
+	const char *text =
+		"quote = \"a\\\"b\"\n"
+		"quotes = \"\\\"\\\"\"\n"
+		"backslash = \"a\\\\b\"\n"
+		"trailing = \"ab\\\\\"\n"
+		"both = \"\\\\\\\"\"\n"
+		"list = [ \"\\\"\", \"\\\\\" ]\n";
+	const struct dm_config_value *cv;
+
+	T_ASSERT((cft = dm_config_from_string(text)));
+
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "quote", ""), "a\"b"));
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "quotes", ""), "\"\""));
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "backslash", ""), "a\\b"));
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "trailing", ""), "ab\\"));
+	T_ASSERT(!strcmp(dm_config_find_str(cft->root, "both", ""), "\\\""));
+
+	T_ASSERT(dm_config_get_list(cft->root, "list", &cv));
+	T_ASSERT(!strcmp(cv->v.str, "\""));
+	T_ASSERT(cv->next && !strcmp(cv->next->v.str, "\\"));
+	T_ASSERT(!cv->next->next);
+
+	dm_config_destroy(cft);
+}
+
+static void test_parse_truncated(void *fixture)
+{
+	static const char *_texts[] = {
+		"vg {\n\tseqno = 15\n",
+		"vg {\n\tid = \"yada",
+		"vg {\n\tid = \"yada\\\"}\n",
+		"vg {\n\tstatus = [\"READ\", \n",
+		"vg {\n\tstatus = [\"READ\"",
+		"vg {\n\tseqno =",
+		"vg {\n\tpv0 {\n\t\tid = \"x\"\n}\n",
+	};
+	struct dm_config_tree *cft;
+	unsigned i;
+
+	for (i = 0; i < DM_ARRAY_SIZE(_texts); i++) {
+		T_ASSERT((cft = dm_config_create()));
+		T_ASSERT(!dm_config_parse(cft, _texts[i], _texts[i] + strlen(_texts[i])));
+		dm_config_destroy(cft);
+	}
+}
+
 #define T(path, desc, fn) register_test(ts, "/metadata/config/" path, desc, fn)
 
 void config_tests(struct dm_list *all_tests)
@@ -175,6 +350,9 @@ void config_tests(struct dm_list *all_tests)
 	T("parse", "parsing various", test_parse);
 	T("clone", "duplicating a config tree", test_clone);
 	T("cascade", "cascade", test_cascade);
+	T("round-trip", "written values parse back unchanged", test_round_trip);
+	T("parse-escaped", "parsing escaped quotes and backslashes", test_parse_escaped);
+	T("parse-truncated", "parsing truncated text fails", test_parse_truncated);
 
 	dm_list_add(all_tests, &ts->list);
 };
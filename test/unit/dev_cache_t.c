@@ -0,0 +1,449 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/datastruct/str_list.h"
+#include "lib/device/dev-cache.h"
+#include "lib/label/label.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------
+
+/*
+ * Events are fed to dev-cache as the udev monitor would deliver them,
+ * with a fake /proc/partitions in the directory given as global/proc.
+ * Device nodes need not exist, dev-cache takes the device numbers
+ * from the events.  The changes are then applied to the devices saved
+ * by incremental label_scan.
+ */
+struct fixture {
+	char dir[64];
+	struct cmd_context *cmd;
+	struct dm_list changes;
+};
+
+static void _write_file(struct fixture *f, const char *name, const char *content)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", f->dir, name);
+	T_ASSERT(fp = fopen(path, "w"));
+	T_ASSERT(fputs(content, fp) >= 0);
+	T_ASSERT(!fclose(fp));
+}
+
+static void _partitions(struct fixture *f, const char *lines)
+{
+	char content[1024];
+
+	snprintf(content, sizeof(content), "major minor  #blocks  name\n\n%s", lines);
+	_write_file(f, "proc/partitions", content);
+}
+
+static void *_fix_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+	char path[PATH_MAX], conf[1024];
+
+	T_ASSERT(f);
+	snprintf(f->dir, sizeof(f->dir), "unit-test-XXXXXX");
+	T_ASSERT(mkdtemp(f->dir));
+
+	snprintf(path, sizeof(path), "%s/proc", f->dir);
+	T_ASSERT(!mkdir(path, 0700));
+	snprintf(path, sizeof(path), "%s/dev", f->dir);
+	T_ASSERT(!mkdir(path, 0700));
+
+	_write_file(f, "proc/devices", "Character devices:\n  1 mem\n\n"
+		    "Block devices:\n  7 loop\n  9 md\n253 device-mapper\n");
+	/* sysfs comes from the real system */
+	snprintf(path, sizeof(path), "%s/proc/mounts", f->dir);
+	T_ASSERT(!symlink("/proc/mounts", path));
+
+	snprintf(conf, sizeof(conf),
+		 "global { proc = \"%s/proc\" }\n"
+		 "devices { dir = \"%s/dev\" scan = [ \"%s/dev\" ]\n"
+		 "  obtain_device_list_from_udev = 0 use_devicesfile = 0 }\n",
+		 f->dir, f->dir, f->dir);
+	_write_file(f, "lvm.conf", conf);
+	_partitions(f, "");
+
+	T_ASSERT(f->cmd = create_toolcontext(0, f->dir, 0, 0, 0, 0));
+	dm_list_init(&f->changes);
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	char cmd[128];
+
+	if (f) {
+		if (f->cmd) {
+			f->cmd->filter = NULL; /* not allocated */
+			destroy_toolcontext(f->cmd);
+		}
+		snprintf(cmd, sizeof(cmd), "rm -rf %s", f->dir);
+		if (system(cmd))
+			fprintf(stderr, "failed to remove %s\n", f->dir);
+		free(f);
+	}
+}
+
+/* Feed one event with the device node and an optional symlink */
+static void _event(struct fixture *f, const char *action, int major, int minor,
+		   const char *node, const char *symlink)
+{
+	struct dm_list names;
+	char path[PATH_MAX];
+
+	dm_list_init(&names);
+
+	snprintf(path, sizeof(path), "%s/dev/%s", f->dir, node);
+	T_ASSERT(str_list_add(f->cmd->mem, &names, dm_pool_strdup(f->cmd->mem, path)));
+	if (symlink) {
+		snprintf(path, sizeof(path), "%s/dev/%s", f->dir, symlink);
+		T_ASSERT(str_list_add(f->cmd->mem, &names, dm_pool_strdup(f->cmd->mem, path)));
+	}
+
+	T_ASSERT(dev_cache_apply_event(f->cmd, action, MKDEV(major, minor), &names, &f->changes));
+}
+
+/* Returns the only change recorded for the device */
+static struct dev_cache_change *_change(struct fixture *f, int major, int minor)
+{
+	struct dev_cache_change *dc, *found = NULL;
+
+	dm_list_iterate_items(dc, &f->changes)
+		if (dc->devt == MKDEV(major, minor)) {
+			T_ASSERT(!found);
+			found = dc;
+		}
+
+	T_ASSERT(found);
+
+	return found;
+}
+
+static void _assert_aliases(struct fixture *f, int major, int minor, unsigned count)
+{
+	struct device *dev;
+
+	T_ASSERT(dev = dev_cache_get_by_devt(f->cmd, MKDEV(major, minor)));
+	T_ASSERT_EQUAL(dm_list_size(&dev->aliases), count);
+}
+
+/* Two devices, known to dev-cache through add events */
+static void _add_two(struct fixture *f)
+{
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     102400 loop1\n");
+	_event(f, "add", 7, 0, "loop0", NULL);
+	_event(f, "add", 7, 1, "loop1", "disk/by-id/loop1");
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+	dm_list_init(&f->changes);
+}
+
+//----------------------------------------------------------------
+
+static void _test_add(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dev_cache_change *dc;
+
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     102400 loop1\n");
+	_event(f, "add", 7, 0, "loop0", NULL);
+	_event(f, "add", 7, 1, "loop1", "disk/by-id/loop1");
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT_EQUAL(dm_list_size(&f->changes), 2);
+	dm_list_iterate_items(dc, &f->changes) {
+		T_ASSERT(dc->added);
+		T_ASSERT(!dc->removed);
+	}
+
+	_assert_aliases(f, 7, 0, 1);
+	_assert_aliases(f, 7, 1, 2);
+}
+
+static void _test_resize(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dev_cache_change *dc;
+
+	_add_two(f);
+
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     204800 loop1\n");
+	_event(f, "change", 7, 1, "loop1", "disk/by-id/loop1");
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT_EQUAL(dm_list_size(&f->changes), 1);
+	dc = _change(f, 7, 1);
+	T_ASSERT(!dc->added);
+	T_ASSERT(!dc->removed);
+
+	/* The same names are not added twice */
+	_assert_aliases(f, 7, 1, 2);
+}
+
+static void _test_remove(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_add_two(f);
+
+	_partitions(f, "   7        1     102400 loop1\n");
+	_event(f, "remove", 7, 0, "loop0", NULL);
+
+	T_ASSERT(_change(f, 7, 0)->removed);
+	_assert_aliases(f, 7, 0, 0);
+	_assert_aliases(f, 7, 1, 2);
+
+	/* A device without aliases is again reported as removed */
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+	T_ASSERT_EQUAL(dm_list_size(&f->changes), 2);
+}
+
+static void _test_readd(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_add_two(f);
+
+	_partitions(f, "   7        1     102400 loop1\n");
+	_event(f, "remove", 7, 0, "loop0", NULL);
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+	dm_list_init(&f->changes);
+
+	_partitions(f, "   7        0      51200 loop0\n"
+		       "   7        1     102400 loop1\n");
+	_event(f, "add", 7, 0, "loop0", NULL);
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT_EQUAL(dm_list_size(&f->changes), 1);
+	T_ASSERT(_change(f, 7, 0)->added);
+	_assert_aliases(f, 7, 0, 1);
+}
+
+static void _test_lost_remove(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct dev_cache_change *dc;
+
+	_add_two(f);
+
+	/* The remove event for loop1 was lost */
+	_partitions(f, "   7        0     102400 loop0\n");
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT_EQUAL(dm_list_size(&f->changes), 1);
+	dc = _change(f, 7, 1);
+	T_ASSERT(!dc->added);
+	T_ASSERT(dc->removed);
+}
+
+static void _test_lost_add(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_add_two(f);
+
+	/* The add event for loop2 was lost, all devices must be listed again */
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     102400 loop1\n"
+		       "   7        2     102400 loop2\n");
+	T_ASSERT(!dev_cache_check_partitions(f->cmd, &f->changes));
+
+	/* Lost add after a remove of the same device */
+	_add_two(f);
+	_partitions(f, "   7        1     102400 loop1\n");
+	_event(f, "remove", 7, 0, "loop0", NULL);
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     102400 loop1\n");
+	T_ASSERT(!dev_cache_check_partitions(f->cmd, &f->changes));
+}
+
+/*
+ * Saved devices of incremental label_scan updated with the changes,
+ * the fake filter rejects devices with minor 9.
+ */
+static int _passes_filter(struct cmd_context *cmd, struct dev_filter *f,
+			  struct device *dev, const char *use_filter_name)
+{
+	return MINOR(dev->dev) != 9;
+}
+
+static void _wipe(struct cmd_context *cmd, struct dev_filter *f,
+		  struct device *dev, const char *use_filter_name)
+{
+}
+
+static struct dev_filter _filter = {
+	.passes_filter = _passes_filter,
+	.wipe = _wipe,
+	.name = "unit-test",
+};
+
+static int _saved(struct fixture *f, int major, int minor)
+{
+	unsigned i;
+
+	for (i = 0; i < f->cmd->incremental_devs->count; i++)
+		if (f->cmd->incremental_devs->devs[i] == MKDEV(major, minor))
+			return 1;
+
+	return 0;
+}
+
+/* Saves loop0 and loop1 as the devices of a full label_scan */
+static void _save_two(struct fixture *f)
+{
+	struct device_list devl[2];
+	struct dm_list devs;
+
+	_add_two(f);
+
+	dm_list_init(&devs);
+	T_ASSERT(devl[0].dev = dev_cache_get_by_devt(f->cmd, MKDEV(7, 0)));
+	T_ASSERT(devl[1].dev = dev_cache_get_by_devt(f->cmd, MKDEV(7, 1)));
+	dm_list_add(&devs, &devl[0].list);
+	dm_list_add(&devs, &devl[1].list);
+
+	label_scan_incremental_save(f->cmd, 1, 1, &devs);
+	T_ASSERT(f->cmd->incremental_devs);
+	T_ASSERT_EQUAL(f->cmd->incremental_devs->count, 2);
+
+	f->cmd->filter = &_filter;
+}
+
+static void _test_saved_update(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_save_two(f);
+
+	/* loop0 removed, loop1 resized, loop2 added, loop9 added but filtered */
+	_partitions(f, "   7        1     204800 loop1\n"
+		       "   7        2     102400 loop2\n"
+		       "   7        9     102400 loop9\n");
+	_event(f, "remove", 7, 0, "loop0", NULL);
+	_event(f, "change", 7, 1, "loop1", "disk/by-id/loop1");
+	_event(f, "add", 7, 2, "loop2", NULL);
+	_event(f, "add", 7, 9, "loop9", NULL);
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT(label_scan_incremental_update(f->cmd, 2, &f->changes));
+
+	T_ASSERT_EQUAL(f->cmd->incremental_devs->token, 2);
+	T_ASSERT_EQUAL(f->cmd->incremental_devs->count, 2);
+	T_ASSERT(!_saved(f, 7, 0));
+	T_ASSERT(_saved(f, 7, 1));
+	T_ASSERT(_saved(f, 7, 2));
+	T_ASSERT(!_saved(f, 7, 9));
+}
+
+static void _test_saved_stacked(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	_save_two(f);
+
+	/* A new dm device may hide its components, filter all again */
+	_partitions(f, "   7        0     102400 loop0\n"
+		       "   7        1     102400 loop1\n"
+		       " 253        0     102400 dm-0\n");
+	_event(f, "add", 253, 0, "dm-0", "mapper/vg-lv");
+	T_ASSERT(dev_cache_check_partitions(f->cmd, &f->changes));
+
+	T_ASSERT(!label_scan_incremental_update(f->cmd, 2, &f->changes));
+}
+
+/*
+ * Without the udev monitor, saved devices are reused only while
+ * /proc/partitions stays the same.
+ */
+static uint32_t _token(struct fixture *f, const char *lines)
+{
+	uint32_t token, devices_file_token;
+
+	_partitions(f, lines);
+	T_ASSERT(label_scan_incremental_token(f->cmd, &token, &devices_file_token));
+
+	return token;
+}
+
+static void _test_token(void *fixture)
+{
+	struct fixture *f = fixture;
+	const char *two = "   7        0     102400 loop0\n"
+			  "   7        1     102400 loop1\n";
+	uint32_t token = _token(f, two);
+
+	T_ASSERT_EQUAL(_token(f, two), token);
+
+	/* added */
+	T_ASSERT(_token(f, "   7        0     102400 loop0\n"
+			  "   7        1     102400 loop1\n"
+			  "   7        2     102400 loop2\n") != token);
+	/* removed */
+	T_ASSERT(_token(f, "   7        0     102400 loop0\n") != token);
+	/* resized */
+	T_ASSERT(_token(f, "   7        0     102400 loop0\n"
+			  "   7        1     102401 loop1\n") != token);
+	/* replaced by another device with the same name */
+	T_ASSERT(_token(f, "   7        0     102400 loop0\n"
+			  "   7        3     102400 loop1\n") != token);
+
+	T_ASSERT_EQUAL(_token(f, two), token);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/device/dev-cache/events/" path, desc, fn)
+
+static struct test_suite *_tests(void)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("add", "add events insert devices with all names", _test_add);
+	T("resize", "change event reports a resized device", _test_resize);
+	T("remove", "remove event drops device names", _test_remove);
+	T("readd", "device added again after remove", _test_readd);
+	T("lost-remove", "device missing in partitions is reported removed", _test_lost_remove);
+	T("lost-add", "device unknown to dev-cache needs full listing", _test_lost_add);
+	T("saved-update", "saved devices of label scan follow the changes", _test_saved_update);
+	T("token", "partitions token changes with devices and sizes", _test_token);
+	T("saved-stacked", "added dm device needs filtering of all devices", _test_saved_stacked);
+
+	return ts;
+}
+
+void dev_cache_tests(struct dm_list *all_tests)
+{
+	dm_list_add(all_tests, &_tests()->list);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/device/device.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+/* Only the addresses are used, ranges are grouped by device pointer */
+static struct device _devs[2];
+
+static void _range(struct dev_discard_range *r, struct device *dev,
+		   uint64_t offset, uint64_t size)
+{
+	memset(r, 0, sizeof(*r));
+	r->dev = dev;
+	r->offset_bytes = offset;
+	r->size_bytes = size;
+}
+
+static void _assert_range(struct dev_discard_range *r, struct device *dev,
+			  uint64_t offset, uint64_t size)
+{
+	T_ASSERT(r->dev == dev);
+	T_ASSERT_EQUAL(r->offset_bytes, offset);
+	T_ASSERT_EQUAL(r->size_bytes, size);
+}
+
+static void test_merge_empty(void *fixture)
+{
+	struct dev_discard_range r[1];
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 0), 0);
+}
+
+static void test_merge_sorted(void *fixture)
+{
+	struct dev_discard_range r[3];
+
+	_range(&r[0], &_devs[0], 4096, 1024);
+	_range(&r[1], &_devs[0], 0, 1024);
+	_range(&r[2], &_devs[0], 2048, 1024);
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 3), 3);
+	_assert_range(&r[0], &_devs[0], 0, 1024);
+	_assert_range(&r[1], &_devs[0], 2048, 1024);
+	_assert_range(&r[2], &_devs[0], 4096, 1024);
+}
+
+static void test_merge_adjacent(void *fixture)
+{
+	struct dev_discard_range r[4];
+
+	/* Released extents 2, 0, 3 and 1 make one range */
+	_range(&r[0], &_devs[0], 2048, 1024);
+	_range(&r[1], &_devs[0], 0, 1024);
+	_range(&r[2], &_devs[0], 3072, 1024);
+	_range(&r[3], &_devs[0], 1024, 1024);
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 4), 1);
+	_assert_range(&r[0], &_devs[0], 0, 4096);
+}
+
+static void test_merge_overlapping(void *fixture)
+{
+	struct dev_discard_range r[4];
+
+	_range(&r[0], &_devs[0], 0, 2048);
+	_range(&r[1], &_devs[0], 1024, 2048);
+	/* Contained in the range before */
+	_range(&r[2], &_devs[0], 1024, 512);
+	/* Same offset as the first one */
+	_range(&r[3], &_devs[0], 0, 512);
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 4), 1);
+	_assert_range(&r[0], &_devs[0], 0, 3072);
+}
+
+static void test_merge_gap(void *fixture)
+{
+	struct dev_discard_range r[3];
+
+	_range(&r[0], &_devs[0], 0, 1024);
+	_range(&r[1], &_devs[0], 1024, 1024);
+	_range(&r[2], &_devs[0], 2049, 1024);
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 3), 2);
+	_assert_range(&r[0], &_devs[0], 0, 2048);
+	_assert_range(&r[1], &_devs[0], 2049, 1024);
+}
+
+static void test_merge_devices(void *fixture)
+{
+	struct dev_discard_range r[5];
+
+	/* Same offsets on two devices are never merged together */
+	_range(&r[0], &_devs[1], 1024, 1024);
+	_range(&r[1], &_devs[0], 0, 1024);
+	_range(&r[2], &_devs[1], 0, 1024);
+	_range(&r[3], &_devs[0], 1024, 1024);
+	_range(&r[4], &_devs[1], 4096, 1024);
+
+	T_ASSERT_EQUAL(dev_discard_ranges_merge(r, 5), 3);
+	_assert_range(&r[0], &_devs[0], 0, 2048);
+	_assert_range(&r[1], &_devs[1], 0, 2048);
+	_assert_range(&r[2], &_devs[1], 4096, 1024);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/device/dev-io/" path, desc, fn)
+
+void dev_io_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("discard-merge-empty", "no ranges to discard", test_merge_empty);
+	T("discard-merge-sorted", "discard ranges are sorted by offset", test_merge_sorted);
+	T("discard-merge-adjacent", "adjacent discard ranges are merged", test_merge_adjacent);
+	T("discard-merge-overlapping", "overlapping discard ranges are merged", test_merge_overlapping);
+	T("discard-merge-gap", "discard ranges with a gap stay separate", test_merge_gap);
+	T("discard-merge-devices", "discard ranges on other devices stay separate", test_merge_devices);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
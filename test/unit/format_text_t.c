@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/misc/crc.h"
+#include "lib/commands/toolcontext.h"
+#include "lib/format_text/format-text.h"
+#include "lib/format_text/import-export.h"
+#include "lib/metadata/metadata.h"
+#include "libdaemon/client/config-util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------
+
+/*
+ * A VG is imported from canned metadata without any devices, exported
+ * with the metadata exporter and imported back from the written text
+ * as metadata/defer_precommitted_import does on first use.
+ */
+struct fixture {
+	char dir[64];
+	struct cmd_context *cmd;
+};
+
+static const char _metadata[] =
+	"vg {\n"
+	"	id = \"Zc8Pnq-Q7Um-Vsyu-Zu5E-r0dD-Jz1C-pVxqNe\"\n"
+	"	seqno = 3\n"
+	"	format = \"lvm2\"\n"
+	"	status = [\"RESIZEABLE\", \"READ\", \"WRITE\"]\n"
+	"	flags = []\n"
+	"	extent_size = 8192\n"
+	"	max_lv = 0\n"
+	"	max_pv = 0\n"
+	"	metadata_copies = 0\n"
+	"	physical_volumes {\n"
+	"		pv0 {\n"
+	"			id = \"kHYqNt-Wd1w-2lLC-Tb7D-Kx1k-6bNo-mEAf3o\"\n"
+	"			device = \"/dev/unit-test-pv\"\n"
+	"			status = [\"ALLOCATABLE\"]\n"
+	"			flags = []\n"
+	"			dev_size = 2097152\n"
+	"			pe_start = 2048\n"
+	"			pe_count = 255\n"
+	"		}\n"
+	"	}\n"
+	"	logical_volumes {\n"
+	"		lv {\n"
+	"			id = \"3tHgSx-7wIX-G1sJ-oPHv-Wf2H-Hb7L-dR5zLk\"\n"
+	"			status = [\"READ\", \"WRITE\", \"VISIBLE\"]\n"
+	"			flags = []\n"
+	"			creation_time = 1700000000\n"
+	"			creation_host = \"unit-test-host\"\n"
+	"			segment_count = 1\n"
+	"			segment1 {\n"
+	"				start_extent = 0\n"
+	"				extent_count = 16\n"
+	"				type = \"striped\"\n"
+	"				stripe_count = 1\n"
+	"				stripes = [\"pv0\", 0]\n"
+	"			}\n"
+	"		}\n"
+	"	}\n"
+	"}\n"
+	"contents = \"Text Format Volume Group\"\n"
+	"version = 1\n"
+	"description = \"\"\n"
+	"creation_host = \"host\"\n"
+	"creation_time = 1700000000\n";
+
+static void *_fix_init(void)
+{
+	struct fixture *f = zalloc(sizeof(*f));
+	char path[PATH_MAX], conf[1024];
+	FILE *fp;
+
+	T_ASSERT(f);
+	snprintf(f->dir, sizeof(f->dir), "unit-test-XXXXXX");
+	T_ASSERT(mkdtemp(f->dir));
+
+	snprintf(path, sizeof(path), "%s/dev", f->dir);
+	T_ASSERT(!mkdir(path, 0700));
+
+	/* No devices are scanned */
+	snprintf(conf, sizeof(conf),
+		 "devices { dir = \"%s/dev\" scan = [ \"%s/dev\" ]\n"
+		 "  obtain_device_list_from_udev = 0 use_devicesfile = 0 }\n",
+		 f->dir, f->dir);
+	snprintf(path, sizeof(path), "%s/lvm.conf", f->dir);
+	T_ASSERT(fp = fopen(path, "w"));
+	T_ASSERT(fputs(conf, fp) >= 0);
+	T_ASSERT(!fclose(fp));
+
+	T_ASSERT(f->cmd = create_toolcontext(0, f->dir, 0, 0, 0, 0));
+
+	return f;
+}
+
+static void _fix_exit(void *fixture)
+{
+	struct fixture *f = fixture;
+	char cmd[128];
+
+	if (f) {
+		if (f->cmd)
+			destroy_toolcontext(f->cmd);
+		snprintf(cmd, sizeof(cmd), "rm -rf %s", f->dir);
+		if (system(cmd))
+			fprintf(stderr, "failed to remove %s\n", f->dir);
+		free(f);
+	}
+}
+
+static struct volume_group *_import_vg(struct cmd_context *cmd)
+{
+	struct text_context tc = { .path_live = "/dev/null" };
+	struct format_instance_ctx fic = { .type = FMT_INSTANCE_PRIVATE_MDAS,
+					   .context.private = &tc };
+	struct format_instance *fid;
+	struct dm_config_tree *cft;
+	struct volume_group *vg;
+
+	T_ASSERT(fid = cmd->fmt->ops->create_instance(cmd->fmt, &fic));
+	T_ASSERT(cft = config_tree_from_string_without_dup_node_check(_metadata));
+	T_ASSERT(vg = import_vg_from_config_tree(cmd, fid, cft));
+	dm_config_destroy(cft);
+
+	return vg;
+}
+
+//----------------------------------------------------------------
+
+static void test_deferred_import(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct volume_group *vg = _import_vg(f->cmd);
+	struct logical_volume *lv;
+	char *buf;
+	uint32_t size, crc;
+
+	T_ASSERT(size = (uint32_t) text_vg_export_raw(vg, "unit test", &buf, NULL, NULL));
+	crc = calc_crc(INITIAL_CRC, (uint8_t *) buf, size);
+
+	T_ASSERT(text_vg_defer_import(vg, buf, size, crc));
+	T_ASSERT(!vg->vg_precommitted);
+	T_ASSERT(text_vg_import_deferred(vg));
+
+	T_ASSERT(vg->vg_precommitted);
+	T_ASSERT(!vg->precommitted_deferred);
+	T_ASSERT(!strcmp(vg->vg_precommitted->name, "vg"));
+	T_ASSERT_EQUAL(vg->vg_precommitted->seqno, 3);
+	T_ASSERT(lv = find_lv(vg->vg_precommitted, "lv"));
+	T_ASSERT_EQUAL(lv->le_count, 16);
+	T_ASSERT(!strcmp(lv->hostname, "unit-test-host"));
+
+	release_vg(vg);
+}
+
+static void test_deferred_import_changed(void *fixture)
+{
+	struct fixture *f = fixture;
+	struct volume_group *vg = _import_vg(f->cmd);
+	uint32_t size, crc, pos[3];
+	char *buf;
+	unsigned i;
+
+	T_ASSERT(size = (uint32_t) text_vg_export_raw(vg, "unit test", &buf, NULL, NULL));
+	crc = calc_crc(INITIAL_CRC, (uint8_t *) buf, size);
+
+	pos[0] = 0;
+	pos[1] = size / 2;
+	pos[2] = size - 2;	/* Last character before the terminating NUL */
+
+	for (i = 0; i < DM_ARRAY_SIZE(pos); i++) {
+		T_ASSERT(text_vg_defer_import(vg, buf, size, crc));
+		buf[pos[i]] ^= 1;
+		T_ASSERT(!text_vg_import_deferred(vg));
+		T_ASSERT(!vg->vg_precommitted);
+		T_ASSERT(!vg->precommitted_deferred);
+		buf[pos[i]] ^= 1;
+	}
+
+	/* Restored text is imported */
+	T_ASSERT(text_vg_defer_import(vg, buf, size, crc));
+	T_ASSERT(text_vg_import_deferred(vg));
+	T_ASSERT(vg->vg_precommitted);
+
+	release_vg(vg);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/metadata/format-text/" path, desc, fn)
+
+void format_text_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("deferred-import", "exported VG is imported from the written text", test_deferred_import);
+	T("deferred-import-changed", "changed written text is refused", test_deferred_import_changed);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
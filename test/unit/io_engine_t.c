@@ -202,6 +202,44 @@ static void _test_write_bytes(void *fixture)
 	f->e = NULL;   // already destroyed
 }
 
+static void _test_flush_coalesced(void *fixture)
+{
+	struct fixture *f = fixture;
+
+	size_t block_size = SECTOR_SIZE * BLOCK_SIZE_SECTORS;
+	/* blocks 0-3 and 5-6 are written as two runs, block 4 stays zeroed */
+	static const unsigned _blocks[] = { 2, 0, 3, 1, 6, 5 };
+	uint8_t *buf = malloc(block_size);
+	unsigned i;
+	struct bcache *cache = bcache_create(PAGE_SIZE_SECTORS, BLOCK_SIZE_SECTORS, f->e);
+	T_ASSERT(cache);
+	T_ASSERT(buf);
+
+	T_ASSERT(!ftruncate(f->fd, 8 * block_size));
+	f->di = bcache_set_fd(f->fd);
+	T_ASSERT(f->di >= 0);
+
+	for (i = 0; i < DM_ARRAY_SIZE(_blocks); i++) {
+		_fill_buffer(buf, _blocks[i], block_size);
+		T_ASSERT(bcache_write_bytes(cache, f->di, _blocks[i] * block_size, block_size, buf));
+	}
+
+	T_ASSERT(bcache_flush(cache));
+
+	for (i = 0; i < DM_ARRAY_SIZE(_blocks); i++) {
+		T_ASSERT_EQUAL(pread(f->fd, buf, block_size, _blocks[i] * block_size), (ssize_t) block_size);
+		_check_buffer(buf, _blocks[i], block_size);
+	}
+
+	T_ASSERT_EQUAL(pread(f->fd, buf, block_size, 4 * block_size), (ssize_t) block_size);
+	for (i = 0; i < block_size; i++)
+		T_ASSERT_EQUAL(buf[i], 0);
+
+	free(buf);
+	bcache_destroy(cache);
+	f->e = NULL;   // already destroyed
+}
+
 //----------------------------------------------------------------
 
 #define T(path, desc, fn) register_test(ts, "/base/device/bcache/io-engine/" path, desc, fn)
@@ -218,6 +256,7 @@ static struct test_suite *_tests(void)
         T("read", "read sanity check", _test_read);
         T("write", "write sanity check", _test_write);
         T("bcache-write-bytes", "test the utility fns", _test_write_bytes);
+        T("bcache-flush-coalesced", "coalesced dirty blocks reach the disk", _test_flush_coalesced);
 
         return ts;
 }
@@ -0,0 +1,337 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------
+
+/* Longer than the string arguments kept by the ring */
+#define LOG_RING_MAX_STR_TEST 300
+
+static void _record(const char *format, ...)
+	__attribute__ ((format(printf, 1, 2)));
+
+static void _record(const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	log_ring_record(7, __FILE__, __LINE__, format, ap);
+	va_end(ap);
+}
+
+/* Returns dumped content, caller frees */
+static char *_dump(void)
+{
+	FILE *fp;
+	long len;
+	char *buf;
+
+	T_ASSERT(fp = tmpfile());
+	T_ASSERT(log_ring_dump(fileno(fp)));
+
+	len = lseek(fileno(fp), 0, SEEK_END);
+	T_ASSERT(len >= 0);
+	T_ASSERT(buf = malloc(len + 1));
+
+	T_ASSERT_EQUAL(pread(fileno(fp), buf, len, 0), len);
+	buf[len] = 0;
+	fclose(fp);
+
+	return buf;
+}
+
+static void *_fixture_init(void)
+{
+	return NULL;
+}
+
+static void _fixture_exit(void *fixture)
+{
+	fin_log_ring();
+}
+
+//----------------------------------------------------------------
+
+static void test_disabled(void *fixture)
+{
+	char *buf;
+
+	init_log_ring(0, NULL);
+	_record("not recorded %d", 1);
+
+	buf = _dump();
+	T_ASSERT_EQUAL(buf[0], 0);
+	free(buf);
+}
+
+static void test_formatting(void *fixture)
+{
+	const char *vg_name = "vg";
+	char *buf;
+
+	init_log_ring(4096, NULL);
+	_record("Reading %s %-4s|%5.2f %llu %zu %hhd %c %%%x %*d %.*s %p",
+		vg_name, "ab", 1.5, 123456789012ULL, (size_t) 42,
+		(signed char) -1, 'z', 255U, 3, 7, 2, "xyz", NULL);
+
+	/* Argument changes after recording are not visible */
+	vg_name = "other";
+
+	buf = _dump();
+	T_ASSERT(strstr(buf, "Reading vg ab  | 1.50 123456789012 42 -1 z %ff   7 xy (nil)\n"));
+	T_ASSERT(strstr(buf, "log_ring_t.c:"));
+	free(buf);
+}
+
+static void test_format_only(void *fixture)
+{
+	char *buf;
+
+	init_log_ring(4096, NULL);
+	T_ASSERT_EQUAL(log_ring_active, 1);
+	log_ring_record_format(7, __FILE__, __LINE__, "Skipped %s %d");
+	_record("Recorded %s %d", "vg", 1);
+
+	/* Arguments of gated messages are never evaluated */
+	buf = _dump();
+	T_ASSERT(strstr(buf, "  Skipped %s %d\n"));
+	T_ASSERT(strstr(buf, "  Recorded vg 1\n"));
+	free(buf);
+
+	init_log_ring(0, NULL);
+	T_ASSERT_EQUAL(log_ring_active, 0);
+}
+
+static void test_long_string(void *fixture)
+{
+	char str[1024], *buf;
+
+	memset(str, 'a', sizeof(str) - 1);
+	str[sizeof(str) - 1] = 0;
+
+	init_log_ring(8192, NULL);
+	_record("%s|%d", str, 5);
+
+	buf = _dump();
+	/* Strings are truncated */
+	T_ASSERT(strstr(buf, "aaaa|5\n"));
+	T_ASSERT(!strstr(buf, str));
+	free(buf);
+}
+
+static void test_precision(void *fixture)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	char *map, *str, *buf;
+
+	/* Unterminated string right before an inaccessible page */
+	T_ASSERT(page > 0);
+	T_ASSERT((map = mmap(NULL, page * 2, PROT_READ | PROT_WRITE,
+			     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) != MAP_FAILED);
+	T_ASSERT(!mprotect(map + page, page, PROT_NONE));
+	str = map + page - 6;
+	memcpy(str, "abcdef", 6);
+
+	init_log_ring(4096, NULL);
+	_record("%.*s|%.6s|%.3s|%-8.2s|", 4, str, str, str, str);
+
+	buf = _dump();
+	T_ASSERT(strstr(buf, "abcd|abcdef|abc|ab      |\n"));
+	free(buf);
+
+	T_ASSERT(!munmap(map, page * 2));
+}
+
+/* Returns content of file, caller frees */
+static char *_read_file(const char *path)
+{
+	char *buf;
+	int fd;
+	ssize_t len;
+
+	T_ASSERT((fd = open(path, O_RDONLY)) >= 0);
+	T_ASSERT(buf = malloc(65536));
+	T_ASSERT((len = read(fd, buf, 65535)) >= 0);
+	buf[len] = 0;
+	close(fd);
+
+	return buf;
+}
+
+/* Runs fn in a child process with dumps to file, returns wait status */
+static int _run_child(const char *path, void (*fn)(void))
+{
+	int status;
+	pid_t pid;
+
+	T_ASSERT((pid = fork()) >= 0);
+
+	if (!pid) {
+		init_log_ring(4096, path);
+		log_ring_catch_signals();
+		fn();
+		_exit(0);
+	}
+
+	T_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+
+	return status;
+}
+
+static void _abort_child(void)
+{
+	_record("before abort %s %d %u %x %c %.2s %p %lld", "str", -12, 4000000000U,
+		255, 'q', "xyz", (void *) 0x10, -1234567890123LL);
+	abort();
+}
+
+static void _usr2_child(void)
+{
+	_record("first %d", 1);
+	raise(SIGUSR2);
+	_record("second %d", 2);
+}
+
+static void test_fatal_signal(void *fixture)
+{
+	char path[] = "/tmp/log_ring_t_XXXXXX", *buf;
+	int fd, status;
+
+	T_ASSERT((fd = mkstemp(path)) >= 0);
+	close(fd);
+
+	status = _run_child(path, _abort_child);
+	T_ASSERT(WIFSIGNALED(status));
+	T_ASSERT_EQUAL(WTERMSIG(status), SIGABRT);
+
+	/* Dumped with the async-signal-safe formatter */
+	buf = _read_file(path);
+	T_ASSERT(strstr(buf, ": fatal signal 6 ---\n"));
+	T_ASSERT(strstr(buf, "log_ring_t.c:"));
+	T_ASSERT(strstr(buf, "before abort str -12 4000000000 ff q xy 0x10 -1234567890123\n"));
+	free(buf);
+
+	unlink(path);
+}
+
+static void test_dump_request(void *fixture)
+{
+	char path[] = "/tmp/log_ring_t_XXXXXX", *buf;
+	int fd, status;
+
+	T_ASSERT((fd = mkstemp(path)) >= 0);
+	close(fd);
+
+	status = _run_child(path, _usr2_child);
+	T_ASSERT(WIFEXITED(status));
+	T_ASSERT_EQUAL(WEXITSTATUS(status), 0);
+
+	/* Dumped on the next record, which is not in the dump yet */
+	buf = _read_file(path);
+	T_ASSERT(strstr(buf, ": dump requested ---\n"));
+	T_ASSERT(strstr(buf, "first 1\n"));
+	T_ASSERT(!strstr(buf, "second 2"));
+	free(buf);
+
+	unlink(path);
+}
+
+static void test_wrap(void *fixture)
+{
+	char *buf, expect[32];
+	unsigned i;
+
+	init_log_ring(1024, NULL);
+
+	for (i = 0; i < 1000; i++)
+		_record("message %u %s", i, (i & 1) ? "odd" : "even number");
+
+	buf = _dump();
+
+	/* Oldest messages are dropped, newest are kept in order */
+	T_ASSERT(!strstr(buf, "message 0 even"));
+	T_ASSERT(strstr(buf, "message 998 even number\n"));
+	T_ASSERT(strstr(buf, "message 999 odd\n"));
+	T_ASSERT(strstr(buf, "message 998") < strstr(buf, "message 999"));
+
+	for (i = 990; i < 1000; i++) {
+		snprintf(expect, sizeof(expect), "message %u ", i);
+		T_ASSERT(strstr(buf, expect));
+	}
+
+	free(buf);
+}
+
+static void test_tiny_ring(void *fixture)
+{
+	char str[LOG_RING_MAX_STR_TEST], *buf;
+	unsigned i;
+
+	memset(str, 'b', sizeof(str) - 1);
+	str[sizeof(str) - 1] = 0;
+
+	/* Rounded up to fit the longest record */
+	init_log_ring(16, NULL);
+
+	for (i = 0; i < 10; i++) {
+		/* Truncated to the maximal record size */
+		_record("%s%s%s%s%s%s%s%s%s", str, str, str, str, str, str, str, str, str);
+		_record("short %u", i);
+	}
+
+	buf = _dump();
+	/* Last long record is kept with its truncated arguments */
+	str[LOG_RING_MAX_STR_TEST - 45] = 0;
+	T_ASSERT(strstr(buf, str));
+	T_ASSERT(strstr(buf, "short 8\n") < strstr(buf, "short 9\n"));
+	T_ASSERT(!strstr(buf, "short 0\n"));
+	free(buf);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/log/ring/" path, desc, fn)
+
+void log_ring_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fixture_init, _fixture_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("disabled", "nothing recorded without ring", test_disabled);
+	T("formatting", "recorded arguments are formatted on dump", test_formatting);
+	T("format-only", "gated messages are recorded by their format", test_format_only);
+	T("long-string", "long string arguments are truncated", test_long_string);
+	T("precision", "string precision limits the copied bytes", test_precision);
+	T("fatal-signal", "ring is dumped on fatal signal", test_fatal_signal);
+	T("dump-request", "SIGUSR2 dumps the ring with the next record", test_dump_request);
+	T("wrap", "oldest records are dropped", test_wrap);
+	T("tiny-ring", "ring smaller than a record is enlarged", test_tiny_ring);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
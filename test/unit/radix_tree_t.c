@@ -492,6 +492,58 @@ static void test_iterate_vary_middle(void *fixture)
 	}
 }
 
+struct order_visitor {
+	struct radix_tree_iterator it;
+	unsigned count;
+	uint64_t last;
+	bool in_order;
+};
+
+static bool _visit_order(struct radix_tree_iterator *it,
+                         uint8_t *kb, uint8_t *ke, union radix_value v)
+{
+	struct order_visitor *vt = container_of(it, struct order_visitor, it);
+
+	if (vt->count && (v.n <= vt->last))
+		vt->in_order = false;
+
+	vt->last = v.n;
+	vt->count++;
+	return true;
+}
+
+static void test_iterate_in_order(void *fixture)
+{
+	struct radix_tree *rt = fixture;
+	unsigned i;
+	uint8_t k[4];
+	union radix_value v;
+	struct order_visitor vt;
+
+	// the value is the big endian key, so should be visited ascending
+	for (i = 0; i < 100000; i++) {
+        	_gen_key(k, k + sizeof(k));
+		v.n = ((uint64_t) k[0] << 24) | (k[1] << 16) | (k[2] << 8) | k[3];
+		T_ASSERT(radix_tree_insert(rt, k, k + sizeof(k), v));
+	}
+
+	T_ASSERT(radix_tree_is_well_formed(rt));
+	vt.count = 0;
+	vt.last = 0;
+	vt.in_order = true;
+	vt.it.visit = _visit_order;
+	radix_tree_iterate(rt, NULL, NULL, &vt.it);
+	T_ASSERT_EQUAL(vt.count, radix_tree_size(rt));
+	T_ASSERT(vt.in_order);
+
+	// and within a prefix
+	vt.count = 0;
+	vt.in_order = true;
+	k[0] = 21;
+	radix_tree_iterate(rt, k, k + 1, &vt.it);
+	T_ASSERT(vt.in_order);
+}
+
 //----------------------------------------------------------------
 
 #define DTR_COUNT 100
@@ -841,6 +893,7 @@ void radix_tree_tests(struct dm_list *all_tests)
 	T("iterate-subset", "iterate a subset of entries in tree", test_iterate_subset);
 	T("iterate-single", "iterate a subset that contains a single entry", test_iterate_single);
 	T("iterate-vary-middle", "iterate keys that vary in the middle", test_iterate_vary_middle);
+	T("iterate-in-order", "iteration visits keys in lexicographical order", test_iterate_in_order);
 	T("remove-calls-dtr", "remove should call the dtr for the value", test_remove_calls_dtr);
 	T("destroy-calls-dtr", "destroy should call the dtr for all values", test_destroy_calls_dtr);
 	T("bcache-scenario", "A specific series of keys from a bcache scenario", test_bcache_scenario);
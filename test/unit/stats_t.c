@@ -0,0 +1,578 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * The stats code is only part of libdm, so it is built into this file
+ * to reach the message parsers: handles are populated from canned
+ * @stats_list and @stats_print responses instead of the kernel.
+ */
+#undef GNU_SYMVER
+#include "libdm/libdm-stats.c"
+
+#include "units.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------
+
+/* libdm functions not provided by device_mapper */
+
+void *dm_malloc_wrapper(size_t s, const char *file, int line)
+{
+	return malloc(s);
+}
+
+void *dm_zalloc_wrapper(size_t s, const char *file, int line)
+{
+	return calloc(1, s);
+}
+
+char *dm_strdup_wrapper(const char *s, const char *file, int line)
+{
+	return strdup(s);
+}
+
+void dm_free_wrapper(void *ptr)
+{
+	free(ptr);
+}
+
+int dm_message_supports_precise_timestamps(void)
+{
+	return 0;
+}
+
+//----------------------------------------------------------------
+
+/* Malformed streams are expected, keep their errors quiet */
+__attribute__ ((format(printf, 5, 6)))
+static void _log(int level, const char *file, int line,
+		 int dm_errno_or_class, const char *f, ...)
+{
+}
+
+static void *_fix_init(void)
+{
+	dm_log_with_errno_init(_log);
+
+	return NULL;
+}
+
+static void _fix_exit(void *fixture)
+{
+	dm_log_with_errno_init(NULL);
+}
+
+//----------------------------------------------------------------
+
+#define MAX_RECORDS 16
+#define MAX_TEST_BINS 8
+
+/* Region 0 has two areas with a histogram, region 1 has none */
+static const char _list[] =
+	"0: 0+2048 1024 test - histogram:10,20\n"
+	"1: 4096+1024 1024 test -\n";
+
+static const char *_print1[] = {
+	"0+1024 1 0 8 3 2 0 16 5 0 8 8 3 5 4:5:6\n"
+	"1024+1024 10 2 80 30 20 1 160 50 1 80 81 30 50 0:0:300\n",
+	"4096+1024 100 0 800 300 0 0 0 0 0 300 300 300 0\n"
+};
+
+/* Counters grow, one bin drops when a region was cleared */
+static const char *_print2[] = {
+	"0+1024 3 0 24 9 2 0 16 5 0 14 14 9 5 6:5:6\n"
+	"1024+1024 1000 200 8000 3000 2000 100 16000 5000 0 8000 8100 3000 5000 70000:0:1\n",
+	"4096+1024 100 0 800 300 0 0 0 0 0 300 300 300 0\n"
+};
+
+/* Region 0 histogram gets another boundary, region 1 gets one */
+static const char _list_layout[] =
+	"0: 0+2048 1024 test - histogram:10,20,30\n"
+	"1: 4096+1024 1024 test - histogram:5\n";
+
+static const char *_print_layout[] = {
+	"0+1024 4 0 32 12 2 0 16 5 0 16 16 12 5 1:2:3:4\n"
+	"1024+1024 1001 200 8008 3003 2000 100 16000 5000 0 8003 8103 3003 5000 7:8:9:10\n",
+	"4096+1024 101 0 808 303 0 0 0 0 0 303 303 303 0 99:2\n"
+};
+
+struct record {
+	uint64_t timestamp_ns;
+	uint64_t region_id;
+	uint64_t area_id;
+	uint64_t counters[DM_STATS_NR_COUNTERS];
+	int nr_bins;
+	uint64_t bins[MAX_TEST_BINS];
+};
+
+struct stream {
+	char *buf;
+	size_t size;
+	struct record expected[MAX_RECORDS];
+	unsigned nr_expected;
+};
+
+static struct dm_stats *_stats(const char *list, const char **print)
+{
+	struct dm_stats *dms;
+	uint64_t i;
+
+	T_ASSERT(dms = dm_stats_create("test"));
+	T_ASSERT(dm_stats_bind_devno(dms, 253, 4));
+	T_ASSERT(dms->name = dm_strdup("vg-lv"));
+	dms->interval_ns = 1000000000;
+
+	T_ASSERT(_stats_parse_list(dms, list));
+	for (i = 0; i <= dms->max_region; i++)
+		T_ASSERT(_dm_stats_populate_region(dms, i, print[i]));
+
+	return dms;
+}
+
+/* Remember the values of dms as written at timestamp_ns */
+static void _expect(struct stream *s, const struct dm_stats *dms, uint64_t timestamp_ns)
+{
+	const struct dm_stats_counters *area;
+	struct record *rec;
+	uint64_t i, j;
+	int c, bin;
+
+	for (i = 0; i <= dms->max_region; i++) {
+		if (!_stats_region_present(&dms->regions[i]))
+			continue;
+
+		for (j = 0; j < _nr_areas_region(&dms->regions[i]); j++) {
+			T_ASSERT(s->nr_expected < MAX_RECORDS);
+			rec = &s->expected[s->nr_expected++];
+			area = &dms->regions[i].counters[j];
+
+			rec->timestamp_ns = timestamp_ns;
+			rec->region_id = i;
+			rec->area_id = j;
+			for (c = 0; c < DM_STATS_NR_COUNTERS; c++)
+				rec->counters[c] = _stats_get_counter(dms, area, c);
+			rec->nr_bins = area->histogram ? area->histogram->nr_bins : 0;
+			T_ASSERT(rec->nr_bins <= MAX_TEST_BINS);
+			for (bin = 0; bin < rec->nr_bins; bin++)
+				rec->bins[bin] = area->histogram->bins[bin].count;
+		}
+	}
+}
+
+/* Write two intervals, the second one from list2/print2 */
+static void _write(struct stream *s, const char *list2, const char **print2)
+{
+	struct dm_stats_stream *dss;
+	struct dm_stats *dms;
+	FILE *out;
+
+	memset(s, 0, sizeof(*s));
+	T_ASSERT(out = open_memstream(&s->buf, &s->size));
+	T_ASSERT(dss = dm_stats_stream_create());
+
+	dms = _stats(_list, _print1);
+	T_ASSERT(dm_stats_stream_write(dss, out, dms, 1000));
+	_expect(s, dms, 1000);
+	dm_stats_destroy(dms);
+
+	dms = _stats(list2, print2);
+	T_ASSERT(dm_stats_stream_write(dss, out, dms, 2000000001000));
+	_expect(s, dms, 2000000001000);
+	dm_stats_destroy(dms);
+
+	dm_stats_stream_destroy(dss);
+	T_ASSERT(!fclose(out));
+}
+
+static void _assert_record(const struct dm_stats_stream_record *rec,
+			   const struct record *expected)
+{
+	int c, bin;
+
+	T_ASSERT_EQUAL(rec->timestamp_ns, expected->timestamp_ns);
+	T_ASSERT_EQUAL(rec->interval_ns, 1000000000);
+	T_ASSERT_EQUAL(rec->major, 253);
+	T_ASSERT_EQUAL(rec->minor, 4);
+	T_ASSERT(!strcmp(rec->name, "vg-lv"));
+	T_ASSERT_EQUAL(rec->region_id, expected->region_id);
+	T_ASSERT_EQUAL(rec->area_id, expected->area_id);
+
+	for (c = 0; c < DM_STATS_NR_COUNTERS; c++)
+		T_ASSERT_EQUAL(rec->counters[c], expected->counters[c]);
+
+	T_ASSERT_EQUAL(rec->nr_bins, expected->nr_bins);
+	for (bin = 0; bin < rec->nr_bins; bin++)
+		T_ASSERT_EQUAL(rec->bins[bin], expected->bins[bin]);
+}
+
+/*
+ * Read the first size bytes of the stream, checking each record.
+ * Returns the result of the first read not returning a record.
+ */
+static int _read(struct stream *s, size_t size, unsigned *nr_read)
+{
+	struct dm_stats_stream_record rec;
+	struct dm_stats_stream *dss;
+	FILE *in;
+	int r;
+
+	T_ASSERT(in = fmemopen(s->buf, size, "r"));
+	T_ASSERT(dss = dm_stats_stream_create());
+
+	for (*nr_read = 0; (r = dm_stats_stream_read(dss, in, &rec)) == 1; (*nr_read)++) {
+		T_ASSERT(*nr_read < s->nr_expected);
+		_assert_record(&rec, &s->expected[*nr_read]);
+	}
+
+	dm_stats_stream_destroy(dss);
+	fclose(in);
+
+	return r;
+}
+
+static void test_stream_roundtrip(void *fixture)
+{
+	struct stream s;
+	unsigned nr_read;
+
+	_write(&s, _list, _print2);
+	T_ASSERT_EQUAL(s.nr_expected, 6);
+
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), 0);
+	T_ASSERT_EQUAL(nr_read, s.nr_expected);
+
+	free(s.buf);
+}
+
+static void test_stream_unchanged(void *fixture)
+{
+	struct stream s;
+	unsigned nr_read;
+
+	/* Same values again encode as zero deltas */
+	_write(&s, _list, _print1);
+
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), 0);
+	T_ASSERT_EQUAL(nr_read, s.nr_expected);
+
+	free(s.buf);
+}
+
+static void test_stream_layout_change(void *fixture)
+{
+	struct stream s;
+	unsigned nr_read;
+
+	_write(&s, _list_layout, _print_layout);
+	T_ASSERT_EQUAL(s.expected[3].nr_bins, 4);
+	T_ASSERT_EQUAL(s.expected[5].nr_bins, 2);
+
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), 0);
+	T_ASSERT_EQUAL(nr_read, s.nr_expected);
+
+	free(s.buf);
+}
+
+static void test_stream_truncated(void *fixture)
+{
+	struct stream s;
+	unsigned nr_read;
+	size_t size;
+	int r;
+
+	_write(&s, _list, _print2);
+
+	/* Records read before the cut are intact, a cut record fails */
+	for (size = 0; size < s.size; size++) {
+		r = _read(&s, size, &nr_read);
+		T_ASSERT(r == 0 || r == -1);
+		T_ASSERT(nr_read < s.nr_expected);
+	}
+
+	T_ASSERT_EQUAL(_read(&s, s.size - 1, &nr_read), -1);
+	T_ASSERT_EQUAL(nr_read, s.nr_expected - 1);
+
+	T_ASSERT_EQUAL(_read(&s, 3, &nr_read), -1);
+	T_ASSERT_EQUAL(nr_read, 0);
+
+	free(s.buf);
+}
+
+static void test_stream_bad_magic(void *fixture)
+{
+	struct stream s;
+	unsigned nr_read;
+
+	_write(&s, _list, _print2);
+
+	s.buf[0] = 'X';
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), -1);
+	T_ASSERT_EQUAL(nr_read, 0);
+
+	/* Unknown version */
+	s.buf[0] = 'D';
+	s.buf[4] = DM_STATS_STREAM_VERSION + 1;
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), -1);
+	T_ASSERT_EQUAL(nr_read, 0);
+
+	/* Unknown record type */
+	s.buf[4] = DM_STATS_STREAM_VERSION;
+	s.buf[5] = 'Z';
+	T_ASSERT_EQUAL(_read(&s, s.size, &nr_read), -1);
+	T_ASSERT_EQUAL(nr_read, 0);
+
+	free(s.buf);
+}
+
+/* A single area record claiming nr_bins zero bins */
+static int _read_bins(uint64_t nr_bins)
+{
+	struct dm_stats_stream_record rec;
+	struct dm_stats_stream *dss;
+	char *buf;
+	size_t size;
+	FILE *f;
+	int r;
+
+	T_ASSERT(f = open_memstream(&buf, &size));
+	T_ASSERT(fwrite("DMST\001D\375\001\004\000A", 1, 11, f) == 11);
+	T_ASSERT(_stream_put(f, 0) && _stream_put(f, 0));
+	for (r = 0; r < DM_STATS_NR_COUNTERS; r++)
+		T_ASSERT(_stream_put(f, 0));
+	T_ASSERT(_stream_put(f, nr_bins));
+	for (r = 0; r < DM_STATS_STREAM_MAX_BINS + 1; r++)
+		T_ASSERT(_stream_put(f, 0));
+	T_ASSERT(!fclose(f));
+
+	T_ASSERT(f = fmemopen(buf, size, "r"));
+	T_ASSERT(dss = dm_stats_stream_create());
+	r = dm_stats_stream_read(dss, f, &rec);
+	if (r == 1)
+		T_ASSERT_EQUAL(rec.nr_bins, (int) nr_bins);
+	dm_stats_stream_destroy(dss);
+	fclose(f);
+	free(buf);
+
+	return r;
+}
+
+static void test_stream_max_bins(void *fixture)
+{
+	T_ASSERT_EQUAL(_read_bins(DM_STATS_STREAM_MAX_BINS), 1);
+	T_ASSERT_EQUAL(_read_bins(DM_STATS_STREAM_MAX_BINS + 1), -1);
+	T_ASSERT_EQUAL(_read_bins(INT_MAX), -1);
+	T_ASSERT_EQUAL(_read_bins(UINT64_MAX), -1);
+}
+
+//----------------------------------------------------------------
+
+#define MAX_EXTENTS 8
+
+struct diff {
+	struct _extent old_extents[MAX_EXTENTS];
+	struct _extent new_extents[MAX_EXTENTS];
+	uint64_t kept[MAX_EXTENTS];
+	uint64_t nr_deleted;
+};
+
+/* Extent start, len and the region_id mapping it */
+#define E(s, l, r) { .start = (s), .len = (l), .id = (r) }
+
+static void _diff(struct diff *d, const struct _extent *old_extents, uint64_t nr_old,
+		  const struct _extent *extents, uint64_t count)
+{
+	T_ASSERT(nr_old <= MAX_EXTENTS);
+	T_ASSERT(count <= MAX_EXTENTS);
+
+	memset(d, 0, sizeof(*d));
+	if (nr_old)
+		memcpy(d->old_extents, old_extents, nr_old * sizeof(*old_extents));
+	d->nr_deleted = _stats_diff_extents(d->old_extents, nr_old, extents,
+					    d->new_extents, count, d->kept);
+}
+
+static void test_diff_unchanged(void *fixture)
+{
+	static const struct _extent _old[] = { E(0, 8, 3), E(16, 8, 5), E(64, 32, 4) };
+	static const struct _extent _new[] = { E(64, 32, 0), E(0, 8, 0), E(16, 8, 0) };
+	struct diff d;
+
+	_diff(&d, _old, 3, _new, 3);
+	T_ASSERT_EQUAL(d.nr_deleted, 0);
+	T_ASSERT_EQUAL(d.kept[0], 4);
+	T_ASSERT_EQUAL(d.kept[1], 3);
+	T_ASSERT_EQUAL(d.kept[2], 5);
+}
+
+static void test_diff_insert(void *fixture)
+{
+	static const struct _extent _old[] = { E(16, 8, 5), E(0, 8, 3) };
+	static const struct _extent _new[] = { E(0, 8, 0), E(8, 8, 0), E(16, 8, 0), E(128, 8, 0) };
+	struct diff d;
+
+	_diff(&d, _old, 2, _new, 4);
+	T_ASSERT_EQUAL(d.nr_deleted, 0);
+	T_ASSERT_EQUAL(d.kept[0], 3);
+	T_ASSERT_EQUAL(d.kept[1], DM_STATS_REGION_NOT_PRESENT);
+	T_ASSERT_EQUAL(d.kept[2], 5);
+	T_ASSERT_EQUAL(d.kept[3], DM_STATS_REGION_NOT_PRESENT);
+}
+
+static void test_diff_remove(void *fixture)
+{
+	static const struct _extent _old[] = { E(0, 8, 1), E(8, 8, 2), E(16, 8, 3), E(32, 8, 7) };
+	static const struct _extent _new[] = { E(16, 8, 0), E(0, 8, 0) };
+	struct diff d;
+
+	_diff(&d, _old, 4, _new, 2);
+	T_ASSERT_EQUAL(d.nr_deleted, 2);
+	T_ASSERT_EQUAL(d.old_extents[0].id, 2);
+	T_ASSERT_EQUAL(d.old_extents[1].id, 7);
+	T_ASSERT_EQUAL(d.kept[0], 3);
+	T_ASSERT_EQUAL(d.kept[1], 1);
+}
+
+static void test_diff_shift(void *fixture)
+{
+	/* Moved or resized extents need new regions */
+	static const struct _extent _old[] = { E(0, 8, 1), E(8, 8, 2), E(24, 8, 3) };
+	static const struct _extent _new[] = { E(4, 8, 0), E(8, 16, 0), E(24, 8, 0) };
+	struct diff d;
+
+	_diff(&d, _old, 3, _new, 3);
+	T_ASSERT_EQUAL(d.nr_deleted, 2);
+	T_ASSERT_EQUAL(d.old_extents[0].id, 1);
+	T_ASSERT_EQUAL(d.old_extents[1].id, 2);
+	T_ASSERT_EQUAL(d.kept[0], DM_STATS_REGION_NOT_PRESENT);
+	T_ASSERT_EQUAL(d.kept[1], DM_STATS_REGION_NOT_PRESENT);
+	T_ASSERT_EQUAL(d.kept[2], 3);
+}
+
+static void test_diff_empty(void *fixture)
+{
+	static const struct _extent _old[] = { E(0, 8, 1), E(8, 8, 2) };
+	struct diff d;
+
+	/* File truncated */
+	_diff(&d, _old, 2, NULL, 0);
+	T_ASSERT_EQUAL(d.nr_deleted, 2);
+
+	/* No regions mapped yet */
+	_diff(&d, NULL, 0, _old, 2);
+	T_ASSERT_EQUAL(d.nr_deleted, 0);
+	T_ASSERT_EQUAL(d.kept[0], DM_STATS_REGION_NOT_PRESENT);
+	T_ASSERT_EQUAL(d.kept[1], DM_STATS_REGION_NOT_PRESENT);
+}
+
+//----------------------------------------------------------------
+
+#define MS 1000000ULL
+
+static void test_histogram_percentile(void *fixture)
+{
+	static const uint64_t _upper[] = { 10 * MS, 20 * MS, 30 * MS, UINT64_MAX };
+	static const uint64_t _counts[] = { 50, 30, 15, 5 };
+	struct dm_histogram *dmh;
+	int bin;
+
+	T_ASSERT(dmh = _alloc_dm_histogram(4));
+	dmh->nr_bins = 4;
+	for (bin = 0; bin < dmh->nr_bins; bin++)
+		dmh->bins[bin].upper = _upper[bin];
+
+	/* No observations */
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 50.0), 0);
+
+	for (bin = 0; bin < dmh->nr_bins; bin++)
+		dmh->bins[bin].count = _counts[bin];
+
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 1.0), 10 * MS);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 50.0), 10 * MS);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 50.5), 20 * MS);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 80.0), 20 * MS);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 95.0), 30 * MS);
+	/* Final bin is unbounded, its lower bound is reported */
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 99.0), 30 * MS);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 100.0), 30 * MS);
+
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 0.0), 0);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(dmh, 100.5), 0);
+	T_ASSERT_EQUAL(dm_histogram_get_percentile(NULL, 50.0), 0);
+
+	dm_free(dmh);
+}
+
+/* Region 0 areas counted 1:2:3:4 and 7:8:9:10, now only fast I/O */
+static const char _print_fast[] =
+	"0+1024 40 0 320 12 0 0 0 0 0 16 16 12 0 40:0:0:0\n"
+	"1024+1024 4 0 32 3 0 0 0 0 0 3 3 3 0 4:0:0:0\n";
+
+static void test_stats_percentile(void *fixture)
+{
+	struct dm_stats *dms = _stats(_list_layout, _print_layout);
+
+	/* Aggregate of 8:10:12:14 */
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 50.0, 0, DM_STATS_WALK_REGION), 30 * MS);
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 10.0, 0, DM_STATS_WALK_REGION), 10 * MS);
+	T_ASSERT_EQUAL(dm_stats_get_counter(dms, DM_STATS_READS_COUNT, 0, DM_STATS_WALK_REGION), 1005);
+
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 10.0, 0, 0), 10 * MS);
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 50.0, 0, 0), 30 * MS);
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 99.0, 0, 1), 30 * MS);
+
+	/* Region 1 has no areas to aggregate, nor bins below 5ms */
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 50.0, 1, 0), 5 * MS);
+
+	/* Populating the region again replaces the cached aggregates */
+	T_ASSERT(_dm_stats_populate_region(dms, 0, _print_fast));
+	T_ASSERT(!dms->regions[0].histogram);
+	T_ASSERT_EQUAL(dm_stats_get_histogram_percentile(dms, 99.0, 0, DM_STATS_WALK_REGION), 10 * MS);
+	T_ASSERT_EQUAL(dm_stats_get_counter(dms, DM_STATS_READS_COUNT, 0, DM_STATS_WALK_REGION), 44);
+
+	dm_stats_destroy(dms);
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/libdm/stats/" path, desc, fn)
+
+void stats_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(_fix_init, _fix_exit);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("stream-roundtrip", "stream returns the written counters and bins", test_stream_roundtrip);
+	T("stream-unchanged", "stream of unchanged values", test_stream_unchanged);
+	T("stream-layout-change", "stream with changed histogram bounds", test_stream_layout_change);
+	T("stream-truncated", "truncated stream is rejected", test_stream_truncated);
+	T("stream-bad-magic", "stream with bad header or record is rejected", test_stream_bad_magic);
+	T("stream-max-bins", "stream with too many bins is rejected", test_stream_max_bins);
+	T("diff-unchanged", "unchanged file extents keep their regions", test_diff_unchanged);
+	T("diff-insert", "new file extents need new regions", test_diff_insert);
+	T("diff-remove", "regions of released file extents are deleted", test_diff_remove);
+	T("diff-shift", "regions of moved or resized file extents are replaced", test_diff_shift);
+	T("diff-empty", "diff against no regions or no extents", test_diff_empty);
+	T("histogram-percentile", "percentiles of a known histogram", test_histogram_percentile);
+	T("stats-percentile", "percentiles of area and aggregate histograms", test_stats_percentile);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
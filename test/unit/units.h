@@ -23,14 +23,21 @@
 void bcache_tests(struct dm_list *suites);
 void bcache_utils_tests(struct dm_list *suites);
 void bitset_tests(struct dm_list *suites);
+void compress_tests(struct dm_list *suites);
 void config_tests(struct dm_list *suites);
+void dev_cache_tests(struct dm_list *suites);
+void dev_io_tests(struct dm_list *suites);
 void dm_list_tests(struct dm_list *suites);
 void dm_status_tests(struct dm_list *suites);
+void format_text_tests(struct dm_list *suites);
 void io_engine_tests(struct dm_list *suites);
+void log_ring_tests(struct dm_list *suites);
 void percent_tests(struct dm_list *suites);
 void radix_tree_tests(struct dm_list *suites);
 void regex_tests(struct dm_list *suites);
+void stats_tests(struct dm_list *suites);
 void string_tests(struct dm_list *suites);
+void uuid_tests(struct dm_list *suites);
 void vdo_tests(struct dm_list *suites);
 
 // ... and call it in here.
@@ -39,14 +46,21 @@ static inline void register_all_tests(struct dm_list *suites)
 	bcache_tests(suites);
 	bcache_utils_tests(suites);
 	bitset_tests(suites);
+	compress_tests(suites);
 	config_tests(suites);
+	dev_cache_tests(suites);
+	dev_io_tests(suites);
 	dm_list_tests(suites);
 	dm_status_tests(suites);
+	format_text_tests(suites);
 	io_engine_tests(suites);
+	log_ring_tests(suites);
 	percent_tests(suites);
 	radix_tree_tests(suites);
 	regex_tests(suites);
+	stats_tests(suites);
 	string_tests(suites);
+	uuid_tests(suites);
 	vdo_tests(suites);
 }
 
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2024 Red Hat, Inc. All rights reserved.
+ *
+ * This file is part of LVM2.
+ *
+ * This copyrighted material is made available to anyone wishing to use,
+ * modify, copy, or redistribute it subject to the terms and conditions
+ * of the GNU General Public License v.2.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "units.h"
+#include "lib/misc/lib.h"
+#include "lib/uuid/uuid.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//----------------------------------------------------------------
+
+/* More ids than fit into one random pool */
+#define NR_IDS 1000
+
+static void test_create_valid(void *fixture)
+{
+	static const char _chars[] =
+		"0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+	char buf[64];
+	struct id id, id2;
+	unsigned i, j;
+
+	for (i = 0; i < NR_IDS; i++) {
+		T_ASSERT(id_create(&id));
+		T_ASSERT(id_valid(&id));
+
+		/* Randomized ids never use the last 2 characters */
+		for (j = 0; j < ID_LEN; j++)
+			T_ASSERT(id.uuid[j] && strchr(_chars, id.uuid[j]));
+
+		T_ASSERT(id_write_format(&id, buf, sizeof(buf)));
+		T_ASSERT_EQUAL(strlen(buf), ID_LEN + 6);
+		T_ASSERT(id_read_format(&id2, buf));
+		T_ASSERT(id_equal(&id, &id2));
+	}
+}
+
+static void test_create_unique(void *fixture)
+{
+	struct id *ids;
+	unsigned i, j;
+
+	T_ASSERT(ids = malloc(NR_IDS * sizeof(*ids)));
+
+	for (i = 0; i < NR_IDS; i++) {
+		T_ASSERT(id_create(&ids[i]));
+		for (j = 0; j < i; j++)
+			T_ASSERT(!id_equal(&ids[i], &ids[j]));
+	}
+
+	free(ids);
+}
+
+static void test_create_after_fork(void *fixture)
+{
+	struct id parent, child;
+	int fds[2], status;
+	pid_t pid;
+
+	/* Fill the pool in parent */
+	T_ASSERT(id_create(&parent));
+
+	T_ASSERT(!pipe(fds));
+	T_ASSERT((pid = fork()) >= 0);
+
+	if (!pid) {
+		if (!id_create(&child) ||
+		    (write(fds[1], &child, sizeof(child)) != sizeof(child)))
+			_exit(1);
+		_exit(0);
+	}
+
+	(void) close(fds[1]);
+	T_ASSERT_EQUAL(read(fds[0], &child, sizeof(child)), sizeof(child));
+	(void) close(fds[0]);
+	T_ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+	T_ASSERT(WIFEXITED(status) && !WEXITSTATUS(status));
+
+	/* Child must not continue with the parent's pool */
+	T_ASSERT(id_create(&parent));
+	T_ASSERT(id_valid(&child));
+	T_ASSERT(!id_equal(&parent, &child));
+}
+
+//----------------------------------------------------------------
+
+#define T(path, desc, fn) register_test(ts, "/lib/uuid/" path, desc, fn)
+
+void uuid_tests(struct dm_list *all_tests)
+{
+	struct test_suite *ts = test_suite_create(NULL, NULL);
+	if (!ts) {
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	T("create-valid", "created ids have valid format", test_create_valid);
+	T("create-unique", "created ids do not repeat", test_create_unique);
+	T("create-after-fork", "forked child does not reuse parent's random pool", test_create_after_fork);
+
+	dm_list_add(all_tests, &ts->list);
+}
+
+//----------------------------------------------------------------
@@ -483,8 +483,20 @@ arg(metadataprofile_ARG, '\0', "metadataprofile", string_VAL, 0, 0,
     "See \\fBlvm.conf\\fP(5) for more information about profiles.\n")
 
 arg(metadatasize_ARG, '\0', "metadatasize", sizemb_VAL, 0, 0,
+    "#pvcreate\n"
+    "#vgcreate\n"
+    "#vgextend\n"
+    "#vgconvert\n"
     "The approximate amount of space used for each VG metadata area.\n"
-    "The size may be rounded.\n")
+    "The size may be rounded.\n"
+    "#pvresize\n"
+    "The new minimum size of the metadata area at the start of the PV.\n"
+    "The metadata area is grown online into the space up to the first\n"
+    "extent, and into as many following extents as needed, which must\n"
+    "be free (pvmove can move allocated ones.) The extents are removed\n"
+    "from the PV and the metadata area takes all space up to the new\n"
+    "first extent. The new size and the new metadata are committed\n"
+    "together with a single write of the metadata area header.\n")
 
 arg(minor_ARG, '\0', "minor", number_VAL, ARG_GROUPABLE, 0,
    "#lvcreate\n"
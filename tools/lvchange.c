@@ -1624,7 +1624,8 @@ int lvchange_activate_cmd(struct cmd_context *cmd, int argc, char **argv)
 	} else /* Component LVs might be active, support easy deactivation */
 		cmd->process_component_lvs = 1;
 
-	ret = process_each_lv(cmd, argc, argv, NULL, NULL, READ_FOR_ACTIVATE,
+	ret = process_each_lv(cmd, argc, argv, NULL, NULL,
+			      READ_FOR_ACTIVATE | (do_activate ? PROCESS_IMPORT_NAMED_LVS : 0),
 			      NULL, &_lvchange_activate_check, &_lvchange_activate_single);
 
 	if (ret != ECMD_PROCESSED)
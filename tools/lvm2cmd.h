@@ -70,6 +70,17 @@ void *lvm2_init_threaded(void);
  */
 void lvm2_disable_dmeventd_monitoring(void *handle);
 
+/*
+ * Keep device state between lvm2_run calls on this handle.
+ * The list of devices and their filtering is reused by the next command
+ * until the block devices on the system or the devices file change,
+ * so repeated commands do not list and filter all devices again.
+ * With obtain_device_list_from_udev, a udev monitor reports changed
+ * block devices, which are then updated without listing all devices.
+ * Non-zero enables, zero disables (default).
+ */
+void lvm2_incremental(void *handle, int enable);
+
 /*
  * Set log level (as above) if using built-in logging function. 
  * Default is LVM2_LOG_PRINT.  Use LVM2_LOG_SUPPRESS to suppress output.
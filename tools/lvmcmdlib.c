@@ -108,6 +108,16 @@ void lvm2_disable_dmeventd_monitoring(void *handle)
 	init_run_by_dmeventd((struct cmd_context *) handle);
 }
 
+void lvm2_incremental(void *handle, int enable)
+{
+	struct cmd_context *cmd = (struct cmd_context *) handle;
+
+	cmd->incremental = enable ? 1 : 0;
+
+	if (!enable)
+		label_scan_incremental_drop(cmd);
+}
+
 void lvm2_log_level(void *handle, int level)
 {
 	struct cmd_context *cmd = (struct cmd_context *) handle;
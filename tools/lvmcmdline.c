@@ -3344,6 +3344,9 @@ int lvm_run_command(struct cmd_context *cmd, int argc, char **argv)
 
       out:
 
+	if ((ret != ECMD_PROCESSED) && !log_ring_dump_to_file(cmd->cmd_line ? : "command failed"))
+		log_debug("Failed to write flight recorder file.");
+
 	dev_mpath_exit();
 	hints_exit(cmd);
 	lvmcache_destroy(cmd, 1, 1);
@@ -3802,6 +3805,8 @@ int lvm2_main(int argc, char **argv)
 	if (!(cmd = init_lvm(0, 0, 0)))
 		return EINIT_FAILED;
 
+	log_ring_catch_signals();
+
 	/* Store original argv location so we may customise it if we become a daemon */
 	cmd->argv = argv;
 
@@ -0,0 +1 @@
+command.c
\ No newline at end of file
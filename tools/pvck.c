@@ -19,6 +19,7 @@
 #include "lib/format_text/layout.h"
 #include "lib/mm/xlate.h"
 #include "lib/misc/crc.h"
+#include "lib/misc/lvm-compress.h"
 #include "lib/device/device_id.h"
 
 #define ONE_MB_IN_BYTES 1048576
@@ -394,6 +395,124 @@ static bool _read_bytes(struct device *dev, struct devicefile *def, uint64_t sta
 	return true;
 }
 
+static bool _read_ranges(struct device *dev, struct devicefile *def,
+			 const struct bcache_range *ranges, unsigned nr_ranges, void *data)
+{
+	unsigned i;
+
+	if (dev)
+		return dev_read_ranges(dev, ranges, nr_ranges, data);
+
+	for (i = 0; i < nr_ranges; i++) {
+		if (!_read_bytes(dev, def, ranges[i].start, ranges[i].len, data))
+			return false;
+		data = (char *)data + ranges[i].len;
+	}
+
+	return true;
+}
+
+/*
+ * Check the first lines of possible metadata for vgname, id and seqno.
+ *
+ * If a line looks like it begins with a vgname it could be a new copy
+ * of metadata, but it could also be a random bit of metadata that looks
+ * like a vgname, so confirm it's the start of metadata by looking for id
+ * and seqno lines following the possible vgname.
+ */
+static int _check_metadata_start(char *p, char *vgname, char *id_str, uint32_t *seqno)
+{
+	char line[MAX_LINE_CHECK];
+	int vgnamelen = 0;
+	int len;
+
+	/*
+	 * copy line of possible metadata to check for vgname
+	 */
+	memset(line, 0, sizeof(line));
+	_copy_line(p, line, &len, sizeof(line)-1);
+	p += len;
+
+	if (!_check_vgname_start(line, &vgnamelen))
+		return 0;
+
+	memcpy(vgname, line, vgnamelen);
+
+	/*
+	 * copy next line of metadata, which should contain id
+	 */
+	memset(line, 0, sizeof(line));
+	_copy_line(p, line, &len, sizeof(line)-1);
+	p += len;
+
+	if (strncmp(line, "id = ", 5))
+		return 0;
+
+	memcpy(id_str, line + 6, 38);
+
+	/*
+	 * copy next line of metadata, which should contain seqno
+	 */
+	memset(line, 0, sizeof(line));
+	_copy_line(p, line, &len, sizeof(line)-1);
+
+	if (strncmp(line, "seqno = ", 8))
+		return 0;
+	if (sscanf(line, "seqno = %u", seqno) != 1)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Compressed metadata (metadata/compress) begins at start in buf, and
+ * like text metadata it may wrap to the start of the text area.  Returns
+ * the decompressed text and the size of the compressed data.
+ */
+static int _copy_out_compressed(char *buf, uint32_t start, uint64_t mda_size,
+				char **text_buf, uint64_t *text_size, uint32_t *comp_size,
+				int *bad_end)
+{
+	uint64_t area_size = mda_size - 512;
+	uint64_t len_a = mda_size - start;
+	uint32_t size;
+	char *area, *text;
+
+	size = lz_uncompressed_size(buf + start, (uint32_t) len_a);
+
+	/* Text compresses less than 256 times */
+	if (!size || (size > area_size * 256))
+		return 0;
+
+	if (!(area = malloc(area_size)))
+		return 0;
+
+	memcpy(area, buf + start, len_a);
+	memcpy(area + len_a, buf + 512, start - 512);
+
+	if (!(text = zalloc((size_t) size + 1))) {
+		free(area);
+		return 0;
+	}
+
+	if (!(*comp_size = lz_decompress_prefix(area, (uint32_t) area_size, text, size))) {
+		free(text);
+		free(area);
+		return 0;
+	}
+
+	free(area);
+
+	/* \0 should be preceded by \n\n (0x0a0a) */
+	if (size < 3 || text[size-1] != 0 || text[size-2] != 0x0a || text[size-3] != 0x0a)
+		*bad_end = 1;
+
+	*text_buf = text;
+	*text_size = size;
+
+	return 1;
+}
+
 /* all sizes and offsets in bytes */
 
 static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const char *tofile,
@@ -401,7 +520,6 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 			  int mda_num, uint64_t mda_offset, uint64_t mda_size, char *buf)
 {
 	FILE *fp = NULL;
-	char line[MAX_LINE_CHECK];
 	char vgname[NAME_LEN+1];
 	char id_str[ID_STR_SIZE];
 	char id_first[ID_STR_SIZE];
@@ -411,13 +529,13 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 	uint32_t buf_off_first = 0;
 	uint32_t seqno;
 	uint32_t crc;
+	uint32_t comp_size; /* bytes */
 	uint64_t text_size; /* bytes */
 	uint64_t meta_size; /* bytes */
 	int print_count = 0;
 	int one_found = 0;
 	int multiple_vgs = 0;
 	int bad_end;
-	int vgnamelen;
 	unsigned count;
 	int len;
 
@@ -462,7 +580,6 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		memset(vgname, 0, sizeof(vgname));
 		memset(id_str, 0, sizeof(id_str));
 		seqno = 0;
-		vgnamelen = 0;
 		text_size = 0;
 		bad_end = 0;
 
@@ -473,13 +590,6 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		 * Check for a new metadata copy at each 512 offset
 		 * (after skipping 512 bytes for mda_header at the
 		 * start of the buf).
-		 *
-		 * If a line looks like it begins with a vgname
-		 * it could be a new copy of metadata, but it could
-		 * also be a random bit of metadata that looks like
-		 * a vgname, so confirm it's the start of metadata
-		 * by looking for id and seqno lines following the
-		 * possible vgname.
 		 */
 		buf_off = 512 + (count * 512);
 		p = buf + buf_off;
@@ -495,45 +605,25 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 			one_found = 1;
 
 		/*
-		 * copy line of possible metadata to check for vgname
-		 */
-		memset(line, 0, sizeof(line));
-		_copy_line(p, line, &len, sizeof(line)-1);
-		p += len;
-
-		if (!_check_vgname_start(line, &vgnamelen)) {
-			count++;
-			continue;
-		}
-
-		memcpy(vgname, line, vgnamelen);
-
-		/*
-		 * copy next line of metadata, which should contain id
+		 * A compressed copy (metadata/compress) begins with the
+		 * compression header, and is decompressed to check the
+		 * text like uncompressed copies.
 		 */
-		memset(line, 0, sizeof(line));
-		_copy_line(p, line, &len, sizeof(line)-1);
-		p += len;
-
-		if (strncmp(line, "id = ", 5)) {
-			count++;
-			continue;
+		comp_size = 0;
+		if (lz_uncompressed_size(p, 512)) {
+			if (!_copy_out_compressed(buf, buf_off, mda_size, &text_buf, &text_size,
+						  &comp_size, &bad_end)) {
+				log_warn("Failed to decompress metadata text at %llu, skipping.",
+					 (unsigned long long)(mda_offset + buf_off));
+				count++;
+				continue;
+			}
+			p = text_buf;
 		}
 
-		memcpy(id_str, line + 6, 38);
-
-		/*
-		 * copy next line of metadata, which should contain seqno
-		 */
-		memset(line, 0, sizeof(line));
-		_copy_line(p, line, &len, sizeof(line)-1);
-		p += len;
-
-		if (strncmp(line, "seqno = ", 8)) {
-			count++;
-			continue;
-		}
-		if (sscanf(line, "seqno = %u", &seqno) != 1) {
+		if (!_check_metadata_start(p, vgname, id_str, &seqno)) {
+			free(text_buf);
+			text_buf = NULL;
 			count++;
 			continue;
 		}
@@ -544,6 +634,8 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		 * can have the same seqno; this is mostly to simplify testing)
 		 */
 		if (set->seqno_set && (set->seqno != seqno)) {
+			free(text_buf);
+			text_buf = NULL;
 			count++;
 			continue;
 		}
@@ -560,7 +652,8 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		 * a NL or until it reaches buf_off_first (which is
 		 * where we've already taken text from.)
 		 */
-		_copy_out_metadata(buf, buf_off, buf_off_first, mda_size, &text_buf, &text_size, &bad_end);
+		if (!text_buf)
+			_copy_out_metadata(buf, buf_off, buf_off_first, mda_size, &text_buf, &text_size, &bad_end);
 
 		if (!text_buf) {
 			log_warn("Failed to extract full metadata text at %llu, skipping.",
@@ -579,10 +672,16 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 
 		crc = calc_crc(INITIAL_CRC, (uint8_t *)text_buf, text_size);
 
-		log_print("metadata at %llu length %llu crc %08x vg %s seqno %u id %s",
-			  (unsigned long long)(mda_offset + buf_off),
-			  (unsigned long long)text_size,
-			  crc, vgname, seqno, id_str);
+		if (comp_size)
+			log_print("metadata at %llu length %llu crc %08x vg %s seqno %u id %s compressed length %u",
+				  (unsigned long long)(mda_offset + buf_off),
+				  (unsigned long long)text_size,
+				  crc, vgname, seqno, id_str, comp_size);
+		else
+			log_print("metadata at %llu length %llu crc %08x vg %s seqno %u id %s",
+				  (unsigned long long)(mda_offset + buf_off),
+				  (unsigned long long)text_size,
+				  crc, vgname, seqno, id_str);
 
 		/*
 		 * save the location of the first metadata we've found so
@@ -627,6 +726,10 @@ static int _dump_all_text(struct cmd_context *cmd, struct settings *set, const c
 		free(text_buf);
 		text_buf = NULL;
 
+		/* The next copy follows the data on disk */
+		if (comp_size)
+			text_size = comp_size;
+
 		if (text_size < 512)
 			count++;
 		else if (!(text_size % 512))
@@ -717,6 +820,22 @@ static int _check_pv_header(struct pv_header *ph)
  * mda_offset/mda_size are from the pv_header/disk_locn and could
  * be incorrect.
  */
+/*
+ * An mda_header pointing to compressed metadata has a higher version,
+ * which older lvm versions reject.
+ */
+static uint32_t _mda_header_version(struct mda_header *mh)
+{
+	struct raw_locn *rlocn = mh->raw_locns;
+	int i;
+
+	for (i = 0; i < 2 && xlate64(rlocn[i].offset); i++)
+		if (xlate32(rlocn[i].flags) & RAW_LOCN_COMPRESSED)
+			return FMTT_VERSION_COMPRESSED;
+
+	return FMTT_VERSION;
+}
+
 static int _check_mda_header(struct mda_header *mh, int mda_num, uint64_t mda_offset, uint64_t mda_size, int *found_header)
 {
 	char str[256];
@@ -738,8 +857,8 @@ static int _check_mda_header(struct mda_header *mh, int mda_num, uint64_t mda_of
 		bad++;
 	}
 
-	if (xlate32(mh->version) != FMTT_VERSION) {
-		log_print("CHECK: mda_header_%d.version expected %u", mda_num, FMTT_VERSION);
+	if (xlate32(mh->version) != _mda_header_version(mh)) {
+		log_print("CHECK: mda_header_%d.version expected %u", mda_num, _mda_header_version(mh));
 		bad++;
 	}
 
@@ -777,7 +896,8 @@ static int _dump_raw_locn(struct device *dev, struct devicefile *def, int print_
 			  int mda_num, uint64_t mda_offset, uint64_t mda_size,
 			  uint64_t *meta_offset_ret,
 			  uint64_t *meta_size_ret,
-			  uint32_t *meta_checksum_ret)
+			  uint32_t *meta_checksum_ret,
+			  uint32_t *meta_flags_ret)
 {
 	uint64_t meta_offset, meta_size;
 	uint32_t meta_checksum;
@@ -803,6 +923,8 @@ static int _dump_raw_locn(struct device *dev, struct devicefile *def, int print_
 
 		if (meta_flags & RAW_LOCN_IGNORED)
 			log_print("mda_header_%d.raw_locn[%d].flags 0x%x # RAW_LOCN_IGNORED", mn, ri, meta_flags);
+		else if (meta_flags & RAW_LOCN_COMPRESSED)
+			log_print("mda_header_%d.raw_locn[%d].flags 0x%x # RAW_LOCN_COMPRESSED", mn, ri, meta_flags);
 		else
 			log_print("mda_header_%d.raw_locn[%d].flags 0x%x", mn, ri, meta_flags);
 	}
@@ -832,6 +954,8 @@ static int _dump_raw_locn(struct device *dev, struct devicefile *def, int print_
 		*meta_size_ret = meta_size;
 	if (meta_checksum_ret)
 		*meta_checksum_ret = meta_checksum;
+	if (meta_flags_ret)
+		*meta_flags_ret = meta_flags;
 
 	/* No text metadata exists in this metadata area. */
 	if (!meta_offset)
@@ -890,9 +1014,10 @@ static int _dump_current_text(struct device *dev, struct devicefile *def,
 			      int mda_num, int rlocn_index,
 			      uint64_t mda_offset, uint64_t mda_size,
 			      uint64_t meta_offset, uint64_t meta_size,
-			      uint32_t meta_checksum)
+			      uint32_t meta_checksum, uint32_t meta_flags)
 {
-	char *meta_buf;
+	char *meta_buf, *text_buf = NULL;
+	uint32_t text_size;
 	struct dm_config_tree *cft;
 	char *vgname = NULL;
 	uint32_t crc;
@@ -922,18 +1047,15 @@ static int _dump_current_text(struct device *dev, struct devicefile *def,
 		uint32_t size_a = meta_size - wrap;
 		off_t offset_b = mda_offset + 512; /* continues after mda_header sector */
 		uint32_t size_b = wrap;
+		struct bcache_range ranges[2] = {
+			{ .start = offset_a, .len = size_a },
+			{ .start = offset_b, .len = size_b }
+		};
 
-		if (!_read_bytes(dev, def, offset_a, size_a, meta_buf)) {
-			log_print("CHECK: failed to read metadata text at mda_header_%d.raw_locn[%d].offset %llu size %llu part_a %llu %llu", mn, ri,
-				  (unsigned long long)meta_offset, (unsigned long long)meta_size,
-				  (unsigned long long)offset_a, (unsigned long long)size_a);
-			free(meta_buf);
-			return 0;
-		}
-
-		if (!_read_bytes(dev, def, offset_b, size_b, meta_buf + size_a)) {
-			log_print("CHECK: failed to read metadata text at mda_header_%d.raw_locn[%d].offset %llu size %llu part_b %llu %llu", mn, ri,
+		if (!_read_ranges(dev, def, ranges, 2, meta_buf)) {
+			log_print("CHECK: failed to read metadata text at mda_header_%d.raw_locn[%d].offset %llu size %llu part_a %llu %llu part_b %llu %llu", mn, ri,
 				  (unsigned long long)meta_offset, (unsigned long long)meta_size,
+				  (unsigned long long)offset_a, (unsigned long long)size_a,
 				  (unsigned long long)offset_b, (unsigned long long)size_b);
 			free(meta_buf);
 			return 0;
@@ -955,6 +1077,25 @@ static int _dump_current_text(struct device *dev, struct devicefile *def,
 		bad++;
 	}
 
+	/* The checksum covers the compressed data, the text is decompressed. */
+	if (meta_flags & RAW_LOCN_COMPRESSED) {
+		if (!(text_size = lz_uncompressed_size(meta_buf, (uint32_t) meta_size)) ||
+		    !(text_buf = malloc((size_t) text_size + 1)) ||
+		    !lz_decompress(meta_buf, (uint32_t) meta_size, text_buf, text_size)) {
+			log_print("CHECK: failed to decompress metadata text at %llu size %llu",
+				  (unsigned long long)(mda_offset + meta_offset),
+				  (unsigned long long)meta_size);
+			free(text_buf);
+			free(meta_buf);
+			return 0;
+		}
+
+		free(meta_buf);
+		meta_buf = text_buf;
+		meta_size = text_size;
+		meta_buf[meta_size] = 0;
+	}
+
 	if (!(cft = config_open(CONFIG_FILE_SPECIAL, NULL, 0))) {
 		log_print("CHECK: failed to set up metadata parsing");
 		bad++;
@@ -1275,6 +1416,7 @@ static int _dump_mda_header(struct cmd_context *cmd, struct settings *set,
 	uint64_t meta_offset = 0; /* bytes */
 	uint64_t meta_size = 0;   /* bytes */
 	uint32_t meta_checksum = 0;
+	uint32_t meta_flags = 0;
 	int mda_num = (mda_offset <= 65536) ? 1 : 2;
 	int bad = 0;
 
@@ -1334,7 +1476,7 @@ static int _dump_mda_header(struct cmd_context *cmd, struct settings *set,
 	meta_checksum = 0;
 
 	if (!_dump_raw_locn(dev, def, print_fields, rlocn0, 0, rlocn0_offset, mda_num, mda_offset, mda_size,
-			    &meta_offset, &meta_size, &meta_checksum))
+			    &meta_offset, &meta_size, &meta_checksum, &meta_flags))
 		bad++;
 
 	*checksum0_ret = meta_checksum;
@@ -1347,7 +1489,7 @@ static int _dump_mda_header(struct cmd_context *cmd, struct settings *set,
 		log_print("CHECK: problem with rlocn1 offset calculation");
 
 	if (!_dump_raw_locn(dev, def, print_fields, rlocn1, 1, rlocn1_offset, mda_num, mda_offset, mda_size,
-			   NULL, NULL, NULL))
+			   NULL, NULL, NULL, NULL))
 		bad++;
 
 	if (!meta_offset)
@@ -1357,7 +1499,7 @@ static int _dump_mda_header(struct cmd_context *cmd, struct settings *set,
 	 * looking at the current copy of metadata referenced by raw_locn
 	 */
 	if (print_metadata <= PRINT_CURRENT) {
-		if (!_dump_current_text(dev, def, print_fields, print_metadata, tofile, mda_num, 0, mda_offset, mda_size, meta_offset, meta_size, meta_checksum))
+		if (!_dump_current_text(dev, def, print_fields, print_metadata, tofile, mda_num, 0, mda_offset, mda_size, meta_offset, meta_size, meta_checksum, meta_flags))
 			bad++;
 	}
 
@@ -2117,9 +2259,12 @@ static int _check_for_mda2(struct cmd_context *cmd, struct device *dev,
 {
 	struct mda_header *mh;
 	char buf2[256];
-	char *buf;
+	char *buf, *text_buf;
 	uint64_t mda_offset, mda_size, extra_bytes; /* bytes */
+	uint64_t text_size;
+	uint32_t off, comp_size;
 	unsigned i, found = 0;
+	int bad_end;
 
 	if (device_size < (2 * ONE_MB_IN_BYTES))
 		return_0;
@@ -2144,7 +2289,8 @@ static int _check_for_mda2(struct cmd_context *cmd, struct device *dev,
 	if (memcmp(mh->magic, FMTT_MAGIC, sizeof(mh->magic)))
 		goto fail;
 
-	if (xlate32(mh->version) != FMTT_VERSION) {
+	if ((xlate32(mh->version) != FMTT_VERSION) &&
+	    (xlate32(mh->version) != FMTT_VERSION_COMPRESSED)) {
 		log_print("Skipping mda2 (wrong mda_header.version)");
 		goto fail;
 	}
@@ -2162,10 +2308,20 @@ static int _check_for_mda2(struct cmd_context *cmd, struct device *dev,
 	 * still exist, while the current PV does not use an mda2.
 	 *
 	 * Search for the vgid in the first 256 bytes at each 512 byte boundary
-	 * in the first half of the metadata area.
+	 * in the first half of the metadata area.  Compressed metadata
+	 * (metadata/compress) is searched decompressed.
 	 */
 	for (i = 0; i < (mda_size / 1024); i++) {
-		memcpy(buf2, buf + 512 + (i * 512), sizeof(buf2));
+		off = 512 + (i * 512);
+		memset(buf2, 0, sizeof(buf2));
+
+		if (lz_uncompressed_size(buf + off, 512) &&
+		    _copy_out_compressed(buf, off, mda_size, &text_buf, &text_size,
+					 &comp_size, &bad_end)) {
+			memcpy(buf2, text_buf, (text_size < sizeof(buf2)) ? text_size : sizeof(buf2));
+			free(text_buf);
+		} else
+			memcpy(buf2, buf + off, sizeof(buf2));
 
 		if (strstr(buf2, mf->vgid_str)) {
 			log_print("Found mda2 header at offset %llu size %llu",
@@ -18,6 +18,7 @@
 
 struct pvresize_params {
 	uint64_t new_size;
+	uint64_t mda_size;
 
 	unsigned done;
 	unsigned total;
@@ -46,7 +47,10 @@ static int _pvresize_single(struct cmd_context *cmd,
 			return_ECMD_FAILED;
 	}
 
-	if (!pv_resize_single(cmd, vg, pv, params->new_size, arg_is_set(cmd, yes_ARG)))
+	if (arg_is_set(cmd, metadatasize_ARG)) {
+		if (!pv_grow_metadata_area(cmd, vg, pv, params->mda_size))
+			return_ECMD_FAILED;
+	} else if (!pv_resize_single(cmd, vg, pv, params->new_size, arg_is_set(cmd, yes_ARG)))
 		return_ECMD_FAILED;
 
 	params->done++;
@@ -72,8 +76,15 @@ int pvresize(struct cmd_context *cmd, int argc, char **argv)
 		goto out;
 	}
 
+	if (arg_sign_value(cmd, metadatasize_ARG, SIGN_NONE) == SIGN_MINUS) {
+		log_error("Metadata size may not be negative");
+		ret = EINVALID_CMD_LINE;
+		goto out;
+	}
+
 	params.new_size = arg_uint64_value(cmd, setphysicalvolumesize_ARG,
 					   UINT64_C(0));
+	params.mda_size = arg_uint64_value(cmd, metadatasize_ARG, UINT64_C(0));
 
 	params.done = 0;
 	params.total = 0;
@@ -3939,7 +3939,17 @@ static int _process_lv_vgnameid_list(struct cmd_context *cmd, uint32_t read_flag
 			continue;
 		}
 
+		/*
+		 * Activating only named LVs does not need the other LVs
+		 * of the VG imported (metadata/selective_import).
+		 */
+		if ((read_flags & PROCESS_IMPORT_NAMED_LVS) && cmd->selective_import &&
+		    !dm_list_empty(&lvnames) && (!tags_arg || dm_list_empty(tags_arg)) &&
+		    !handle->selection_handle)
+			cmd->import_lv_names = &lvnames;
+
 		vg = vg_read(cmd, vg_name, vg_uuid, read_flags, lockd_state, &error_flags, &error_vg);
+		cmd->import_lv_names = NULL;
 		if (_ignore_vg(cmd, error_flags, error_vg, vg_name, arg_vgnames, read_flags, &skip, &notfound)) {
 			stack;
 			ret_max = ECMD_FAILED;
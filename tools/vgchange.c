@@ -33,6 +33,10 @@ static int _monitor_lvs_in_vg(struct cmd_context *cmd,
 	struct logical_volume *lv;
 	int r = 1;
 
+	/* (Un)register all LVs of the VG with dmeventd in one request */
+	if (!monitor_dev_for_events_batch(cmd))
+		return_0;
+
 	dm_list_iterate_items(lvl, &vg->lvs) {
 		lv = lvl->lv;
 
@@ -53,6 +57,9 @@ static int _monitor_lvs_in_vg(struct cmd_context *cmd,
 		(*count)++;
 	}
 
+	if (!monitor_dev_for_events_flush(cmd))
+		r = 0;
+
 	return r;
 }
 
@@ -274,11 +281,17 @@ int vgchange_activate(struct cmd_context *cmd, struct volume_group *vg,
 		}
 	}
 
+	/* Check pool metadata in parallel, failures leave it for each activation */
+	if (do_activate && !activation_check_pools(cmd, vg))
+		stack;
+
 	if (!_activate_lvs_in_vg(cmd, vg, activate)) {
 		stack;
 		r = 0;
 	}
 
+	activation_check_pools_release(cmd);
+
 	/* Print message only if there was not found a missing VG */
 	log_print_unless_silent("%d logical volume(s) in volume group \"%s\" now active",
 				lvs_in_vg_activated(vg), vg->name);